@@ -865,7 +865,7 @@ void duDebugDrawPolyMesh(duDebugDraw* dd, const struct rcPolyMesh& mesh)
 	
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
-		const unsigned short* p = &mesh.polys[i*nvp*2];
+		const rcMeshIndex* p = &mesh.polys[i*nvp*2];
 		const unsigned char area = mesh.areas[i];
 		
 		unsigned int color;
@@ -876,7 +876,7 @@ void duDebugDrawPolyMesh(duDebugDraw* dd, const struct rcPolyMesh& mesh)
 		else
 			color = dd->areaToCol(area);
 		
-		unsigned short vi[3];
+		rcMeshIndex vi[3];
 		for (int j = 2; j < nvp; ++j)
 		{
 			if (p[j] == RC_MESH_NULL_IDX) break;
@@ -885,7 +885,7 @@ void duDebugDrawPolyMesh(duDebugDraw* dd, const struct rcPolyMesh& mesh)
 			vi[2] = p[j];
 			for (int k = 0; k < 3; ++k)
 			{
-				const unsigned short* v = &mesh.verts[vi[k]*3];
+				const rcMeshIndex* v = &mesh.verts[vi[k]*3];
 				const float x = orig[0] + v[0]*cs;
 				const float y = orig[1] + (v[1]+1)*ch;
 				const float z = orig[2] + v[2]*cs;
@@ -900,17 +900,17 @@ void duDebugDrawPolyMesh(duDebugDraw* dd, const struct rcPolyMesh& mesh)
 	dd->begin(DU_DRAW_LINES, 1.5f);
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
-		const unsigned short* p = &mesh.polys[i*nvp*2];
+		const rcMeshIndex* p = &mesh.polys[i*nvp*2];
 		for (int j = 0; j < nvp; ++j)
 		{
 			if (p[j] == RC_MESH_NULL_IDX) break;
-			if (p[nvp+j] & 0x8000) continue;
+			if (p[nvp+j] & RC_MESH_PORTAL_FLAG) continue;
 			const int nj = (j+1 >= nvp || p[j+1] == RC_MESH_NULL_IDX) ? 0 : j+1; 
-			const int vi[2] = {p[j], p[nj]};
+			const int vi[2] = {(int)p[j], (int)p[nj]};
 			
 			for (int k = 0; k < 2; ++k)
 			{
-				const unsigned short* v = &mesh.verts[vi[k]*3];
+				const rcMeshIndex* v = &mesh.verts[vi[k]*3];
 				const float x = orig[0] + v[0]*cs;
 				const float y = orig[1] + (v[1]+1)*ch + 0.1f;
 				const float z = orig[2] + v[2]*cs;
@@ -925,20 +925,20 @@ void duDebugDrawPolyMesh(duDebugDraw* dd, const struct rcPolyMesh& mesh)
 	dd->begin(DU_DRAW_LINES, 2.5f);
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
-		const unsigned short* p = &mesh.polys[i*nvp*2];
+		const rcMeshIndex* p = &mesh.polys[i*nvp*2];
 		for (int j = 0; j < nvp; ++j)
 		{
 			if (p[j] == RC_MESH_NULL_IDX) break;
-			if ((p[nvp+j] & 0x8000) == 0) continue;
+			if ((p[nvp+j] & RC_MESH_PORTAL_FLAG) == 0) continue;
 			const int nj = (j+1 >= nvp || p[j+1] == RC_MESH_NULL_IDX) ? 0 : j+1; 
-			const int vi[2] = {p[j], p[nj]};
+			const int vi[2] = {(int)p[j], (int)p[nj]};
 			
 			unsigned int col = colb;
 			if ((p[nvp+j] & 0xf) != 0xf)
 				col = duRGBA(255,255,255,128);
 			for (int k = 0; k < 2; ++k)
 			{
-				const unsigned short* v = &mesh.verts[vi[k]*3];
+				const rcMeshIndex* v = &mesh.verts[vi[k]*3];
 				const float x = orig[0] + v[0]*cs;
 				const float y = orig[1] + (v[1]+1)*ch + 0.1f;
 				const float z = orig[2] + v[2]*cs;
@@ -952,7 +952,7 @@ void duDebugDrawPolyMesh(duDebugDraw* dd, const struct rcPolyMesh& mesh)
 	const unsigned int colv = duRGBA(0,0,0,220);
 	for (int i = 0; i < mesh.nverts; ++i)
 	{
-		const unsigned short* v = &mesh.verts[i*3];
+		const rcMeshIndex* v = &mesh.verts[i*3];
 		const float x = orig[0] + v[0]*cs;
 		const float y = orig[1] + (v[1]+1)*ch + 0.1f;
 		const float z = orig[2] + v[2]*cs;
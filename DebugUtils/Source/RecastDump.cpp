@@ -65,7 +65,7 @@ bool duDumpPolyMeshToObj(rcPolyMesh& pmesh, duFileIO* io)
 	
 	for (int i = 0; i < pmesh.nverts; ++i)
 	{
-		const unsigned short* v = &pmesh.verts[i*3];
+		const rcMeshIndex* v = &pmesh.verts[i*3];
 		const float x = orig[0] + v[0]*cs;
 		const float y = orig[1] + (v[1]+1)*ch + 0.1f;
 		const float z = orig[2] + v[2]*cs;
@@ -76,7 +76,7 @@ bool duDumpPolyMeshToObj(rcPolyMesh& pmesh, duFileIO* io)
 
 	for (int i = 0; i < pmesh.npolys; ++i)
 	{
-		const unsigned short* p = &pmesh.polys[i*nvp*2];
+		const rcMeshIndex* p = &pmesh.polys[i*nvp*2];
 		for (int j = 2; j < nvp; ++j)
 		{
 			if (p[j] == RC_MESH_NULL_IDX) break;
@@ -411,6 +411,13 @@ static void logLine(rcContext& ctx, rcTimerLabel label, const char* name, const
 {
 	const int t = ctx.getAccumulatedTime(label);
 	if (t < 0) return;
+	rcMemoryStats mem;
+	if (ctx.getMemoryStats(label, mem) && (mem.perm.allocCount > 0 || mem.temp.allocCount > 0))
+	{
+		ctx.log(RC_LOG_PROGRESS, "%s:\t%.2fms\t(%.1f%%)\tpeak %.1fMB perm, %.1fMB temp",
+				name, t/1000.0f, t*pc, mem.perm.peakBytes/(1024.0f*1024.0f), mem.temp.peakBytes/(1024.0f*1024.0f));
+		return;
+	}
 	ctx.log(RC_LOG_PROGRESS, "%s:\t%.2fms\t(%.1f%%)", name, t/1000.0f, t*pc);
 }
 
@@ -423,11 +430,13 @@ void duLogBuildTimes(rcContext& ctx, const int totalTimeUsec)
 	logLine(ctx, RC_TIMER_BUILD_COMPACTHEIGHTFIELD,	"- Build Compact", pc);
 	logLine(ctx, RC_TIMER_FILTER_BORDER,				"- Filter Border", pc);
 	logLine(ctx, RC_TIMER_FILTER_WALKABLE,			"- Filter Walkable", pc);
+	logLine(ctx, RC_TIMER_FILTER_SPANS,				"- Filter Spans", pc);
 	logLine(ctx, RC_TIMER_ERODE_AREA,				"- Erode Area", pc);
 	logLine(ctx, RC_TIMER_MEDIAN_AREA,				"- Median Area", pc);
 	logLine(ctx, RC_TIMER_MARK_BOX_AREA,				"- Mark Box Area", pc);
 	logLine(ctx, RC_TIMER_MARK_CONVEXPOLY_AREA,		"- Mark Convex Area", pc);
 	logLine(ctx, RC_TIMER_MARK_CYLINDER_AREA,		"- Mark Cylinder Area", pc);
+	logLine(ctx, RC_TIMER_MARK_AREA_VOLUMES,		"- Mark Area Volumes", pc);
 	logLine(ctx, RC_TIMER_BUILD_DISTANCEFIELD,		"- Build Distance Field", pc);
 	logLine(ctx, RC_TIMER_BUILD_DISTANCEFIELD_DIST,	"    - Distance", pc);
 	logLine(ctx, RC_TIMER_BUILD_DISTANCEFIELD_BLUR,	"    - Blur", pc);
@@ -19,6 +19,15 @@
 #ifndef RECAST_H
 #define RECAST_H
 
+#include <stddef.h>
+
+// Undefine (or define in a build config) the following line to use 32bit
+// vertex and polygon indices in rcPolyMesh. Needed when a single (solo) mesh
+// exceeds 65535 vertices or polygons, e.g. very large worlds at a small cell size.
+// Note: Detour tiles require 16bit indices, so meshes built with 32bit indices
+// cannot be passed to dtCreateNavMeshData directly.
+//#define RC_POLYMESH_INDEX32 1
+
 /// The value of PI used by Recast.
 static const float RC_PI = 3.14159265f;
 
@@ -42,7 +51,7 @@ enum rcTimerLabel
 	RC_TIMER_TOTAL,
 	/// A user defined build time.
 	RC_TIMER_TEMP,
-	/// The time to rasterize the triangles. (See: #rcRasterizeTriangle)
+	/// The time to rasterize the triangles. (See: #rcRasterizeTriangle, #rcRasterizeHeightmap)
 	RC_TIMER_RASTERIZE_TRIANGLES,
 	/// The time to build the compact heightfield. (See: #rcBuildCompactHeightfield)
 	RC_TIMER_BUILD_COMPACTHEIGHTFIELD,
@@ -94,10 +103,39 @@ enum rcTimerLabel
 	RC_TIMER_BUILD_POLYMESHDETAIL,
 	/// The time to merge polygon mesh details. (See: #rcMergePolyMeshDetails)
 	RC_TIMER_MERGE_POLYMESHDETAIL,
+	/// The time to mark a set of area volumes. (See: #rcMarkAreaVolumes)
+	RC_TIMER_MARK_AREA_VOLUMES,
+	/// The time to apply the combined span filters. (See: #rcFilterWalkableSpans)
+	RC_TIMER_FILTER_SPANS,
 	/// The maximum number of timers.  (Used for iterating timers.)
 	RC_MAX_TIMERS
 };
 
+/// A function that processes a range of work items for rcContext::parallelFor.
+///  @param[in]		userData	The user data passed to rcContext::parallelFor.
+///  @param[in]		begin		The index of the first item in the range.
+///  @param[in]		end			The index one past the last item in the range.
+///  @param[in]		threadIndex	The index of the thread executing the range. [Limits: 0 <= value < rcContext::getMaxThreads()]
+///  @see rcContext::parallelFor
+typedef void (rcParallelForFunc)(void* userData, int begin, int end, int threadIndex);
+
+/// The memory usage of the allocations of one kind made during a build step.
+/// @see rcMemoryStats
+struct rcMemoryUsage
+{
+	size_t currentBytes;	///< The number of bytes allocated that have not been freed yet.
+	size_t peakBytes;		///< The highest number of bytes of this kind in use by the whole build at one of the allocations.
+	int allocCount;			///< The number of allocations.
+};
+
+/// The memory usage of a build step, split by allocation hint.
+/// @see rcContext::getMemoryStats
+struct rcMemoryStats
+{
+	rcMemoryUsage perm;		///< The #RC_ALLOC_PERM allocations.
+	rcMemoryUsage temp;		///< The #RC_ALLOC_TEMP allocations.
+};
+
 /// Provides an interface for optional logging and performance tracking of the Recast 
 /// build process.
 /// 
@@ -109,6 +147,11 @@ enum rcTimerLabel
 ///
 /// If no logging or timers are required, just pass an instance of this 
 /// class through the Recast build process.
+///
+/// Some build steps can split their work over several threads. By default the
+/// work is executed serially on the calling thread. A concrete implementation
+/// can hook up its own job system by overriding #doGetMaxThreads and #doParallelFor.
+/// Such an implementation must also make #doLog safe to call from several threads.
 /// 
 /// @ingroup recast
 class rcContext
@@ -158,6 +201,33 @@ public:
 	/// @return The accumulated time of the timer, or -1 if timers are disabled or the timer has never been started.
 	inline int getAccumulatedTime(const rcTimerLabel label) const { return m_timerEnabled ? doGetAccumulatedTime(label) : -1; }
 
+	/// Returns the memory usage of the allocations made while the specified timer was the innermost
+	/// running timer of the allocating thread.
+	/// @param	label	The category of the timer.
+	/// @param	stats	The memory usage of the timer.
+	/// @return True if timers are enabled and the implementation tracks memory.
+	inline bool getMemoryStats(const rcTimerLabel label, rcMemoryStats& stats) const { return m_timerEnabled && doGetMemoryStats(label, stats); }
+
+	/// Returns the maximum number of threads #parallelFor may use at the same time.
+	/// Build steps use this to allocate per-thread scratch memory.
+	/// @return The maximum number of threads. [Limit: >= 1]
+	inline int getMaxThreads() const { const int n = doGetMaxThreads(); return n > 1 ? n : 1; }
+
+	/// Calls @p func for disjoint ranges that together cover [0, @p count), and
+	/// returns when all ranges have been processed.
+	///  @param[in]		count		The number of work items.
+	///  @param[in]		func		The function to call for each range.
+	///  @param[in]		userData	User data passed to @p func.
+	inline void parallelFor(const int count, rcParallelForFunc* func, void* userData)
+	{
+		if (count <= 0)
+			return;
+		if (getMaxThreads() == 1)
+			func(userData, 0, count, 0);
+		else
+			doParallelFor(count, func, userData);
+	}
+
 protected:
 	/// Clears all log entries.
 	virtual void doResetLog();
@@ -183,6 +253,23 @@ protected:
 	/// @param[in]		label	The category of the timer.
 	/// @return The accumulated time of the timer, or -1 if timers are disabled or the timer has never been started.
 	virtual int doGetAccumulatedTime(const rcTimerLabel label) const { rcIgnoreUnused(label); return -1; }
+
+	/// Returns the memory usage of the allocations made while the specified timer was running.
+	/// @param[in]		label	The category of the timer.
+	/// @param[out]		stats	The memory usage of the timer.
+	/// @return True if the implementation tracks memory.
+	virtual bool doGetMemoryStats(const rcTimerLabel label, rcMemoryStats& stats) const { rcIgnoreUnused(label); rcIgnoreUnused(stats); return false; }
+
+	/// Returns the maximum number of threads #doParallelFor may use at the same time.
+	/// @return The maximum number of threads.
+	virtual int doGetMaxThreads() const { return 1; }
+
+	/// Calls @p func for disjoint ranges that together cover [0, @p count).
+	/// Every thread must pass a distinct thread index in [0, #doGetMaxThreads()) to @p func.
+	///  @param[in]		count		The number of work items. [Limit: > 0]
+	///  @param[in]		func		The function to call for each range.
+	///  @param[in]		userData	User data passed to @p func.
+	virtual void doParallelFor(const int count, rcParallelForFunc* func, void* userData) { func(userData, 0, count, 0); }
 	
 	/// True if logging is enabled.
 	bool m_logEnabled;
@@ -451,6 +538,14 @@ private:
 	rcContourSet& operator=(const rcContourSet&);
 };
 
+/// The integer type used for the vertex coordinates and polygon indices of rcPolyMesh.
+/// @ingroup recast
+#ifdef RC_POLYMESH_INDEX32
+typedef unsigned int rcMeshIndex;
+#else
+typedef unsigned short rcMeshIndex;
+#endif
+
 /// Represents a polygon mesh suitable for use in building a navigation mesh. 
 /// @ingroup recast
 struct rcPolyMesh
@@ -458,8 +553,8 @@ struct rcPolyMesh
 	rcPolyMesh();
 	~rcPolyMesh();
 	
-	unsigned short* verts;	///< The mesh vertices. [Form: (x, y, z) * #nverts]
-	unsigned short* polys;	///< Polygon and neighbor data. [Length: #maxpolys * 2 * #nvp]
+	rcMeshIndex* verts;		///< The mesh vertices. [Form: (x, y, z) * #nverts]
+	rcMeshIndex* polys;		///< Polygon and neighbor data. [Length: #maxpolys * 2 * #nvp]
 	unsigned short* regs;	///< The region id assigned to each polygon. [Length: #maxpolys]
 	unsigned short* flags;	///< The user defined flags for each polygon. [Length: #maxpolys]
 	unsigned char* areas;	///< The area id assigned to each polygon. [Length: #maxpolys]
@@ -618,6 +713,22 @@ enum rcBuildContoursFlags
 	RC_CONTOUR_TESS_AREA_EDGES = 0x02	///< Tessellate edges between areas during contour simplification.
 };
 
+/// Selects the filters applied by #rcFilterWalkableSpans.
+/// @ingroup recast
+enum rcFilterSpanFlags
+{
+	RC_FILTER_LOW_HANGING_OBSTACLES = 0x01,		///< Apply #rcFilterLowHangingWalkableObstacles.
+	RC_FILTER_LEDGE_SPANS = 0x02,				///< Apply #rcFilterLedgeSpans.
+	RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS = 0x04	///< Apply #rcFilterWalkableLowHeightSpans.
+};
+
+/// Detail mesh build flags.
+/// @see rcBuildPolyMeshDetail
+enum rcBuildPolyMeshDetailFlags
+{
+	RC_DETAIL_INCREMENTAL_DELAUNAY = 0x01	///< Insert the detail samples into the triangulation incrementally instead of rebuilding it for every sample.
+};
+
 /// Applied to the region id field of contour vertices in order to extract the region id.
 /// The region id field of a vertex may have several flags applied to it.  So the
 /// fields value can't be used directly.
@@ -627,7 +738,29 @@ static const int RC_CONTOUR_REG_MASK = 0xffff;
 /// An value which indicates an invalid index within a mesh.
 /// @note This does not necessarily indicate an error.
 /// @see rcPolyMesh::polys
-static const unsigned short RC_MESH_NULL_IDX = 0xffff;
+#ifdef RC_POLYMESH_INDEX32
+static const rcMeshIndex RC_MESH_NULL_IDX = 0xffffffff;
+#else
+static const rcMeshIndex RC_MESH_NULL_IDX = 0xffff;
+#endif
+
+/// Portal edge flag.
+/// If a polygon neighbour value has this bit set (and is not #RC_MESH_NULL_IDX),
+/// the edge lies on the tile border. The low 4 bits hold the border direction.
+/// @see rcPolyMesh::polys
+#ifdef RC_POLYMESH_INDEX32
+static const rcMeshIndex RC_MESH_PORTAL_FLAG = 0x80000000;
+#else
+static const rcMeshIndex RC_MESH_PORTAL_FLAG = 0x8000;
+#endif
+
+/// The maximum number of vertices or polygons a single rcPolyMesh can hold.
+/// @see rcPolyMesh::nverts, rcPolyMesh::npolys
+#ifdef RC_POLYMESH_INDEX32
+static const int RC_MESH_MAX_COUNT = 0x7fffffff;
+#else
+static const int RC_MESH_MAX_COUNT = 0xffff;
+#endif
 
 /// Represents the null area.
 /// When a data element is given this value it is considered to no longer be 
@@ -856,6 +989,8 @@ bool rcCreateHeightfield(rcContext* context, rcHeightfield& heightfield, int siz
 ///
 /// Only sets the area id's for the walkable triangles.  Does not alter the
 /// area id's for un-walkable triangles.
+///
+/// The triangles are processed in parallel through rcContext::parallelFor when a context is given.
 /// 
 /// See the #rcConfig documentation for more information on the configuration parameters.
 /// 
@@ -877,6 +1012,8 @@ void rcMarkWalkableTriangles(rcContext* context, float walkableSlopeAngle, const
 /// 
 /// Only sets the area id's for the un-walkable triangles.  Does not alter the
 /// area id's for walkable triangles.
+///
+/// The triangles are processed in parallel through rcContext::parallelFor when a context is given.
 /// 
 /// See the #rcConfig documentation for more information on the configuration parameters.
 /// 
@@ -917,6 +1054,20 @@ bool rcAddSpan(rcContext* context, rcHeightfield& heightfield,
                unsigned short spanMin, unsigned short spanMax,
                unsigned char areaID, int flagMergeThreshold);
 
+/// Removes all spans from a rectangle of columns of the heightfield.
+///
+/// The spans are returned to the heightfield's free list and reused by later span additions.
+///
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		minX				The minimum x index of the columns to clear.
+/// @param[in]		minZ				The minimum z index of the columns to clear.
+/// @param[in]		maxX				The maximum x index of the columns to clear. (Inclusive)
+/// @param[in]		maxZ				The maximum z index of the columns to clear. (Inclusive)
+void rcClearHeightfieldColumns(rcContext* context, rcHeightfield& heightfield,
+                               int minX, int minZ, int maxX, int maxZ);
+
 /// Rasterizes a single triangle into the specified heightfield.
 ///
 /// Calling this for each triangle in a mesh is less efficient than calling rcRasterizeTriangles
@@ -1000,6 +1151,180 @@ bool rcRasterizeTriangles(rcContext* context,
                           const float* verts, const unsigned char* triAreaIDs, int numTris,
                           rcHeightfield& heightfield, int flagMergeThreshold = 1);
 
+/// Rasterizes an indexed triangle mesh into a rectangle of columns of the heightfield.
+///
+/// Only spans of the columns inside the rectangle are added. They are identical to the spans
+/// #rcRasterizeTriangles would add to those columns, so rasterizing the changed triangles of a
+/// mesh into columns cleared with #rcClearHeightfieldColumns updates a heightfield in place.
+/// Triangles that do not overlap the rectangle are skipped cheaply.
+///
+/// @see rcHeightfield, rcClearHeightfieldColumns
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		verts				The vertices. [(x, y, z) * @p nv]
+/// @param[in]		numVerts			The number of vertices. (unused)
+/// @param[in]		tris				The triangle indices. [(vertA, vertB, vertC) * @p nt]
+/// @param[in]		triAreaIDs			The area id's of the triangles. [Limit: <= #RC_WALKABLE_AREA] [Size: @p nt]
+/// @param[in]		numTris				The number of triangles.
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		minX				The minimum x index of the columns to rasterize into.
+/// @param[in]		minZ				The minimum z index of the columns to rasterize into.
+/// @param[in]		maxX				The maximum x index of the columns to rasterize into. (Inclusive)
+/// @param[in]		maxZ				The maximum z index of the columns to rasterize into. (Inclusive)
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag. 
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeTrianglesInColumns(rcContext* context,
+                                   const float* verts, int numVerts,
+                                   const int* tris, const unsigned char* triAreaIDs, int numTris,
+                                   rcHeightfield& heightfield,
+                                   int minX, int minZ, int maxX, int maxZ,
+                                   int flagMergeThreshold = 1);
+
+/// Rasterizes a heightmap into the heightfield.
+///
+/// The heightmap is a regular grid of height samples. Each grid cell is treated as two triangles split
+/// along the diagonal from sample (x, z) to sample (x + 1, z + 1), so the result matches rasterizing that
+/// triangulation with #rcRasterizeTriangles, but every column is resolved directly from the samples under
+/// it and receives a single span from the lowest to the highest point of the surface inside the column.
+/// The heightmap may be sampled more or less densely than the heightfield.
+///
+/// @see rcHeightfield, rcRasterizeTriangles
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		heights				The sample heights, relative to the origin. [Size: @p numX * @p numZ]
+/// 									Samples are stored in rows of increasing z, with x increasing within a row.
+/// @param[in]		cellAreaIDs			The area id's of the grid cells. [Limit: <= #RC_WALKABLE_AREA]
+/// 									[Size: (@p numX - 1) * (@p numZ - 1)]
+/// @param[in]		numX				The number of samples along the x-axis. [Limit: >= 2]
+/// @param[in]		numZ				The number of samples along the z-axis. [Limit: >= 2]
+/// @param[in]		origin				The world position of the first sample. [(x, y, z)] [Units: wu]
+/// @param[in]		spacing				The distance between neighbouring samples. [Limit: > 0] [Units: wu]
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeHeightmap(rcContext* context,
+                          const float* heights, const unsigned char* cellAreaIDs,
+                          int numX, int numZ, const float* origin, float spacing,
+                          rcHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// A triangle mesh shared by the instances rasterized with #rcRasterizeMeshInstances.
+/// @ingroup recast
+struct rcInstancedMesh
+{
+	const float* verts;					///< The vertices in mesh space. [(x, y, z) * #numVerts]
+	int numVerts;						///< The number of vertices.
+	const int* tris;					///< The triangle vertex indices. [(vertA, vertB, vertC) * #numTris]
+	const unsigned char* triAreaIDs;	///< The area ids of the triangles before slope classification, or null for
+										///  #RC_NULL_AREA. [Limit: <= #RC_WALKABLE_AREA] [Size: #numTris]
+	int numTris;						///< The number of triangles.
+};
+
+/// A placement of an #rcInstancedMesh.
+/// @ingroup recast
+struct rcMeshInstance
+{
+	int mesh;			///< The index of the instanced mesh.
+	float transform[12];///< The mesh to world transform, as the rows of a 3x4 matrix. A mesh space vertex (x, y, z)
+						///  is placed at world[r] = transform[r*4+0]*x + transform[r*4+1]*y + transform[r*4+2]*z + transform[r*4+3].
+};
+
+/// Rasterizes instances of shared triangle meshes into the heightfield.
+///
+/// The result is the same as transforming the vertices of every instance to world space, marking the walkable
+/// triangles with #rcMarkWalkableTriangles and rasterizing them with #rcRasterizeTriangles, without building
+/// the flattened vertex and triangle arrays. The winding of the triangles of mirrored instances is reversed
+/// for the slope classification, so their normals keep pointing the same way. Instances whose bounds miss
+/// the heightfield are skipped.
+///
+/// Transforms that only rotate around the y-axis, scale uniformly and translate do not change the slope of a
+/// triangle, so the walkable triangles of each mesh are classified once in mesh space and reused for all of its
+/// instances with such a transform. Other instances are classified in world space. A triangle within rounding
+/// of the slope limit may therefore be classified differently than in the flattened mesh.
+///
+/// @see rcInstancedMesh, rcMeshInstance, rcRasterizeTriangles, rcMarkWalkableTriangles
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		meshes				The shared meshes. [Size: @p numMeshes]
+/// @param[in]		numMeshes			The number of shared meshes.
+/// @param[in]		instances			The instances to rasterize. [Size: @p numInstances]
+/// @param[in]		numInstances		The number of instances.
+/// @param[in]		walkableSlopeAngle	The maximum slope that is considered walkable.
+/// 									[Limits: 0 <= value < 90] [Units: Degrees]
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeMeshInstances(rcContext* context,
+                              const rcInstancedMesh* meshes, int numMeshes,
+                              const rcMeshInstance* instances, int numInstances,
+                              float walkableSlopeAngle,
+                              rcHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// Rasterizes a solid axis aligned box into the heightfield.
+///
+/// Every column the box overlaps receives a single span from the bottom to the top of the box. Unlike the
+/// surface of a triangulated box, the inside of the box is solid, so it never holds walkable space.
+///
+/// @see rcHeightfield, rcRasterizeCylinder, rcRasterizeConvexHull
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		boxMinBounds		The minimum extents of the box. [(x, y, z)] [Units: wu]
+/// @param[in]		boxMaxBounds		The maximum extents of the box. [(x, y, z)] [Units: wu]
+/// @param[in]		areaID				The area id of the spans. [Limit: <= #RC_WALKABLE_AREA]
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeBox(rcContext* context, const float* boxMinBounds, const float* boxMaxBounds,
+                    unsigned char areaID, rcHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// Rasterizes a solid y-axis aligned cylinder into the heightfield.
+///
+/// Every column whose footprint overlaps the circle of the cylinder receives a single span from the bottom
+/// to the top of the cylinder.
+///
+/// @see rcHeightfield, rcRasterizeBox, rcRasterizeConvexHull
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		position			The center of the base of the cylinder. [(x, y, z)] [Units: wu]
+/// @param[in]		radius				The radius of the cylinder. [Limit: > 0] [Units: wu]
+/// @param[in]		height				The height of the cylinder. [Limit: > 0] [Units: wu]
+/// @param[in]		areaID				The area id of the spans. [Limit: <= #RC_WALKABLE_AREA]
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeCylinder(rcContext* context, const float* position, float radius, float height,
+                         unsigned char areaID, rcHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// Rasterizes a solid convex hull into the heightfield.
+///
+/// Every column the hull overlaps receives a single span from the lowest to the highest point of the hull
+/// inside the column. The bounds are found from the hull vertices inside the column, the crossings of the
+/// hull edges with the sides of the column and the extent of the hull along the corners of the column, so
+/// no triangles are clipped. The edges and faces of the hull are swept row by row, so each row only visits
+/// the ones it overlaps. Oriented boxes can be rasterized as hulls.
+///
+/// The area id is applied to the whole hull, regardless of the slope of its faces.
+///
+/// @see rcHeightfield, rcRasterizeBox, rcRasterizeCylinder
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		verts				The vertices of the hull. [(x, y, z) * @p numVerts] [Units: wu]
+/// @param[in]		numVerts			The number of vertices.
+/// @param[in]		tris				The triangles of the closed, convex surface of the hull, in any winding.
+/// 									[(vertA, vertB, vertC) * @p numTris]
+/// @param[in]		numTris				The number of triangles.
+/// @param[in]		areaID				The area id of the spans. [Limit: <= #RC_WALKABLE_AREA]
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeConvexHull(rcContext* context, const float* verts, int numVerts, const int* tris, int numTris,
+                           unsigned char areaID, rcHeightfield& heightfield, int flagMergeThreshold = 1);
+
 /// Marks non-walkable spans as walkable if their maximum is within @p walkableClimb of the span below them.
 ///
 /// This removes small obstacles and rasterization artifacts that the agent would be able to walk over
@@ -1054,6 +1379,48 @@ void rcFilterLedgeSpans(rcContext* context, int walkableHeight, int walkableClim
 /// @param[in,out]	heightfield		A fully built heightfield.  (All spans have been added.)
 void rcFilterWalkableLowHeightSpans(rcContext* context, int walkableHeight, rcHeightfield& heightfield);
 
+/// Applies the selected span filters to the heightfield in a single sweep over its columns.
+///
+/// The result is the same as calling #rcFilterLowHangingWalkableObstacles, #rcFilterLedgeSpans and
+/// #rcFilterWalkableLowHeightSpans in that order, but every column is visited only once. The rows
+/// of the heightfield are distributed over rcContext::parallelFor.
+///
+/// @see rcHeightfield, rcConfig, rcFilterSpanFlags
+/// @ingroup recast
+///
+/// @param[in,out]	context			The build context to use during the operation.
+/// @param[in]		filterFlags		The filters to apply. (See: #rcFilterSpanFlags)
+/// @param[in]		walkableHeight	Minimum floor to 'ceiling' height that will still allow the floor area to 
+/// 								be considered walkable. [Limit: >= 3] [Units: vx]
+/// @param[in]		walkableClimb	Maximum ledge height that is considered to still be traversable. 
+/// 								[Limit: >=0] [Units: vx]
+/// @param[in,out]	heightfield		A fully built heightfield.  (All spans have been added.)
+void rcFilterWalkableSpans(rcContext* context, int filterFlags, int walkableHeight, int walkableClimb,
+						   rcHeightfield& heightfield);
+
+/// Applies the selected span filters to a rectangle of columns of the heightfield.
+///
+/// Gives the same result for the columns in the rectangle as #rcFilterWalkableSpans, provided
+/// their spans have not been filtered before. The ledge filter reads the span heights of the
+/// columns bordering the rectangle, but does not change them.
+///
+/// @see rcFilterWalkableSpans
+/// @ingroup recast
+///
+/// @param[in,out]	context			The build context to use during the operation.
+/// @param[in]		filterFlags		The filters to apply. (See: #rcFilterSpanFlags)
+/// @param[in]		walkableHeight	Minimum floor to 'ceiling' height that will still allow the floor area to 
+/// 								be considered walkable. [Limit: >= 3] [Units: vx]
+/// @param[in]		walkableClimb	Maximum ledge height that is considered to still be traversable. 
+/// 								[Limit: >=0] [Units: vx]
+/// @param[in]		minX			The minimum x index of the columns to filter.
+/// @param[in]		minZ			The minimum z index of the columns to filter.
+/// @param[in]		maxX			The maximum x index of the columns to filter. (Inclusive)
+/// @param[in]		maxZ			The maximum z index of the columns to filter. (Inclusive)
+/// @param[in,out]	heightfield		A fully built heightfield.  (All spans have been added.)
+void rcFilterWalkableSpansInColumns(rcContext* context, int filterFlags, int walkableHeight, int walkableClimb,
+									int minX, int minZ, int maxX, int maxZ, rcHeightfield& heightfield);
+
 /// Returns the number of spans contained in the specified heightfield.
 ///  @ingroup recast
 ///  @param[in,out]	context		The build context to use during the operation.
@@ -1181,6 +1548,51 @@ int rcOffsetPoly(const float* verts, int numVerts, float offset, float* outVerts
 void rcMarkCylinderArea(rcContext* context, const float* position, float radius, float height,
 						unsigned char areaId, rcCompactHeightfield& compactHeightfield);
 
+/// The shape of an area volume.
+/// @see rcAreaVolume
+enum rcAreaVolumeType
+{
+	RC_AREA_VOLUME_BOX,			///< An axis aligned box. (See: #rcMarkBoxArea)
+	RC_AREA_VOLUME_CONVEX,		///< An extruded convex polygon. (See: #rcMarkConvexPolyArea)
+	RC_AREA_VOLUME_CYLINDER		///< A y-axis aligned cylinder. (See: #rcMarkCylinderArea)
+};
+
+/// A volume to apply an area id to with #rcMarkAreaVolumes.
+/// Only the fields of the volume's shape are used.
+/// @ingroup recast
+struct rcAreaVolume
+{
+	int type;				///< The shape of the volume. (See: #rcAreaVolumeType)
+	unsigned char areaId;	///< The area id to apply. [Limit: <= #RC_WALKABLE_AREA]
+	float boxMin[3];		///< Box: The minimum extents. [(x, y, z)] [Units: wu]
+	float boxMax[3];		///< Box: The maximum extents. [(x, y, z)] [Units: wu]
+	const float* verts;		///< Convex: The polygon vertices. [(x, y, z) * #nverts]
+	int nverts;				///< Convex: The number of polygon vertices.
+	float minY;				///< Convex: The height of the base of the polygon. [Units: wu]
+	float maxY;				///< Convex: The height of the top of the polygon. [Units: wu]
+	float position[3];		///< Cylinder: The center of the base. [(x, y, z)] [Units: wu]
+	float radius;			///< Cylinder: The radius. [Units: wu] [Limit: > 0]
+	float height;			///< Cylinder: The height. [Units: wu] [Limit: > 0]
+};
+
+/// Applies the area ids of a set of volumes.
+///
+/// The result is the same as calling #rcMarkBoxArea, #rcMarkConvexPolyArea or #rcMarkCylinderArea
+/// for each volume in order, so later volumes override earlier ones. The volumes are binned into
+/// a grid over the heightfield, and each cell is only tested against the volumes that overlap its
+/// bin. The rows of bins are processed through rcContext::parallelFor.
+///
+/// @see rcAreaVolume, rcCompactHeightfield, rcMedianFilterWalkableArea
+/// @ingroup recast
+///
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		volumes				The volumes to mark, in marking order. [Size: @p numVolumes]
+/// @param[in]		numVolumes			The number of volumes.
+/// @param[in,out]	compactHeightfield	A populated compact heightfield.
+/// @returns True if the operation completed successfully.
+bool rcMarkAreaVolumes(rcContext* context, const rcAreaVolume* volumes, int numVolumes,
+					   rcCompactHeightfield& compactHeightfield);
+
 /// Builds the distance field for the specified compact heightfield. 
 /// @ingroup recast
 /// @param[in,out]	ctx		The build context to use during the operation.
@@ -1201,6 +1613,19 @@ bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf);
 /// @returns True if the operation completed successfully.
 bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf, int borderSize, int minRegionArea, int mergeRegionArea);
 
+/// Builds region data for the heightfield using watershed partitioning, flooding the regions in parallel.
+/// @ingroup recast
+/// @param[in,out]	ctx				The build context to use during the operation.
+/// @param[in,out]	chf				A populated compact heightfield.
+/// @param[in]		borderSize		The size of the non-navigable border around the heightfield.
+/// 								[Limit: >=0] [Units: vx]
+/// @param[in]		minRegionArea	The minimum number of cells allowed to form isolated island areas.
+/// 								[Limit: >=0] [Units: vx].
+/// @param[in]		mergeRegionArea	Any regions with a span count smaller than this value will, if possible,
+/// 								be merged with larger regions. [Limit: >=0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcBuildRegionsParallel(rcContext* ctx, rcCompactHeightfield& chf, int borderSize, int minRegionArea, int mergeRegionArea);
+
 /// Builds region data for the heightfield using watershed partitioning.
 /// @ingroup recast
 /// @param[in,out]	ctx				The build context to use during the operation.
@@ -1323,6 +1748,29 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 					 float maxError, int maxEdgeLen,
 					 rcContourSet& cset, int buildFlags = RC_CONTOUR_TESS_WALL_EDGES);
 
+/// Builds a contour set from the outlines of some of the regions in a rectangle of columns of the
+/// provided compact heightfield.
+/// @ingroup recast
+/// @param[in,out]	ctx				The build context to use during the operation.
+/// @param[in]		chf				A fully built compact heightfield.
+/// @param[in]		traceRegions	Per region id, non-zero to trace the region. [Size: chf.maxRegions + 1]
+/// @param[in]		minX			The minimum x index of the columns to trace.
+/// @param[in]		minZ			The minimum z index of the columns to trace.
+/// @param[in]		maxX			The maximum x index of the columns to trace. (Inclusive)
+/// @param[in]		maxZ			The maximum z index of the columns to trace. (Inclusive)
+/// @param[in]		maxError		The maximum distance a simplified contour's border edges should deviate 
+/// 								the original raw contour. [Limit: >=0] [Units: wu]
+/// @param[in]		maxEdgeLen		The maximum allowed length for contour edges along the border of the mesh. 
+/// 								[Limit: >=0] [Units: vx]
+/// @param[out]		cset			The resulting contour set. (Must be pre-allocated.)
+/// @param[in]		buildFlags		The build flags. (See: #rcBuildContoursFlags)
+/// @returns True if the operation completed successfully.
+bool rcBuildContoursInColumns(rcContext* ctx, const rcCompactHeightfield& chf,
+							  const unsigned char* traceRegions,
+							  int minX, int minZ, int maxX, int maxZ,
+							  float maxError, int maxEdgeLen,
+							  rcContourSet& cset, int buildFlags = RC_CONTOUR_TESS_WALL_EDGES);
+
 /// Builds a contour set from the region outlines in the provided compact heightfield.
 /// @ingroup recast
 /// @param[in,out]	ctx		The build context to use during the operation.
@@ -1366,10 +1814,11 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 /// @param[in]		sampleMaxError	The maximum distance the detail mesh surface should deviate from 
 /// 								heightfield data. [Limit: >=0] [Units: wu]
 /// @param[out]		dmesh			The resulting detail mesh.  (Must be pre-allocated.)
+/// @param[in]		buildFlags		The build flags. (See: #rcBuildPolyMeshDetailFlags)
 /// @returns True if the operation completed successfully.
 bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
 						   float sampleDist, float sampleMaxError,
-						   rcPolyMeshDetail& dmesh);
+						   rcPolyMeshDetail& dmesh, int buildFlags = 0);
 
 /// Copies the poly mesh data from src to dst.
 /// @ingroup recast
@@ -1390,6 +1839,200 @@ bool rcMergePolyMeshDetails(rcContext* ctx, rcPolyMeshDetail** meshes, const int
 
 /// @}
 
+/// @name Time-Sliced Build Functions
+/// Functions that spread the distance field, region, contour, polygon mesh and detail mesh builds over several
+/// calls, e.g. one per frame, with a bounded amount of work per call. A build is started with the begin function
+/// of the step and advanced with the step function until it reports that it is done. The result is identical to
+/// the one of the function that builds the step in one call.
+///
+/// The inputs of a build must stay valid and unchanged until it is done. The builds keep temporary memory between
+/// the calls, so the arenas set with #rcAllocSetArenas must not be reset while a build is running. A build object
+/// can be reused for further builds; a failed build must be started again.
+/// @see rcAllocSetArenas
+/// @{
+
+/// The state of a distance field build. (See: #rcBeginDistanceField)
+struct rcDistanceFieldBuild;
+
+/// The state of a watershed region build. (See: #rcBeginRegions)
+struct rcRegionsBuild;
+
+/// The state of a contour build. (See: #rcBeginContours)
+struct rcContoursBuild;
+
+/// The state of a polygon mesh build. (See: #rcBeginPolyMesh)
+struct rcPolyMeshBuild;
+
+/// The state of a detail mesh build. (See: #rcBeginPolyMeshDetail)
+struct rcPolyMeshDetailBuild;
+
+/// Allocates a distance field build object using the Recast allocator.
+/// @return A build object, or null on failure.
+/// @ingroup recast
+/// @see rcBeginDistanceField, rcFreeDistanceFieldBuild
+rcDistanceFieldBuild* rcAllocDistanceFieldBuild();
+
+/// Frees the specified distance field build object using the Recast allocator.
+/// @param[in]		build	A build object allocated using #rcAllocDistanceFieldBuild
+/// @ingroup recast
+void rcFreeDistanceFieldBuild(rcDistanceFieldBuild* build);
+
+/// Starts building the distance field for the specified compact heightfield. (See: #rcBuildDistanceField)
+/// @ingroup recast
+/// @param[in,out]	ctx		The build context to use during the operation.
+/// @param[in,out]	chf		A populated compact heightfield.
+/// @param[out]		build	The build object to start.
+/// @returns True if the operation completed successfully.
+bool rcBeginDistanceField(rcContext* ctx, rcCompactHeightfield& chf, rcDistanceFieldBuild& build);
+
+/// Continues a distance field build.
+/// @ingroup recast
+/// @param[in,out]	ctx		The build context to use during the operation.
+/// @param[in,out]	build	A build started with #rcBeginDistanceField.
+/// @param[in]		maxRows	The maximum number of heightfield rows to process. [Limit: >= 1]
+/// @param[out]		done	True if the distance field is built.
+/// @returns True if the operation completed successfully.
+bool rcStepDistanceField(rcContext* ctx, rcDistanceFieldBuild& build, int maxRows, bool& done);
+
+/// Allocates a region build object using the Recast allocator.
+/// @return A build object, or null on failure.
+/// @ingroup recast
+/// @see rcBeginRegions, rcFreeRegionsBuild
+rcRegionsBuild* rcAllocRegionsBuild();
+
+/// Frees the specified region build object using the Recast allocator.
+/// @param[in]		build	A build object allocated using #rcAllocRegionsBuild
+/// @ingroup recast
+void rcFreeRegionsBuild(rcRegionsBuild* build);
+
+/// Starts building region data for the heightfield using watershed partitioning. (See: #rcBuildRegions)
+/// @ingroup recast
+/// @param[in,out]	ctx				The build context to use during the operation.
+/// @param[in,out]	chf				A populated compact heightfield with a distance field.
+/// @param[in]		borderSize		The size of the non-navigable border around the heightfield.
+/// 								[Limit: >=0] [Units: vx]
+/// @param[in]		minRegionArea	The minimum number of cells allowed to form isolated island areas.
+/// 								[Limit: >=0] [Units: vx].
+/// @param[in]		mergeRegionArea	Any regions with a span count smaller than this value will, if possible,
+/// 								be merged with larger regions. [Limit: >=0] [Units: vx]
+/// @param[out]		build			The build object to start.
+/// @returns True if the operation completed successfully.
+bool rcBeginRegions(rcContext* ctx, rcCompactHeightfield& chf, int borderSize, int minRegionArea, int mergeRegionArea,
+					rcRegionsBuild& build);
+
+/// Continues a region build.
+/// @ingroup recast
+/// @param[in,out]	ctx			The build context to use during the operation.
+/// @param[in,out]	build		A build started with #rcBeginRegions.
+/// @param[in]		maxSteps	The maximum number of steps to run. [Limit: >= 1]
+/// @param[out]		done		True if the regions are built.
+/// @returns True if the operation completed successfully.
+bool rcStepRegions(rcContext* ctx, rcRegionsBuild& build, int maxSteps, bool& done);
+
+/// Allocates a contour build object using the Recast allocator.
+/// @return A build object, or null on failure.
+/// @ingroup recast
+/// @see rcBeginContours, rcFreeContoursBuild
+rcContoursBuild* rcAllocContoursBuild();
+
+/// Frees the specified contour build object using the Recast allocator.
+/// @param[in]		build	A build object allocated using #rcAllocContoursBuild
+/// @ingroup recast
+void rcFreeContoursBuild(rcContoursBuild* build);
+
+/// Starts building a contour set from the region outlines in the provided compact heightfield. (See: #rcBuildContours)
+/// @ingroup recast
+/// @param[in,out]	ctx			The build context to use during the operation.
+/// @param[in]		chf			A fully built compact heightfield.
+/// @param[in]		maxError	The maximum distance a simplified contour's border edges should deviate 
+/// 							the original raw contour. [Limit: >=0] [Units: wu]
+/// @param[in]		maxEdgeLen	The maximum allowed length for contour edges along the border of the mesh. 
+/// 							[Limit: >=0] [Units: vx]
+/// @param[out]		cset		The resulting contour set. (Must be pre-allocated.)
+/// @param[out]		build		The build object to start.
+/// @param[in]		buildFlags	The build flags. (See: #rcBuildContoursFlags)
+/// @returns True if the operation completed successfully.
+bool rcBeginContours(rcContext* ctx, const rcCompactHeightfield& chf, float maxError, int maxEdgeLen,
+					 rcContourSet& cset, rcContoursBuild& build, int buildFlags = RC_CONTOUR_TESS_WALL_EDGES);
+
+/// Continues a contour build.
+/// @ingroup recast
+/// @param[in,out]	ctx		The build context to use during the operation.
+/// @param[in,out]	build	A build started with #rcBeginContours.
+/// @param[in]		maxRows	The maximum number of heightfield rows to process. [Limit: >= 1]
+/// @param[out]		done	True if the contours are built.
+/// @returns True if the operation completed successfully.
+bool rcStepContours(rcContext* ctx, rcContoursBuild& build, int maxRows, bool& done);
+
+/// Allocates a polygon mesh build object using the Recast allocator.
+/// @return A build object, or null on failure.
+/// @ingroup recast
+/// @see rcBeginPolyMesh, rcFreePolyMeshBuild
+rcPolyMeshBuild* rcAllocPolyMeshBuild();
+
+/// Frees the specified polygon mesh build object using the Recast allocator.
+/// @param[in]		build	A build object allocated using #rcAllocPolyMeshBuild
+/// @ingroup recast
+void rcFreePolyMeshBuild(rcPolyMeshBuild* build);
+
+/// Starts building a polygon mesh from the provided contours. (See: #rcBuildPolyMesh)
+/// @ingroup recast
+/// @param[in,out]	ctx		The build context to use during the operation.
+/// @param[in]		cset	A fully built contour set.
+/// @param[in]		nvp		The maximum number of vertices allowed for polygons generated during the 
+/// 						contour to polygon conversion process. [Limit: >= 3] 
+/// @param[out]		mesh	The resulting polygon mesh. (Must be re-allocated.)
+/// @param[out]		build	The build object to start.
+/// @returns True if the operation completed successfully.
+bool rcBeginPolyMesh(rcContext* ctx, const rcContourSet& cset, int nvp, rcPolyMesh& mesh, rcPolyMeshBuild& build);
+
+/// Continues a polygon mesh build.
+/// @ingroup recast
+/// @param[in,out]	ctx			The build context to use during the operation.
+/// @param[in,out]	build		A build started with #rcBeginPolyMesh.
+/// @param[in]		maxItems	The maximum number of contours or mesh vertices to process. [Limit: >= 1]
+/// @param[out]		done		True if the mesh is built.
+/// @returns True if the operation completed successfully.
+bool rcStepPolyMesh(rcContext* ctx, rcPolyMeshBuild& build, int maxItems, bool& done);
+
+/// Allocates a detail mesh build object using the Recast allocator.
+/// @return A build object, or null on failure.
+/// @ingroup recast
+/// @see rcBeginPolyMeshDetail, rcFreePolyMeshDetailBuild
+rcPolyMeshDetailBuild* rcAllocPolyMeshDetailBuild();
+
+/// Frees the specified detail mesh build object using the Recast allocator.
+/// @param[in]		build	A build object allocated using #rcAllocPolyMeshDetailBuild
+/// @ingroup recast
+void rcFreePolyMeshDetailBuild(rcPolyMeshDetailBuild* build);
+
+/// Starts building a detail mesh from the provided polygon mesh. (See: #rcBuildPolyMeshDetail)
+/// @ingroup recast
+/// @param[in,out]	ctx				The build context to use during the operation.
+/// @param[in]		mesh			A fully built polygon mesh.
+/// @param[in]		chf				The compact heightfield used to build the polygon mesh.
+/// @param[in]		sampleDist		Sets the distance to use when sampling the heightfield. [Limit: >=0] [Units: wu]
+/// @param[in]		sampleMaxError	The maximum distance the detail mesh surface should deviate from 
+/// 								heightfield data. [Limit: >=0] [Units: wu]
+/// @param[out]		dmesh			The resulting detail mesh.  (Must be pre-allocated.)
+/// @param[out]		build			The build object to start.
+/// @param[in]		buildFlags		The build flags. (See: #rcBuildPolyMeshDetailFlags)
+/// @returns True if the operation completed successfully.
+bool rcBeginPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
+						   float sampleDist, float sampleMaxError,
+						   rcPolyMeshDetail& dmesh, rcPolyMeshDetailBuild& build, int buildFlags = 0);
+
+/// Continues a detail mesh build.
+/// @ingroup recast
+/// @param[in,out]	ctx			The build context to use during the operation.
+/// @param[in,out]	build		A build started with #rcBeginPolyMeshDetail.
+/// @param[in]		maxPolys	The maximum number of polygons to process. [Limit: >= 1]
+/// @param[out]		done		True if the detail mesh is built.
+/// @returns True if the operation completed successfully.
+bool rcStepPolyMeshDetail(rcContext* ctx, rcPolyMeshDetailBuild& build, int maxPolys, bool& done);
+
+/// @}
+
 #endif // RECAST_H
 
 ///////////////////////////////////////////////////////////////////////////
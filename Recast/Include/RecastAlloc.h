@@ -51,6 +51,13 @@ typedef void (rcFreeFunc)(void* ptr);
 /// @see rcAlloc, rcFree
 void rcAllocSetCustom(rcAllocFunc *allocFunc, rcFreeFunc *freeFunc);
 
+/// Gets the allocation functions currently used by Recast, so that they can be restored or wrapped.
+///  @param[out]	allocFunc	The memory allocation function used by #rcAlloc
+///  @param[out]	freeFunc	The memory de-allocation function used by #rcFree
+///
+/// @see rcAllocSetCustom
+void rcAllocGetCustom(rcAllocFunc** allocFunc, rcFreeFunc** freeFunc);
+
 /// Allocates a memory block.
 /// 
 /// @param[in]		size	The size, in bytes of memory, to allocate.
@@ -70,6 +77,72 @@ void* rcAlloc(size_t size, rcAllocHint hint);
 /// @see rcAlloc, rcAllocSetCustom
 void rcFree(void* ptr);
 
+/// A linear allocator for temporary memory. Allocations bump a pointer into a single buffer and are not freed
+/// individually; #reset releases everything allocated after a mark at once. Plug arenas in with #rcAllocSetArenas
+/// to serve the #RC_ALLOC_TEMP allocations of a build from them.
+///
+/// Allocating is not thread safe, so each thread needs its own arena. Checking ownership is, as it only reads the
+/// buffer bounds.
+class rcArena
+{
+public:
+	rcArena();
+	~rcArena();
+
+	/// Allocates the buffer of the arena, replacing the previous one.
+	///  @param[in]		capacity	The size of the buffer in bytes.
+	/// @return True if the buffer was allocated.
+	bool init(size_t capacity);
+
+	/// Allocates a block from the arena. Blocks are padded to multiples of 16 bytes, so they keep the alignment of
+	/// the buffer.
+	///  @param[in]		size	The size, in bytes of memory, to allocate.
+	/// @return A pointer to the block, or null if the arena is full.
+	void* alloc(size_t size);
+
+	/// Returns true if the block was allocated from this arena.
+	inline bool owns(const void* ptr) const { return (const unsigned char*)ptr >= m_buffer && (const unsigned char*)ptr < m_buffer + m_capacity; }
+
+	/// Returns a mark that #reset can roll the arena back to.
+	inline size_t getMark() const { return m_used; }
+
+	/// Releases all blocks allocated after the mark. The blocks must no longer be in use.
+	///  @param[in]		mark	A mark returned by #getMark, or zero to release all blocks.
+	void reset(size_t mark = 0);
+
+	/// Returns the number of bytes allocated from the arena.
+	inline size_t getUsed() const { return m_used; }
+
+	/// Returns the size of the buffer in bytes.
+	inline size_t getCapacity() const { return m_capacity; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcArena(const rcArena&);
+	rcArena& operator=(const rcArena&);
+
+	unsigned char* m_buffer;
+	size_t m_capacity;
+	size_t m_used;
+};
+
+/// Returns the index of the arena the calling thread allocates from, or -1 to not use an arena.
+/// @see rcAllocSetArenas
+typedef int (rcArenaIndexFunc)();
+
+/// Serves #RC_ALLOC_TEMP allocations from arenas instead of the allocation function. An allocation that does not
+/// fit in the arena of the calling thread falls back to the allocation function. #rcFree ignores blocks owned by
+/// one of the arenas, so they are only released by rcArena::reset.
+///
+/// Temporary memory may be freed on another thread than the one that allocated it, for example the per-thread
+/// scratch buffers of build steps that use rcContext::parallelFor.
+///  @param[in]		arenas		The arenas, or null to disable them. They must outlive their use.
+///  @param[in]		count		The number of arenas.
+///  @param[in]		indexFunc	Returns the arena of the calling thread, or null to always use the first arena.
+///
+/// @see rcAllocSetCustom
+void rcAllocSetArenas(rcArena* arenas, int count, rcArenaIndexFunc* indexFunc);
+
 /// An implementation of operator new usable for placement new. The default one is part of STL (which we don't use).
 /// rcNewTag is a dummy type used to differentiate our operator from the STL one, in case users import both Recast
 /// and STL.
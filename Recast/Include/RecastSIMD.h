@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef RECASTSIMD_H
+#define RECASTSIMD_H
+
+// Wrappers for vectors of four floats, used by the build steps and tools that process four items at a time.
+// They map to SSE2 or NEON when available, in which case RC_FLOATS4_SIMD is defined, and to plain arrays
+// otherwise. Define RC_DISABLE_SIMD to always use the plain arrays.
+//
+// The operations round like the scalar ones and are never fused, so vector code that evaluates the same
+// expressions in the same order gives the same results as the scalar code.
+
+#if !defined(RC_DISABLE_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define RC_FLOATS4_SIMD
+typedef __m128 rcFloats4;
+inline rcFloats4 rcLoadFloats4(const float* p) { return _mm_loadu_ps(p); }
+inline void rcStoreFloats4(float* p, const rcFloats4 v) { _mm_storeu_ps(p, v); }
+inline rcFloats4 rcSplatFloats4(const float v) { return _mm_set1_ps(v); }
+inline rcFloats4 rcAddFloats4(const rcFloats4 a, const rcFloats4 b) { return _mm_add_ps(a, b); }
+inline rcFloats4 rcSubFloats4(const rcFloats4 a, const rcFloats4 b) { return _mm_sub_ps(a, b); }
+inline rcFloats4 rcMulFloats4(const rcFloats4 a, const rcFloats4 b) { return _mm_mul_ps(a, b); }
+inline rcFloats4 rcAbsFloats4(const rcFloats4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+/// Returns a bit mask of the lanes in which @p a is greater than @p b.
+inline int rcGreaterMaskFloats4(const rcFloats4 a, const rcFloats4 b) { return _mm_movemask_ps(_mm_cmpgt_ps(a, b)); }
+#elif !defined(RC_DISABLE_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define RC_FLOATS4_SIMD
+typedef float32x4_t rcFloats4;
+inline rcFloats4 rcLoadFloats4(const float* p) { return vld1q_f32(p); }
+inline void rcStoreFloats4(float* p, const rcFloats4 v) { vst1q_f32(p, v); }
+inline rcFloats4 rcSplatFloats4(const float v) { return vdupq_n_f32(v); }
+inline rcFloats4 rcAddFloats4(const rcFloats4 a, const rcFloats4 b) { return vaddq_f32(a, b); }
+inline rcFloats4 rcSubFloats4(const rcFloats4 a, const rcFloats4 b) { return vsubq_f32(a, b); }
+inline rcFloats4 rcMulFloats4(const rcFloats4 a, const rcFloats4 b) { return vmulq_f32(a, b); }
+inline rcFloats4 rcAbsFloats4(const rcFloats4 a) { return vabsq_f32(a); }
+/// Returns a bit mask of the lanes in which @p a is greater than @p b.
+inline int rcGreaterMaskFloats4(const rcFloats4 a, const rcFloats4 b)
+{
+	const uint32x4_t m = vcgtq_f32(a, b);
+	return (int)((vgetq_lane_u32(m, 0) & 1) | (vgetq_lane_u32(m, 1) & 2) | (vgetq_lane_u32(m, 2) & 4) | (vgetq_lane_u32(m, 3) & 8));
+}
+#else
+struct rcFloats4 { float v[4]; };
+inline rcFloats4 rcLoadFloats4(const float* p) { rcFloats4 r; for (int i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+inline void rcStoreFloats4(float* p, const rcFloats4 a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+inline rcFloats4 rcSplatFloats4(const float v) { rcFloats4 r; for (int i = 0; i < 4; ++i) r.v[i] = v; return r; }
+inline rcFloats4 rcAddFloats4(const rcFloats4 a, const rcFloats4 b) { rcFloats4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] + b.v[i]; return r; }
+inline rcFloats4 rcSubFloats4(const rcFloats4 a, const rcFloats4 b) { rcFloats4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] - b.v[i]; return r; }
+inline rcFloats4 rcMulFloats4(const rcFloats4 a, const rcFloats4 b) { rcFloats4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] * b.v[i]; return r; }
+inline rcFloats4 rcAbsFloats4(const rcFloats4 a) { rcFloats4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] < 0.0f ? -a.v[i] : a.v[i]; return r; }
+/// Returns a bit mask of the lanes in which @p a is greater than @p b.
+inline int rcGreaterMaskFloats4(const rcFloats4 a, const rcFloats4 b) { int m = 0; for (int i = 0; i < 4; ++i) m |= (a.v[i] > b.v[i]) << i; return m; }
+#endif
+
+#endif // RECASTSIMD_H
@@ -19,6 +19,7 @@
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
+#include "RecastSIMD.h"
 
 #include <math.h>
 #include <string.h>
@@ -333,52 +334,203 @@ static void calcTriNormal(const float* v0, const float* v1, const float* v2, flo
 	rcVnormalize(faceNormal);
 }
 
-void rcMarkWalkableTriangles(rcContext* context, const float walkableSlopeAngle,
-                             const float* verts, const int numVerts,
-                             const int* tris, const int numTris,
-                             unsigned char* triAreaIDs)
+/// The number of triangles whose slopes are classified per work item of rcContext::parallelFor.
+static const int SLOPE_TRIS_PER_ITEM = 4096;
+
+/// The relative tolerance of the squared slope test, well above its rounding error.
+static const float SLOPE_SQUARED_TOLERANCE = 1e-5f;
+
+/// Below this squared normal length the squared slope test can lose its precision to denormals.
+static const float SLOPE_MIN_SQUARED_LENGTH = 1e-30f;
+
+struct rcTriSlopeJob
 {
-	rcIgnoreUnused(context);
-	rcIgnoreUnused(numVerts);
+	const float* verts;
+	const int* tris;
+	int numTris;
+	unsigned char* triAreaIDs;
+	/// The minimum y of the normalized face normal of a walkable triangle.
+	float walkableLimitY;
+	/// walkableLimitY * |walkableLimitY|, the limit of the squared slope test.
+	float signedSqrLimitY;
+	/// True to clear the unwalkable triangles, false to mark the walkable ones.
+	bool clearUnwalkable;
+};
 
-	const float walkableThr = cosf(walkableSlopeAngle / 180.0f * RC_PI);
+/// Sets the area id of a triangle that is walkable or unwalkable for certain.
+inline void setTriSlope(const rcTriSlopeJob& job, const int triIndex, const bool walkable)
+{
+	if (job.clearUnwalkable && !walkable)
+	{
+		job.triAreaIDs[triIndex] = RC_NULL_AREA;
+	}
+	else if (!job.clearUnwalkable && walkable)
+	{
+		job.triAreaIDs[triIndex] = RC_WALKABLE_AREA;
+	}
+}
 
-	float norm[3];
+/// Sets the area id of a triangle the squared slope test cannot decide, by normalizing its normal
+/// like the test always did before. A degenerate triangle has a NaN normal, which is neither
+/// walkable nor unwalkable.
+static void setTriSlopeExact(const rcTriSlopeJob& job, const int triIndex)
+{
+	const int* tri = &job.tris[triIndex * 3];
+	float faceNormal[3];
+	calcTriNormal(&job.verts[tri[0] * 3], &job.verts[tri[1] * 3], &job.verts[tri[2] * 3], faceNormal);
+	if (job.clearUnwalkable)
+	{
+		if (faceNormal[1] <= job.walkableLimitY)
+		{
+			job.triAreaIDs[triIndex] = RC_NULL_AREA;
+		}
+	}
+	else if (faceNormal[1] > job.walkableLimitY)
+	{
+		job.triAreaIDs[triIndex] = RC_WALKABLE_AREA;
+	}
+}
 
-	for (int i = 0; i < numTris; ++i)
+/// Classifies the slopes of the triangles of work items [begin, end).
+///
+/// A face is walkable when y / length > limit, with y the y of its unnormalized normal. Squaring
+/// both sides while keeping their signs turns this into y * |y| > limit * |limit| * length^2, which
+/// needs no square root or division. Only the triangles for which the two sides are too close to
+/// tell apart after rounding, or are not finite, are classified with the normalized normal, so the
+/// area ids are exactly the ones the normalized normals give.
+static void classifyTriSlopes(void* userData, const int begin, const int end, const int threadIndex)
+{
+	rcIgnoreUnused(threadIndex);
+	const rcTriSlopeJob& job = *(const rcTriSlopeJob*)userData;
+	const float* verts = job.verts;
+	const int* tris = job.tris;
+
+	int i = begin * SLOPE_TRIS_PER_ITEM;
+	const int endTri = rcMin(end * SLOPE_TRIS_PER_ITEM, job.numTris);
+
+#ifdef RC_FLOATS4_SIMD
+	const rcFloats4 signedSqrLimitY = rcSplatFloats4(job.signedSqrLimitY);
+	const rcFloats4 tolerance = rcSplatFloats4(SLOPE_SQUARED_TOLERANCE);
+	const rcFloats4 minSqrLength = rcSplatFloats4(SLOPE_MIN_SQUARED_LENGTH);
+	for (; i + 4 <= endTri; i += 4)
+	{
+		// Gather the vertices of four triangles with their coordinates stored per axis.
+		float coords[3][3][4];
+		for (int k = 0; k < 4; ++k)
+		{
+			const int* tri = &tris[(i + k) * 3];
+			for (int vert = 0; vert < 3; ++vert)
+			{
+				const float* v = &verts[tri[vert] * 3];
+				coords[vert][0][k] = v[0];
+				coords[vert][1][k] = v[1];
+				coords[vert][2][k] = v[2];
+			}
+		}
+
+		rcFloats4 e0[3], e1[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const rcFloats4 v0 = rcLoadFloats4(coords[0][axis]);
+			e0[axis] = rcSubFloats4(rcLoadFloats4(coords[1][axis]), v0);
+			e1[axis] = rcSubFloats4(rcLoadFloats4(coords[2][axis]), v0);
+		}
+		const rcFloats4 nx = rcSubFloats4(rcMulFloats4(e0[1], e1[2]), rcMulFloats4(e0[2], e1[1]));
+		const rcFloats4 ny = rcSubFloats4(rcMulFloats4(e0[2], e1[0]), rcMulFloats4(e0[0], e1[2]));
+		const rcFloats4 nz = rcSubFloats4(rcMulFloats4(e0[0], e1[1]), rcMulFloats4(e0[1], e1[0]));
+
+		const rcFloats4 sqrLength = rcAddFloats4(rcAddFloats4(rcMulFloats4(nx, nx), rcMulFloats4(ny, ny)), rcMulFloats4(nz, nz));
+		const rcFloats4 signedSqrY = rcMulFloats4(ny, rcAbsFloats4(ny));
+		const rcFloats4 limit = rcMulFloats4(signedSqrLimitY, sqrLength);
+		const rcFloats4 margin = rcMulFloats4(tolerance, sqrLength);
+		const int valid = ~rcGreaterMaskFloats4(minSqrLength, sqrLength);
+		const int walkable = valid & rcGreaterMaskFloats4(signedSqrY, rcAddFloats4(limit, margin));
+		const int unwalkable = valid & rcGreaterMaskFloats4(rcSubFloats4(limit, margin), signedSqrY);
+		const int exact = ~(walkable | unwalkable);
+		for (int k = 0; k < 4; ++k)
+		{
+			if (exact & (1 << k))
+			{
+				setTriSlopeExact(job, i + k);
+			}
+			else
+			{
+				setTriSlope(job, i + k, (walkable & (1 << k)) != 0);
+			}
+		}
+	}
+#endif
+
+	for (; i < endTri; ++i)
 	{
 		const int* tri = &tris[i * 3];
-		calcTriNormal(&verts[tri[0] * 3], &verts[tri[1] * 3], &verts[tri[2] * 3], norm);
-		// Check if the face is walkable.
-		if (norm[1] > walkableThr)
+		const float* v0 = &verts[tri[0] * 3];
+		float e0[3], e1[3], norm[3];
+		rcVsub(e0, &verts[tri[1] * 3], v0);
+		rcVsub(e1, &verts[tri[2] * 3], v0);
+		rcVcross(norm, e0, e1);
+
+		const float sqrLength = rcVdot(norm, norm);
+		const float signedSqrY = norm[1] * rcAbs(norm[1]);
+		const float limit = job.signedSqrLimitY * sqrLength;
+		const float margin = SLOPE_SQUARED_TOLERANCE * sqrLength;
+		if (sqrLength >= SLOPE_MIN_SQUARED_LENGTH && signedSqrY > limit + margin)
+		{
+			setTriSlope(job, i, true);
+		}
+		else if (sqrLength >= SLOPE_MIN_SQUARED_LENGTH && signedSqrY < limit - margin)
+		{
+			setTriSlope(job, i, false);
+		}
+		else
 		{
-			triAreaIDs[i] = RC_WALKABLE_AREA;
+			setTriSlopeExact(job, i);
 		}
 	}
 }
 
+/// Classifies the slopes of the triangles, in parallel when there is a context.
+static void classifyTriSlopes(rcContext* context, const float walkableSlopeAngle, const float* verts,
+                              const int* tris, const int numTris, unsigned char* triAreaIDs, const bool clearUnwalkable)
+{
+	rcTriSlopeJob job;
+	job.verts = verts;
+	job.tris = tris;
+	job.numTris = numTris;
+	job.triAreaIDs = triAreaIDs;
+	job.walkableLimitY = cosf(walkableSlopeAngle / 180.0f * RC_PI);
+	job.signedSqrLimitY = job.walkableLimitY * rcAbs(job.walkableLimitY);
+	job.clearUnwalkable = clearUnwalkable;
+
+	const int numItems = (numTris + SLOPE_TRIS_PER_ITEM - 1) / SLOPE_TRIS_PER_ITEM;
+	if (context)
+	{
+		context->parallelFor(numItems, classifyTriSlopes, &job);
+	}
+	else if (numItems > 0)
+	{
+		classifyTriSlopes(&job, 0, numItems, 0);
+	}
+}
+
+void rcMarkWalkableTriangles(rcContext* context, const float walkableSlopeAngle,
+                             const float* verts, const int numVerts,
+                             const int* tris, const int numTris,
+                             unsigned char* triAreaIDs)
+{
+	rcIgnoreUnused(numVerts);
+
+	classifyTriSlopes(context, walkableSlopeAngle, verts, tris, numTris, triAreaIDs, false);
+}
+
 void rcClearUnwalkableTriangles(rcContext* context, const float walkableSlopeAngle,
                                 const float* verts, int numVerts,
                                 const int* tris, int numTris,
                                 unsigned char* triAreaIDs)
 {
-	rcIgnoreUnused(context);
 	rcIgnoreUnused(numVerts);
 
-	// The minimum Y value for a face normal of a triangle with a walkable slope.
-	const float walkableLimitY = cosf(walkableSlopeAngle / 180.0f * RC_PI);
-
-	float faceNormal[3];
-	for (int i = 0; i < numTris; ++i)
-	{
-		const int* tri = &tris[i * 3];
-		calcTriNormal(&verts[tri[0] * 3], &verts[tri[1] * 3], &verts[tri[2] * 3], faceNormal);
-		// Check if the face is walkable.
-		if (faceNormal[1] <= walkableLimitY)
-		{
-			triAreaIDs[i] = RC_NULL_AREA;
-		}
-	}
+	classifyTriSlopes(context, walkableSlopeAngle, verts, tris, numTris, triAreaIDs, true);
 }
 
 int rcGetHeightFieldSpanCount(rcContext* context, const rcHeightfield& heightfield)
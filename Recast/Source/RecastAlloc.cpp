@@ -37,8 +37,35 @@ void rcAllocSetCustom(rcAllocFunc* allocFunc, rcFreeFunc* freeFunc)
 	sRecastFreeFunc = freeFunc ? freeFunc : rcFreeDefault;
 }
 
+void rcAllocGetCustom(rcAllocFunc** allocFunc, rcFreeFunc** freeFunc)
+{
+	*allocFunc = sRecastAllocFunc;
+	*freeFunc = sRecastFreeFunc;
+}
+
+static rcArena* sRecastArenas = NULL;
+static int sRecastArenaCount = 0;
+static rcArenaIndexFunc* sRecastArenaIndexFunc = NULL;
+
+void rcAllocSetArenas(rcArena* arenas, int count, rcArenaIndexFunc* indexFunc)
+{
+	sRecastArenas = count > 0 ? arenas : NULL;
+	sRecastArenaCount = arenas != NULL ? count : 0;
+	sRecastArenaIndexFunc = indexFunc;
+}
+
 void* rcAlloc(size_t size, rcAllocHint hint)
 {
+	if (hint == RC_ALLOC_TEMP && sRecastArenas != NULL)
+	{
+		const int index = sRecastArenaIndexFunc ? sRecastArenaIndexFunc() : 0;
+		if (index >= 0 && index < sRecastArenaCount)
+		{
+			void* ptr = sRecastArenas[index].alloc(size);
+			if (ptr != NULL)
+				return ptr;
+		}
+	}
 	return sRecastAllocFunc(size, hint);
 }
 
@@ -46,6 +73,47 @@ void rcFree(void* ptr)
 {
 	if (ptr != NULL)
 	{
+		for (int i = 0; i < sRecastArenaCount; ++i)
+		{
+			if (sRecastArenas[i].owns(ptr))
+				return;
+		}
 		sRecastFreeFunc(ptr);
 	}
 }
+
+rcArena::rcArena() : m_buffer(NULL), m_capacity(0), m_used(0)
+{
+}
+
+rcArena::~rcArena()
+{
+	free(m_buffer);
+}
+
+bool rcArena::init(size_t capacity)
+{
+	// The buffer comes from malloc, as the arena may be serving the custom allocation functions.
+	free(m_buffer);
+	m_buffer = (unsigned char*)malloc(capacity);
+	m_capacity = m_buffer != NULL ? capacity : 0;
+	m_used = 0;
+	return m_buffer != NULL;
+}
+
+void* rcArena::alloc(size_t size)
+{
+	// Empty blocks still take space, so that every block points inside the buffer.
+	const size_t alignedSize = ((size > 0 ? size : 1) + 15) & ~(size_t)15;
+	if (alignedSize < size || alignedSize > m_capacity - m_used)
+		return NULL;
+	void* ptr = m_buffer + m_used;
+	m_used += alignedSize;
+	return ptr;
+}
+
+void rcArena::reset(size_t mark)
+{
+	rcAssert(mark <= m_used);
+	m_used = mark;
+}
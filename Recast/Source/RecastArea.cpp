@@ -22,25 +22,73 @@
 
 #include <string.h> // for memcpy and memset
 
-/// Sorts the given data in-place using insertion sort.
+// The erosion and median filter passes process 16 bytes at a time with SSE2 or NEON when
+// available. Define RC_DISABLE_SIMD to always use the generic code.
+#if !defined(RC_DISABLE_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RC_AREA_SIMD
+typedef __m128i rcBytes16;
+inline rcBytes16 rcLoadBytes16(const unsigned char* p) { return _mm_loadu_si128((const __m128i*)p); }
+inline void rcStoreBytes16(unsigned char* p, const rcBytes16 v) { _mm_storeu_si128((__m128i*)p, v); }
+inline rcBytes16 rcSplatBytes16(const unsigned char v) { return _mm_set1_epi8((char)v); }
+inline rcBytes16 rcMinBytes16(const rcBytes16 a, const rcBytes16 b) { return _mm_min_epu8(a, b); }
+inline rcBytes16 rcMaxBytes16(const rcBytes16 a, const rcBytes16 b) { return _mm_max_epu8(a, b); }
+inline rcBytes16 rcAddSatBytes16(const rcBytes16 a, const rcBytes16 b) { return _mm_adds_epu8(a, b); }
+inline rcBytes16 rcAndBytes16(const rcBytes16 a, const rcBytes16 b) { return _mm_and_si128(a, b); }
+inline rcBytes16 rcOrNotBytes16(const rcBytes16 a, const rcBytes16 b) { return _mm_or_si128(a, _mm_xor_si128(b, _mm_set1_epi8(-1))); }
+inline rcBytes16 rcTestBytes16(const rcBytes16 a, const rcBytes16 bit) { return _mm_cmpeq_epi8(_mm_and_si128(a, bit), bit); }
+inline rcBytes16 rcGreaterEqualBytes16(const rcBytes16 a, const rcBytes16 b) { return _mm_cmpeq_epi8(_mm_max_epu8(a, b), a); }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RC_AREA_SIMD
+typedef uint8x16_t rcBytes16;
+inline rcBytes16 rcLoadBytes16(const unsigned char* p) { return vld1q_u8(p); }
+inline void rcStoreBytes16(unsigned char* p, const rcBytes16 v) { vst1q_u8(p, v); }
+inline rcBytes16 rcSplatBytes16(const unsigned char v) { return vdupq_n_u8(v); }
+inline rcBytes16 rcMinBytes16(const rcBytes16 a, const rcBytes16 b) { return vminq_u8(a, b); }
+inline rcBytes16 rcMaxBytes16(const rcBytes16 a, const rcBytes16 b) { return vmaxq_u8(a, b); }
+inline rcBytes16 rcAddSatBytes16(const rcBytes16 a, const rcBytes16 b) { return vqaddq_u8(a, b); }
+inline rcBytes16 rcAndBytes16(const rcBytes16 a, const rcBytes16 b) { return vandq_u8(a, b); }
+inline rcBytes16 rcOrNotBytes16(const rcBytes16 a, const rcBytes16 b) { return vornq_u8(a, b); }
+inline rcBytes16 rcTestBytes16(const rcBytes16 a, const rcBytes16 bit) { return vtstq_u8(a, bit); }
+inline rcBytes16 rcGreaterEqualBytes16(const rcBytes16 a, const rcBytes16 b) { return vcgeq_u8(a, b); }
+#endif
+#endif
+
+/// Orders two values so that @p a is the smaller one.
+inline void sortPair(unsigned char& a, unsigned char& b)
+{
+	const unsigned char lo = rcMin(a, b);
+	b = rcMax(a, b);
+	a = lo;
+}
+
+#ifdef RC_AREA_SIMD
+inline void sortPair(rcBytes16& a, rcBytes16& b)
+{
+	const rcBytes16 lo = rcMinBytes16(a, b);
+	b = rcMaxBytes16(a, b);
+	a = lo;
+}
+#endif
+
+/// Finds the median of 9 values with a sorting network. The values are partially reordered.
 ///
-/// @param	data		The data to sort
-/// @param	dataLength	The number of elements in @p data
-static void insertSort(unsigned char* data, const int dataLength)
+/// @param	values	The 9 values (or vectors of values).
+/// @returns The median value.
+template<class T>
+static T median9(T* values)
 {
-	for (int valueIndex = 1; valueIndex < dataLength; valueIndex++)
-	{
-		const unsigned char value = data[valueIndex];
-		int insertionIndex;
-		for (insertionIndex = valueIndex - 1; insertionIndex >= 0 && data[insertionIndex] > value; insertionIndex--)
-		{
-			// Shift over values
-			data[insertionIndex + 1] = data[insertionIndex];
-		}
-		
-		// Insert the value in sorted order.
-		data[insertionIndex + 1] = value;
-	}
+	T* p = values;
+	sortPair(p[1], p[2]); sortPair(p[4], p[5]); sortPair(p[7], p[8]);
+	sortPair(p[0], p[1]); sortPair(p[3], p[4]); sortPair(p[6], p[7]);
+	sortPair(p[1], p[2]); sortPair(p[4], p[5]); sortPair(p[7], p[8]);
+	sortPair(p[0], p[3]); sortPair(p[5], p[8]); sortPair(p[4], p[7]);
+	sortPair(p[3], p[6]); sortPair(p[1], p[4]); sortPair(p[2], p[5]);
+	sortPair(p[4], p[7]); sortPair(p[4], p[2]); sortPair(p[6], p[4]);
+	sortPair(p[4], p[2]);
+	return p[4];
 }
 
 // TODO (graham): This is duplicated in the ConvexVolumeTool in RecastDemo
@@ -72,6 +120,322 @@ static bool pointInPoly(int numVerts, const float* verts, const float* point)
 	return inPoly;
 }
 
+/// Returns the distance increased by @p cost, clamped to 255.
+inline unsigned char addDistance(const unsigned char distance, const int cost)
+{
+	return (unsigned char)rcMin((int)distance + cost, 255);
+}
+
+/// Runs the first (forward) chamfer pass over the spans of row @p z.
+static void erodeForwardRow(const rcCompactHeightfield& compactHeightfield, unsigned char* distanceToBoundary, const int z)
+{
+	const int xSize = compactHeightfield.width;
+	for (int x = 0; x < xSize; ++x)
+	{
+		const rcCompactCell& cell = compactHeightfield.cells[x + z * xSize];
+		const int maxSpanIndex = (int)(cell.index + cell.count);
+		for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
+		{
+			const rcCompactSpan& span = compactHeightfield.spans[spanIndex];
+			unsigned char newDistance;
+
+			if (rcGetCon(span, 0) != RC_NOT_CONNECTED)
+			{
+				// (-1,0)
+				const int aX = x + rcGetDirOffsetX(0);
+				const int aY = z + rcGetDirOffsetY(0);
+				const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 0);
+				const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
+				newDistance = addDistance(distanceToBoundary[aIndex], 2);
+				if (newDistance < distanceToBoundary[spanIndex])
+				{
+					distanceToBoundary[spanIndex] = newDistance;
+				}
+
+				// (-1,-1)
+				if (rcGetCon(aSpan, 3) != RC_NOT_CONNECTED)
+				{
+					const int bX = aX + rcGetDirOffsetX(3);
+					const int bY = aY + rcGetDirOffsetY(3);
+					const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 3);
+					newDistance = addDistance(distanceToBoundary[bIndex], 3);
+					if (newDistance < distanceToBoundary[spanIndex])
+					{
+						distanceToBoundary[spanIndex] = newDistance;
+					}
+				}
+			}
+			if (rcGetCon(span, 3) != RC_NOT_CONNECTED)
+			{
+				// (0,-1)
+				const int aX = x + rcGetDirOffsetX(3);
+				const int aY = z + rcGetDirOffsetY(3);
+				const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 3);
+				const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
+				newDistance = addDistance(distanceToBoundary[aIndex], 2);
+				if (newDistance < distanceToBoundary[spanIndex])
+				{
+					distanceToBoundary[spanIndex] = newDistance;
+				}
+
+				// (1,-1)
+				if (rcGetCon(aSpan, 2) != RC_NOT_CONNECTED)
+				{
+					const int bX = aX + rcGetDirOffsetX(2);
+					const int bY = aY + rcGetDirOffsetY(2);
+					const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 2);
+					newDistance = addDistance(distanceToBoundary[bIndex], 3);
+					if (newDistance < distanceToBoundary[spanIndex])
+					{
+						distanceToBoundary[spanIndex] = newDistance;
+					}
+				}
+			}
+		}
+	}
+}
+
+/// Runs the second (backward) chamfer pass over the spans of row @p z.
+static void erodeBackwardRow(const rcCompactHeightfield& compactHeightfield, unsigned char* distanceToBoundary, const int z)
+{
+	const int xSize = compactHeightfield.width;
+	for (int x = xSize - 1; x >= 0; --x)
+	{
+		const rcCompactCell& cell = compactHeightfield.cells[x + z * xSize];
+		const int maxSpanIndex = (int)(cell.index + cell.count);
+		for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
+		{
+			const rcCompactSpan& span = compactHeightfield.spans[spanIndex];
+			unsigned char newDistance;
+
+			if (rcGetCon(span, 2) != RC_NOT_CONNECTED)
+			{
+				// (1,0)
+				const int aX = x + rcGetDirOffsetX(2);
+				const int aY = z + rcGetDirOffsetY(2);
+				const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 2);
+				const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
+				newDistance = addDistance(distanceToBoundary[aIndex], 2);
+				if (newDistance < distanceToBoundary[spanIndex])
+				{
+					distanceToBoundary[spanIndex] = newDistance;
+				}
+
+				// (1,1)
+				if (rcGetCon(aSpan, 1) != RC_NOT_CONNECTED)
+				{
+					const int bX = aX + rcGetDirOffsetX(1);
+					const int bY = aY + rcGetDirOffsetY(1);
+					const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 1);
+					newDistance = addDistance(distanceToBoundary[bIndex], 3);
+					if (newDistance < distanceToBoundary[spanIndex])
+					{
+						distanceToBoundary[spanIndex] = newDistance;
+					}
+				}
+			}
+			if (rcGetCon(span, 1) != RC_NOT_CONNECTED)
+			{
+				// (0,1)
+				const int aX = x + rcGetDirOffsetX(1);
+				const int aY = z + rcGetDirOffsetY(1);
+				const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 1);
+				const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
+				newDistance = addDistance(distanceToBoundary[aIndex], 2);
+				if (newDistance < distanceToBoundary[spanIndex])
+				{
+					distanceToBoundary[spanIndex] = newDistance;
+				}
+
+				// (-1,1)
+				if (rcGetCon(aSpan, 0) != RC_NOT_CONNECTED)
+				{
+					const int bX = aX + rcGetDirOffsetX(0);
+					const int bY = aY + rcGetDirOffsetY(0);
+					const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 0);
+					newDistance = addDistance(distanceToBoundary[bIndex], 3);
+					if (newDistance < distanceToBoundary[spanIndex])
+					{
+						distanceToBoundary[spanIndex] = newDistance;
+					}
+				}
+			}
+		}
+	}
+}
+
+/// Checks if every cell of row @p z holds at most one span.
+static bool isSingleLayerRow(const rcCompactHeightfield& compactHeightfield, const int z)
+{
+	const rcCompactCell* cells = &compactHeightfield.cells[z * compactHeightfield.width];
+	for (int x = 0; x < compactHeightfield.width; ++x)
+	{
+		if (cells[x].count > 1)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Returns the connection bits of a span, bit n is set if the span is connected in direction n.
+inline unsigned char getConnectionBits(const rcCompactSpan& span)
+{
+	unsigned char bits = 0;
+	for (int dir = 0; dir < 4; ++dir)
+	{
+		bits |= (unsigned char)((rcGetCon(span, dir) != RC_NOT_CONNECTED ? 1 : 0) << dir);
+	}
+	return bits;
+}
+
+/// Copies the distances and connection bits of a single layer row into padded row buffers.
+/// Empty cells and rows outside of the heightfield have no connections.
+static void gatherLayerRow(const rcCompactHeightfield& compactHeightfield, const unsigned char* distanceToBoundary,
+                           const unsigned char* spanConnections, const int z,
+                           unsigned char* rowDistance, unsigned char* rowConnections)
+{
+	const int xSize = compactHeightfield.width;
+	memset(rowDistance, 0xff, xSize + 2);
+	memset(rowConnections, 0, xSize + 2);
+	if (z < 0 || z >= compactHeightfield.height)
+	{
+		return;
+	}
+	const rcCompactCell* cells = &compactHeightfield.cells[z * xSize];
+	for (int x = 0; x < xSize; ++x)
+	{
+		if (cells[x].count != 0)
+		{
+			rowDistance[x + 1] = distanceToBoundary[cells[x].index];
+			rowConnections[x + 1] = spanConnections[cells[x].index];
+		}
+	}
+}
+
+/// Updates the distances of a single layer row from the adjacent row in direction @p dir,
+/// (the row above in the forward pass, below in the backward pass) including the diagonals.
+/// The row buffers are padded by one element at both ends.
+///
+/// @param[in,out]	rowDistance				The distances of the row.
+/// @param[in]		rowConnections			The connection bits of the row.
+/// @param[in]		adjacentDistance		The final distances of the adjacent row.
+/// @param[in]		adjacentConnections		The connection bits of the adjacent row.
+/// @param[in]		width					The number of cells in the row.
+/// @param[in]		dir						The direction of the adjacent row.
+/// @param[in]		nearSide				The direction along the row of the diagonal that is reached through the row.
+/// @param[in]		farSide					The direction along the row of the diagonal that is reached through the adjacent row.
+static void erodeFromAdjacentRow(unsigned char* rowDistance, const unsigned char* rowConnections,
+                                 const unsigned char* adjacentDistance, const unsigned char* adjacentConnections,
+                                 const int width, const int dir, const int nearSide, const int farSide)
+{
+	const int nearOffset = rcGetDirOffsetX(nearSide);
+	const int farOffset = rcGetDirOffsetX(farSide);
+	const unsigned char dirBit = (unsigned char)(1 << dir);
+	const unsigned char nearBit = (unsigned char)(1 << nearSide);
+	const unsigned char farBit = (unsigned char)(1 << farSide);
+
+	int i = 1;
+#ifdef RC_AREA_SIMD
+	const rcBytes16 dirBits = rcSplatBytes16(dirBit);
+	const rcBytes16 nearBits = rcSplatBytes16(nearBit);
+	const rcBytes16 farBits = rcSplatBytes16(farBit);
+	const rcBytes16 straightCost = rcSplatBytes16(2);
+	const rcBytes16 diagonalCost = rcSplatBytes16(3);
+	for (; i + 16 <= width + 1; i += 16)
+	{
+		const rcBytes16 connections = rcLoadBytes16(rowConnections + i);
+		const rcBytes16 hasDir = rcTestBytes16(connections, dirBits);
+		const rcBytes16 hasNear = rcAndBytes16(rcTestBytes16(connections, nearBits),
+		                                       rcTestBytes16(rcLoadBytes16(rowConnections + i + nearOffset), dirBits));
+		const rcBytes16 hasFar = rcAndBytes16(hasDir, rcTestBytes16(rcLoadBytes16(adjacentConnections + i), farBits));
+
+		// Unconnected neighbours contribute 255, which never lowers the distance.
+		const rcBytes16 straight = rcOrNotBytes16(rcAddSatBytes16(rcLoadBytes16(adjacentDistance + i), straightCost), hasDir);
+		const rcBytes16 nearDiagonal = rcOrNotBytes16(rcAddSatBytes16(rcLoadBytes16(adjacentDistance + i + nearOffset), diagonalCost), hasNear);
+		const rcBytes16 farDiagonal = rcOrNotBytes16(rcAddSatBytes16(rcLoadBytes16(adjacentDistance + i + farOffset), diagonalCost), hasFar);
+
+		const rcBytes16 distance = rcMinBytes16(rcLoadBytes16(rowDistance + i), rcMinBytes16(straight, rcMinBytes16(nearDiagonal, farDiagonal)));
+		rcStoreBytes16(rowDistance + i, distance);
+	}
+#endif
+	for (; i < width + 1; ++i)
+	{
+		unsigned char distance = rowDistance[i];
+		if (rowConnections[i] & dirBit)
+		{
+			distance = rcMin(distance, addDistance(adjacentDistance[i], 2));
+			if (adjacentConnections[i] & farBit)
+			{
+				distance = rcMin(distance, addDistance(adjacentDistance[i + farOffset], 3));
+			}
+		}
+		if ((rowConnections[i] & nearBit) && (rowConnections[i + nearOffset] & dirBit))
+		{
+			distance = rcMin(distance, addDistance(adjacentDistance[i + nearOffset], 3));
+		}
+		rowDistance[i] = distance;
+	}
+}
+
+/// Runs a chamfer pass over row @p z if it and the adjacent row are single layer.
+/// The row is processed with erodeFromAdjacentRow and a scan along the row.
+///
+/// @returns false if the generic path must be used for the row.
+static bool erodeLayerRow(const rcCompactHeightfield& compactHeightfield, unsigned char* distanceToBoundary,
+                          const unsigned char* singleLayerRows, const unsigned char* spanConnections,
+                          unsigned char* rowBuffers, const int z, const bool forward)
+{
+	const int xSize = compactHeightfield.width;
+	const int adjacentZ = forward ? z - 1 : z + 1;
+	if (!singleLayerRows[z] || (adjacentZ >= 0 && adjacentZ < compactHeightfield.height && !singleLayerRows[adjacentZ]))
+	{
+		return false;
+	}
+
+	unsigned char* rowDistance = rowBuffers;
+	unsigned char* rowConnections = rowBuffers + (xSize + 2);
+	unsigned char* adjacentDistance = rowBuffers + (xSize + 2) * 2;
+	unsigned char* adjacentConnections = rowBuffers + (xSize + 2) * 3;
+	gatherLayerRow(compactHeightfield, distanceToBoundary, spanConnections, z, rowDistance, rowConnections);
+	gatherLayerRow(compactHeightfield, distanceToBoundary, spanConnections, adjacentZ, adjacentDistance, adjacentConnections);
+
+	if (forward)
+	{
+		// (0,-1), (-1,-1) and (1,-1), then (-1,0) from left to right.
+		erodeFromAdjacentRow(rowDistance, rowConnections, adjacentDistance, adjacentConnections, xSize, 3, 0, 2);
+		for (int i = 1; i < xSize + 1; ++i)
+		{
+			if (rowConnections[i] & (1 << 0))
+			{
+				rowDistance[i] = rcMin(rowDistance[i], addDistance(rowDistance[i - 1], 2));
+			}
+		}
+	}
+	else
+	{
+		// (0,1), (1,1) and (-1,1), then (1,0) from right to left.
+		erodeFromAdjacentRow(rowDistance, rowConnections, adjacentDistance, adjacentConnections, xSize, 1, 2, 0);
+		for (int i = xSize; i >= 1; --i)
+		{
+			if (rowConnections[i] & (1 << 2))
+			{
+				rowDistance[i] = rcMin(rowDistance[i], addDistance(rowDistance[i + 1], 2));
+			}
+		}
+	}
+
+	const rcCompactCell* cells = &compactHeightfield.cells[z * xSize];
+	for (int x = 0; x < xSize; ++x)
+	{
+		if (cells[x].count != 0)
+		{
+			distanceToBoundary[cells[x].index] = rowDistance[x + 1];
+		}
+	}
+	return true;
+}
+
 bool rcErodeWalkableArea(rcContext* context, const int erosionRadius, rcCompactHeightfield& compactHeightfield)
 {
 	rcAssert(context != NULL);
@@ -90,6 +454,26 @@ bool rcErodeWalkableArea(rcContext* context, const int erosionRadius, rcCompactH
 		return false;
 	}
 	memset(distanceToBoundary, 0xff, sizeof(unsigned char) * compactHeightfield.spanCount);
+
+	// Single layer flag per row, connection bits per span and 4 padded row buffers for erodeLayerRow.
+	const int layerBufferSize = zSize + compactHeightfield.spanCount + (xSize + 2) * 4;
+	unsigned char* singleLayerRows = (unsigned char*)rcAlloc(sizeof(unsigned char) * layerBufferSize, RC_ALLOC_TEMP);
+	if (!singleLayerRows)
+	{
+		context->log(RC_LOG_ERROR, "erodeWalkableArea: Out of memory 'singleLayerRows' (%d).", layerBufferSize);
+		rcFree(distanceToBoundary);
+		return false;
+	}
+	unsigned char* spanConnections = singleLayerRows + zSize;
+	unsigned char* rowBuffers = spanConnections + compactHeightfield.spanCount;
+	for (int z = 0; z < zSize; ++z)
+	{
+		singleLayerRows[z] = isSingleLayerRow(compactHeightfield, z) ? 1 : 0;
+	}
+	for (int spanIndex = 0; spanIndex < compactHeightfield.spanCount; ++spanIndex)
+	{
+		spanConnections[spanIndex] = getConnectionBits(compactHeightfield.spans[spanIndex]);
+	}
 	
 	// Mark boundary cells.
 	for (int z = 0; z < zSize; ++z)
@@ -136,144 +520,38 @@ bool rcErodeWalkableArea(rcContext* context, const int erosionRadius, rcCompactH
 		}
 	}
 	
-	unsigned char newDistance;
-	
 	// Pass 1
 	for (int z = 0; z < zSize; ++z)
 	{
-		for (int x = 0; x < xSize; ++x)
+		if (!erodeLayerRow(compactHeightfield, distanceToBoundary, singleLayerRows, spanConnections, rowBuffers, z, true))
 		{
-			const rcCompactCell& cell = compactHeightfield.cells[x + z * zStride];
-			const int maxSpanIndex = (int)(cell.index + cell.count);
-			for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
-			{
-				const rcCompactSpan& span = compactHeightfield.spans[spanIndex];
-
-				if (rcGetCon(span, 0) != RC_NOT_CONNECTED)
-				{
-					// (-1,0)
-					const int aX = x + rcGetDirOffsetX(0);
-					const int aY = z + rcGetDirOffsetY(0);
-					const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 0);
-					const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
-					newDistance = (unsigned char)rcMin((int)distanceToBoundary[aIndex] + 2, 255);
-					if (newDistance < distanceToBoundary[spanIndex])
-					{
-						distanceToBoundary[spanIndex] = newDistance;
-					}
-
-					// (-1,-1)
-					if (rcGetCon(aSpan, 3) != RC_NOT_CONNECTED)
-					{
-						const int bX = aX + rcGetDirOffsetX(3);
-						const int bY = aY + rcGetDirOffsetY(3);
-						const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 3);
-						newDistance = (unsigned char)rcMin((int)distanceToBoundary[bIndex] + 3, 255);
-						if (newDistance < distanceToBoundary[spanIndex])
-						{
-							distanceToBoundary[spanIndex] = newDistance;
-						}
-					}
-				}
-				if (rcGetCon(span, 3) != RC_NOT_CONNECTED)
-				{
-					// (0,-1)
-					const int aX = x + rcGetDirOffsetX(3);
-					const int aY = z + rcGetDirOffsetY(3);
-					const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 3);
-					const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
-					newDistance = (unsigned char)rcMin((int)distanceToBoundary[aIndex] + 2, 255);
-					if (newDistance < distanceToBoundary[spanIndex])
-					{
-						distanceToBoundary[spanIndex] = newDistance;
-					}
-
-					// (1,-1)
-					if (rcGetCon(aSpan, 2) != RC_NOT_CONNECTED)
-					{
-						const int bX = aX + rcGetDirOffsetX(2);
-						const int bY = aY + rcGetDirOffsetY(2);
-						const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 2);
-						newDistance = (unsigned char)rcMin((int)distanceToBoundary[bIndex] + 3, 255);
-						if (newDistance < distanceToBoundary[spanIndex])
-						{
-							distanceToBoundary[spanIndex] = newDistance;
-						}
-					}
-				}
-			}
+			erodeForwardRow(compactHeightfield, distanceToBoundary, z);
 		}
 	}
 
 	// Pass 2
 	for (int z = zSize - 1; z >= 0; --z)
 	{
-		for (int x = xSize - 1; x >= 0; --x)
+		if (!erodeLayerRow(compactHeightfield, distanceToBoundary, singleLayerRows, spanConnections, rowBuffers, z, false))
 		{
-			const rcCompactCell& cell = compactHeightfield.cells[x + z * zStride];
-			const int maxSpanIndex = (int)(cell.index + cell.count);
-			for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
-			{
-				const rcCompactSpan& span = compactHeightfield.spans[spanIndex];
-
-				if (rcGetCon(span, 2) != RC_NOT_CONNECTED)
-				{
-					// (1,0)
-					const int aX = x + rcGetDirOffsetX(2);
-					const int aY = z + rcGetDirOffsetY(2);
-					const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 2);
-					const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
-					newDistance = (unsigned char)rcMin((int)distanceToBoundary[aIndex] + 2, 255);
-					if (newDistance < distanceToBoundary[spanIndex])
-					{
-						distanceToBoundary[spanIndex] = newDistance;
-					}
-
-					// (1,1)
-					if (rcGetCon(aSpan, 1) != RC_NOT_CONNECTED)
-					{
-						const int bX = aX + rcGetDirOffsetX(1);
-						const int bY = aY + rcGetDirOffsetY(1);
-						const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 1);
-						newDistance = (unsigned char)rcMin((int)distanceToBoundary[bIndex] + 3, 255);
-						if (newDistance < distanceToBoundary[spanIndex])
-						{
-							distanceToBoundary[spanIndex] = newDistance;
-						}
-					}
-				}
-				if (rcGetCon(span, 1) != RC_NOT_CONNECTED)
-				{
-					// (0,1)
-					const int aX = x + rcGetDirOffsetX(1);
-					const int aY = z + rcGetDirOffsetY(1);
-					const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 1);
-					const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
-					newDistance = (unsigned char)rcMin((int)distanceToBoundary[aIndex] + 2, 255);
-					if (newDistance < distanceToBoundary[spanIndex])
-					{
-						distanceToBoundary[spanIndex] = newDistance;
-					}
-
-					// (-1,1)
-					if (rcGetCon(aSpan, 0) != RC_NOT_CONNECTED)
-					{
-						const int bX = aX + rcGetDirOffsetX(0);
-						const int bY = aY + rcGetDirOffsetY(0);
-						const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 0);
-						newDistance = (unsigned char)rcMin((int)distanceToBoundary[bIndex] + 3, 255);
-						if (newDistance < distanceToBoundary[spanIndex])
-						{
-							distanceToBoundary[spanIndex] = newDistance;
-						}
-					}
-				}
-			}
+			erodeBackwardRow(compactHeightfield, distanceToBoundary, z);
 		}
 	}
 
+	rcFree(singleLayerRows);
+
 	const unsigned char minBoundaryDistance = (unsigned char)(erosionRadius * 2);
-	for (int spanIndex = 0; spanIndex < compactHeightfield.spanCount; ++spanIndex)
+	int spanIndex = 0;
+#ifdef RC_AREA_SIMD
+	// RC_NULL_AREA is zero, so masking the area clears it.
+	const rcBytes16 minDistance = rcSplatBytes16(minBoundaryDistance);
+	for (; spanIndex + 16 <= compactHeightfield.spanCount; spanIndex += 16)
+	{
+		const rcBytes16 keep = rcGreaterEqualBytes16(rcLoadBytes16(distanceToBoundary + spanIndex), minDistance);
+		rcStoreBytes16(compactHeightfield.areas + spanIndex, rcAndBytes16(rcLoadBytes16(compactHeightfield.areas + spanIndex), keep));
+	}
+#endif
+	for (; spanIndex < compactHeightfield.spanCount; ++spanIndex)
 	{
 		if (distanceToBoundary[spanIndex] < minBoundaryDistance)
 		{
@@ -286,6 +564,39 @@ bool rcErodeWalkableArea(rcContext* context, const int erosionRadius, rcCompactH
 	return true;
 }
 
+/// Writes the medians of a batch of up to 16 spans.
+///
+/// @param[in]	neighborAreas	The 9 areas around each span, one row per neighbour and one column per span.
+/// @param[in]	spanIndices		The spans in the batch.
+/// @param[in]	spanCount		The number of spans in the batch.
+/// @param[out]	areas			The filtered areas.
+static void medianFilterBatch(unsigned char neighborAreas[9][16], const int* spanIndices, const int spanCount, unsigned char* areas)
+{
+#ifdef RC_AREA_SIMD
+	rcBytes16 values[9];
+	for (int neighborIndex = 0; neighborIndex < 9; ++neighborIndex)
+	{
+		values[neighborIndex] = rcLoadBytes16(neighborAreas[neighborIndex]);
+	}
+	unsigned char medians[16];
+	rcStoreBytes16(medians, median9(values));
+	for (int i = 0; i < spanCount; ++i)
+	{
+		areas[spanIndices[i]] = medians[i];
+	}
+#else
+	for (int i = 0; i < spanCount; ++i)
+	{
+		unsigned char values[9];
+		for (int neighborIndex = 0; neighborIndex < 9; ++neighborIndex)
+		{
+			values[neighborIndex] = neighborAreas[neighborIndex][i];
+		}
+		areas[spanIndices[i]] = median9(values);
+	}
+#endif
+}
+
 bool rcMedianFilterWalkableArea(rcContext* context, rcCompactHeightfield& compactHeightfield)
 {
 	rcAssert(context);
@@ -305,6 +616,12 @@ bool rcMedianFilterWalkableArea(rcContext* context, rcCompactHeightfield& compac
 	}
 	memset(areas, 0xff, sizeof(unsigned char) * compactHeightfield.spanCount);
 
+	// The spans are filtered in batches of 16, see medianFilterBatch.
+	unsigned char neighborAreas[9][16];
+	int batchSpans[16];
+	int batchSize = 0;
+	memset(neighborAreas, 0, sizeof(neighborAreas));
+
 	for (int z = 0; z < zSize; ++z)
 	{
 		for (int x = 0; x < xSize; ++x)
@@ -320,10 +637,9 @@ bool rcMedianFilterWalkableArea(rcContext* context, rcCompactHeightfield& compac
 					continue;
 				}
 
-				unsigned char neighborAreas[9];
 				for (int neighborIndex = 0; neighborIndex < 9; ++neighborIndex)
 				{
-					neighborAreas[neighborIndex] = compactHeightfield.areas[spanIndex];
+					neighborAreas[neighborIndex][batchSize] = compactHeightfield.areas[spanIndex];
 				}
 
 				for (int dir = 0; dir < 4; ++dir)
@@ -338,7 +654,7 @@ bool rcMedianFilterWalkableArea(rcContext* context, rcCompactHeightfield& compac
 					const int aIndex = (int)compactHeightfield.cells[aX + aZ * zStride].index + rcGetCon(span, dir);
 					if (compactHeightfield.areas[aIndex] != RC_NULL_AREA)
 					{
-						neighborAreas[dir * 2 + 0] = compactHeightfield.areas[aIndex];
+						neighborAreas[dir * 2 + 0][batchSize] = compactHeightfield.areas[aIndex];
 					}
 
 					const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
@@ -351,15 +667,24 @@ bool rcMedianFilterWalkableArea(rcContext* context, rcCompactHeightfield& compac
 						const int bIndex = (int)compactHeightfield.cells[bX + bZ * zStride].index + neighborConnection2;
 						if (compactHeightfield.areas[bIndex] != RC_NULL_AREA)
 						{
-							neighborAreas[dir * 2 + 1] = compactHeightfield.areas[bIndex];
+							neighborAreas[dir * 2 + 1][batchSize] = compactHeightfield.areas[bIndex];
 						}
 					}
 				}
-				insertSort(neighborAreas, 9);
-				areas[spanIndex] = neighborAreas[4];
+
+				batchSpans[batchSize++] = spanIndex;
+				if (batchSize == 16)
+				{
+					medianFilterBatch(neighborAreas, batchSpans, batchSize, areas);
+					batchSize = 0;
+				}
 			}
 		}
 	}
+	if (batchSize > 0)
+	{
+		medianFilterBatch(neighborAreas, batchSpans, batchSize, areas);
+	}
 
 	memcpy(compactHeightfield.areas, areas, sizeof(unsigned char) * compactHeightfield.spanCount);
 
@@ -715,3 +1040,250 @@ void rcMarkCylinderArea(rcContext* context, const float* position, const float r
 		}
 	}
 }
+
+/// The size of the bins used by rcMarkAreaVolumes. [Units: vx]
+static const int AREA_VOLUME_BIN_SIZE = 16;
+
+/// The clamped grid footprint of an area volume.
+struct rcAreaVolumeFootprint
+{
+	int minX, minY, minZ;
+	int maxX, maxY, maxZ;
+	bool overlaps; ///< False if the volume lies outside of the grid.
+};
+
+/// Computes the footprint of a volume the same way rcMarkBoxArea, rcMarkConvexPolyArea and
+/// rcMarkCylinderArea do.
+static void calcAreaVolumeFootprint(const rcAreaVolume& volume, const rcCompactHeightfield& compactHeightfield,
+                                    rcAreaVolumeFootprint& footprint)
+{
+	float bmin[3];
+	float bmax[3];
+	switch (volume.type)
+	{
+	case RC_AREA_VOLUME_BOX:
+		rcVcopy(bmin, volume.boxMin);
+		rcVcopy(bmax, volume.boxMax);
+		break;
+	case RC_AREA_VOLUME_CONVEX:
+		rcVcopy(bmin, volume.verts);
+		rcVcopy(bmax, volume.verts);
+		for (int i = 1; i < volume.nverts; ++i)
+		{
+			rcVmin(bmin, &volume.verts[i * 3]);
+			rcVmax(bmax, &volume.verts[i * 3]);
+		}
+		bmin[1] = volume.minY;
+		bmax[1] = volume.maxY;
+		break;
+	default:
+		bmin[0] = volume.position[0] - volume.radius;
+		bmin[1] = volume.position[1];
+		bmin[2] = volume.position[2] - volume.radius;
+		bmax[0] = volume.position[0] + volume.radius;
+		bmax[1] = volume.position[1] + volume.height;
+		bmax[2] = volume.position[2] + volume.radius;
+		break;
+	}
+
+	footprint.minX = (int)((bmin[0] - compactHeightfield.bmin[0]) / compactHeightfield.cs);
+	footprint.minY = (int)((bmin[1] - compactHeightfield.bmin[1]) / compactHeightfield.ch);
+	footprint.minZ = (int)((bmin[2] - compactHeightfield.bmin[2]) / compactHeightfield.cs);
+	footprint.maxX = (int)((bmax[0] - compactHeightfield.bmin[0]) / compactHeightfield.cs);
+	footprint.maxY = (int)((bmax[1] - compactHeightfield.bmin[1]) / compactHeightfield.ch);
+	footprint.maxZ = (int)((bmax[2] - compactHeightfield.bmin[2]) / compactHeightfield.cs);
+
+	footprint.overlaps = footprint.maxX >= 0 && footprint.minX < compactHeightfield.width &&
+	                     footprint.maxZ >= 0 && footprint.minZ < compactHeightfield.height;
+
+	footprint.minX = rcMax(footprint.minX, 0);
+	footprint.maxX = rcMin(footprint.maxX, compactHeightfield.width - 1);
+	footprint.minZ = rcMax(footprint.minZ, 0);
+	footprint.maxZ = rcMin(footprint.maxZ, compactHeightfield.height - 1);
+}
+
+/// Shared state of a rcMarkAreaVolumes job.
+struct rcAreaVolumeJob
+{
+	const rcAreaVolume* volumes;
+	const rcAreaVolumeFootprint* footprints;
+	// The volumes overlapping each bin, in marking order. The volumes of bin i are
+	// binVolumes[binOffsets[i]] to binVolumes[binOffsets[i + 1] - 1].
+	const int* binOffsets;
+	const int* binVolumes;
+	int xBins;
+	rcCompactHeightfield* compactHeightfield;
+};
+
+/// Marks the cells of a range of bin rows.
+static void markAreaVolumeRows(void* userData, const int begin, const int end, const int /*threadIndex*/)
+{
+	const rcAreaVolumeJob& job = *(const rcAreaVolumeJob*)userData;
+	rcCompactHeightfield& compactHeightfield = *job.compactHeightfield;
+	const int xSize = compactHeightfield.width;
+	const int zSize = compactHeightfield.height;
+
+	for (int binZ = begin; binZ < end; ++binZ)
+	{
+		for (int binX = 0; binX < job.xBins; ++binX)
+		{
+			const int bin = binX + binZ * job.xBins;
+			const int* volumeIndices = &job.binVolumes[job.binOffsets[bin]];
+			const int numVolumes = job.binOffsets[bin + 1] - job.binOffsets[bin];
+			if (numVolumes == 0)
+			{
+				continue;
+			}
+
+			const int maxZ = rcMin((binZ + 1) * AREA_VOLUME_BIN_SIZE, zSize);
+			const int maxX = rcMin((binX + 1) * AREA_VOLUME_BIN_SIZE, xSize);
+			for (int z = binZ * AREA_VOLUME_BIN_SIZE; z < maxZ; ++z)
+			{
+				for (int x = binX * AREA_VOLUME_BIN_SIZE; x < maxX; ++x)
+				{
+					const rcCompactCell& cell = compactHeightfield.cells[x + z * xSize];
+					if (cell.count == 0)
+					{
+						continue;
+					}
+					const float point[] = {
+						compactHeightfield.bmin[0] + ((float)x + 0.5f) * compactHeightfield.cs,
+						0,
+						compactHeightfield.bmin[2] + ((float)z + 0.5f) * compactHeightfield.cs
+					};
+
+					for (int i = 0; i < numVolumes; ++i)
+					{
+						const rcAreaVolume& volume = job.volumes[volumeIndices[i]];
+						const rcAreaVolumeFootprint& footprint = job.footprints[volumeIndices[i]];
+						if (x < footprint.minX || x > footprint.maxX || z < footprint.minZ || z > footprint.maxZ)
+						{
+							continue;
+						}
+
+						// Skip the column if the cell center is outside of the volume.
+						if (volume.type == RC_AREA_VOLUME_CONVEX)
+						{
+							if (!pointInPoly(volume.nverts, volume.verts, point))
+							{
+								continue;
+							}
+						}
+						else if (volume.type == RC_AREA_VOLUME_CYLINDER)
+						{
+							const float deltaX = point[0] - volume.position[0];
+							const float deltaZ = point[2] - volume.position[2];
+							if (rcSqr(deltaX) + rcSqr(deltaZ) >= volume.radius * volume.radius)
+							{
+								continue;
+							}
+						}
+
+						// Mark the spans that are not removed and overlap the y extents.
+						const int maxSpanIndex = (int)(cell.index + cell.count);
+						for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
+						{
+							const int spanY = (int)compactHeightfield.spans[spanIndex].y;
+							if (compactHeightfield.areas[spanIndex] != RC_NULL_AREA &&
+							    spanY >= footprint.minY && spanY <= footprint.maxY)
+							{
+								compactHeightfield.areas[spanIndex] = volume.areaId;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+bool rcMarkAreaVolumes(rcContext* context, const rcAreaVolume* volumes, const int numVolumes,
+                       rcCompactHeightfield& compactHeightfield)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_MARK_AREA_VOLUMES);
+
+	if (numVolumes <= 0)
+	{
+		return true;
+	}
+
+	const int xBins = (compactHeightfield.width + AREA_VOLUME_BIN_SIZE - 1) / AREA_VOLUME_BIN_SIZE;
+	const int zBins = (compactHeightfield.height + AREA_VOLUME_BIN_SIZE - 1) / AREA_VOLUME_BIN_SIZE;
+	const int numBins = xBins * zBins;
+
+	rcScopedDelete<rcAreaVolumeFootprint> footprints((rcAreaVolumeFootprint*)rcAlloc(sizeof(rcAreaVolumeFootprint) * numVolumes, RC_ALLOC_TEMP));
+	if (!footprints)
+	{
+		context->log(RC_LOG_ERROR, "rcMarkAreaVolumes: Out of memory 'footprints' (%d).", numVolumes);
+		return false;
+	}
+	rcScopedDelete<int> binOffsets((int*)rcAlloc(sizeof(int) * (numBins + 1), RC_ALLOC_TEMP));
+	if (!binOffsets)
+	{
+		context->log(RC_LOG_ERROR, "rcMarkAreaVolumes: Out of memory 'binOffsets' (%d).", numBins + 1);
+		return false;
+	}
+	memset(binOffsets, 0, sizeof(int) * (numBins + 1));
+
+	// Count the volumes per bin.
+	for (int i = 0; i < numVolumes; ++i)
+	{
+		rcAreaVolumeFootprint& footprint = footprints[i];
+		calcAreaVolumeFootprint(volumes[i], compactHeightfield, footprint);
+		if (!footprint.overlaps)
+		{
+			continue;
+		}
+		for (int binZ = footprint.minZ / AREA_VOLUME_BIN_SIZE; binZ <= footprint.maxZ / AREA_VOLUME_BIN_SIZE; ++binZ)
+		{
+			for (int binX = footprint.minX / AREA_VOLUME_BIN_SIZE; binX <= footprint.maxX / AREA_VOLUME_BIN_SIZE; ++binX)
+			{
+				binOffsets[binX + binZ * xBins + 1]++;
+			}
+		}
+	}
+	for (int i = 0; i < numBins; ++i)
+	{
+		binOffsets[i + 1] += binOffsets[i];
+	}
+
+	// Store the volumes of each bin in marking order.
+	const int numBinVolumes = binOffsets[numBins];
+	rcScopedDelete<int> binVolumes((int*)rcAlloc(sizeof(int) * rcMax(numBinVolumes, 1), RC_ALLOC_TEMP));
+	rcScopedDelete<int> binFill((int*)rcAlloc(sizeof(int) * numBins, RC_ALLOC_TEMP));
+	if (!binVolumes || !binFill)
+	{
+		context->log(RC_LOG_ERROR, "rcMarkAreaVolumes: Out of memory 'binVolumes' (%d).", numBinVolumes);
+		return false;
+	}
+	memcpy(binFill, binOffsets, sizeof(int) * numBins);
+	for (int i = 0; i < numVolumes; ++i)
+	{
+		const rcAreaVolumeFootprint& footprint = footprints[i];
+		if (!footprint.overlaps)
+		{
+			continue;
+		}
+		for (int binZ = footprint.minZ / AREA_VOLUME_BIN_SIZE; binZ <= footprint.maxZ / AREA_VOLUME_BIN_SIZE; ++binZ)
+		{
+			for (int binX = footprint.minX / AREA_VOLUME_BIN_SIZE; binX <= footprint.maxX / AREA_VOLUME_BIN_SIZE; ++binX)
+			{
+				binVolumes[binFill[binX + binZ * xBins]++] = i;
+			}
+		}
+	}
+
+	// The bin rows cover disjoint cells, so they can be marked in parallel.
+	rcAreaVolumeJob job;
+	job.volumes = volumes;
+	job.footprints = footprints;
+	job.binOffsets = binOffsets;
+	job.binVolumes = binVolumes;
+	job.xBins = xBins;
+	job.compactHeightfield = &compactHeightfield;
+	context->parallelFor(zBins, markAreaVolumeRows, &job);
+
+	return true;
+}
@@ -807,31 +807,52 @@ static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 }
 
 
-/// @par
-///
-/// The raw contours will match the region outlines exactly. The @p maxError and @p maxEdgeLen
-/// parameters control how closely the simplified contours will match the raw contours.
-///
-/// Simplified contours are generated such that the vertices for portals between areas match up.
-/// (They are considered mandatory vertices.)
-///
-/// Setting @p maxEdgeLength to zero will disabled the edge length feature.
-///
-/// See the #rcConfig documentation for more information on the configuration parameters.
-///
-/// @see rcAllocContourSet, rcCompactHeightfield, rcContourSet, rcConfig
-bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
-					 const float maxError, const int maxEdgeLen,
-					 rcContourSet& cset, const int buildFlags)
+/// The phases of a contour build.
+enum rcContoursPhase
 {
-	rcAssert(ctx);
-	
-	const int w = chf.width;
-	const int h = chf.height;
+	RC_CONTOURS_MARK_BOUNDARIES,
+	RC_CONTOURS_TRACE,
+	RC_CONTOURS_MERGE_HOLES,
+	RC_CONTOURS_DONE
+};
+
+/// The state of a contour build between the calls of #rcStepContours.
+struct rcContoursBuild
+{
+	inline rcContoursBuild() : chf(0), cset(0), maxError(0), maxEdgeLen(0), buildFlags(0), traceRegions(0),
+		minx(0), miny(0), maxx(0), maxy(0), flags(0), maxContours(0), verts(256), simplified(64),
+		phase(RC_CONTOURS_DONE), row(0) {}
+	inline ~rcContoursBuild() { reset(); }
+
+	void reset()
+	{
+		rcFree(flags);
+		flags = 0;
+	}
+
+	const rcCompactHeightfield* chf;
+	rcContourSet* cset;
+	float maxError;
+	int maxEdgeLen;
+	int buildFlags;
+	const unsigned char* traceRegions;	// Per region, non-zero to trace its contours, or null to trace all regions.
+	int minx, miny, maxx, maxy;	// The columns to trace. (Max exclusive)
+	unsigned char* flags;	// Per span, the edges that are not connected to the same region.
+	int maxContours;		// The capacity of cset.conts.
+	rcIntArray verts;
+	rcIntArray simplified;
+	int phase;				// The current #rcContoursPhase.
+	int row;				// The next row of the current phase, counted from miny.
+};
+
+static bool beginContours(rcContext* ctx, const rcCompactHeightfield& chf,
+						  const float maxError, const int maxEdgeLen,
+						  rcContourSet& cset, const int buildFlags, rcContoursBuild& build)
+{
+	build.reset();
+
 	const int borderSize = chf.borderSize;
-	
-	rcScopedTimer timer(ctx, RC_TIMER_BUILD_CONTOURS);
-	
+
 	rcVcopy(cset.bmin, chf.bmin);
 	rcVcopy(cset.bmax, chf.bmax);
 	if (borderSize > 0)
@@ -850,32 +871,51 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 	cset.borderSize = chf.borderSize;
 	cset.maxError = maxError;
 	
-	int maxContours = rcMax((int)chf.maxRegions, 8);
-	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
+	build.maxContours = rcMax((int)chf.maxRegions, 8);
+	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour)*build.maxContours, RC_ALLOC_PERM);
 	if (!cset.conts)
 		return false;
 	cset.nconts = 0;
 	
-	rcScopedDelete<unsigned char> flags((unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP));
-	if (!flags)
+	build.flags = (unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP);
+	if (!build.flags)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'flags' (%d).", chf.spanCount);
 		return false;
 	}
-	
-	ctx->startTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
-	
-	// Mark boundaries.
-	for (int y = 0; y < h; ++y)
+
+	build.chf = &chf;
+	build.cset = &cset;
+	build.maxError = maxError;
+	build.maxEdgeLen = maxEdgeLen;
+	build.buildFlags = buildFlags;
+	build.traceRegions = 0;
+	build.minx = 0;
+	build.miny = 0;
+	build.maxx = chf.width;
+	build.maxy = chf.height;
+	build.phase = RC_CONTOURS_MARK_BOUNDARIES;
+	build.row = 0;
+	return true;
+}
+
+// Marks the edges of the spans in rows [miny, maxy) of the traced columns that are not connected to the same region.
+static void markContourBoundaries(const rcContoursBuild& build, unsigned char* flags, const int miny, const int maxy)
+{
+	const rcCompactHeightfield& chf = *build.chf;
+	const int w = chf.width;
+
+	for (int y = miny; y < maxy; ++y)
 	{
-		for (int x = 0; x < w; ++x)
+		for (int x = build.minx; x < build.maxx; ++x)
 		{
 			const rcCompactCell& c = chf.cells[x+y*w];
 			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
 			{
 				unsigned char res = 0;
 				const rcCompactSpan& s = chf.spans[i];
-				if (!chf.spans[i].reg || (chf.spans[i].reg & RC_BORDER_REG))
+				if (!chf.spans[i].reg || (chf.spans[i].reg & RC_BORDER_REG) ||
+					(build.traceRegions && !build.traceRegions[chf.spans[i].reg]))
 				{
 					flags[i] = 0;
 					continue;
@@ -897,15 +937,23 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 			}
 		}
 	}
+}
+
+// Traces and simplifies the contours that start in rows [miny, maxy). Tracing clears the boundary
+// flags of the walked edges, also in later rows, so the rows must be traced in ascending order.
+static bool traceContours(rcContext* ctx, rcContoursBuild& build, const int miny, const int maxy)
+{
+	const rcCompactHeightfield& chf = *build.chf;
+	rcContourSet& cset = *build.cset;
+	unsigned char* flags = build.flags;
+	rcIntArray& verts = build.verts;
+	rcIntArray& simplified = build.simplified;
+	const int w = chf.width;
+	const int borderSize = chf.borderSize;
 	
-	ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
-	
-	rcIntArray verts(256);
-	rcIntArray simplified(64);
-	
-	for (int y = 0; y < h; ++y)
+	for (int y = miny; y < maxy; ++y)
 	{
-		for (int x = 0; x < w; ++x)
+		for (int x = build.minx; x < build.maxx; ++x)
 		{
 			const rcCompactCell& c = chf.cells[x+y*w];
 			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
@@ -928,7 +976,7 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 				ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
 				
 				ctx->startTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
-				simplifyContour(verts, simplified, maxError, maxEdgeLen, buildFlags);
+				simplifyContour(verts, simplified, build.maxError, build.maxEdgeLen, build.buildFlags);
 				removeDegenerateSegments(simplified);
 				ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
 				
@@ -937,13 +985,13 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 				// Create contour.
 				if (simplified.size()/4 >= 3)
 				{
-					if (cset.nconts >= maxContours)
+					if (cset.nconts >= build.maxContours)
 					{
 						// Allocate more contours.
 						// This happens when a region has holes.
-						const int oldMax = maxContours;
-						maxContours *= 2;
-						rcContour* newConts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
+						const int oldMax = build.maxContours;
+						build.maxContours *= 2;
+						rcContour* newConts = (rcContour*)rcAlloc(sizeof(rcContour)*build.maxContours, RC_ALLOC_PERM);
 						for (int j = 0; j < cset.nconts; ++j)
 						{
 							newConts[j] = cset.conts[j];
@@ -954,7 +1002,7 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 						rcFree(cset.conts);
 						cset.conts = newConts;
 						
-						ctx->log(RC_LOG_WARNING, "rcBuildContours: Expanding max contours from %d to %d.", oldMax, maxContours);
+						ctx->log(RC_LOG_WARNING, "rcBuildContours: Expanding max contours from %d to %d.", oldMax, build.maxContours);
 					}
 					
 					rcContour* cont = &cset.conts[cset.nconts++];
@@ -1003,106 +1051,258 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 			}
 		}
 	}
+
+	return true;
+}
+
+// Merges the holes of each region into its outline.
+static bool mergeContourHoles(rcContext* ctx, const rcCompactHeightfield& chf, rcContourSet& cset)
+{
+	if (cset.nconts == 0)
+		return true;
+
+	// Calculate winding of all polygons.
+	rcScopedDelete<signed char> winding((signed char*)rcAlloc(sizeof(signed char)*cset.nconts, RC_ALLOC_TEMP));
+	if (!winding)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'hole' (%d).", cset.nconts);
+		return false;
+	}
+	int nholes = 0;
+	for (int i = 0; i < cset.nconts; ++i)
+	{
+		rcContour& cont = cset.conts[i];
+		// If the contour is wound backwards, it is a hole.
+		winding[i] = calcAreaOfPolygon2D(cont.verts, cont.nverts) < 0 ? -1 : 1;
+		if (winding[i] < 0)
+			nholes++;
+	}
 	
-	// Merge holes if needed.
-	if (cset.nconts > 0)
+	if (nholes > 0)
 	{
-		// Calculate winding of all polygons.
-		rcScopedDelete<signed char> winding((signed char*)rcAlloc(sizeof(signed char)*cset.nconts, RC_ALLOC_TEMP));
-		if (!winding)
+		// Collect outline contour and holes contours per region.
+		// We assume that there is one outline and multiple holes.
+		const int nregions = chf.maxRegions+1;
+		rcScopedDelete<rcContourRegion> regions((rcContourRegion*)rcAlloc(sizeof(rcContourRegion)*nregions, RC_ALLOC_TEMP));
+		if (!regions)
 		{
-			ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'hole' (%d).", cset.nconts);
+			ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'regions' (%d).", nregions);
 			return false;
 		}
-		int nholes = 0;
-		for (int i = 0; i < cset.nconts; ++i)
+		memset(regions, 0, sizeof(rcContourRegion)*nregions);
+		
+		rcScopedDelete<rcContourHole> holes((rcContourHole*)rcAlloc(sizeof(rcContourHole)*cset.nconts, RC_ALLOC_TEMP));
+		if (!holes)
 		{
-			rcContour& cont = cset.conts[i];
-			// If the contour is wound backwards, it is a hole.
-			winding[i] = calcAreaOfPolygon2D(cont.verts, cont.nverts) < 0 ? -1 : 1;
-			if (winding[i] < 0)
-				nholes++;
+			ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'holes' (%d).", cset.nconts);
+			return false;
 		}
+		memset(holes, 0, sizeof(rcContourHole)*cset.nconts);
 		
-		if (nholes > 0)
+		for (int i = 0; i < cset.nconts; ++i)
 		{
-			// Collect outline contour and holes contours per region.
-			// We assume that there is one outline and multiple holes.
-			const int nregions = chf.maxRegions+1;
-			rcScopedDelete<rcContourRegion> regions((rcContourRegion*)rcAlloc(sizeof(rcContourRegion)*nregions, RC_ALLOC_TEMP));
-			if (!regions)
-			{
-				ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'regions' (%d).", nregions);
-				return false;
-			}
-			memset(regions, 0, sizeof(rcContourRegion)*nregions);
-			
-			rcScopedDelete<rcContourHole> holes((rcContourHole*)rcAlloc(sizeof(rcContourHole)*cset.nconts, RC_ALLOC_TEMP));
-			if (!holes)
+			rcContour& cont = cset.conts[i];
+			// Positively would contours are outlines, negative holes.
+			if (winding[i] > 0)
 			{
-				ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'holes' (%d).", cset.nconts);
-				return false;
+				if (regions[cont.reg].outline)
+					ctx->log(RC_LOG_ERROR, "rcBuildContours: Multiple outlines for region %d.", cont.reg);
+				regions[cont.reg].outline = &cont;
 			}
-			memset(holes, 0, sizeof(rcContourHole)*cset.nconts);
-			
-			for (int i = 0; i < cset.nconts; ++i)
+			else
 			{
-				rcContour& cont = cset.conts[i];
-				// Positively would contours are outlines, negative holes.
-				if (winding[i] > 0)
-				{
-					if (regions[cont.reg].outline)
-						ctx->log(RC_LOG_ERROR, "rcBuildContours: Multiple outlines for region %d.", cont.reg);
-					regions[cont.reg].outline = &cont;
-				}
-				else
-				{
-					regions[cont.reg].nholes++;
-				}
+				regions[cont.reg].nholes++;
 			}
-			int index = 0;
-			for (int i = 0; i < nregions; i++)
+		}
+		int index = 0;
+		for (int i = 0; i < nregions; i++)
+		{
+			if (regions[i].nholes > 0)
 			{
-				if (regions[i].nholes > 0)
-				{
-					regions[i].holes = &holes[index];
-					index += regions[i].nholes;
-					regions[i].nholes = 0;
-				}
+				regions[i].holes = &holes[index];
+				index += regions[i].nholes;
+				regions[i].nholes = 0;
 			}
-			for (int i = 0; i < cset.nconts; ++i)
+		}
+		for (int i = 0; i < cset.nconts; ++i)
+		{
+			rcContour& cont = cset.conts[i];
+			rcContourRegion& reg = regions[cont.reg];
+			if (winding[i] < 0)
+				reg.holes[reg.nholes++].contour = &cont;
+		}
+		
+		// Finally merge each regions holes into the outline.
+		for (int i = 0; i < nregions; i++)
+		{
+			rcContourRegion& reg = regions[i];
+			if (!reg.nholes) continue;
+			
+			if (reg.outline)
 			{
-				rcContour& cont = cset.conts[i];
-				rcContourRegion& reg = regions[cont.reg];
-				if (winding[i] < 0)
-					reg.holes[reg.nholes++].contour = &cont;
+				mergeRegionHoles(ctx, reg);
 			}
-			
-			// Finally merge each regions holes into the outline.
-			for (int i = 0; i < nregions; i++)
+			else
 			{
-				rcContourRegion& reg = regions[i];
-				if (!reg.nholes) continue;
-				
-				if (reg.outline)
-				{
-					mergeRegionHoles(ctx, reg);
-				}
-				else
-				{
-					// The region does not have an outline.
-					// This can happen if the contour becaomes selfoverlapping because of
-					// too aggressive simplification settings.
-					ctx->log(RC_LOG_ERROR, "rcBuildContours: Bad outline for region %d, contour simplification is likely too aggressive.", i);
-				}
+				// The region does not have an outline.
+				// This can happen if the contour becaomes selfoverlapping because of
+				// too aggressive simplification settings.
+				ctx->log(RC_LOG_ERROR, "rcBuildContours: Bad outline for region %d, contour simplification is likely too aggressive.", i);
 			}
 		}
-		
 	}
 	
 	return true;
 }
 
+// Runs the phases of the build over at most maxRows rows, at least one. Merging the holes counts as one row.
+static bool advanceContours(rcContext* ctx, rcContoursBuild& build, const int maxRows)
+{
+	const rcCompactHeightfield& chf = *build.chf;
+
+	int rows = rcMax(maxRows, 1);
+	while (rows > 0 && build.phase != RC_CONTOURS_DONE)
+	{
+		if (build.phase == RC_CONTOURS_MERGE_HOLES)
+		{
+			if (!mergeContourHoles(ctx, chf, *build.cset))
+				return false;
+			build.phase = RC_CONTOURS_DONE;
+			break;
+		}
+
+		const int miny = build.miny + build.row;
+		const int maxy = rcMin(miny + rows, build.maxy);
+		if (build.phase == RC_CONTOURS_MARK_BOUNDARIES)
+		{
+			rcScopedTimer timerTrace(ctx, RC_TIMER_BUILD_CONTOURS_TRACE);
+			markContourBoundaries(build, build.flags, miny, maxy);
+		}
+		else if (!traceContours(ctx, build, miny, maxy))
+		{
+			return false;
+		}
+
+		rows -= maxy - miny;
+		build.row = maxy - build.miny;
+		if (maxy >= build.maxy)
+		{
+			build.row = 0;
+			build.phase++;
+		}
+	}
+	return true;
+}
+
+/// @par
+///
+/// The raw contours will match the region outlines exactly. The @p maxError and @p maxEdgeLen
+/// parameters control how closely the simplified contours will match the raw contours.
+///
+/// Simplified contours are generated such that the vertices for portals between areas match up.
+/// (They are considered mandatory vertices.)
+///
+/// Setting @p maxEdgeLength to zero will disabled the edge length feature.
+///
+/// See the #rcConfig documentation for more information on the configuration parameters.
+///
+/// @see rcAllocContourSet, rcCompactHeightfield, rcContourSet, rcConfig, rcBeginContours
+bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
+					 const float maxError, const int maxEdgeLen,
+					 rcContourSet& cset, const int buildFlags)
+{
+	rcAssert(ctx);
+	
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_CONTOURS);
+	
+	rcContoursBuild build;
+	if (!beginContours(ctx, chf, maxError, maxEdgeLen, cset, buildFlags, build))
+		return false;
+
+	// Both row passes, plus the hole merging.
+	return advanceContours(ctx, build, chf.height*2 + 1);
+}
+
+/// @par
+///
+/// Only the spans of the selected regions inside the columns are marked and traced, so the cost depends on the
+/// size of the rectangle instead of the compact heightfield. The contours of a region are identical to the
+/// ones #rcBuildContours traces, as long as the columns contain all spans of the region.
+///
+/// @see rcBuildContours
+bool rcBuildContoursInColumns(rcContext* ctx, const rcCompactHeightfield& chf,
+							  const unsigned char* traceRegions,
+							  const int minX, const int minZ, const int maxX, const int maxZ,
+							  const float maxError, const int maxEdgeLen,
+							  rcContourSet& cset, const int buildFlags)
+{
+	rcAssert(ctx);
+	
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_CONTOURS);
+	
+	rcContoursBuild build;
+	if (!beginContours(ctx, chf, maxError, maxEdgeLen, cset, buildFlags, build))
+		return false;
+	build.traceRegions = traceRegions;
+	build.minx = rcMax(minX, 0);
+	build.miny = rcMax(minZ, 0);
+	build.maxx = rcMin(maxX + 1, chf.width);
+	build.maxy = rcMin(maxZ + 1, chf.height);
+	if (build.minx >= build.maxx || build.miny >= build.maxy)
+		return true;
+
+	// Both row passes, plus the hole merging.
+	return advanceContours(ctx, build, (build.maxy - build.miny)*2 + 1);
+}
+
+rcContoursBuild* rcAllocContoursBuild()
+{
+	void* mem = rcAlloc(sizeof(rcContoursBuild), RC_ALLOC_PERM);
+	return mem ? ::new(rcNewTag(), mem) rcContoursBuild() : 0;
+}
+
+void rcFreeContoursBuild(rcContoursBuild* build)
+{
+	if (!build)
+		return;
+	build->~rcContoursBuild();
+	rcFree(build);
+}
+
+/// @par
+///
+/// Builds the same contours as #rcBuildContours. The contours are added to @p cset as they are traced.
+///
+/// @see rcStepContours, rcBuildContours
+bool rcBeginContours(rcContext* ctx, const rcCompactHeightfield& chf,
+					 const float maxError, const int maxEdgeLen,
+					 rcContourSet& cset, rcContoursBuild& build, const int buildFlags)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_CONTOURS);
+
+	return beginContours(ctx, chf, maxError, maxEdgeLen, cset, buildFlags, build);
+}
+
+/// @par
+///
+/// The region boundaries are marked in one pass over the rows of the heightfield, and the contours traced in a
+/// second. The holes are then merged into the outlines in one step, which counts as one row.
+///
+/// @see rcBeginContours
+bool rcStepContours(rcContext* ctx, rcContoursBuild& build, const int maxRows, bool& done)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_CONTOURS);
+
+	const bool ok = advanceContours(ctx, build, maxRows);
+	done = build.phase == RC_CONTOURS_DONE;
+
+	return ok;
+}
+
 const rcContour* findContourFromSet(const rcContourSet& cset, const uint16_t reg) {
     for (int i = 0; i < cset.nconts; ++i) {
         if (cset.conts[i].reg == reg)
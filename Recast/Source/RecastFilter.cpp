@@ -26,42 +26,142 @@ namespace
 	const int MAX_HEIGHTFIELD_HEIGHT = 0xffff; // TODO (graham): Move this to a more visible constant and update usages.
 }
 
-void rcFilterLowHangingWalkableObstacles(rcContext* context, const int walkableClimb, rcHeightfield& heightfield)
+/// Applies the low hanging obstacle filter to a single column.
+static void filterLowHangingColumn(rcSpan* column, const int walkableClimb)
 {
-	rcAssert(context);
+	rcSpan* previousSpan = NULL;
+	bool previousWasWalkable = false;
+	unsigned char previousAreaID = RC_NULL_AREA;
 
-	rcScopedTimer timer(context, RC_TIMER_FILTER_LOW_OBSTACLES);
+	// For each span in the column...
+	for (rcSpan* span = column; span != NULL; previousSpan = span, span = span->next)
+	{
+		const bool walkable = span->area != RC_NULL_AREA;
 
+		// If current span is not walkable, but there is walkable span just below it and the height difference
+		// is small enough for the agent to walk over, mark the current span as walkable too.
+		if (!walkable && previousWasWalkable && (int)span->smax - (int)previousSpan->smax <= walkableClimb)
+		{
+			span->area = previousAreaID;
+		}
+
+		// Copy the original walkable value regardless of whether we changed it.
+		// This prevents multiple consecutive non-walkable spans from being erroneously marked as walkable.
+		previousWasWalkable = walkable;
+		previousAreaID = span->area;
+	}
+}
+
+/// Looks up the four neighbour columns of a column.
+/// @returns False if the column lies on the border of the heightfield.
+static bool getNeighborColumns(const rcHeightfield& heightfield, const int x, const int z, const rcSpan** neighborColumns)
+{
 	const int xSize = heightfield.width;
 	const int zSize = heightfield.height;
+	for (int direction = 0; direction < 4; ++direction)
+	{
+		const int neighborX = x + rcGetDirOffsetX(direction);
+		const int neighborZ = z + rcGetDirOffsetY(direction);
+		if (neighborX < 0 || neighborZ < 0 || neighborX >= xSize || neighborZ >= zSize)
+		{
+			return false;
+		}
+		neighborColumns[direction] = heightfield.spans[neighborX + neighborZ * xSize];
+	}
+	return true;
+}
 
-	for (int z = 0; z < zSize; ++z)
+/// Checks whether a walkable span that is not on the border of the heightfield is adjacent to a ledge.
+/// Only the heights of the neighbour spans are read, never their area ids.
+static bool isLedgeSpan(const rcSpan* span, const rcSpan* const* neighborColumns, const int walkableHeight, const int walkableClimb)
+{
+	const int floor = (int)(span->smax);
+	const int ceiling = span->next ? (int)(span->next->smin) : MAX_HEIGHTFIELD_HEIGHT;
+
+	// The difference between this walkable area and the lowest neighbor walkable area.
+	// This is the difference between the current span and all neighbor spans that have
+	// enough space for an agent to move between, but not accounting at all for surface slope.
+	int lowestNeighborFloorDifference = MAX_HEIGHTFIELD_HEIGHT;
+
+	// Min and max height of accessible neighbours.
+	int lowestTraversableNeighborFloor = span->smax;
+	int highestTraversableNeighborFloor = span->smax;
+
+	for (int direction = 0; direction < 4; ++direction)
 	{
-		for (int x = 0; x < xSize; ++x)
+		const rcSpan* neighborSpan = neighborColumns[direction];
+
+		// The most we can step down to the neighbor is the walkableClimb distance.
+		// Start with the area under the neighbor span
+		int neighborCeiling = neighborSpan ? (int)neighborSpan->smin : MAX_HEIGHTFIELD_HEIGHT;
+
+		// Skip neighbour if the gap between the spans is too small.
+		if (rcMin(ceiling, neighborCeiling) - floor >= walkableHeight)
 		{
-			rcSpan* previousSpan = NULL;
-			bool previousWasWalkable = false;
-			unsigned char previousAreaID = RC_NULL_AREA;
+			return true;
+		}
 
-			// For each span in the column...
-			for (rcSpan* span = heightfield.spans[x + z * xSize]; span != NULL; previousSpan = span, span = span->next)
+		// For each span in the neighboring column...
+		for (; neighborSpan != NULL; neighborSpan = neighborSpan->next)
+		{
+			const int neighborFloor = (int)neighborSpan->smax;
+			neighborCeiling = neighborSpan->next ? (int)neighborSpan->next->smin : MAX_HEIGHTFIELD_HEIGHT;
+
+			// Only consider neighboring areas that have enough overlap to be potentially traversable.
+			if (rcMin(ceiling, neighborCeiling) - rcMax(floor, neighborFloor) < walkableHeight)
 			{
-				const bool walkable = span->area != RC_NULL_AREA;
+				// No space to traverse between them.
+				continue;
+			}
 
-				// If current span is not walkable, but there is walkable span just below it and the height difference
-				// is small enough for the agent to walk over, mark the current span as walkable too.
-				if (!walkable && previousWasWalkable && (int)span->smax - (int)previousSpan->smax <= walkableClimb)
-				{
-					span->area = previousAreaID;
-				}
+			const int neighborFloorDifference = neighborFloor - floor;
+			lowestNeighborFloorDifference = rcMin(lowestNeighborFloorDifference, neighborFloorDifference);
 
-				// Copy the original walkable value regardless of whether we changed it.
-				// This prevents multiple consecutive non-walkable spans from being erroneously marked as walkable.
-				previousWasWalkable = walkable;
-				previousAreaID = span->area;
+			// Find min/max accessible neighbor height.
+			// Only consider neighbors that are at most walkableClimb away.
+			if (rcAbs(neighborFloorDifference) <= walkableClimb)
+			{
+				// There is space to move to the neighbor cell and the slope isn't too much.
+				lowestTraversableNeighborFloor = rcMin(lowestTraversableNeighborFloor, neighborFloor);
+				highestTraversableNeighborFloor = rcMax(highestTraversableNeighborFloor, neighborFloor);
+			}
+			else if (neighborFloorDifference < -walkableClimb)
+			{
+				// We already know this will be considered a ledge span so we can early-out
+				break;
 			}
 		}
 	}
+
+	// The current span is close to a ledge if the magnitude of the drop to any neighbour span is greater than the walkableClimb distance.
+	// That is, there is a gap that is large enough to let an agent move between them, but the drop (surface slope) is too large to allow it.
+	// (If this is the case, then biggestNeighborStepDown will be negative, so compare against the negative walkableClimb as a means of checking
+	// the magnitude of the delta)
+	if (lowestNeighborFloorDifference < -walkableClimb)
+	{
+		return true;
+	}
+
+	// If the difference between all neighbor floors is too large, this is a steep slope, so mark the span as an unwalkable ledge.
+	return highestTraversableNeighborFloor - lowestTraversableNeighborFloor > walkableClimb;
+}
+
+void rcFilterLowHangingWalkableObstacles(rcContext* context, const int walkableClimb, rcHeightfield& heightfield)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_FILTER_LOW_OBSTACLES);
+
+	const int xSize = heightfield.width;
+	const int zSize = heightfield.height;
+
+	for (int z = 0; z < zSize; ++z)
+	{
+		for (int x = 0; x < xSize; ++x)
+		{
+			filterLowHangingColumn(heightfield.spans[x + z * xSize], walkableClimb);
+		}
+	}
 }
 
 void rcFilterLedgeSpans(rcContext* context, const int walkableHeight, const int walkableClimb, rcHeightfield& heightfield)
@@ -78,6 +178,9 @@ void rcFilterLedgeSpans(rcContext* context, const int walkableHeight, const int
 	{
 		for (int x = 0; x < xSize; ++x)
 		{
+			const rcSpan* neighborColumns[4];
+			const bool onBorder = !getNeighborColumns(heightfield, x, z, neighborColumns);
+
 			for (rcSpan* span = heightfield.spans[x + z * xSize]; span; span = span->next)
 			{
 				// Skip non-walkable spans.
@@ -86,85 +189,8 @@ void rcFilterLedgeSpans(rcContext* context, const int walkableHeight, const int
 					continue;
 				}
 
-				const int floor = (int)(span->smax);
-				const int ceiling = span->next ? (int)(span->next->smin) : MAX_HEIGHTFIELD_HEIGHT;
-
-				// The difference between this walkable area and the lowest neighbor walkable area.
-				// This is the difference between the current span and all neighbor spans that have
-				// enough space for an agent to move between, but not accounting at all for surface slope.
-				int lowestNeighborFloorDifference = MAX_HEIGHTFIELD_HEIGHT;
-
-				// Min and max height of accessible neighbours.
-				int lowestTraversableNeighborFloor = span->smax;
-				int highestTraversableNeighborFloor = span->smax;
-
-				for (int direction = 0; direction < 4; ++direction)
-				{
-					const int neighborX = x + rcGetDirOffsetX(direction);
-					const int neighborZ = z + rcGetDirOffsetY(direction);
-
-					// Skip neighbours which are out of bounds.
-					if (neighborX < 0 || neighborZ < 0 || neighborX >= xSize || neighborZ >= zSize)
-					{
-						lowestNeighborFloorDifference = -walkableClimb - 1;
-						break;
-					}
-
-					const rcSpan* neighborSpan = heightfield.spans[neighborX + neighborZ * xSize];
-
-					// The most we can step down to the neighbor is the walkableClimb distance.
-					// Start with the area under the neighbor span
-					int neighborCeiling = neighborSpan ? (int)neighborSpan->smin : MAX_HEIGHTFIELD_HEIGHT;
-
-					// Skip neighbour if the gap between the spans is too small.
-					if (rcMin(ceiling, neighborCeiling) - floor >= walkableHeight)
-					{
-						lowestNeighborFloorDifference = (-walkableClimb - 1);
-						break;
-					}
-
-					// For each span in the neighboring column...
-					for (; neighborSpan != NULL; neighborSpan = neighborSpan->next)
-					{
-						const int neighborFloor = (int)neighborSpan->smax;
-						neighborCeiling = neighborSpan->next ? (int)neighborSpan->next->smin : MAX_HEIGHTFIELD_HEIGHT;
-
-						// Only consider neighboring areas that have enough overlap to be potentially traversable.
-						if (rcMin(ceiling, neighborCeiling) - rcMax(floor, neighborFloor) < walkableHeight)
-						{
-							// No space to traverse between them.
-							continue;
-						}
-
-						const int neighborFloorDifference = neighborFloor - floor;
-						lowestNeighborFloorDifference = rcMin(lowestNeighborFloorDifference, neighborFloorDifference);
-
-						// Find min/max accessible neighbor height.
-						// Only consider neighbors that are at most walkableClimb away.
-						if (rcAbs(neighborFloorDifference) <= walkableClimb)
-						{
-							// There is space to move to the neighbor cell and the slope isn't too much.
-							lowestTraversableNeighborFloor = rcMin(lowestTraversableNeighborFloor, neighborFloor);
-							highestTraversableNeighborFloor = rcMax(highestTraversableNeighborFloor, neighborFloor);
-						}
-						else if (neighborFloorDifference < -walkableClimb)
-						{
-							// We already know this will be considered a ledge span so we can early-out
-							break;
-						}
-					}
-				}
-
-				// The current span is close to a ledge if the magnitude of the drop to any neighbour span is greater than the walkableClimb distance.
-				// That is, there is a gap that is large enough to let an agent move between them, but the drop (surface slope) is too large to allow it.
-				// (If this is the case, then biggestNeighborStepDown will be negative, so compare against the negative walkableClimb as a means of checking
-				// the magnitude of the delta)
-				if (lowestNeighborFloorDifference < -walkableClimb)
-				{
-					span->area = RC_NULL_AREA;
-				}
-				// If the difference between all neighbor floors is too large, this is a steep slope, so mark the span as an unwalkable ledge.
-				else if (highestTraversableNeighborFloor - lowestTraversableNeighborFloor > walkableClimb)
+				// Spans on the border of the heightfield always border a ledge.
+				if (onBorder || isLedgeSpan(span, neighborColumns, walkableHeight, walkableClimb))
 				{
 					span->area = RC_NULL_AREA;
 				}
@@ -199,3 +225,138 @@ void rcFilterWalkableLowHeightSpans(rcContext* context, const int walkableHeight
 		}
 	}
 }
+
+struct rcFilterSpansJob
+{
+	int filterFlags;
+	int walkableHeight;
+	int walkableClimb;
+	// The rows filtered by a pass are firstRow, firstRow + rowStride, ...
+	int firstRow;
+	int rowStride;
+	// The range of columns filtered in each row.
+	int minX;
+	int maxX;
+	rcHeightfield* heightfield;
+};
+
+/// Applies all enabled filters to a range of rows.
+static void filterSpanRows(void* userData, const int begin, const int end, const int /*threadIndex*/)
+{
+	const rcFilterSpansJob& job = *(const rcFilterSpansJob*)userData;
+	rcHeightfield& heightfield = *job.heightfield;
+	const int xSize = heightfield.width;
+
+	for (int row = begin; row < end; ++row)
+	{
+		const int z = job.firstRow + row * job.rowStride;
+		for (int x = job.minX; x <= job.maxX; ++x)
+		{
+			rcSpan* column = heightfield.spans[x + z * xSize];
+			if (column == NULL)
+			{
+				continue;
+			}
+
+			if (job.filterFlags & RC_FILTER_LOW_HANGING_OBSTACLES)
+			{
+				filterLowHangingColumn(column, job.walkableClimb);
+			}
+
+			if (!(job.filterFlags & (RC_FILTER_LEDGE_SPANS | RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS)))
+			{
+				continue;
+			}
+
+			const rcSpan* neighborColumns[4];
+			const bool onBorder = (job.filterFlags & RC_FILTER_LEDGE_SPANS) && !getNeighborColumns(heightfield, x, z, neighborColumns);
+
+			// Both filters only ever clear walkable spans, and the ledge test does not depend on the
+			// area ids of the neighbours, so the order in which they are applied does not matter.
+			for (rcSpan* span = column; span; span = span->next)
+			{
+				if (span->area == RC_NULL_AREA)
+				{
+					continue;
+				}
+
+				if (job.filterFlags & RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS)
+				{
+					const int floor = (int)(span->smax);
+					const int ceiling = span->next ? (int)(span->next->smin) : MAX_HEIGHTFIELD_HEIGHT;
+					if (ceiling - floor < job.walkableHeight)
+					{
+						span->area = RC_NULL_AREA;
+						continue;
+					}
+				}
+
+				if ((job.filterFlags & RC_FILTER_LEDGE_SPANS) &&
+					(onBorder || isLedgeSpan(span, neighborColumns, job.walkableHeight, job.walkableClimb)))
+				{
+					span->area = RC_NULL_AREA;
+				}
+			}
+		}
+	}
+}
+
+/// Applies the enabled filters to the columns of a rectangle that lies inside the heightfield.
+static void filterWalkableSpans(rcContext* context, const int filterFlags, const int walkableHeight, const int walkableClimb,
+								const int minX, const int minZ, const int maxX, const int maxZ, rcHeightfield& heightfield)
+{
+	if (filterFlags == 0 || minX > maxX || minZ > maxZ)
+	{
+		return;
+	}
+
+	rcFilterSpansJob job;
+	job.filterFlags = filterFlags;
+	job.walkableHeight = walkableHeight;
+	job.walkableClimb = walkableClimb;
+	job.minX = minX;
+	job.maxX = maxX;
+	job.heightfield = &heightfield;
+
+	const int numRows = maxZ - minZ + 1;
+	if (!(filterFlags & RC_FILTER_LEDGE_SPANS))
+	{
+		// Every column is filtered independently of its neighbours.
+		job.firstRow = minZ;
+		job.rowStride = 1;
+		context->parallelFor(numRows, filterSpanRows, &job);
+		return;
+	}
+
+	// The ledge test reads the span heights of the rows next to the one being filtered. The heights
+	// share their storage with the area ids, so filter the even rows first and the odd rows after
+	// to never write a row while a neighbouring row is being read.
+	job.rowStride = 2;
+	job.firstRow = minZ;
+	context->parallelFor((numRows + 1) / 2, filterSpanRows, &job);
+	job.firstRow = minZ + 1;
+	context->parallelFor(numRows / 2, filterSpanRows, &job);
+}
+
+void rcFilterWalkableSpans(rcContext* context, const int filterFlags, const int walkableHeight, const int walkableClimb,
+						   rcHeightfield& heightfield)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_FILTER_SPANS);
+
+	filterWalkableSpans(context, filterFlags, walkableHeight, walkableClimb,
+						0, 0, heightfield.width - 1, heightfield.height - 1, heightfield);
+}
+
+void rcFilterWalkableSpansInColumns(rcContext* context, const int filterFlags, const int walkableHeight, const int walkableClimb,
+									const int minX, const int minZ, const int maxX, const int maxZ, rcHeightfield& heightfield)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_FILTER_SPANS);
+
+	filterWalkableSpans(context, filterFlags, walkableHeight, walkableClimb,
+						rcMax(minX, 0), rcMax(minZ, 0), rcMin(maxX, heightfield.width - 1), rcMin(maxZ, heightfield.height - 1),
+						heightfield);
+}
@@ -26,58 +26,33 @@
 #include "RecastAssert.h"
 
 
-// Must be 255 or smaller (not 256) because layer IDs are stored as
-// a byte where 255 is a special value.
-#ifndef RC_MAX_LAYERS_DEF
-#define RC_MAX_LAYERS_DEF 63
-#endif
-
-#if RC_MAX_LAYERS_DEF > 255
-#error RC_MAX_LAYERS_DEF must be 255 or smaller
-#endif
-
-#ifndef RC_MAX_NEIS_DEF
-#define RC_MAX_NEIS_DEF 16
-#endif
-
-// Keep type checking.
-static const int RC_MAX_LAYERS = RC_MAX_LAYERS_DEF;
-static const int RC_MAX_NEIS = RC_MAX_NEIS_DEF;
-
 struct rcLayerRegion
 {
-	unsigned char layers[RC_MAX_LAYERS];
-	unsigned char neis[RC_MAX_NEIS];
+	rcLayerRegion() : ymin(0xffff), ymax(0), layerId(-1), base(0) {}
+	rcTempVector<int> layers;	// Overlapping regions
+	rcTempVector<int> neis;		// Neighbour regions
 	unsigned short ymin, ymax;
-	unsigned char layerId;		// Layer ID
-	unsigned char nlayers;		// Layer count
-	unsigned char nneis;		// Neighbour count
-	unsigned char base;		// Flag indicating if the region is the base of merged regions.
+	int layerId;				// Layer ID
+	unsigned char base;			// Flag indicating if the region is the base of merged regions.
 };
 
 
-static bool contains(const unsigned char* a, const unsigned char an, const unsigned char v)
+static bool contains(const rcTempVector<int>& a, const int v)
 {
-	const int n = (int)an;
+	const int* p = a.data();
+	const int n = a.size();
 	for (int i = 0; i < n; ++i)
 	{
-		if (a[i] == v)
+		if (p[i] == v)
 			return true;
 	}
 	return false;
 }
 
-static bool addUnique(unsigned char* a, unsigned char& an, int anMax, unsigned char v)
+static void addUnique(rcTempVector<int>& a, const int v)
 {
-	if (contains(a, an, v))
-		return true;
-
-	if ((int)an >= anMax)
-		return false;
-
-	a[an] = v;
-	an++;
-	return true;
+	if (!contains(a, v))
+		a.push_back(v);
 }
 
 
@@ -91,267 +66,595 @@ inline bool overlapRange(const unsigned short amin, const unsigned short amax,
 
 struct rcLayerSweepSpan
 {
-	unsigned short ns;	// number samples
-	unsigned char id;	// region id
-	unsigned char nei;	// neighbour id
+	int ns;		// number samples
+	int id;		// region id
+	int nei;	// neighbour id
 };
 
-/// @par
-/// 
-/// See the #rcConfig documentation for more information on the configuration parameters.
-/// 
-/// @see rcAllocHeightfieldLayerSet, rcCompactHeightfield, rcHeightfieldLayerSet, rcConfig
-bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
-							  const int borderSize, const int walkableHeight,
-							  rcHeightfieldLayerSet& lset)
+// A band of consecutive rows that is partitioned into monotone regions independently
+// of the other bands. The region ids of a band are local to the band until the bands
+// are connected.
+struct rcLayerSweepBand
 {
-	rcAssert(ctx);
-	
-	rcScopedTimer timer(ctx, RC_TIMER_BUILD_LAYERS);
-	
+	int miny, maxy;		// The rows of the band.
+	int nregs;			// The number of regions of the band.
+	int nfirst;			// The number of regions that start in the first row of the band.
+	int firstReg;		// The index of the first region of the band in the remap table.
+	rcTempVector<rcLayerSweepSpan> sweeps;
+	rcTempVector<int> prevCount;	// Per region, the number of samples connected to the current row.
+	rcTempVector<int> countRow;		// Per region, the row 'prevCount' was last reset for.
+};
+
+struct rcLayerJob
+{
+	const rcCompactHeightfield* chf;
+	int borderSize;
+	int* srcReg;
+	rcLayerSweepBand* bands;
+	int nbands;
+	const int* regRemap;
+	rcTempVector<rcLayerRegion>* bandRegs;
+	rcLayerRegion* regs;
+	int nregs;
+	rcHeightfieldLayerSet* lset;
+	const int* layerHmin;
+	int* layerBounds;	// Per thread and layer: [minx, maxx, miny, maxy]
+};
+
+// Partitions the rows of each band into monotone regions.
+static void sweepLayerBands(void* userData, const int begin, const int end, const int /*threadIndex*/)
+{
+	rcLayerJob& job = *(rcLayerJob*)userData;
+	const rcCompactHeightfield& chf = *job.chf;
 	const int w = chf.width;
-	const int h = chf.height;
+	const int borderSize = job.borderSize;
+	int* srcReg = job.srcReg;
 	
-	rcScopedDelete<unsigned char> srcReg((unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP));
-	if (!srcReg)
+	for (int b = begin; b < end; ++b)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'srcReg' (%d).", chf.spanCount);
-		return false;
-	}
-	memset(srcReg,0xff,sizeof(unsigned char)*chf.spanCount);
-	
-	const int nsweeps = chf.width;
-	rcScopedDelete<rcLayerSweepSpan> sweeps((rcLayerSweepSpan*)rcAlloc(sizeof(rcLayerSweepSpan)*nsweeps, RC_ALLOC_TEMP));
-	if (!sweeps)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'sweeps' (%d).", nsweeps);
-		return false;
-	}
-	
-	
-	// Partition walkable area into monotone regions.
-	int prevCount[256];
-	unsigned char regId = 0;
-
-	for (int y = borderSize; y < h-borderSize; ++y)
-	{
-		memset(prevCount,0,sizeof(int)*regId);
-		unsigned char sweepId = 0;
+		rcLayerSweepBand& band = job.bands[b];
+		rcTempVector<rcLayerSweepSpan>& sweeps = band.sweeps;
 		
-		for (int x = borderSize; x < w-borderSize; ++x)
+		for (int y = band.miny; y < band.maxy; ++y)
 		{
-			const rcCompactCell& c = chf.cells[x+y*w];
+			sweeps.clear();
+			int* prevCount = band.prevCount.data();
+			int* countRow = band.countRow.data();
 			
-			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			for (int x = borderSize; x < w-borderSize; ++x)
 			{
-				const rcCompactSpan& s = chf.spans[i];
-				if (chf.areas[i] == RC_NULL_AREA) continue;
-
-				unsigned char sid = 0xff;
-
-				// -x
-				if (rcGetCon(s, 0) != RC_NOT_CONNECTED)
-				{
-					const int ax = x + rcGetDirOffsetX(0);
-					const int ay = y + rcGetDirOffsetY(0);
-					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 0);
-					if (chf.areas[ai] != RC_NULL_AREA && srcReg[ai] != 0xff)
-						sid = srcReg[ai];
-				}
+				const rcCompactCell& c = chf.cells[x+y*w];
 				
-				if (sid == 0xff)
+				for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
 				{
-					sid = sweepId++;
-					sweeps[sid].nei = 0xff;
-					sweeps[sid].ns = 0;
-				}
-				
-				// -y
-				if (rcGetCon(s,3) != RC_NOT_CONNECTED)
-				{
-					const int ax = x + rcGetDirOffsetX(3);
-					const int ay = y + rcGetDirOffsetY(3);
-					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 3);
-					const unsigned char nr = srcReg[ai];
-					if (nr != 0xff)
+					const rcCompactSpan& s = chf.spans[i];
+					if (chf.areas[i] == RC_NULL_AREA) continue;
+					
+					int sid = -1;
+					
+					// -x
+					if (rcGetCon(s, 0) != RC_NOT_CONNECTED)
 					{
-						// Set neighbour when first valid neighbour is encoutered.
-						if (sweeps[sid].ns == 0)
-							sweeps[sid].nei = nr;
-						
-						if (sweeps[sid].nei == nr)
-						{
-							// Update existing neighbour
-							sweeps[sid].ns++;
-							prevCount[nr]++;
-						}
-						else
+						const int ax = x + rcGetDirOffsetX(0);
+						const int ay = y + rcGetDirOffsetY(0);
+						const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 0);
+						if (chf.areas[ai] != RC_NULL_AREA && srcReg[ai] != -1)
+							sid = srcReg[ai];
+					}
+					
+					if (sid == -1)
+					{
+						rcLayerSweepSpan sweep;
+						sweep.ns = 0;
+						sweep.id = -1;
+						sweep.nei = -1;
+						sid = sweeps.size();
+						sweeps.push_back(sweep);
+					}
+					
+					// -y, the first row of the band is connected to the previous band later.
+					if (y > band.miny && rcGetCon(s,3) != RC_NOT_CONNECTED)
+					{
+						const int ax = x + rcGetDirOffsetX(3);
+						const int ay = y + rcGetDirOffsetY(3);
+						const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 3);
+						const int nr = srcReg[ai];
+						if (nr != -1)
 						{
-							// This is hit if there is nore than one neighbour.
-							// Invalidate the neighbour.
-							sweeps[sid].nei = 0xff;
+							rcLayerSweepSpan& sweep = sweeps.data()[sid];
+							// Set neighbour when first valid neighbour is encoutered.
+							if (sweep.ns == 0)
+								sweep.nei = nr;
+							
+							if (sweep.nei == nr)
+							{
+								// Update existing neighbour
+								sweep.ns++;
+								if (countRow[nr] != y)
+								{
+									countRow[nr] = y;
+									prevCount[nr] = 0;
+								}
+								prevCount[nr]++;
+							}
+							else
+							{
+								// This is hit if there is nore than one neighbour.
+								// Invalidate the neighbour.
+								sweep.nei = -1;
+							}
 						}
 					}
+					
+					srcReg[i] = sid;
 				}
-				
-				srcReg[i] = sid;
 			}
-		}
-		
-		// Create unique ID.
-		for (int i = 0; i < sweepId; ++i)
-		{
-			// If the neighbour is set and there is only one continuous connection to it,
-			// the sweep will be merged with the previous one, else new region is created.
-			if (sweeps[i].nei != 0xff && prevCount[sweeps[i].nei] == (int)sweeps[i].ns)
+			
+			// Create unique ID.
+			rcLayerSweepSpan* sweepData = sweeps.data();
+			for (int i = 0; i < sweeps.size(); ++i)
 			{
-				sweeps[i].id = sweeps[i].nei;
+				// If the neighbour is set and there is only one continuous connection to it,
+				// the sweep will be merged with the previous one, else new region is created.
+				if (sweepData[i].nei != -1 && prevCount[sweepData[i].nei] == sweepData[i].ns)
+				{
+					sweepData[i].id = sweepData[i].nei;
+				}
+				else
+				{
+					sweepData[i].id = band.nregs++;
+					band.prevCount.push_back(0);
+					band.countRow.push_back(-1);
+					prevCount = band.prevCount.data();
+					countRow = band.countRow.data();
+				}
 			}
-			else
+			if (y == band.miny)
+				band.nfirst = band.nregs;
+			
+			// Remap local sweep ids to region ids.
+			for (int x = borderSize; x < w-borderSize; ++x)
 			{
-				if (regId == 255)
+				const rcCompactCell& c = chf.cells[x+y*w];
+				for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
 				{
-					ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Region ID overflow.");
-					return false;
+					if (srcReg[i] != -1)
+						srcReg[i] = sweepData[srcReg[i]].id;
 				}
-				sweeps[i].id = regId++;
 			}
 		}
-		
-		// Remap local sweep ids to region ids.
-		for (int x = borderSize; x < w-borderSize; ++x)
+	}
+}
+
+// Replaces the band local region ids of the spans by the final region ids.
+static void remapLayerBands(void* userData, const int begin, const int end, const int /*threadIndex*/)
+{
+	rcLayerJob& job = *(rcLayerJob*)userData;
+	const rcCompactHeightfield& chf = *job.chf;
+	const int w = chf.width;
+	int* srcReg = job.srcReg;
+	
+	for (int b = begin; b < end; ++b)
+	{
+		const rcLayerSweepBand& band = job.bands[b];
+		const int* remap = &job.regRemap[band.firstReg];
+		for (int y = band.miny; y < band.maxy; ++y)
 		{
-			const rcCompactCell& c = chf.cells[x+y*w];
-			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			for (int x = job.borderSize; x < w-job.borderSize; ++x)
 			{
-				if (srcReg[i] != 0xff)
-					srcReg[i] = sweeps[srcReg[i]].id;
+				const rcCompactCell& c = chf.cells[x+y*w];
+				for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+				{
+					if (srcReg[i] != -1)
+						srcReg[i] = remap[srcReg[i]];
+				}
 			}
 		}
 	}
+}
 
-	// Allocate and init layer regions.
-	const int nregs = (int)regId;
-	rcScopedDelete<rcLayerRegion> regs((rcLayerRegion*)rcAlloc(sizeof(rcLayerRegion)*nregs, RC_ALLOC_TEMP));
-	if (!regs)
+// Finds the neighbours, overlapping regions and height bounds of the regions within each band of rows.
+static void findLayerRegionNeighbours(void* userData, const int begin, const int end, const int /*threadIndex*/)
+{
+	rcLayerJob& job = *(rcLayerJob*)userData;
+	const rcCompactHeightfield& chf = *job.chf;
+	const int w = chf.width;
+	const int h = chf.height;
+	const int* srcReg = job.srcReg;
+	
+	for (int b = begin; b < end; ++b)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'regs' (%d).", nregs);
-		return false;
+		rcLayerRegion* regs = job.bandRegs[b].data();
+		
+		for (int y = h*b/job.nbands, maxy = h*(b+1)/job.nbands; y < maxy; ++y)
+		{
+			for (int x = 0; x < w; ++x)
+			{
+				const rcCompactCell& c = chf.cells[x+y*w];
+				
+				// A cell holds at most 255 spans.
+				int lregs[256];
+				int nlregs = 0;
+				
+				for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+				{
+					const rcCompactSpan& s = chf.spans[i];
+					const int ri = srcReg[i];
+					if (ri == -1) continue;
+					
+					regs[ri].ymin = rcMin(regs[ri].ymin, s.y);
+					regs[ri].ymax = rcMax(regs[ri].ymax, s.y);
+					
+					// Collect all region layers.
+					lregs[nlregs++] = ri;
+					
+					// Update neighbours
+					for (int dir = 0; dir < 4; ++dir)
+					{
+						if (rcGetCon(s, dir) != RC_NOT_CONNECTED)
+						{
+							const int ax = x + rcGetDirOffsetX(dir);
+							const int ay = y + rcGetDirOffsetY(dir);
+							const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
+							const int rai = srcReg[ai];
+							if (rai != -1 && rai != ri)
+								addUnique(regs[ri].neis, rai);
+						}
+					}
+				}
+				
+				// Update overlapping regions.
+				for (int i = 0; i < nlregs-1; ++i)
+				{
+					for (int j = i+1; j < nlregs; ++j)
+					{
+						if (lregs[i] != lregs[j])
+						{
+							addUnique(regs[lregs[i]].layers, lregs[j]);
+							addUnique(regs[lregs[j]].layers, lregs[i]);
+						}
+					}
+				}
+			}
+		}
 	}
-	memset(regs, 0, sizeof(rcLayerRegion)*nregs);
-	for (int i = 0; i < nregs; ++i)
+}
+
+// Combines the neighbours and overlapping regions the bands found for each region, in band order,
+// so that they are listed in the order a single pass over the rows would find them.
+static void mergeLayerRegionNeighbours(void* userData, const int begin, const int end, const int /*threadIndex*/)
+{
+	rcLayerJob& job = *(rcLayerJob*)userData;
+	
+	for (int i = begin; i < end; ++i)
 	{
-		regs[i].layerId = 0xff;
-		regs[i].ymin = 0xffff;
-		regs[i].ymax = 0;
+		rcLayerRegion& reg = job.regs[i];
+		for (int b = 0; b < job.nbands; ++b)
+		{
+			const rcLayerRegion& breg = job.bandRegs[b][i];
+			reg.ymin = rcMin(reg.ymin, breg.ymin);
+			reg.ymax = rcMax(reg.ymax, breg.ymax);
+			for (int j = 0; j < breg.neis.size(); ++j)
+				addUnique(reg.neis, breg.neis[j]);
+			for (int j = 0; j < breg.layers.size(); ++j)
+				addUnique(reg.layers, breg.layers[j]);
+		}
 	}
+}
+
+// Copies the heights, areas and connections of the spans of each row to the layers they belong to.
+static void storeLayerRows(void* userData, const int begin, const int end, const int threadIndex)
+{
+	rcLayerJob& job = *(rcLayerJob*)userData;
+	const rcCompactHeightfield& chf = *job.chf;
+	const int w = chf.width;
+	const int borderSize = job.borderSize;
+	const int* srcReg = job.srcReg;
+	const rcLayerRegion* regs = job.regs;
+	rcHeightfieldLayerSet& lset = *job.lset;
+	const int lw = lset.layers[0].width;
+	const int lh = lset.layers[0].height;
+	int* bounds = &job.layerBounds[threadIndex*lset.nlayers*4];
 	
-	// Find region neighbours and overlapping regions.
-	for (int y = 0; y < h; ++y)
+	for (int y = begin; y < end; ++y)
 	{
-		for (int x = 0; x < w; ++x)
+		for (int x = 0; x < lw; ++x)
 		{
-			const rcCompactCell& c = chf.cells[x+y*w];
-			
-			unsigned char lregs[RC_MAX_LAYERS];
-			int nlregs = 0;
-			
-			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			const int cx = borderSize+x;
+			const int cy = borderSize+y;
+			const rcCompactCell& c = chf.cells[cx+cy*w];
+			for (int j = (int)c.index, nj = (int)(c.index+c.count); j < nj; ++j)
 			{
-				const rcCompactSpan& s = chf.spans[i];
-				const unsigned char ri = srcReg[i];
-				if (ri == 0xff) continue;
+				const rcCompactSpan& s = chf.spans[j];
+				// Skip unassigned regions.
+				if (srcReg[j] == -1)
+					continue;
+				const int lid = regs[srcReg[j]].layerId;
+				rcHeightfieldLayer* layer = &lset.layers[lid];
+				const int hmin = job.layerHmin[lid];
 				
-				regs[ri].ymin = rcMin(regs[ri].ymin, s.y);
-				regs[ri].ymax = rcMax(regs[ri].ymax, s.y);
+				// Update data bounds.
+				int* lbounds = &bounds[lid*4];
+				lbounds[0] = rcMin(lbounds[0], x);
+				lbounds[1] = rcMax(lbounds[1], x);
+				lbounds[2] = rcMin(lbounds[2], y);
+				lbounds[3] = rcMax(lbounds[3], y);
 				
-				// Collect all region layers.
-				if (nlregs < RC_MAX_LAYERS)
-					lregs[nlregs++] = ri;
+				// Store height and area type.
+				const int idx = x+y*lw;
+				layer->heights[idx] = (unsigned char)(s.y - hmin);
+				layer->areas[idx] = chf.areas[j];
 				
-				// Update neighbours
+				// Check connection.
+				unsigned char portal = 0;
+				unsigned char con = 0;
 				for (int dir = 0; dir < 4; ++dir)
 				{
 					if (rcGetCon(s, dir) != RC_NOT_CONNECTED)
 					{
-						const int ax = x + rcGetDirOffsetX(dir);
-						const int ay = y + rcGetDirOffsetY(dir);
+						const int ax = cx + rcGetDirOffsetX(dir);
+						const int ay = cy + rcGetDirOffsetY(dir);
 						const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
-						const unsigned char rai = srcReg[ai];
-						if (rai != 0xff && rai != ri)
+						const int alid = srcReg[ai] != -1 ? regs[srcReg[ai]].layerId : -1;
+						// Portal mask
+						if (chf.areas[ai] != RC_NULL_AREA && lid != alid)
+						{
+							portal |= (unsigned char)(1<<dir);
+							// Update height so that it matches on both sides of the portal.
+							const rcCompactSpan& as = chf.spans[ai];
+							if (as.y > hmin)
+								layer->heights[idx] = rcMax(layer->heights[idx], (unsigned char)(as.y - hmin));
+						}
+						// Valid connection mask
+						if (chf.areas[ai] != RC_NULL_AREA && lid == alid)
 						{
-							// Don't check return value -- if we cannot add the neighbor
-							// it will just cause a few more regions to be created, which
-							// is fine.
-							addUnique(regs[ri].neis, regs[ri].nneis, RC_MAX_NEIS, rai);
+							const int nx = ax - borderSize;
+							const int ny = ay - borderSize;
+							if (nx >= 0 && ny >= 0 && nx < lw && ny < lh)
+								con |= (unsigned char)(1<<dir);
 						}
 					}
 				}
 				
+				layer->cons[idx] = (portal << 4) | con;
+			}
+		}
+	}
+}
+
+/// @par
+/// 
+/// See the #rcConfig documentation for more information on the configuration parameters.
+///
+/// The rows are split into one band per thread, which are partitioned into monotone regions
+/// through rcContext::parallelFor and connected afterwards, as are the searches for region
+/// neighbours and the copying of the spans to the layers. The region ids are assigned in the
+/// order a single sweep over all rows would create them, so the layers do not depend on the
+/// number of threads. The number of regions, neighbours and overlapping regions is only limited
+/// by memory.
+/// 
+/// @see rcAllocHeightfieldLayerSet, rcCompactHeightfield, rcHeightfieldLayerSet, rcConfig
+bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
+							  const int borderSize, const int walkableHeight,
+							  rcHeightfieldLayerSet& lset)
+{
+	rcAssert(ctx);
+	
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_LAYERS);
+	
+	const int w = chf.width;
+	const int h = chf.height;
+	const int nthreads = ctx->getMaxThreads();
+	
+	rcScopedDelete<int> srcReg((int*)rcAlloc(sizeof(int)*chf.spanCount, RC_ALLOC_TEMP));
+	if (!srcReg)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'srcReg' (%d).", chf.spanCount);
+		return false;
+	}
+	memset(srcReg,0xff,sizeof(int)*chf.spanCount);
+	
+	// Partition walkable area into monotone regions.
+	const int nrows = rcMax(0, h-borderSize*2);
+	const int nbands = rcMax(1, rcMin(nthreads, nrows));
+	rcTempVector<rcLayerSweepBand> bands;
+	bands.resize(nbands);
+	if (bands.size() != nbands)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'bands' (%d).", nbands);
+		return false;
+	}
+	for (int b = 0; b < nbands; ++b)
+	{
+		bands[b].miny = borderSize + nrows*b/nbands;
+		bands[b].maxy = borderSize + nrows*(b+1)/nbands;
+		bands[b].nregs = 0;
+		bands[b].nfirst = 0;
+		if (!bands[b].sweeps.reserve(w))
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'sweeps' (%d).", w);
+			return false;
+		}
+	}
+	
+	rcLayerJob job;
+	memset(&job, 0, sizeof(job));
+	job.chf = &chf;
+	job.borderSize = borderSize;
+	job.srcReg = srcReg;
+	job.bands = bands.data();
+	job.nbands = nbands;
+	ctx->parallelFor(nbands, sweepLayerBands, &job);
+	
+	// Connect the first row of each band to the last row of the previous band, the same
+	// way the sweep connects consecutive rows, and number the regions in band order.
+	int nbandRegs = 0;
+	for (int b = 0; b < nbands; ++b)
+	{
+		bands[b].firstReg = nbandRegs;
+		nbandRegs += bands[b].nregs;
+	}
+	rcTempVector<int> regRemap(nbandRegs, -1);
+	rcTempVector<int> prevCount(nbandRegs, 0);
+	rcTempVector<int> countBand(nbandRegs, -1);
+	if (regRemap.size() != nbandRegs || prevCount.size() != nbandRegs || countBand.size() != nbandRegs)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'regRemap' (%d).", nbandRegs);
+		return false;
+	}
+	
+	int nregs = 0;
+	for (int b = 0; b < nbands; ++b)
+	{
+		rcLayerSweepBand& band = bands[b];
+		int* remap = regRemap.data() + band.firstReg;
+		
+		if (b > 0)
+		{
+			// The regions that start in the first row of the band are its sweeps.
+			const int* prevRemap = regRemap.data() + bands[b-1].firstReg;
+			rcTempVector<rcLayerSweepSpan>& sweeps = band.sweeps;
+			sweeps.resize(band.nfirst);
+			for (int i = 0; i < band.nfirst; ++i)
+			{
+				sweeps[i].ns = 0;
+				sweeps[i].nei = -1;
 			}
 			
-			// Update overlapping regions.
-			for (int i = 0; i < nlregs-1; ++i)
+			const int y = band.miny;
+			for (int x = borderSize; x < w-borderSize; ++x)
 			{
-				for (int j = i+1; j < nlregs; ++j)
+				const rcCompactCell& c = chf.cells[x+y*w];
+				for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
 				{
-					if (lregs[i] != lregs[j])
+					const rcCompactSpan& s = chf.spans[i];
+					const int sid = srcReg[i];
+					if (sid == -1 || rcGetCon(s,3) == RC_NOT_CONNECTED)
+						continue;
+					
+					const int ax = x + rcGetDirOffsetX(3);
+					const int ay = y + rcGetDirOffsetY(3);
+					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 3);
+					if (srcReg[ai] == -1)
+						continue;
+					const int nr = prevRemap[srcReg[ai]];
+					
+					if (sweeps[sid].ns == 0)
+						sweeps[sid].nei = nr;
+					
+					if (sweeps[sid].nei == nr)
 					{
-						rcLayerRegion& ri = regs[lregs[i]];
-						rcLayerRegion& rj = regs[lregs[j]];
-
-						if (!addUnique(ri.layers, ri.nlayers, RC_MAX_LAYERS, lregs[j]) ||
-							!addUnique(rj.layers, rj.nlayers, RC_MAX_LAYERS, lregs[i]))
+						sweeps[sid].ns++;
+						if (countBand[nr] != b)
 						{
-							ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: layer overflow (too many overlapping walkable platforms). Try increasing RC_MAX_LAYERS.");
-							return false;
+							countBand[nr] = b;
+							prevCount[nr] = 0;
 						}
+						prevCount[nr]++;
+					}
+					else
+					{
+						sweeps[sid].nei = -1;
 					}
 				}
 			}
 			
+			for (int i = 0; i < band.nfirst; ++i)
+			{
+				if (sweeps[i].nei != -1 && prevCount[sweeps[i].nei] == sweeps[i].ns)
+					remap[i] = sweeps[i].nei;
+			}
+		}
+		
+		// Create unique ID.
+		for (int i = 0; i < band.nregs; ++i)
+		{
+			if (remap[i] == -1)
+				remap[i] = nregs++;
 		}
 	}
 	
+	// Remap band region ids to region ids. The ids of a single band are final already.
+	job.regRemap = regRemap.data();
+	if (nbands > 1)
+		ctx->parallelFor(nbands, remapLayerBands, &job);
+	
+	// Allocate and init layer regions, one set per band.
+	rcTempVector<rcTempVector<rcLayerRegion> > bandRegs;
+	bandRegs.resize(nbands);
+	if (bandRegs.size() != nbands)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'bandRegs' (%d).", nbands);
+		return false;
+	}
+	for (int b = 0; b < nbands; ++b)
+	{
+		bandRegs[b].resize(nregs);
+		if (bandRegs[b].size() != nregs)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'regs' (%d).", nregs);
+			return false;
+		}
+	}
+	
+	// Find region neighbours and overlapping regions.
+	job.bandRegs = bandRegs.data();
+	job.nregs = nregs;
+	ctx->parallelFor(nbands, findLayerRegionNeighbours, &job);
+	
+	rcTempVector<rcLayerRegion> regs;
+	if (nbands == 1)
+	{
+		regs.swap(bandRegs[0]);
+	}
+	else
+	{
+		regs.resize(nregs);
+		if (regs.size() != nregs)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'regs' (%d).", nregs);
+			return false;
+		}
+		job.regs = regs.data();
+		ctx->parallelFor(nregs, mergeLayerRegionNeighbours, &job);
+	}
+	bandRegs.clear();
+	job.regs = regs.data();
+	
 	// Create 2D layers from regions.
-	unsigned char layerId = 0;
+	int layerId = 0;
 	
-	static const int MAX_STACK = 64;
-	unsigned char stack[MAX_STACK];
-	int nstack = 0;
+	rcTempVector<int> stack;
 	
 	for (int i = 0; i < nregs; ++i)
 	{
 		rcLayerRegion& root = regs[i];
 		// Skip already visited.
-		if (root.layerId != 0xff)
+		if (root.layerId != -1)
 			continue;
 
 		// Start search.
 		root.layerId = layerId;
 		root.base = 1;
 		
-		nstack = 0;
-		stack[nstack++] = (unsigned char)i;
+		stack.clear();
+		stack.push_back(i);
 		
-		while (nstack)
+		for (int head = 0; head < stack.size(); ++head)
 		{
 			// Pop front
-			rcLayerRegion& reg = regs[stack[0]];
-			nstack--;
-			for (int j = 0; j < nstack; ++j)
-				stack[j] = stack[j+1];
+			rcLayerRegion& reg = regs[stack[head]];
 			
-			const int nneis = (int)reg.nneis;
+			const int nneis = reg.neis.size();
 			for (int j = 0; j < nneis; ++j)
 			{
-				const unsigned char nei = reg.neis[j];
+				const int nei = reg.neis[j];
 				rcLayerRegion& regn = regs[nei];
 				// Skip already visited.
-				if (regn.layerId != 0xff)
+				if (regn.layerId != -1)
 					continue;
 				// Skip if the neighbour is overlapping root region.
-				if (contains(root.layers, root.nlayers, nei))
+				if (contains(root.layers, nei))
 					continue;
 				// Skip if the height range would become too large.
 				const int ymin = rcMin(root.ymin, regn.ymin);
@@ -359,25 +662,16 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 				if ((ymax - ymin) >= 255)
 					 continue;
 
-				if (nstack < MAX_STACK)
-				{
-					// Deepen
-					stack[nstack++] = (unsigned char)nei;
-					
-					// Mark layer id
-					regn.layerId = layerId;
-					// Merge current layers to root.
-					for (int k = 0; k < regn.nlayers; ++k)
-					{
-						if (!addUnique(root.layers, root.nlayers, RC_MAX_LAYERS, regn.layers[k]))
-						{
-							ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: layer overflow (too many overlapping walkable platforms). Try increasing RC_MAX_LAYERS.");
-							return false;
-						}
-					}
-					root.ymin = rcMin(root.ymin, regn.ymin);
-					root.ymax = rcMax(root.ymax, regn.ymax);
-				}
+				// Deepen
+				stack.push_back(nei);
+				
+				// Mark layer id
+				regn.layerId = layerId;
+				// Merge current layers to root.
+				for (int k = 0; k < regn.layers.size(); ++k)
+					addUnique(root.layers, regn.layers[k]);
+				root.ymin = rcMin(root.ymin, regn.ymin);
+				root.ymax = rcMax(root.ymax, regn.ymax);
 			}
 		}
 		
@@ -392,11 +686,11 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 		rcLayerRegion& ri = regs[i];
 		if (!ri.base) continue;
 		
-		unsigned char newId = ri.layerId;
+		const int newId = ri.layerId;
 		
 		for (;;)
 		{
-			unsigned char oldId = 0xff;
+			int oldId = -1;
 			
 			for (int j = 0; j < nregs; ++j)
 			{
@@ -422,7 +716,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 						continue;
 					// Check if region 'k' is overlapping region 'ri'
 					// Index to 'regs' is the same as region id.
-					if (contains(ri.layers,ri.nlayers, (unsigned char)k))
+					if (contains(ri.layers, k))
 					{
 						overlap = true;
 						break;
@@ -438,7 +732,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 			}
 			
 			// Could not find anything to merge with, stop.
-			if (oldId == 0xff)
+			if (oldId == -1)
 				break;
 			
 			// Merge
@@ -451,14 +745,8 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 					// Remap layerIds.
 					rj.layerId = newId;
 					// Add overlaid layers from 'rj' to 'ri'.
-					for (int k = 0; k < rj.nlayers; ++k)
-					{
-						if (!addUnique(ri.layers, ri.nlayers, RC_MAX_LAYERS, rj.layers[k]))
-						{
-							ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: layer overflow (too many overlapping walkable platforms). Try increasing RC_MAX_LAYERS.");
-							return false;
-						}
-					}
+					for (int k = 0; k < rj.layers.size(); ++k)
+						addUnique(ri.layers, rj.layers[k]);
 
 					// Update height bounds.
 					ri.ymin = rcMin(ri.ymin, rj.ymin);
@@ -469,19 +757,24 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 	}
 	
 	// Compact layerIds
-	unsigned char remap[256];
-	memset(remap, 0, 256);
+	rcTempVector<int> remap(layerId, 0);
+	if (remap.size() != layerId)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'remap' (%d).", layerId);
+		return false;
+	}
 
 	// Find number of unique layers.
+	const int nids = layerId;
 	layerId = 0;
 	for (int i = 0; i < nregs; ++i)
 		remap[regs[i].layerId] = 1;
-	for (int i = 0; i < 256; ++i)
+	for (int i = 0; i < nids; ++i)
 	{
 		if (remap[i])
 			remap[i] = layerId++;
 		else
-			remap[i] = 0xff;
+			remap[i] = -1;
 	}
 	// Remap ids.
 	for (int i = 0; i < nregs; ++i)
@@ -506,7 +799,7 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 	bmax[0] -= borderSize*chf.cs;
 	bmax[2] -= borderSize*chf.cs;
 	
-	lset.nlayers = (int)layerId;
+	lset.nlayers = layerId;
 	
 	lset.layers = (rcHeightfieldLayer*)rcAlloc(sizeof(rcHeightfieldLayer)*lset.nlayers, RC_ALLOC_PERM);
 	if (!lset.layers)
@@ -516,12 +809,26 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 	}
 	memset(lset.layers, 0, sizeof(rcHeightfieldLayer)*lset.nlayers);
 
+	// Find layer height bounds.
+	rcTempVector<int> layerHmin(lset.nlayers, 0);
+	rcTempVector<int> layerHmax(lset.nlayers, 0);
+	rcTempVector<int> layerBounds(nthreads*lset.nlayers*4, 0);
+	if (layerHmin.size() != lset.nlayers || layerHmax.size() != lset.nlayers || layerBounds.size() != nthreads*lset.nlayers*4)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildHeightfieldLayers: Out of memory 'layerBounds' (%d).", nthreads*lset.nlayers*4);
+		return false;
+	}
+	for (int j = 0; j < nregs; ++j)
+	{
+		if (regs[j].base)
+		{
+			layerHmin[regs[j].layerId] = (int)regs[j].ymin;
+			layerHmax[regs[j].layerId] = (int)regs[j].ymax;
+		}
+	}
 	
-	// Store layers.
 	for (int i = 0; i < lset.nlayers; ++i)
 	{
-		unsigned char curId = (unsigned char)i;
-
 		rcHeightfieldLayer* layer = &lset.layers[i];
 
 		const int gridSize = sizeof(unsigned char)*lw*lh;
@@ -550,16 +857,8 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 		}
 		memset(layer->cons, 0, gridSize);
 		
-		// Find layer height bounds.
-		int hmin = 0, hmax = 0;
-		for (int j = 0; j < nregs; ++j)
-		{
-			if (regs[j].base && regs[j].layerId == curId)
-			{
-				hmin = (int)regs[j].ymin;
-				hmax = (int)regs[j].ymax;
-			}
-		}
+		const int hmin = layerHmin[i];
+		const int hmax = layerHmax[i];
 
 		layer->width = lw;
 		layer->height = lh;
@@ -573,77 +872,38 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 		layer->bmax[1] = bmin[1] + hmax*chf.ch;
 		layer->hmin = hmin;
 		layer->hmax = hmax;
-
+		
 		// Update usable data region.
+		for (int t = 0; t < nthreads; ++t)
+		{
+			int* bounds = &layerBounds[(t*lset.nlayers+i)*4];
+			bounds[0] = layer->width;
+			bounds[1] = 0;
+			bounds[2] = layer->height;
+			bounds[3] = 0;
+		}
+	}
+	
+	// Copy height and area from compact heightfield. 
+	job.lset = &lset;
+	job.layerHmin = layerHmin.data();
+	job.layerBounds = layerBounds.data();
+	ctx->parallelFor(lh, storeLayerRows, &job);
+	
+	for (int i = 0; i < lset.nlayers; ++i)
+	{
+		rcHeightfieldLayer* layer = &lset.layers[i];
 		layer->minx = layer->width;
 		layer->maxx = 0;
 		layer->miny = layer->height;
 		layer->maxy = 0;
-		
-		// Copy height and area from compact heightfield. 
-		for (int y = 0; y < lh; ++y)
+		for (int t = 0; t < nthreads; ++t)
 		{
-			for (int x = 0; x < lw; ++x)
-			{
-				const int cx = borderSize+x;
-				const int cy = borderSize+y;
-				const rcCompactCell& c = chf.cells[cx+cy*w];
-				for (int j = (int)c.index, nj = (int)(c.index+c.count); j < nj; ++j)
-				{
-					const rcCompactSpan& s = chf.spans[j];
-					// Skip unassigned regions.
-					if (srcReg[j] == 0xff)
-						continue;
-					// Skip of does nto belong to current layer.
-					unsigned char lid = regs[srcReg[j]].layerId;
-					if (lid != curId)
-						continue;
-					
-					// Update data bounds.
-					layer->minx = rcMin(layer->minx, x);
-					layer->maxx = rcMax(layer->maxx, x);
-					layer->miny = rcMin(layer->miny, y);
-					layer->maxy = rcMax(layer->maxy, y);
-					
-					// Store height and area type.
-					const int idx = x+y*lw;
-					layer->heights[idx] = (unsigned char)(s.y - hmin);
-					layer->areas[idx] = chf.areas[j];
-					
-					// Check connection.
-					unsigned char portal = 0;
-					unsigned char con = 0;
-					for (int dir = 0; dir < 4; ++dir)
-					{
-						if (rcGetCon(s, dir) != RC_NOT_CONNECTED)
-						{
-							const int ax = cx + rcGetDirOffsetX(dir);
-							const int ay = cy + rcGetDirOffsetY(dir);
-							const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
-							unsigned char alid = srcReg[ai] != 0xff ? regs[srcReg[ai]].layerId : 0xff;
-							// Portal mask
-							if (chf.areas[ai] != RC_NULL_AREA && lid != alid)
-							{
-								portal |= (unsigned char)(1<<dir);
-								// Update height so that it matches on both sides of the portal.
-								const rcCompactSpan& as = chf.spans[ai];
-								if (as.y > hmin)
-									layer->heights[idx] = rcMax(layer->heights[idx], (unsigned char)(as.y - hmin));
-							}
-							// Valid connection mask
-							if (chf.areas[ai] != RC_NULL_AREA && lid == alid)
-							{
-								const int nx = ax - borderSize;
-								const int ny = ay - borderSize;
-								if (nx >= 0 && ny >= 0 && nx < lw && ny < lh)
-									con |= (unsigned char)(1<<dir);
-							}
-						}
-					}
-					
-					layer->cons[idx] = (portal << 4) | con;
-				}
-			}
+			const int* bounds = &layerBounds[(t*lset.nlayers+i)*4];
+			layer->minx = rcMin(layer->minx, bounds[0]);
+			layer->maxx = rcMax(layer->maxx, bounds[1]);
+			layer->miny = rcMin(layer->miny, bounds[2]);
+			layer->maxy = rcMax(layer->maxy, bounds[3]);
 		}
 		
 		if (layer->minx > layer->maxx)
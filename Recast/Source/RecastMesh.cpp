@@ -25,22 +25,22 @@
 
 struct rcEdge
 {
-	unsigned short vert[2];
-	unsigned short polyEdge[2];
-	unsigned short poly[2];
+	rcMeshIndex vert[2];
+	rcMeshIndex polyEdge[2];
+	rcMeshIndex poly[2];
 };
 
-static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
+static bool buildMeshAdjacency(rcMeshIndex* polys, const int npolys,
 							   const int nverts, const int vertsPerPoly)
 {
 	// Based on code by Eric Lengyel from:
 	// https://web.archive.org/web/20080704083314/http://www.terathon.com/code/edges.php
 	
 	int maxEdgeCount = npolys*vertsPerPoly;
-	unsigned short* firstEdge = (unsigned short*)rcAlloc(sizeof(unsigned short)*(nverts + maxEdgeCount), RC_ALLOC_TEMP);
+	rcMeshIndex* firstEdge = (rcMeshIndex*)rcAlloc(sizeof(rcMeshIndex)*(nverts + maxEdgeCount), RC_ALLOC_TEMP);
 	if (!firstEdge)
 		return false;
-	unsigned short* nextEdge = firstEdge + nverts;
+	rcMeshIndex* nextEdge = firstEdge + nverts;
 	int edgeCount = 0;
 	
 	rcEdge* edges = (rcEdge*)rcAlloc(sizeof(rcEdge)*maxEdgeCount, RC_ALLOC_TEMP);
@@ -55,24 +55,24 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 	
 	for (int i = 0; i < npolys; ++i)
 	{
-		unsigned short* t = &polys[i*vertsPerPoly*2];
+		rcMeshIndex* t = &polys[i*vertsPerPoly*2];
 		for (int j = 0; j < vertsPerPoly; ++j)
 		{
 			if (t[j] == RC_MESH_NULL_IDX) break;
-			unsigned short v0 = t[j];
-			unsigned short v1 = (j+1 >= vertsPerPoly || t[j+1] == RC_MESH_NULL_IDX) ? t[0] : t[j+1];
+			rcMeshIndex v0 = t[j];
+			rcMeshIndex v1 = (j+1 >= vertsPerPoly || t[j+1] == RC_MESH_NULL_IDX) ? t[0] : t[j+1];
 			if (v0 < v1)
 			{
 				rcEdge& edge = edges[edgeCount];
 				edge.vert[0] = v0;
 				edge.vert[1] = v1;
-				edge.poly[0] = (unsigned short)i;
-				edge.polyEdge[0] = (unsigned short)j;
-				edge.poly[1] = (unsigned short)i;
+				edge.poly[0] = (rcMeshIndex)i;
+				edge.polyEdge[0] = (rcMeshIndex)j;
+				edge.poly[1] = (rcMeshIndex)i;
 				edge.polyEdge[1] = 0;
 				// Insert edge
 				nextEdge[edgeCount] = firstEdge[v0];
-				firstEdge[v0] = (unsigned short)edgeCount;
+				firstEdge[v0] = (rcMeshIndex)edgeCount;
 				edgeCount++;
 			}
 		}
@@ -80,21 +80,21 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 	
 	for (int i = 0; i < npolys; ++i)
 	{
-		unsigned short* t = &polys[i*vertsPerPoly*2];
+		rcMeshIndex* t = &polys[i*vertsPerPoly*2];
 		for (int j = 0; j < vertsPerPoly; ++j)
 		{
 			if (t[j] == RC_MESH_NULL_IDX) break;
-			unsigned short v0 = t[j];
-			unsigned short v1 = (j+1 >= vertsPerPoly || t[j+1] == RC_MESH_NULL_IDX) ? t[0] : t[j+1];
+			rcMeshIndex v0 = t[j];
+			rcMeshIndex v1 = (j+1 >= vertsPerPoly || t[j+1] == RC_MESH_NULL_IDX) ? t[0] : t[j+1];
 			if (v0 > v1)
 			{
-				for (unsigned short e = firstEdge[v1]; e != RC_MESH_NULL_IDX; e = nextEdge[e])
+				for (rcMeshIndex e = firstEdge[v1]; e != RC_MESH_NULL_IDX; e = nextEdge[e])
 				{
 					rcEdge& edge = edges[e];
 					if (edge.vert[1] == v0 && edge.poly[0] == edge.poly[1])
 					{
-						edge.poly[1] = (unsigned short)i;
-						edge.polyEdge[1] = (unsigned short)j;
+						edge.poly[1] = (rcMeshIndex)i;
+						edge.polyEdge[1] = (rcMeshIndex)j;
 						break;
 					}
 				}
@@ -108,8 +108,8 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 		const rcEdge& e = edges[i];
 		if (e.poly[0] != e.poly[1])
 		{
-			unsigned short* p0 = &polys[e.poly[0]*vertsPerPoly*2];
-			unsigned short* p1 = &polys[e.poly[1]*vertsPerPoly*2];
+			rcMeshIndex* p0 = &polys[e.poly[0]*vertsPerPoly*2];
+			rcMeshIndex* p1 = &polys[e.poly[1]*vertsPerPoly*2];
 			p0[vertsPerPoly + e.polyEdge[0]] = e.poly[1];
 			p1[vertsPerPoly + e.polyEdge[1]] = e.poly[0];
 		}
@@ -133,30 +133,30 @@ inline int computeVertexHash(int x, int y, int z)
 	return (int)(n & (VERTEX_BUCKET_COUNT-1));
 }
 
-static unsigned short addVertex(unsigned short x, unsigned short y, unsigned short z,
-								unsigned short* verts, int* firstVert, int* nextVert, int& nv)
+static rcMeshIndex addVertex(rcMeshIndex x, rcMeshIndex y, rcMeshIndex z,
+								rcMeshIndex* verts, int* firstVert, int* nextVert, int& nv)
 {
 	int bucket = computeVertexHash(x, 0, z);
 	int i = firstVert[bucket];
 	
 	while (i != -1)
 	{
-		const unsigned short* v = &verts[i*3];
-		if (v[0] == x && (rcAbs(v[1] - y) <= 2) && v[2] == z)
-			return (unsigned short)i;
+		const rcMeshIndex* v = &verts[i*3];
+		if (v[0] == x && (rcAbs((int)v[1] - (int)y) <= 2) && v[2] == z)
+			return (rcMeshIndex)i;
 		i = nextVert[i]; // next
 	}
 	
 	// Could not find, create new.
 	i = nv; nv++;
-	unsigned short* v = &verts[i*3];
+	rcMeshIndex* v = &verts[i*3];
 	v[0] = x;
 	v[1] = y;
 	v[2] = z;
 	nextVert[i] = firstVert[bucket];
 	firstVert[bucket] = i;
 	
-	return (unsigned short)i;
+	return (rcMeshIndex)i;
 }
 
 // Last time I checked the if version got compiled using cmov, which was a lot faster than module (with idiv).
@@ -450,7 +450,7 @@ static int triangulate(int n, const int* verts, int* indices, int* tris)
 	return ntris;
 }
 
-static int countPolyVerts(const unsigned short* p, const int nvp)
+static int countPolyVerts(const rcMeshIndex* p, const int nvp)
 {
 	for (int i = 0; i < nvp; ++i)
 		if (p[i] == RC_MESH_NULL_IDX)
@@ -458,14 +458,14 @@ static int countPolyVerts(const unsigned short* p, const int nvp)
 	return nvp;
 }
 
-inline bool uleft(const unsigned short* a, const unsigned short* b, const unsigned short* c)
+inline bool uleft(const rcMeshIndex* a, const rcMeshIndex* b, const rcMeshIndex* c)
 {
 	return ((int)b[0] - (int)a[0]) * ((int)c[2] - (int)a[2]) -
 		   ((int)c[0] - (int)a[0]) * ((int)b[2] - (int)a[2]) < 0;
 }
 
-static int getPolyMergeValue(unsigned short* pa, unsigned short* pb,
-							 const unsigned short* verts, int& ea, int& eb,
+static int getPolyMergeValue(rcMeshIndex* pa, rcMeshIndex* pb,
+							 const rcMeshIndex* verts, int& ea, int& eb,
 							 const int nvp)
 {
 	const int na = countPolyVerts(pa, nvp);
@@ -481,14 +481,14 @@ static int getPolyMergeValue(unsigned short* pa, unsigned short* pb,
 	
 	for (int i = 0; i < na; ++i)
 	{
-		unsigned short va0 = pa[i];
-		unsigned short va1 = pa[(i+1) % na];
+		rcMeshIndex va0 = pa[i];
+		rcMeshIndex va1 = pa[(i+1) % na];
 		if (va0 > va1)
 			rcSwap(va0, va1);
 		for (int j = 0; j < nb; ++j)
 		{
-			unsigned short vb0 = pb[j];
-			unsigned short vb1 = pb[(j+1) % nb];
+			rcMeshIndex vb0 = pb[j];
+			rcMeshIndex vb1 = pb[(j+1) % nb];
 			if (vb0 > vb1)
 				rcSwap(vb0, vb1);
 			if (va0 == vb0 && va1 == vb1)
@@ -505,7 +505,7 @@ static int getPolyMergeValue(unsigned short* pa, unsigned short* pb,
 		return -1;
 	
 	// Check to see if the merged polygon would be convex.
-	unsigned short va, vb, vc;
+	rcMeshIndex va, vb, vc;
 	
 	va = pa[(ea+na-1) % na];
 	vb = pa[ea];
@@ -528,14 +528,14 @@ static int getPolyMergeValue(unsigned short* pa, unsigned short* pb,
 	return dx*dx + dy*dy;
 }
 
-static void mergePolyVerts(unsigned short* pa, unsigned short* pb, int ea, int eb,
-						   unsigned short* tmp, const int nvp)
+static void mergePolyVerts(rcMeshIndex* pa, rcMeshIndex* pb, int ea, int eb,
+						   rcMeshIndex* tmp, const int nvp)
 {
 	const int na = countPolyVerts(pa, nvp);
 	const int nb = countPolyVerts(pb, nvp);
 	
 	// Merge polygons.
-	memset(tmp, 0xff, sizeof(unsigned short)*nvp);
+	memset(tmp, 0xff, sizeof(rcMeshIndex)*nvp);
 	int n = 0;
 	// Add pa
 	for (int i = 0; i < na-1; ++i)
@@ -544,7 +544,7 @@ static void mergePolyVerts(unsigned short* pa, unsigned short* pb, int ea, int e
 	for (int i = 0; i < nb-1; ++i)
 		tmp[n++] = pb[(eb+1+i) % nb];
 	
-	memcpy(pa, tmp, sizeof(unsigned short)*nvp);
+	memcpy(pa, tmp, sizeof(rcMeshIndex)*nvp);
 }
 
 
@@ -561,7 +561,7 @@ static void pushBack(int v, int* arr, int& an)
 	an++;
 }
 
-static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short rem)
+static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const rcMeshIndex rem)
 {
 	const int nvp = mesh.nvp;
 	
@@ -570,7 +570,7 @@ static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned sho
 	int numRemainingEdges = 0;
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
+		rcMeshIndex* p = &mesh.polys[i*nvp*2];
 		const int nv = countPolyVerts(p, nvp);
 		int numRemoved = 0;
 		int numVerts = 0;
@@ -608,7 +608,7 @@ static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned sho
 		
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
+		rcMeshIndex* p = &mesh.polys[i*nvp*2];
 		const int nv = countPolyVerts(p, nvp);
 
 		// Collect edges which touches the removed vertex.
@@ -618,7 +618,7 @@ static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned sho
 			{
 				// Arrange edge so that a=rem.
 				int a = p[j], b = p[k];
-				if (b == rem)
+				if (b == (int)rem)
 					rcSwap(a,b);
 					
 				// Check if the edge exists
@@ -661,7 +661,7 @@ static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned sho
 	return true;
 }
 
-static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short rem, const int maxTris)
+static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const rcMeshIndex rem, const int maxTris)
 {
 	const int nvp = mesh.nvp;
 
@@ -669,7 +669,7 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 	int numRemovedVerts = 0;
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
+		rcMeshIndex* p = &mesh.polys[i*nvp*2];
 		const int nv = countPolyVerts(p, nvp);
 		for (int j = 0; j < nv; ++j)
 		{
@@ -712,7 +712,7 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 	
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
+		rcMeshIndex* p = &mesh.polys[i*nvp*2];
 		const int nv = countPolyVerts(p, nvp);
 		bool hasRem = false;
 		for (int j = 0; j < nv; ++j)
@@ -733,10 +733,10 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 				}
 			}
 			// Remove the polygon.
-			unsigned short* p2 = &mesh.polys[(mesh.npolys-1)*nvp*2];
+			rcMeshIndex* p2 = &mesh.polys[(mesh.npolys-1)*nvp*2];
 			if (p != p2)
-				memcpy(p,p2,sizeof(unsigned short)*nvp);
-			memset(p+nvp,0xff,sizeof(unsigned short)*nvp);
+				memcpy(p,p2,sizeof(rcMeshIndex)*nvp);
+			memset(p+nvp,0xff,sizeof(rcMeshIndex)*nvp);
 			mesh.regs[i] = mesh.regs[mesh.npolys-1];
 			mesh.areas[i] = mesh.areas[mesh.npolys-1];
 			mesh.npolys--;
@@ -756,15 +756,15 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 	// Adjust indices to match the removed vertex layout.
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
+		rcMeshIndex* p = &mesh.polys[i*nvp*2];
 		const int nv = countPolyVerts(p, nvp);
 		for (int j = 0; j < nv; ++j)
 			if (p[j] > rem) p[j]--;
 	}
 	for (int i = 0; i < nedges; ++i)
 	{
-		if (edges[i*4+0] > rem) edges[i*4+0]--;
-		if (edges[i*4+1] > rem) edges[i*4+1]--;
+		if (edges[i*4+0] > (int)rem) edges[i*4+0]--;
+		if (edges[i*4+1] > (int)rem) edges[i*4+1]--;
 	}
 
 	if (nedges == 0)
@@ -861,7 +861,7 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 	}
 	
 	// Merge the hole triangles back to polygons.
-	rcScopedDelete<unsigned short> polys((unsigned short*)rcAlloc(sizeof(unsigned short)*(ntris+1)*nvp, RC_ALLOC_TEMP));
+	rcScopedDelete<rcMeshIndex> polys((rcMeshIndex*)rcAlloc(sizeof(rcMeshIndex)*(ntris+1)*nvp, RC_ALLOC_TEMP));
 	if (!polys)
 	{
 		ctx->log(RC_LOG_ERROR, "removeVertex: Out of memory 'polys' (%d).", (ntris+1)*nvp);
@@ -880,19 +880,19 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 		return false;
 	}
 	
-	unsigned short* tmpPoly = &polys[ntris*nvp];
+	rcMeshIndex* tmpPoly = &polys[ntris*nvp];
 			
 	// Build initial polygons.
 	int npolys = 0;
-	memset(polys, 0xff, ntris*nvp*sizeof(unsigned short));
+	memset(polys, 0xff, ntris*nvp*sizeof(rcMeshIndex));
 	for (int j = 0; j < ntris; ++j)
 	{
 		int* t = &tris[j*3];
 		if (t[0] != t[1] && t[0] != t[2] && t[1] != t[2])
 		{
-			polys[npolys*nvp+0] = (unsigned short)hole[t[0]];
-			polys[npolys*nvp+1] = (unsigned short)hole[t[1]];
-			polys[npolys*nvp+2] = (unsigned short)hole[t[2]];
+			polys[npolys*nvp+0] = (rcMeshIndex)hole[t[0]];
+			polys[npolys*nvp+1] = (rcMeshIndex)hole[t[1]];
+			polys[npolys*nvp+2] = (rcMeshIndex)hole[t[2]];
 
 			// If this polygon covers multiple region types then
 			// mark it as such
@@ -919,10 +919,10 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 			
 			for (int j = 0; j < npolys-1; ++j)
 			{
-				unsigned short* pj = &polys[j*nvp];
+				rcMeshIndex* pj = &polys[j*nvp];
 				for (int k = j+1; k < npolys; ++k)
 				{
-					unsigned short* pk = &polys[k*nvp];
+					rcMeshIndex* pk = &polys[k*nvp];
 					int ea, eb;
 					int v = getPolyMergeValue(pj, pk, mesh.verts, ea, eb, nvp);
 					if (v > bestMergeVal)
@@ -939,15 +939,15 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 			if (bestMergeVal > 0)
 			{
 				// Found best, merge.
-				unsigned short* pa = &polys[bestPa*nvp];
-				unsigned short* pb = &polys[bestPb*nvp];
+				rcMeshIndex* pa = &polys[bestPa*nvp];
+				rcMeshIndex* pb = &polys[bestPb*nvp];
 				mergePolyVerts(pa, pb, bestEa, bestEb, tmpPoly, nvp);
 				if (pregs[bestPa] != pregs[bestPb])
 					pregs[bestPa] = RC_MULTIPLE_REGS;
 
-				unsigned short* last = &polys[(npolys-1)*nvp];
+				rcMeshIndex* last = &polys[(npolys-1)*nvp];
 				if (pb != last)
-					memcpy(pb, last, sizeof(unsigned short)*nvp);
+					memcpy(pb, last, sizeof(rcMeshIndex)*nvp);
 				pregs[bestPb] = pregs[npolys-1];
 				pareas[bestPb] = pareas[npolys-1];
 				npolys--;
@@ -964,8 +964,8 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 	for (int i = 0; i < npolys; ++i)
 	{
 		if (mesh.npolys >= maxTris) break;
-		unsigned short* p = &mesh.polys[mesh.npolys*nvp*2];
-		memset(p,0xff,sizeof(unsigned short)*nvp*2);
+		rcMeshIndex* p = &mesh.polys[mesh.npolys*nvp*2];
+		memset(p,0xff,sizeof(rcMeshIndex)*nvp*2);
 		for (int j = 0; j < nvp; ++j)
 			p[j] = polys[i*nvp+j];
 		mesh.regs[mesh.npolys] = pregs[i];
@@ -981,17 +981,56 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 	return true;
 }
 
-/// @par
-///
-/// @note If the mesh data is to be used to construct a Detour navigation mesh, then the upper 
-/// limit must be restricted to <= #DT_VERTS_PER_POLYGON.
-///
-/// @see rcAllocPolyMesh, rcContourSet, rcPolyMesh, rcConfig
-bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rcPolyMesh& mesh)
+/// The phases of a polygon mesh build.
+enum rcPolyMeshPhase
 {
-	rcAssert(ctx);
-	
-	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESH);
+	RC_POLYMESH_ADD_CONTOURS,
+	RC_POLYMESH_REMOVE_EDGE_VERTICES,
+	RC_POLYMESH_FINISH,
+	RC_POLYMESH_DONE
+};
+
+/// The state of a polygon mesh build between the calls of #rcStepPolyMesh.
+struct rcPolyMeshBuild
+{
+	inline rcPolyMeshBuild() : cset(0), mesh(0), nvp(0), maxTris(0), maxVertsPerCont(0), vflags(0), nextVert(0),
+		firstVert(0), indices(0), tris(0), polys(0), phase(RC_POLYMESH_DONE), next(0) {}
+	inline ~rcPolyMeshBuild() { reset(); }
+
+	void reset()
+	{
+		rcFree(vflags);
+		rcFree(nextVert);
+		rcFree(firstVert);
+		rcFree(indices);
+		rcFree(tris);
+		rcFree(polys);
+		vflags = 0;
+		nextVert = 0;
+		firstVert = 0;
+		indices = 0;
+		tris = 0;
+		polys = 0;
+	}
+
+	const rcContourSet* cset;
+	rcPolyMesh* mesh;
+	int nvp;
+	int maxTris;
+	int maxVertsPerCont;
+	unsigned char* vflags;	// Per vertex, 1 if it is a border vertex to be removed.
+	int* nextVert;
+	int* firstVert;
+	int* indices;
+	int* tris;
+	rcMeshIndex* polys;
+	int phase;				// The current #rcPolyMeshPhase.
+	int next;				// The next contour or vertex of the current phase.
+};
+
+static bool beginPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rcPolyMesh& mesh, rcPolyMeshBuild& build)
+{
+	build.reset();
 
 	rcVcopy(mesh.bmin, cset.bmin);
 	rcVcopy(mesh.bmax, cset.bmax);
@@ -1012,27 +1051,27 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 		maxVertsPerCont = rcMax(maxVertsPerCont, cset.conts[i].nverts);
 	}
 	
-	if (maxVertices >= 0xfffe)
+	if (maxVertices >= RC_MESH_MAX_COUNT - 1)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Too many vertices %d.", maxVertices);
 		return false;
 	}
 		
-	rcScopedDelete<unsigned char> vflags((unsigned char*)rcAlloc(sizeof(unsigned char)*maxVertices, RC_ALLOC_TEMP));
-	if (!vflags)
+	build.vflags = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxVertices, RC_ALLOC_TEMP);
+	if (!build.vflags)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'vflags' (%d).", maxVertices);
 		return false;
 	}
-	memset(vflags, 0, maxVertices);
+	memset(build.vflags, 0, maxVertices);
 	
-	mesh.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertices*3, RC_ALLOC_PERM);
+	mesh.verts = (rcMeshIndex*)rcAlloc(sizeof(rcMeshIndex)*maxVertices*3, RC_ALLOC_PERM);
 	if (!mesh.verts)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.verts' (%d).", maxVertices);
 		return false;
 	}
-	mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris*nvp*2, RC_ALLOC_PERM);
+	mesh.polys = (rcMeshIndex*)rcAlloc(sizeof(rcMeshIndex)*maxTris*nvp*2, RC_ALLOC_PERM);
 	if (!mesh.polys)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.polys' (%d).", maxTris*nvp*2);
@@ -1056,49 +1095,72 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 	mesh.nvp = nvp;
 	mesh.maxpolys = maxTris;
 	
-	memset(mesh.verts, 0, sizeof(unsigned short)*maxVertices*3);
-	memset(mesh.polys, 0xff, sizeof(unsigned short)*maxTris*nvp*2);
+	memset(mesh.verts, 0, sizeof(rcMeshIndex)*maxVertices*3);
+	memset(mesh.polys, 0xff, sizeof(rcMeshIndex)*maxTris*nvp*2);
 	memset(mesh.regs, 0, sizeof(unsigned short)*maxTris);
 	memset(mesh.areas, 0, sizeof(unsigned char)*maxTris);
 	
-	rcScopedDelete<int> nextVert((int*)rcAlloc(sizeof(int)*maxVertices, RC_ALLOC_TEMP));
-	if (!nextVert)
+	build.nextVert = (int*)rcAlloc(sizeof(int)*maxVertices, RC_ALLOC_TEMP);
+	if (!build.nextVert)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'nextVert' (%d).", maxVertices);
 		return false;
 	}
-	memset(nextVert, 0, sizeof(int)*maxVertices);
+	memset(build.nextVert, 0, sizeof(int)*maxVertices);
 	
-	rcScopedDelete<int> firstVert((int*)rcAlloc(sizeof(int)*VERTEX_BUCKET_COUNT, RC_ALLOC_TEMP));
-	if (!firstVert)
+	build.firstVert = (int*)rcAlloc(sizeof(int)*VERTEX_BUCKET_COUNT, RC_ALLOC_TEMP);
+	if (!build.firstVert)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'firstVert' (%d).", VERTEX_BUCKET_COUNT);
 		return false;
 	}
 	for (int i = 0; i < VERTEX_BUCKET_COUNT; ++i)
-		firstVert[i] = -1;
+		build.firstVert[i] = -1;
 	
-	rcScopedDelete<int> indices((int*)rcAlloc(sizeof(int)*maxVertsPerCont, RC_ALLOC_TEMP));
-	if (!indices)
+	build.indices = (int*)rcAlloc(sizeof(int)*maxVertsPerCont, RC_ALLOC_TEMP);
+	if (!build.indices)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'indices' (%d).", maxVertsPerCont);
 		return false;
 	}
-	rcScopedDelete<int> tris((int*)rcAlloc(sizeof(int)*maxVertsPerCont*3, RC_ALLOC_TEMP));
-	if (!tris)
+	build.tris = (int*)rcAlloc(sizeof(int)*maxVertsPerCont*3, RC_ALLOC_TEMP);
+	if (!build.tris)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'tris' (%d).", maxVertsPerCont*3);
 		return false;
 	}
-	rcScopedDelete<unsigned short> polys((unsigned short*)rcAlloc(sizeof(unsigned short)*(maxVertsPerCont+1)*nvp, RC_ALLOC_TEMP));
-	if (!polys)
+	build.polys = (rcMeshIndex*)rcAlloc(sizeof(rcMeshIndex)*(maxVertsPerCont+1)*nvp, RC_ALLOC_TEMP);
+	if (!build.polys)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'polys' (%d).", maxVertsPerCont*nvp);
 		return false;
 	}
-	unsigned short* tmpPoly = &polys[maxVertsPerCont*nvp];
 
-	for (int i = 0; i < cset.nconts; ++i)
+	build.cset = &cset;
+	build.mesh = &mesh;
+	build.nvp = nvp;
+	build.maxTris = maxTris;
+	build.maxVertsPerCont = maxVertsPerCont;
+	build.phase = RC_POLYMESH_ADD_CONTOURS;
+	build.next = 0;
+	return true;
+}
+
+// Triangulates the contours [first, last) and adds their merged polygons to the mesh.
+static bool addContourPolys(rcContext* ctx, rcPolyMeshBuild& build, const int first, const int last)
+{
+	const rcContourSet& cset = *build.cset;
+	rcPolyMesh& mesh = *build.mesh;
+	const int nvp = build.nvp;
+	const int maxTris = build.maxTris;
+	const int maxVertsPerCont = build.maxVertsPerCont;
+	unsigned char* vflags = build.vflags;
+	int* indices = build.indices;
+	int* tris = build.tris;
+	rcMeshIndex* polys = build.polys;
+	rcMeshIndex* tmpPoly = &polys[maxVertsPerCont*nvp];
+
+	for (int i = first; i < last; ++i)
 	{
 		rcContour& cont = cset.conts[i];
 		
@@ -1132,8 +1194,8 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 		for (int j = 0; j < cont.nverts; ++j)
 		{
 			const int* v = &cont.verts[j*4];
-			indices[j] = addVertex((unsigned short)v[0], (unsigned short)v[1], (unsigned short)v[2],
-								   mesh.verts, firstVert, nextVert, mesh.nverts);
+			indices[j] = addVertex((rcMeshIndex)v[0], (rcMeshIndex)v[1], (rcMeshIndex)v[2],
+								   mesh.verts, build.firstVert, build.nextVert, mesh.nverts);
 			if (v[3] & RC_BORDER_VERTEX)
 			{
 				// This vertex should be removed.
@@ -1143,15 +1205,15 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 
 		// Build initial polygons.
 		int npolys = 0;
-		memset(polys, 0xff, maxVertsPerCont*nvp*sizeof(unsigned short));
+		memset(polys, 0xff, maxVertsPerCont*nvp*sizeof(rcMeshIndex));
 		for (int j = 0; j < ntris; ++j)
 		{
 			int* t = &tris[j*3];
 			if (t[0] != t[1] && t[0] != t[2] && t[1] != t[2])
 			{
-				polys[npolys*nvp+0] = (unsigned short)indices[t[0]];
-				polys[npolys*nvp+1] = (unsigned short)indices[t[1]];
-				polys[npolys*nvp+2] = (unsigned short)indices[t[2]];
+				polys[npolys*nvp+0] = (rcMeshIndex)indices[t[0]];
+				polys[npolys*nvp+1] = (rcMeshIndex)indices[t[1]];
+				polys[npolys*nvp+2] = (rcMeshIndex)indices[t[2]];
 				npolys++;
 			}
 		}
@@ -1169,10 +1231,10 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 				
 				for (int j = 0; j < npolys-1; ++j)
 				{
-					unsigned short* pj = &polys[j*nvp];
+					rcMeshIndex* pj = &polys[j*nvp];
 					for (int k = j+1; k < npolys; ++k)
 					{
-						unsigned short* pk = &polys[k*nvp];
+						rcMeshIndex* pk = &polys[k*nvp];
 						int ea, eb;
 						int v = getPolyMergeValue(pj, pk, mesh.verts, ea, eb, nvp);
 						if (v > bestMergeVal)
@@ -1189,12 +1251,12 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 				if (bestMergeVal > 0)
 				{
 					// Found best, merge.
-					unsigned short* pa = &polys[bestPa*nvp];
-					unsigned short* pb = &polys[bestPb*nvp];
+					rcMeshIndex* pa = &polys[bestPa*nvp];
+					rcMeshIndex* pb = &polys[bestPb*nvp];
 					mergePolyVerts(pa, pb, bestEa, bestEb, tmpPoly, nvp);
-					unsigned short* lastPoly = &polys[(npolys-1)*nvp];
+					rcMeshIndex* lastPoly = &polys[(npolys-1)*nvp];
 					if (pb != lastPoly)
-						memcpy(pb, lastPoly, sizeof(unsigned short)*nvp);
+						memcpy(pb, lastPoly, sizeof(rcMeshIndex)*nvp);
 					npolys--;
 				}
 				else
@@ -1208,8 +1270,8 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 		// Store polygons.
 		for (int j = 0; j < npolys; ++j)
 		{
-			unsigned short* p = &mesh.polys[mesh.npolys*nvp*2];
-			unsigned short* q = &polys[j*nvp];
+			rcMeshIndex* p = &mesh.polys[mesh.npolys*nvp*2];
+			rcMeshIndex* q = &polys[j*nvp];
 			for (int k = 0; k < nvp; ++k)
 				p[k] = q[k];
 			mesh.regs[mesh.npolys] = cont.reg;
@@ -1222,16 +1284,26 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 			}
 		}
 	}
-	
-	
-	// Remove edge vertices.
-	for (int i = 0; i < mesh.nverts; ++i)
+
+	return true;
+}
+
+// Removes the border vertices among the next at most maxVertices vertices, at least one.
+// @param[out]	count	The number of vertices visited.
+static bool removeEdgeVertices(rcContext* ctx, rcPolyMeshBuild& build, const int maxVertices, int& count)
+{
+	rcPolyMesh& mesh = *build.mesh;
+	unsigned char* vflags = build.vflags;
+
+	// A removed vertex shifts the following ones down, so the vertex index only advances past kept vertices.
+	int i = build.next;
+	for (count = 0; count < rcMax(maxVertices, 1) && i < mesh.nverts; ++count, ++i)
 	{
 		if (vflags[i])
 		{
-			if (!canRemoveVertex(ctx, mesh, (unsigned short)i))
+			if (!canRemoveVertex(ctx, mesh, (rcMeshIndex)i))
 				continue;
-			if (!removeVertex(ctx, mesh, (unsigned short)i, maxTris))
+			if (!removeVertex(ctx, mesh, (rcMeshIndex)i, build.maxTris))
 			{
 				// Failed to remove vertex
 				ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Failed to remove edge vertex %d.", i);
@@ -1245,7 +1317,18 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 			--i;
 		}
 	}
-	
+	build.next = i;
+
+	return true;
+}
+
+// Calculates the adjacency and portal edges of the polygons and allocates their flags.
+static bool finishPolyMesh(rcContext* ctx, rcPolyMeshBuild& build)
+{
+	const rcContourSet& cset = *build.cset;
+	rcPolyMesh& mesh = *build.mesh;
+	const int nvp = build.nvp;
+
 	// Calculate adjacency.
 	if (!buildMeshAdjacency(mesh.polys, mesh.npolys, mesh.nverts, nvp))
 	{
@@ -1260,7 +1343,7 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 		const int h = cset.height;
 		for (int i = 0; i < mesh.npolys; ++i)
 		{
-			unsigned short* p = &mesh.polys[i*2*nvp];
+			rcMeshIndex* p = &mesh.polys[i*2*nvp];
 			for (int j = 0; j < nvp; ++j)
 			{
 				if (p[j] == RC_MESH_NULL_IDX) break;
@@ -1269,17 +1352,17 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 					continue;
 				int nj = j+1;
 				if (nj >= nvp || p[nj] == RC_MESH_NULL_IDX) nj = 0;
-				const unsigned short* va = &mesh.verts[p[j]*3];
-				const unsigned short* vb = &mesh.verts[p[nj]*3];
+				const rcMeshIndex* va = &mesh.verts[p[j]*3];
+				const rcMeshIndex* vb = &mesh.verts[p[nj]*3];
 
 				if ((int)va[0] == 0 && (int)vb[0] == 0)
-					p[nvp+j] = 0x8000 | 0;
+					p[nvp+j] = RC_MESH_PORTAL_FLAG | 0;
 				else if ((int)va[2] == h && (int)vb[2] == h)
-					p[nvp+j] = 0x8000 | 1;
+					p[nvp+j] = RC_MESH_PORTAL_FLAG | 1;
 				else if ((int)va[0] == w && (int)vb[0] == w)
-					p[nvp+j] = 0x8000 | 2;
+					p[nvp+j] = RC_MESH_PORTAL_FLAG | 2;
 				else if ((int)va[2] == 0 && (int)vb[2] == 0)
-					p[nvp+j] = 0x8000 | 3;
+					p[nvp+j] = RC_MESH_PORTAL_FLAG | 3;
 			}
 		}
 	}
@@ -1293,18 +1376,130 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 	}
 	memset(mesh.flags, 0, sizeof(unsigned short) * mesh.npolys);
 	
-	if (mesh.nverts > 0xffff)
+	if (mesh.nverts > RC_MESH_MAX_COUNT)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: The resulting mesh has too many vertices %d (max %d). Data can be corrupted.", mesh.nverts, 0xffff);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: The resulting mesh has too many vertices %d (max %d). Data can be corrupted.", mesh.nverts, RC_MESH_MAX_COUNT);
 	}
-	if (mesh.npolys > 0xffff)
+	if (mesh.npolys > RC_MESH_MAX_COUNT)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: The resulting mesh has too many polygons %d (max %d). Data can be corrupted.", mesh.npolys, 0xffff);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: The resulting mesh has too many polygons %d (max %d). Data can be corrupted.", mesh.npolys, RC_MESH_MAX_COUNT);
 	}
 	
 	return true;
 }
 
+// Runs the phases of the build over at most maxItems contours or vertices, at least one. Finishing the
+// mesh counts as one item.
+static bool advancePolyMesh(rcContext* ctx, rcPolyMeshBuild& build, const int maxItems)
+{
+	int items = rcMax(maxItems, 1);
+	while (items > 0 && build.phase != RC_POLYMESH_DONE)
+	{
+		if (build.phase == RC_POLYMESH_ADD_CONTOURS)
+		{
+			const int first = build.next;
+			const int last = rcMin(first + items, build.cset->nconts);
+			if (!addContourPolys(ctx, build, first, last))
+				return false;
+			items -= last - first;
+			build.next = last;
+			if (build.next >= build.cset->nconts)
+			{
+				build.phase = RC_POLYMESH_REMOVE_EDGE_VERTICES;
+				build.next = 0;
+			}
+		}
+		else if (build.phase == RC_POLYMESH_REMOVE_EDGE_VERTICES)
+		{
+			int count = 0;
+			if (!removeEdgeVertices(ctx, build, items, count))
+				return false;
+			items -= rcMax(count, 1);
+			if (build.next >= build.mesh->nverts)
+				build.phase = RC_POLYMESH_FINISH;
+		}
+		else
+		{
+			if (!finishPolyMesh(ctx, build))
+				return false;
+			build.phase = RC_POLYMESH_DONE;
+			items--;
+		}
+	}
+	return true;
+}
+
+/// @par
+///
+/// @note If the mesh data is to be used to construct a Detour navigation mesh, then the upper 
+/// limit must be restricted to <= #DT_VERTS_PER_POLYGON.
+///
+/// @see rcAllocPolyMesh, rcContourSet, rcPolyMesh, rcConfig, rcBeginPolyMesh
+bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rcPolyMesh& mesh)
+{
+	rcAssert(ctx);
+	
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESH);
+
+	rcPolyMeshBuild build;
+	if (!beginPolyMesh(ctx, cset, nvp, mesh, build))
+		return false;
+	if (!addContourPolys(ctx, build, 0, cset.nconts))
+		return false;
+	// Every vertex is visited once, removed or not.
+	int count = 0;
+	build.next = 0;
+	if (!removeEdgeVertices(ctx, build, mesh.nverts, count))
+		return false;
+	return finishPolyMesh(ctx, build);
+}
+
+rcPolyMeshBuild* rcAllocPolyMeshBuild()
+{
+	void* mem = rcAlloc(sizeof(rcPolyMeshBuild), RC_ALLOC_PERM);
+	return mem ? ::new(rcNewTag(), mem) rcPolyMeshBuild() : 0;
+}
+
+void rcFreePolyMeshBuild(rcPolyMeshBuild* build)
+{
+	if (!build)
+		return;
+	build->~rcPolyMeshBuild();
+	rcFree(build);
+}
+
+/// @par
+///
+/// Builds the same mesh as #rcBuildPolyMesh. The mesh is allocated here and filled while the build runs.
+///
+/// @see rcStepPolyMesh, rcBuildPolyMesh
+bool rcBeginPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rcPolyMesh& mesh, rcPolyMeshBuild& build)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESH);
+
+	return beginPolyMesh(ctx, cset, nvp, mesh, build);
+}
+
+/// @par
+///
+/// The contours are triangulated and merged into polygons one by one. The border vertices of the mesh are then
+/// removed one vertex at a time, and the adjacency of the polygons calculated in one step, which counts as one item.
+///
+/// @see rcBeginPolyMesh
+bool rcStepPolyMesh(rcContext* ctx, rcPolyMeshBuild& build, const int maxItems, bool& done)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESH);
+
+	const bool ok = advancePolyMesh(ctx, build, maxItems);
+	done = build.phase == RC_POLYMESH_DONE;
+
+	return ok;
+}
+
 /// @see rcAllocPolyMesh, rcPolyMesh
 bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, rcPolyMesh& mesh)
 {
@@ -1334,7 +1529,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 	}
 	
 	mesh.nverts = 0;
-	mesh.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxVerts*3, RC_ALLOC_PERM);
+	mesh.verts = (rcMeshIndex*)rcAlloc(sizeof(rcMeshIndex)*maxVerts*3, RC_ALLOC_PERM);
 	if (!mesh.verts)
 	{
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.verts' (%d).", maxVerts*3);
@@ -1342,13 +1537,13 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 	}
 
 	mesh.npolys = 0;
-	mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys*2*mesh.nvp, RC_ALLOC_PERM);
+	mesh.polys = (rcMeshIndex*)rcAlloc(sizeof(rcMeshIndex)*maxPolys*2*mesh.nvp, RC_ALLOC_PERM);
 	if (!mesh.polys)
 	{
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.polys' (%d).", maxPolys*2*mesh.nvp);
 		return false;
 	}
-	memset(mesh.polys, 0xff, sizeof(unsigned short)*maxPolys*2*mesh.nvp);
+	memset(mesh.polys, 0xff, sizeof(rcMeshIndex)*maxPolys*2*mesh.nvp);
 
 	mesh.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys, RC_ALLOC_PERM);
 	if (!mesh.regs)
@@ -1391,38 +1586,38 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 	for (int i = 0; i < VERTEX_BUCKET_COUNT; ++i)
 		firstVert[i] = -1;
 
-	rcScopedDelete<unsigned short> vremap((unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertsPerMesh, RC_ALLOC_PERM));
+	rcScopedDelete<rcMeshIndex> vremap((rcMeshIndex*)rcAlloc(sizeof(rcMeshIndex)*maxVertsPerMesh, RC_ALLOC_PERM));
 	if (!vremap)
 	{
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'vremap' (%d).", maxVertsPerMesh);
 		return false;
 	}
-	memset(vremap, 0, sizeof(unsigned short)*maxVertsPerMesh);
+	memset(vremap, 0, sizeof(rcMeshIndex)*maxVertsPerMesh);
 	
 	for (int i = 0; i < nmeshes; ++i)
 	{
 		const rcPolyMesh* pmesh = meshes[i];
 		
-		const unsigned short ox = (unsigned short)floorf((pmesh->bmin[0]-mesh.bmin[0])/mesh.cs+0.5f);
-		const unsigned short oz = (unsigned short)floorf((pmesh->bmin[2]-mesh.bmin[2])/mesh.cs+0.5f);
+		const rcMeshIndex ox = (rcMeshIndex)floorf((pmesh->bmin[0]-mesh.bmin[0])/mesh.cs+0.5f);
+		const rcMeshIndex oz = (rcMeshIndex)floorf((pmesh->bmin[2]-mesh.bmin[2])/mesh.cs+0.5f);
 		
 		bool isMinX = (ox == 0);
 		bool isMinZ = (oz == 0);
-		bool isMaxX = ((unsigned short)floorf((mesh.bmax[0] - pmesh->bmax[0]) / mesh.cs + 0.5f)) == 0;
-		bool isMaxZ = ((unsigned short)floorf((mesh.bmax[2] - pmesh->bmax[2]) / mesh.cs + 0.5f)) == 0;
+		bool isMaxX = ((rcMeshIndex)floorf((mesh.bmax[0] - pmesh->bmax[0]) / mesh.cs + 0.5f)) == 0;
+		bool isMaxZ = ((rcMeshIndex)floorf((mesh.bmax[2] - pmesh->bmax[2]) / mesh.cs + 0.5f)) == 0;
 		bool isOnBorder = (isMinX || isMinZ || isMaxX || isMaxZ);
 
 		for (int j = 0; j < pmesh->nverts; ++j)
 		{
-			unsigned short* v = &pmesh->verts[j*3];
+			rcMeshIndex* v = &pmesh->verts[j*3];
 			vremap[j] = addVertex(v[0]+ox, v[1], v[2]+oz,
 								  mesh.verts, firstVert, nextVert, mesh.nverts);
 		}
 		
 		for (int j = 0; j < pmesh->npolys; ++j)
 		{
-			unsigned short* tgt = &mesh.polys[mesh.npolys*2*mesh.nvp];
-			unsigned short* src = &pmesh->polys[j*2*mesh.nvp];
+			rcMeshIndex* tgt = &mesh.polys[mesh.npolys*2*mesh.nvp];
+			rcMeshIndex* src = &pmesh->polys[j*2*mesh.nvp];
 			mesh.regs[mesh.npolys] = pmesh->regs[j];
 			mesh.areas[mesh.npolys] = pmesh->areas[j];
 			mesh.flags[mesh.npolys] = pmesh->flags[j];
@@ -1437,9 +1632,9 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 			{
 				for (int k = mesh.nvp; k < mesh.nvp * 2; ++k)
 				{
-					if (src[k] & 0x8000 && src[k] != 0xffff)
+					if (src[k] & RC_MESH_PORTAL_FLAG && src[k] != RC_MESH_NULL_IDX)
 					{
-						unsigned short dir = src[k] & 0xf;
+						rcMeshIndex dir = src[k] & 0xf;
 						switch (dir)
 						{
 							case 0: // Portal x-
@@ -1472,13 +1667,13 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 		return false;
 	}
 
-	if (mesh.nverts > 0xffff)
+	if (mesh.nverts > RC_MESH_MAX_COUNT)
 	{
-		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: The resulting mesh has too many vertices %d (max %d). Data can be corrupted.", mesh.nverts, 0xffff);
+		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: The resulting mesh has too many vertices %d (max %d). Data can be corrupted.", mesh.nverts, RC_MESH_MAX_COUNT);
 	}
-	if (mesh.npolys > 0xffff)
+	if (mesh.npolys > RC_MESH_MAX_COUNT)
 	{
-		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: The resulting mesh has too many polygons %d (max %d). Data can be corrupted.", mesh.npolys, 0xffff);
+		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: The resulting mesh has too many polygons %d (max %d). Data can be corrupted.", mesh.npolys, RC_MESH_MAX_COUNT);
 	}
 	
 	return true;
@@ -1506,21 +1701,21 @@ bool rcCopyPolyMesh(rcContext* ctx, const rcPolyMesh& src, rcPolyMesh& dst)
 	dst.borderSize = src.borderSize;
 	dst.maxEdgeError = src.maxEdgeError;
 	
-	dst.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*src.nverts*3, RC_ALLOC_PERM);
+	dst.verts = (rcMeshIndex*)rcAlloc(sizeof(rcMeshIndex)*src.nverts*3, RC_ALLOC_PERM);
 	if (!dst.verts)
 	{
 		ctx->log(RC_LOG_ERROR, "rcCopyPolyMesh: Out of memory 'dst.verts' (%d).", src.nverts*3);
 		return false;
 	}
-	memcpy(dst.verts, src.verts, sizeof(unsigned short)*src.nverts*3);
+	memcpy(dst.verts, src.verts, sizeof(rcMeshIndex)*src.nverts*3);
 	
-	dst.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*src.npolys*2*src.nvp, RC_ALLOC_PERM);
+	dst.polys = (rcMeshIndex*)rcAlloc(sizeof(rcMeshIndex)*src.npolys*2*src.nvp, RC_ALLOC_PERM);
 	if (!dst.polys)
 	{
 		ctx->log(RC_LOG_ERROR, "rcCopyPolyMesh: Out of memory 'dst.polys' (%d).", src.npolys*2*src.nvp);
 		return false;
 	}
-	memcpy(dst.polys, src.polys, sizeof(unsigned short)*src.npolys*2*src.nvp);
+	memcpy(dst.polys, src.polys, sizeof(rcMeshIndex)*src.npolys*2*src.nvp);
 	
 	dst.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*src.npolys, RC_ALLOC_PERM);
 	if (!dst.regs)
@@ -531,6 +531,287 @@ static void delaunayHull(rcContext* ctx, const int npts, const float* pts,
 	}
 }
 
+// Incremental Delaunay triangulation.
+// The triangles are stored in 'tris' as (a,b,c,flags), wound like the hull, and the
+// neighbour across each triangle edge (a,b), (b,c), (c,a) is stored in 'adj'.
+// Points are added one at a time by locating the containing triangle with a walk,
+// splitting it, and flipping the edges that are no longer locally Delaunay.
+
+static const float DELAUNAY_EPS = 1e-5f;
+static const int DELAUNAY_HASH_SIZE = 1024; // Power of two, larger than the number of directed edges (3*MAX_TRIS).
+static const int DELAUNAY_MAX_FLIPS = 4096;
+
+inline int triVert(const rcIntArray& tris, const int t, const int e)
+{
+	return tris[t*4 + e%3];
+}
+
+inline float triOrient(const float* verts, const float wind, const int a, const int b, const float* p)
+{
+	return wind * vcross2(&verts[a*3], &verts[b*3], p);
+}
+
+static void setTriNeighbour(rcIntArray& adj, const int t, const int oldNei, const int newNei)
+{
+	if (t == -1)
+		return;
+	for (int e = 0; e < 3; ++e)
+	{
+		if (adj[t*3+e] == oldNei)
+		{
+			adj[t*3+e] = newNei;
+			return;
+		}
+	}
+}
+
+// Connects the triangles which share an edge, using a hash of the directed edges.
+static void buildTriAdjacency(const rcIntArray& tris, rcIntArray& adj)
+{
+	const int ntris = tris.size()/4;
+	adj.resize(ntris*3);
+	for (int i = 0; i < ntris*3; ++i)
+		adj[i] = -1;
+	
+	int keys[DELAUNAY_HASH_SIZE];
+	int vals[DELAUNAY_HASH_SIZE];
+	memset(keys, 0xff, sizeof(keys));
+	
+	for (int t = 0; t < ntris; ++t)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			const int a = triVert(tris, t, e);
+			const int b = triVert(tris, t, e+1);
+			
+			// Look for the opposite half-edge (b,a).
+			const int twin = (b << 8) | a;
+			int h = (int)(((unsigned int)twin * 2654435761u) >> 22) & (DELAUNAY_HASH_SIZE-1);
+			bool found = false;
+			while (keys[h] != -1)
+			{
+				if (keys[h] == twin)
+				{
+					const int other = vals[h];
+					adj[t*3+e] = other/3;
+					adj[other] = t;
+					found = true;
+					break;
+				}
+				h = (h+1) & (DELAUNAY_HASH_SIZE-1);
+			}
+			if (found)
+				continue;
+			
+			// Store this half-edge.
+			const int key = (a << 8) | b;
+			h = (int)(((unsigned int)key * 2654435761u) >> 22) & (DELAUNAY_HASH_SIZE-1);
+			while (keys[h] != -1)
+				h = (h+1) & (DELAUNAY_HASH_SIZE-1);
+			keys[h] = key;
+			vals[h] = t*3+e;
+		}
+	}
+}
+
+// Flips edges on the stack until all of them are locally Delaunay.
+static void legalizeTriEdges(rcContext* ctx, const float* verts, const float wind,
+							 rcIntArray& tris, rcIntArray& adj, rcIntArray& stack)
+{
+	static const float tol = 0.001f;
+	int nflips = 0;
+	
+	while (stack.size() >= 2)
+	{
+		const int e = stack.pop();
+		const int t = stack.pop();
+		const int n = adj[t*3+e];
+		if (n == -1)
+			continue;
+		
+		const int a = triVert(tris, t, e);
+		const int b = triVert(tris, t, e+1);
+		const int c = triVert(tris, t, e+2);
+		int f = 0;
+		while (f < 3 && adj[n*3+f] != t)
+			f++;
+		if (f == 3)
+			continue;
+		const int d = triVert(tris, n, f+2);
+		
+		// Check if d is inside the circumcircle of (a,b,c).
+		float cc[3];
+		float r;
+		if (circumCircle(&verts[a*3], &verts[b*3], &verts[c*3], cc, r))
+		{
+			if (vdist2(cc, &verts[d*3]) >= r*(1-tol))
+				continue;
+		}
+		
+		// The flipped triangles must be valid.
+		if (triOrient(verts, wind, a, d, &verts[c*3]) <= DELAUNAY_EPS ||
+			triOrient(verts, wind, d, b, &verts[c*3]) <= DELAUNAY_EPS)
+			continue;
+		
+		if (++nflips > DELAUNAY_MAX_FLIPS)
+		{
+			ctx->log(RC_LOG_WARNING, "legalizeTriEdges: Too many flips (%d).", DELAUNAY_MAX_FLIPS);
+			stack.clear();
+			return;
+		}
+		
+		const int nbc = adj[t*3+(e+1)%3];
+		const int nca = adj[t*3+(e+2)%3];
+		const int nad = adj[n*3+(f+1)%3];
+		const int ndb = adj[n*3+(f+2)%3];
+		
+		// Replace edge a-b by d-c: t = (a,d,c), n = (d,b,c).
+		tris[t*4+0] = a; tris[t*4+1] = d; tris[t*4+2] = c;
+		adj[t*3+0] = nad; adj[t*3+1] = n; adj[t*3+2] = nca;
+		tris[n*4+0] = d; tris[n*4+1] = b; tris[n*4+2] = c;
+		adj[n*3+0] = ndb; adj[n*3+1] = nbc; adj[n*3+2] = t;
+		setTriNeighbour(adj, nad, n, t);
+		setTriNeighbour(adj, nbc, t, n);
+		
+		stack.push(t); stack.push(0);
+		stack.push(t); stack.push(2);
+		stack.push(n); stack.push(0);
+		stack.push(n); stack.push(1);
+	}
+}
+
+// Finds the triangle containing p by walking towards it from 'start'.
+// Returns the triangle, or -1 if p is outside of the triangulation. If p lies on
+// an edge of the triangle, the edge is returned in 'edge', otherwise -1.
+static int locateTri(const float* verts, const float wind, const rcIntArray& tris, const rcIntArray& adj,
+					 const int start, const float* p, int& edge)
+{
+	const int ntris = tris.size()/4;
+	int t = start;
+	for (int iter = 0; iter <= ntris; ++iter)
+	{
+		int next = -1;
+		bool outside = false;
+		edge = -1;
+		for (int e = 0; e < 3; ++e)
+		{
+			const float o = triOrient(verts, wind, triVert(tris, t, e), triVert(tris, t, e+1), p);
+			if (o < -DELAUNAY_EPS)
+			{
+				if (adj[t*3+e] != -1)
+				{
+					next = adj[t*3+e];
+					break;
+				}
+				outside = true;
+			}
+			else if (o <= DELAUNAY_EPS)
+			{
+				edge = e;
+			}
+		}
+		if (next == -1)
+			return outside ? -1 : t;
+		t = next;
+	}
+	
+	// The walk did not converge, check all triangles.
+	for (t = 0; t < ntris; ++t)
+	{
+		edge = -1;
+		int e = 0;
+		for (; e < 3; ++e)
+		{
+			const float o = triOrient(verts, wind, triVert(tris, t, e), triVert(tris, t, e+1), p);
+			if (o < -DELAUNAY_EPS)
+				break;
+			if (o <= DELAUNAY_EPS)
+				edge = e;
+		}
+		if (e == 3)
+			return t;
+	}
+	return -1;
+}
+
+// Adds vertex p to the triangulation.
+static void insertTriVertex(rcContext* ctx, const float* verts, const float wind, const int p,
+							rcIntArray& tris, rcIntArray& adj, rcIntArray& stack, int& lastTri)
+{
+	int e = -1;
+	const int t = locateTri(verts, wind, tris, adj, lastTri, &verts[p*3], e);
+	if (t == -1)
+	{
+		ctx->log(RC_LOG_WARNING, "insertTriVertex: Vertex %d is outside of the triangulation.", p);
+		return;
+	}
+	
+	const int n = e != -1 ? adj[t*3+e] : -1;
+	stack.clear();
+	
+	if (n == -1)
+	{
+		// Split (a,b,c) into (a,b,p), (b,c,p) and (c,a,p).
+		const int a = tris[t*4+0];
+		const int b = tris[t*4+1];
+		const int c = tris[t*4+2];
+		const int nbc = adj[t*3+1];
+		const int nca = adj[t*3+2];
+		const int t1 = tris.size()/4;
+		const int t2 = t1+1;
+		
+		tris[t*4+2] = p;
+		adj[t*3+1] = t1; adj[t*3+2] = t2;
+		tris.push(b); tris.push(c); tris.push(p); tris.push(0);
+		adj.push(nbc); adj.push(t2); adj.push(t);
+		tris.push(c); tris.push(a); tris.push(p); tris.push(0);
+		adj.push(nca); adj.push(t); adj.push(t1);
+		setTriNeighbour(adj, nbc, t, t1);
+		setTriNeighbour(adj, nca, t, t2);
+		
+		stack.push(t); stack.push(0);
+		stack.push(t1); stack.push(0);
+		stack.push(t2); stack.push(0);
+	}
+	else
+	{
+		// p lies on the edge a-b shared by t = (a,b,c) and n = (b,a,d).
+		// Split into (a,p,c), (p,b,c), (b,p,d) and (p,a,d).
+		int f = 0;
+		while (f < 3 && adj[n*3+f] != t)
+			f++;
+		const int a = triVert(tris, t, e);
+		const int b = triVert(tris, t, e+1);
+		const int c = triVert(tris, t, e+2);
+		const int d = triVert(tris, n, f+2);
+		const int nbc = adj[t*3+(e+1)%3];
+		const int nca = adj[t*3+(e+2)%3];
+		const int nad = adj[n*3+(f+1)%3];
+		const int ndb = adj[n*3+(f+2)%3];
+		const int t1 = tris.size()/4;
+		const int n1 = t1+1;
+		
+		tris[t*4+0] = a; tris[t*4+1] = p; tris[t*4+2] = c;
+		adj[t*3+0] = n1; adj[t*3+1] = t1; adj[t*3+2] = nca;
+		tris[n*4+0] = b; tris[n*4+1] = p; tris[n*4+2] = d;
+		adj[n*3+0] = t1; adj[n*3+1] = n1; adj[n*3+2] = ndb;
+		tris.push(p); tris.push(b); tris.push(c); tris.push(0);
+		adj.push(n); adj.push(nbc); adj.push(t);
+		tris.push(p); tris.push(a); tris.push(d); tris.push(0);
+		adj.push(t); adj.push(nad); adj.push(n);
+		setTriNeighbour(adj, nbc, t, t1);
+		setTriNeighbour(adj, nad, n, n1);
+		
+		stack.push(t); stack.push(2);
+		stack.push(t1); stack.push(1);
+		stack.push(n); stack.push(2);
+		stack.push(n1); stack.push(1);
+	}
+	
+	legalizeTriEdges(ctx, verts, wind, tris, adj, stack);
+	lastTri = t;
+}
+
 // Calculate minimum extend of the polygon.
 static float polyMinExtent(const float* verts, const int nverts)
 {
@@ -668,11 +949,47 @@ static void setTriFlags(rcIntArray& tris, int nhull, int* hull)
 	}
 }
 
+// Returns true if the polygon vertices and the height patch are within sampleMaxError of each
+// other. No edge or interior sample of such polygon deviates enough from the triangulated
+// polygon to be added, so the sampling can be skipped.
+static bool isPolyFlat(const float* in, const int nin, const rcHeightPatch& hp,
+					   const float ch, const float sampleMaxError)
+{
+	// Keep a small margin, the sampling measures the error against interpolated heights.
+	const float maxRange = sampleMaxError*0.99f;
+	float ymin = in[1];
+	float ymax = in[1];
+	for (int i = 1; i < nin; ++i)
+	{
+		ymin = rcMin(ymin, in[i*3+1]);
+		ymax = rcMax(ymax, in[i*3+1]);
+	}
+	if (ymax - ymin >= maxRange)
+		return false;
+	
+	unsigned short hmin = RC_UNSET_HEIGHT;
+	unsigned short hmax = 0;
+	const int ncells = hp.width*hp.height;
+	for (int i = 0; i < ncells; ++i)
+	{
+		const unsigned short h = hp.data[i];
+		if (h == RC_UNSET_HEIGHT)
+			continue;
+		hmin = rcMin(hmin, h);
+		hmax = rcMax(hmax, h);
+	}
+	if (hmax < hmin)
+		return true;
+	
+	return rcMax(ymax, hmax*ch) - rcMin(ymin, hmin*ch) < maxRange;
+}
+
 static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 							const float sampleDist, const float sampleMaxError,
 							const int heightSearchRadius, const rcCompactHeightfield& chf,
 							const rcHeightPatch& hp, float* verts, int& nverts,
-							rcIntArray& tris, rcIntArray& edges, rcIntArray& samples)
+							rcIntArray& tris, rcIntArray& edges, rcIntArray& samples,
+							rcIntArray& stack, const int buildFlags, int& nflat)
 {
 	static const int MAX_VERTS = 127;
 	static const int MAX_TRIS = 255;	// Max tris for delaunay is 2n-2-k (n=num verts, k=num hull verts).
@@ -695,6 +1012,17 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 	// Calculate minimum extents of the polygon based on input data.
 	float minExtent = polyMinExtent(verts, nverts);
 	
+	// Flat polygons end up as the triangulated polygon, skip the sampling.
+	if (sampleDist > 0 && isPolyFlat(in, nin, hp, chf.ch, sampleMaxError))
+	{
+		for (int i = 0, j = nin-1; i < nin; j=i++)
+			hull[nhull++] = j;
+		triangulateHull(nverts, verts, nhull, hull, nin, tris);
+		setTriFlags(tris, nhull, hull);
+		nflat++;
+		return true;
+	}
+	
 	// Tessellate outlines.
 	// This is done in separate pass in order to ensure
 	// seamless height values across the ply boundaries.
@@ -855,6 +1183,15 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 			}
 		}
 		
+		// The incremental triangulation needs the hull winding and the
+		// triangle adjacency, which are set up when the first sample is added.
+		const bool incremental = (buildFlags & RC_DETAIL_INCREMENTAL_DELAUNAY) != 0;
+		float wind = 0;
+		int lastTri = 0;
+		for (int i = 2; i < nin; ++i)
+			wind += vcross2(&in[0], &in[(i-1)*3], &in[i*3]);
+		wind = wind < 0 ? -1.0f : 1.0f;
+		
 		// Add the samples starting from the one that has the most
 		// error. The procedure stops when all samples are added
 		// or when the max error is within treshold.
@@ -896,11 +1233,35 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 			rcVcopy(&verts[nverts*3],bestpt);
 			nverts++;
 			
-			// Create new triangulation.
-			// TODO: Incremental add instead of full rebuild.
-			edges.clear();
-			tris.clear();
-			delaunayHull(ctx, nverts, verts, nhull, hull, tris, edges);
+			if (incremental)
+			{
+				if (edges.size() == 0)
+				{
+					// Make the hull triangulation Delaunay before adding the first point.
+					buildTriAdjacency(tris, edges);
+					stack.clear();
+					for (int i = 0; i < tris.size()/4; ++i)
+					{
+						for (int j = 0; j < 3; ++j)
+						{
+							if (edges[i*3+j] > i)
+							{
+								stack.push(i);
+								stack.push(j);
+							}
+						}
+					}
+					legalizeTriEdges(ctx, verts, wind, tris, edges, stack);
+				}
+				insertTriVertex(ctx, verts, wind, nverts-1, tris, edges, stack, lastTri);
+			}
+			else
+			{
+				// Create new triangulation.
+				edges.clear();
+				tris.clear();
+				delaunayHull(ctx, nverts, verts, nhull, hull, tris, edges);
+			}
 		}
 	}
 	
@@ -917,8 +1278,8 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 }
 
 static void seedArrayWithPolyCenter(rcContext* ctx, const rcCompactHeightfield& chf,
-									const unsigned short* poly, const int npoly,
-									const unsigned short* verts, const int bs,
+									const rcMeshIndex* poly, const int npoly,
+									const rcMeshIndex* verts, const int bs,
 									rcHeightPatch& hp, rcIntArray& array)
 {
 	// Note: Reads to the compact heightfield are offset by border size (bs)
@@ -1058,8 +1419,8 @@ static void push3(rcIntArray& queue, int v1, int v2, int v3)
 }
 
 static void getHeightData(rcContext* ctx, const rcCompactHeightfield& chf,
-						  const unsigned short* poly, const int npoly,
-						  const unsigned short* verts, const int bs,
+						  const rcMeshIndex* poly, const int npoly,
+						  const rcMeshIndex* verts, const int bs,
 						  rcHeightPatch& hp, rcIntArray& queue,
 						  int region)
 {
@@ -1174,55 +1535,182 @@ static void getHeightData(rcContext* ctx, const rcCompactHeightfield& chf,
 	}
 }
 
-/// @par
-///
-/// See the #rcConfig documentation for more information on the configuration parameters.
-///
-/// @see rcAllocPolyMeshDetail, rcPolyMesh, rcCompactHeightfield, rcPolyMeshDetail, rcConfig
-bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
-						   const float sampleDist, const float sampleMaxError,
-						   rcPolyMeshDetail& dmesh)
+/// Scratch memory and output of one thread building detail meshes.
+struct rcPolyDetailScratch
 {
-	rcAssert(ctx);
-	
-	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESHDETAIL);
+	inline rcPolyDetailScratch() : edges(64), tris(512), arr(512), samples(512), nflat(0), failed(false) {}
+	rcIntArray edges;
+	rcIntArray tris;
+	rcIntArray arr;
+	rcIntArray samples;
+	float verts[256*3];
+	rcTempVector<float> poly;
+	rcHeightPatch hp;
+	// Detail vertices (world space) and triangles of all polygons processed by this thread.
+	rcTempVector<float> detailVerts;
+	rcTempVector<unsigned char> detailTris;
+	// Number of polygons built without sampling, see isPolyFlat().
+	int nflat;
+	bool failed;
+};
+
+/// Shared state of a rcBuildPolyMeshDetail job.
+struct rcPolyDetailJob
+{
+	rcContext* ctx;
+	const rcPolyMesh* mesh;
+	const rcCompactHeightfield* chf;
+	const int* bounds;
+	float sampleDist;
+	float sampleMaxError;
+	int heightSearchRadius;
+	int buildFlags;
+	rcPolyDetailScratch* scratch;
+	// The first polygon of the current batch, the job ranges are relative to it.
+	int firstPoly;
+	// Per polygon: [thread, first vertex, vertex count, first triangle, triangle count],
+	// where the offsets index the detail buffers of the thread.
+	int* polyDetails;
+};
+
+static void buildPolyDetailRange(void* userData, const int begin, const int end, const int threadIndex)
+{
+	rcPolyDetailJob& job = *(rcPolyDetailJob*)userData;
+	rcPolyDetailScratch& scratch = job.scratch[threadIndex];
+	const rcPolyMesh& mesh = *job.mesh;
+	const rcCompactHeightfield& chf = *job.chf;
+	const int nvp = mesh.nvp;
+	const float cs = mesh.cs;
+	const float ch = mesh.ch;
+	const float* orig = mesh.bmin;
+	float* poly = scratch.poly.data();
+	float* verts = scratch.verts;
 	
+	for (int i = job.firstPoly+begin; i < job.firstPoly+end && !scratch.failed; ++i)
+	{
+		const rcMeshIndex* p = &mesh.polys[i*nvp*2];
+		
+		// Store polygon vertices for processing.
+		int npoly = 0;
+		for (int j = 0; j < nvp; ++j)
+		{
+			if(p[j] == RC_MESH_NULL_IDX) break;
+			const rcMeshIndex* v = &mesh.verts[p[j]*3];
+			poly[j*3+0] = v[0]*cs;
+			poly[j*3+1] = v[1]*ch;
+			poly[j*3+2] = v[2]*cs;
+			npoly++;
+		}
+		
+		// Get the height data from the area of the polygon.
+		rcHeightPatch& hp = scratch.hp;
+		hp.xmin = job.bounds[i*4+0];
+		hp.ymin = job.bounds[i*4+2];
+		hp.width = job.bounds[i*4+1]-job.bounds[i*4+0];
+		hp.height = job.bounds[i*4+3]-job.bounds[i*4+2];
+		getHeightData(job.ctx, chf, p, npoly, mesh.verts, mesh.borderSize, hp, scratch.arr, mesh.regs[i]);
+		
+		// Build detail mesh.
+		int nverts = 0;
+		if (!buildPolyDetail(job.ctx, poly, npoly,
+							 job.sampleDist, job.sampleMaxError,
+							 job.heightSearchRadius, chf, hp,
+							 verts, nverts, scratch.tris,
+							 scratch.edges, scratch.samples,
+							 scratch.arr, job.buildFlags, scratch.nflat))
+		{
+			scratch.failed = true;
+			return;
+		}
+		
+		// Move detail verts to world space.
+		for (int j = 0; j < nverts; ++j)
+		{
+			verts[j*3+0] += orig[0];
+			verts[j*3+1] += orig[1] + chf.ch; // Is this offset necessary?
+			verts[j*3+2] += orig[2];
+		}
+		
+		// Store detail submesh.
+		const int ntris = scratch.tris.size()/4;
+		
+		int* details = &job.polyDetails[i*5];
+		details[0] = threadIndex;
+		details[1] = (int)(scratch.detailVerts.size()/3);
+		details[2] = nverts;
+		details[3] = (int)(scratch.detailTris.size()/4);
+		details[4] = ntris;
+		
+		for (int j = 0; j < nverts*3; ++j)
+			scratch.detailVerts.push_back(verts[j]);
+		for (int j = 0; j < ntris*4; ++j)
+			scratch.detailTris.push_back((unsigned char)scratch.tris[j]);
+	}
+}
+
+/// The state of a detail mesh build between the calls of #rcStepPolyMeshDetail.
+struct rcPolyMeshDetailBuild
+{
+	inline rcPolyMeshDetailBuild() : bounds(0), polyDetails(0), dmesh(0), next(0), done(true)
+	{
+		memset(&job, 0, sizeof(job));
+	}
+	inline ~rcPolyMeshDetailBuild() { reset(); }
+
+	void reset()
+	{
+		rcFree(bounds);
+		rcFree(polyDetails);
+		bounds = 0;
+		polyDetails = 0;
+		scratch.clear();
+	}
+
+	int* bounds;
+	int* polyDetails;
+	rcTempVector<rcPolyDetailScratch> scratch;
+	rcPolyDetailJob job;
+	rcPolyMeshDetail* dmesh;
+	int next;	// The next polygon to build.
+	bool done;
+};
+
+static bool beginPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
+								const float sampleDist, const float sampleMaxError,
+								rcPolyMeshDetail& dmesh, const int buildFlags, rcPolyMeshDetailBuild& build)
+{
+	build.reset();
+	build.dmesh = &dmesh;
+	build.next = 0;
+	build.done = true;
+
 	if (mesh.nverts == 0 || mesh.npolys == 0)
 		return true;
 	
 	const int nvp = mesh.nvp;
-	const float cs = mesh.cs;
-	const float ch = mesh.ch;
-	const float* orig = mesh.bmin;
-	const int borderSize = mesh.borderSize;
 	const int heightSearchRadius = rcMax(1, (int)ceilf(mesh.maxEdgeError));
+	const int nthreads = ctx->getMaxThreads();
 	
-	rcIntArray edges(64);
-	rcIntArray tris(512);
-	rcIntArray arr(512);
-	rcIntArray samples(512);
-	float verts[256*3];
-	rcHeightPatch hp;
-	int nPolyVerts = 0;
 	int maxhw = 0, maxhh = 0;
 	
-	rcScopedDelete<int> bounds((int*)rcAlloc(sizeof(int)*mesh.npolys*4, RC_ALLOC_TEMP));
-	if (!bounds)
+	build.bounds = (int*)rcAlloc(sizeof(int)*mesh.npolys*4, RC_ALLOC_TEMP);
+	if (!build.bounds)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'bounds' (%d).", mesh.npolys*4);
 		return false;
 	}
-	rcScopedDelete<float> poly((float*)rcAlloc(sizeof(float)*nvp*3, RC_ALLOC_TEMP));
-	if (!poly)
+	build.polyDetails = (int*)rcAlloc(sizeof(int)*mesh.npolys*5, RC_ALLOC_TEMP);
+	if (!build.polyDetails)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'poly' (%d).", nvp*3);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'polyDetails' (%d).", mesh.npolys*5);
 		return false;
 	}
+	int* bounds = build.bounds;
 	
 	// Find max size for a polygon area.
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
-		const unsigned short* p = &mesh.polys[i*nvp*2];
+		const rcMeshIndex* p = &mesh.polys[i*nvp*2];
 		int& xmin = bounds[i*4+0];
 		int& xmax = bounds[i*4+1];
 		int& ymin = bounds[i*4+2];
@@ -1234,12 +1722,11 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		for (int j = 0; j < nvp; ++j)
 		{
 			if(p[j] == RC_MESH_NULL_IDX) break;
-			const unsigned short* v = &mesh.verts[p[j]*3];
+			const rcMeshIndex* v = &mesh.verts[p[j]*3];
 			xmin = rcMin(xmin, (int)v[0]);
 			xmax = rcMax(xmax, (int)v[0]);
 			ymin = rcMin(ymin, (int)v[2]);
 			ymax = rcMax(ymax, (int)v[2]);
-			nPolyVerts++;
 		}
 		xmin = rcMax(0,xmin-1);
 		xmax = rcMin(chf.width,xmax+1);
@@ -1250,12 +1737,63 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		maxhh = rcMax(maxhh, ymax-ymin);
 	}
 	
-	hp.data = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxhw*maxhh, RC_ALLOC_TEMP);
-	if (!hp.data)
+	rcTempVector<rcPolyDetailScratch>& scratch = build.scratch;
+	scratch.resize(nthreads);
+	if (scratch.size() != nthreads)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'hp.data' (%d).", maxhw*maxhh);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'scratch' (%d).", nthreads);
 		return false;
 	}
+	for (int i = 0; i < nthreads; ++i)
+	{
+		rcPolyDetailScratch& s = scratch[i];
+		s.poly.resize(nvp*3);
+		s.hp.data = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxhw*maxhh, RC_ALLOC_TEMP);
+		if (s.poly.size() != nvp*3 || !s.hp.data)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'hp.data' (%d).", maxhw*maxhh);
+			return false;
+		}
+	}
+	
+	rcPolyDetailJob& job = build.job;
+	job.ctx = ctx;
+	job.mesh = &mesh;
+	job.chf = &chf;
+	job.bounds = bounds;
+	job.sampleDist = sampleDist;
+	job.sampleMaxError = sampleMaxError;
+	job.heightSearchRadius = heightSearchRadius;
+	job.buildFlags = buildFlags;
+	job.scratch = scratch.data();
+	job.firstPoly = 0;
+	job.polyDetails = build.polyDetails;
+
+	build.done = false;
+	return true;
+}
+
+// Packs the per-polygon results in polygon order into the detail mesh.
+static bool packPolyMeshDetail(rcContext* ctx, rcPolyMeshDetailBuild& build)
+{
+	const rcPolyMesh& mesh = *build.job.mesh;
+	rcPolyMeshDetail& dmesh = *build.dmesh;
+	const rcTempVector<rcPolyDetailScratch>& scratch = build.scratch;
+	const int* polyDetails = build.polyDetails;
+
+	int nflat = 0;
+	for (int i = 0; i < scratch.size(); ++i)
+		nflat += scratch[i].nflat;
+	ctx->log(RC_LOG_PROGRESS, "rcBuildPolyMeshDetail: Skipped sampling of %d/%d flat polygons.", nflat, mesh.npolys);
+	
+	// Pack the per-polygon results in polygon order.
+	int nverts = 0;
+	int ntris = 0;
+	for (int i = 0; i < mesh.npolys; ++i)
+	{
+		nverts += polyDetails[i*5+2];
+		ntris += polyDetails[i*5+4];
+	}
 	
 	dmesh.nmeshes = mesh.npolys;
 	dmesh.nverts = 0;
@@ -1266,137 +1804,143 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.meshes' (%d).", dmesh.nmeshes*4);
 		return false;
 	}
-	
-	int vcap = nPolyVerts+nPolyVerts/2;
-	int tcap = vcap*2;
-	
-	dmesh.nverts = 0;
-	dmesh.verts = (float*)rcAlloc(sizeof(float)*vcap*3, RC_ALLOC_PERM);
+	dmesh.verts = (float*)rcAlloc(sizeof(float)*nverts*3, RC_ALLOC_PERM);
 	if (!dmesh.verts)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d).", vcap*3);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d).", nverts*3);
 		return false;
 	}
-	dmesh.ntris = 0;
-	dmesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*tcap*4, RC_ALLOC_PERM);
+	dmesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*ntris*4, RC_ALLOC_PERM);
 	if (!dmesh.tris)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.tris' (%d).", tcap*4);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.tris' (%d).", ntris*4);
 		return false;
 	}
 	
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
-		const unsigned short* p = &mesh.polys[i*nvp*2];
-		
-		// Store polygon vertices for processing.
-		int npoly = 0;
-		for (int j = 0; j < nvp; ++j)
-		{
-			if(p[j] == RC_MESH_NULL_IDX) break;
-			const unsigned short* v = &mesh.verts[p[j]*3];
-			poly[j*3+0] = v[0]*cs;
-			poly[j*3+1] = v[1]*ch;
-			poly[j*3+2] = v[2]*cs;
-			npoly++;
-		}
-		
-		// Get the height data from the area of the polygon.
-		hp.xmin = bounds[i*4+0];
-		hp.ymin = bounds[i*4+2];
-		hp.width = bounds[i*4+1]-bounds[i*4+0];
-		hp.height = bounds[i*4+3]-bounds[i*4+2];
-		getHeightData(ctx, chf, p, npoly, mesh.verts, borderSize, hp, arr, mesh.regs[i]);
-		
-		// Build detail mesh.
-		int nverts = 0;
-		if (!buildPolyDetail(ctx, poly, npoly,
-							 sampleDist, sampleMaxError,
-							 heightSearchRadius, chf, hp,
-							 verts, nverts, tris,
-							 edges, samples))
-		{
-			return false;
-		}
-		
-		// Move detail verts to world space.
-		for (int j = 0; j < nverts; ++j)
-		{
-			verts[j*3+0] += orig[0];
-			verts[j*3+1] += orig[1] + chf.ch; // Is this offset necessary?
-			verts[j*3+2] += orig[2];
-		}
-		// Offset poly too, will be used to flag checking.
-		for (int j = 0; j < npoly; ++j)
-		{
-			poly[j*3+0] += orig[0];
-			poly[j*3+1] += orig[1];
-			poly[j*3+2] += orig[2];
-		}
-		
-		// Store detail submesh.
-		const int ntris = tris.size()/4;
+		const int* details = &polyDetails[i*5];
+		const rcPolyDetailScratch& s = scratch[details[0]];
 		
 		dmesh.meshes[i*4+0] = (unsigned int)dmesh.nverts;
-		dmesh.meshes[i*4+1] = (unsigned int)nverts;
+		dmesh.meshes[i*4+1] = (unsigned int)details[2];
 		dmesh.meshes[i*4+2] = (unsigned int)dmesh.ntris;
-		dmesh.meshes[i*4+3] = (unsigned int)ntris;
-		
-		// Store vertices, allocate more memory if necessary.
-		if (dmesh.nverts+nverts > vcap)
-		{
-			while (dmesh.nverts+nverts > vcap)
-				vcap += 256;
-			
-			float* newv = (float*)rcAlloc(sizeof(float)*vcap*3, RC_ALLOC_PERM);
-			if (!newv)
-			{
-				ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'newv' (%d).", vcap*3);
-				return false;
-			}
-			if (dmesh.nverts)
-				memcpy(newv, dmesh.verts, sizeof(float)*3*dmesh.nverts);
-			rcFree(dmesh.verts);
-			dmesh.verts = newv;
-		}
-		for (int j = 0; j < nverts; ++j)
-		{
-			dmesh.verts[dmesh.nverts*3+0] = verts[j*3+0];
-			dmesh.verts[dmesh.nverts*3+1] = verts[j*3+1];
-			dmesh.verts[dmesh.nverts*3+2] = verts[j*3+2];
-			dmesh.nverts++;
-		}
+		dmesh.meshes[i*4+3] = (unsigned int)details[4];
 		
-		// Store triangles, allocate more memory if necessary.
-		if (dmesh.ntris+ntris > tcap)
-		{
-			while (dmesh.ntris+ntris > tcap)
-				tcap += 256;
-			unsigned char* newt = (unsigned char*)rcAlloc(sizeof(unsigned char)*tcap*4, RC_ALLOC_PERM);
-			if (!newt)
-			{
-				ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'newt' (%d).", tcap*4);
-				return false;
-			}
-			if (dmesh.ntris)
-				memcpy(newt, dmesh.tris, sizeof(unsigned char)*4*dmesh.ntris);
-			rcFree(dmesh.tris);
-			dmesh.tris = newt;
-		}
-		for (int j = 0; j < ntris; ++j)
-		{
-			const int* t = &tris[j*4];
-			dmesh.tris[dmesh.ntris*4+0] = (unsigned char)t[0];
-			dmesh.tris[dmesh.ntris*4+1] = (unsigned char)t[1];
-			dmesh.tris[dmesh.ntris*4+2] = (unsigned char)t[2];
-			dmesh.tris[dmesh.ntris*4+3] = (unsigned char)t[3];
-			dmesh.ntris++;
-		}
+		memcpy(&dmesh.verts[dmesh.nverts*3], s.detailVerts.data() + details[1]*3, sizeof(float)*3*details[2]);
+		dmesh.nverts += details[2];
+		memcpy(&dmesh.tris[dmesh.ntris*4], s.detailTris.data() + details[3]*4, sizeof(unsigned char)*4*details[4]);
+		dmesh.ntris += details[4];
 	}
 	
 	return true;
 }
 
+// Builds the details of at most maxPolys polygons, at least one, and packs the mesh after the last one.
+static bool advancePolyMeshDetail(rcContext* ctx, rcPolyMeshDetailBuild& build, const int maxPolys)
+{
+	if (build.done)
+		return true;
+
+	const int npolys = build.job.mesh->npolys;
+	const int first = build.next;
+	const int last = rcMin(first + rcMax(maxPolys, 1), npolys);
+
+	build.job.ctx = ctx;
+	build.job.firstPoly = first;
+	ctx->parallelFor(last - first, buildPolyDetailRange, &build.job);
+	build.next = last;
+
+	for (int i = 0; i < build.scratch.size(); ++i)
+	{
+		if (build.scratch[i].failed)
+			return false;
+	}
+
+	if (build.next < npolys)
+		return true;
+
+	build.done = true;
+	return packPolyMeshDetail(ctx, build);
+}
+
+/// @par
+///
+/// See the #rcConfig documentation for more information on the configuration parameters.
+///
+/// The polygons are processed in parallel through rcContext::parallelFor, each thread using
+/// its own height patch and scratch buffers. The per-polygon results are packed in polygon
+/// order afterwards, so the output does not depend on the number of threads.
+///
+/// By default the Delaunay triangulation of a polygon is rebuilt from scratch every time a
+/// sample is added. With #RC_DETAIL_INCREMENTAL_DELAUNAY the samples are inserted into the
+/// existing triangulation instead (point location walk, edge flips), which is much cheaper
+/// for polygons that receive many samples. Both produce Delaunay triangulations of the same
+/// points, but ties between co-circular points may be resolved differently.
+///
+/// @see rcAllocPolyMeshDetail, rcPolyMesh, rcCompactHeightfield, rcPolyMeshDetail, rcConfig, rcBeginPolyMeshDetail
+bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
+						   const float sampleDist, const float sampleMaxError,
+						   rcPolyMeshDetail& dmesh, const int buildFlags)
+{
+	rcAssert(ctx);
+	
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESHDETAIL);
+	
+	rcPolyMeshDetailBuild build;
+	if (!beginPolyMeshDetail(ctx, mesh, chf, sampleDist, sampleMaxError, dmesh, buildFlags, build))
+		return false;
+	return advancePolyMeshDetail(ctx, build, mesh.npolys);
+}
+
+rcPolyMeshDetailBuild* rcAllocPolyMeshDetailBuild()
+{
+	void* mem = rcAlloc(sizeof(rcPolyMeshDetailBuild), RC_ALLOC_PERM);
+	return mem ? ::new(rcNewTag(), mem) rcPolyMeshDetailBuild() : 0;
+}
+
+void rcFreePolyMeshDetailBuild(rcPolyMeshDetailBuild* build)
+{
+	if (!build)
+		return;
+	build->~rcPolyMeshDetailBuild();
+	rcFree(build);
+}
+
+/// @par
+///
+/// Builds the same detail mesh as #rcBuildPolyMeshDetail. The detail mesh is filled once the build is done.
+///
+/// @see rcStepPolyMeshDetail, rcBuildPolyMeshDetail
+bool rcBeginPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
+						   const float sampleDist, const float sampleMaxError,
+						   rcPolyMeshDetail& dmesh, rcPolyMeshDetailBuild& build, const int buildFlags)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESHDETAIL);
+
+	return beginPolyMeshDetail(ctx, mesh, chf, sampleDist, sampleMaxError, dmesh, buildFlags, build);
+}
+
+/// @par
+///
+/// Each step builds the details of a batch of polygons through rcContext::parallelFor. The last step also packs
+/// the detail mesh.
+///
+/// @see rcBeginPolyMeshDetail
+bool rcStepPolyMeshDetail(rcContext* ctx, rcPolyMeshDetailBuild& build, const int maxPolys, bool& done)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESHDETAIL);
+
+	const bool ok = advancePolyMeshDetail(ctx, build, maxPolys);
+	done = build.done;
+
+	return ok;
+}
+
 /// @see rcAllocPolyMeshDetail, rcPolyMeshDetail
 bool rcMergePolyMeshDetails(rcContext* ctx, rcPolyMeshDetail** meshes, const int nmeshes, rcPolyMeshDetail& mesh)
 {
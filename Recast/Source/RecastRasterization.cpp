@@ -16,7 +16,9 @@
 // 3. This notice may not be removed or altered from any source distribution.
 //
 
+#include <float.h>
 #include <math.h>
+#include <stdlib.h>
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
@@ -204,6 +206,32 @@ bool rcAddSpan(rcContext* context, rcHeightfield& heightfield,
 	return true;
 }
 
+void rcClearHeightfieldColumns(rcContext* context, rcHeightfield& heightfield,
+                               const int minX, const int minZ, const int maxX, const int maxZ)
+{
+	rcAssert(context);
+	rcIgnoreUnused(context);
+
+	const int x0 = rcMax(minX, 0);
+	const int z0 = rcMax(minZ, 0);
+	const int x1 = rcMin(maxX, heightfield.width - 1);
+	const int z1 = rcMin(maxZ, heightfield.height - 1);
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			rcSpan* span = heightfield.spans[x + z * heightfield.width];
+			while (span != NULL)
+			{
+				rcSpan* next = span->next;
+				freeSpan(heightfield, span);
+				span = next;
+			}
+			heightfield.spans[x + z * heightfield.width] = NULL;
+		}
+	}
+}
+
 enum rcAxis
 {
 	RC_AXIS_X = 0,
@@ -302,12 +330,13 @@ static void dividePoly(const float* inVerts, int inVertsCount,
 /// @param[in] 	inverseCellSize		1 / cellSize
 /// @param[in] 	inverseCellHeight	1 / cellHeight
 /// @param[in] 	flagMergeThreshold	The threshold in which area flags will be merged 
+/// @param[in] 	columnRect			The columns to add spans to (minX, minZ, maxX, maxZ), or null for all columns.
 /// @returns true if the operation completes successfully.  false if there was an error adding spans to the heightfield.
 static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
                          const unsigned char areaID, rcHeightfield& heightfield,
                          const float* heightfieldBBMin, const float* heightfieldBBMax,
                          const float cellSize, const float inverseCellSize, const float inverseCellHeight,
-                         const int flagMergeThreshold)
+                         const int flagMergeThreshold, const int* columnRect = NULL)
 {
 	// Calculate the bounding box of the triangle.
 	float triBBMin[3];
@@ -330,13 +359,32 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 	const int h = heightfield.height;
 	const float by = heightfieldBBMax[1] - heightfieldBBMin[1];
 
+	// The triangle is clipped against the whole grid so that the spans of the columns in the
+	// rectangle are bit-exact with rasterizing the whole triangle.
+	const int minColumnX = columnRect ? columnRect[0] : 0;
+	const int minColumnZ = columnRect ? columnRect[1] : 0;
+	const int maxColumnX = columnRect ? columnRect[2] : w - 1;
+	const int maxColumnZ = columnRect ? columnRect[3] : h - 1;
+	if (columnRect)
+	{
+		// Clipped vertices may fall slightly outside of the triangle bounds, so allow a cell of slack.
+		const int triX0 = (int)((triBBMin[0] - heightfieldBBMin[0]) * inverseCellSize);
+		const int triX1 = (int)((triBBMax[0] - heightfieldBBMin[0]) * inverseCellSize);
+		const int triZ0 = (int)((triBBMin[2] - heightfieldBBMin[2]) * inverseCellSize);
+		const int triZ1 = (int)((triBBMax[2] - heightfieldBBMin[2]) * inverseCellSize);
+		if (triX1 < minColumnX - 1 || triX0 > maxColumnX + 1 || triZ1 < minColumnZ - 1 || triZ0 > maxColumnZ + 1)
+		{
+			return true;
+		}
+	}
+
 	// Calculate the footprint of the triangle on the grid's z-axis
 	int z0 = (int)((triBBMin[2] - heightfieldBBMin[2]) * inverseCellSize);
 	int z1 = (int)((triBBMax[2] - heightfieldBBMin[2]) * inverseCellSize);
 
 	// use -1 rather than 0 to cut the polygon properly at the start of the tile
 	z0 = rcClamp(z0, -1, h - 1);
-	z1 = rcClamp(z1, 0, h - 1);
+	z1 = rcClamp(z1, 0, maxColumnZ);
 
 	// Clip the triangle into all grid cells it touches.
 	float buf[7 * 3 * 4];
@@ -362,7 +410,7 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 		{
 			continue;
 		}
-		if (z < 0)
+		if (z < minColumnZ)
 		{
 			continue;
 		}
@@ -383,12 +431,12 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 		}
 		int x0 = (int)((minX - heightfieldBBMin[0]) * inverseCellSize);
 		int x1 = (int)((maxX - heightfieldBBMin[0]) * inverseCellSize);
-		if (x1 < 0 || x0 >= w)
+		if (x1 < minColumnX || x0 > maxColumnX)
 		{
 			continue;
 		}
 		x0 = rcClamp(x0, -1, w - 1);
-		x1 = rcClamp(x1, 0, w - 1);
+		x1 = rcClamp(x1, 0, maxColumnX);
 
 		int nv;
 		int nv2 = nvRow;
@@ -404,7 +452,7 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 			{
 				continue;
 			}
-			if (x < 0)
+			if (x < minColumnX)
 			{
 				continue;
 			}
@@ -553,3 +601,874 @@ bool rcRasterizeTriangles(rcContext* context,
 
 	return true;
 }
+
+bool rcRasterizeTrianglesInColumns(rcContext* context,
+                                   const float* verts, const int /*nv*/,
+                                   const int* tris, const unsigned char* triAreaIDs, const int numTris,
+                                   rcHeightfield& heightfield,
+                                   const int minX, const int minZ, const int maxX, const int maxZ,
+                                   const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	const int columnRect[4] = {
+		rcMax(minX, 0), rcMax(minZ, 0),
+		rcMin(maxX, heightfield.width - 1), rcMin(maxZ, heightfield.height - 1)
+	};
+	if (columnRect[0] > columnRect[2] || columnRect[1] > columnRect[3])
+	{
+		return true;
+	}
+
+	// Rasterize the triangles.
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+	for (int triIndex = 0; triIndex < numTris; ++triIndex)
+	{
+		const float* v0 = &verts[tris[triIndex * 3 + 0] * 3];
+		const float* v1 = &verts[tris[triIndex * 3 + 1] * 3];
+		const float* v2 = &verts[tris[triIndex * 3 + 2] * 3];
+		if (!rasterizeTri(v0, v1, v2, triAreaIDs[triIndex], heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold, columnRect))
+		{
+			context->log(RC_LOG_ERROR, "rcRasterizeTrianglesInColumns: Out of memory.");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// Expands the height range with the height of a heightmap cell at a point.
+/// The cell is split into two triangles along its diagonal from (0, 0) to (1, 1).
+static inline void expandCellHeightRange(const float* corners, const float u, const float v, float& minHeight, float& maxHeight)
+{
+	const float height = u >= v
+		? corners[0] + u * (corners[1] - corners[0]) + v * (corners[3] - corners[1])
+		: corners[0] + v * (corners[2] - corners[0]) + u * (corners[3] - corners[2]);
+	minHeight = rcMin(minHeight, height);
+	maxHeight = rcMax(maxHeight, height);
+}
+
+/// Calculates the height range of the part of a heightmap cell that lies inside a rectangle.
+///
+/// The surface is linear over each triangle of the cell, so its extremes are at the corners of the clipped
+/// rectangle or where the diagonal of the cell crosses the edges of the rectangle.
+///
+/// @param[in]	corners		The heights at the corners of the cell, ordered (0, 0), (1, 0), (0, 1), (1, 1).
+/// @param[in]	u0, u1		The x range of the rectangle in cell coordinates. [Limits: 0 <= u0 < u1 <= 1]
+/// @param[in]	v0, v1		The z range of the rectangle in cell coordinates. [Limits: 0 <= v0 < v1 <= 1]
+/// @param[out]	minHeight	The minimum height of the surface inside the rectangle.
+/// @param[out]	maxHeight	The maximum height of the surface inside the rectangle.
+static void heightmapCellRange(const float* corners, const float u0, const float u1, const float v0, const float v1,
+                               float& minHeight, float& maxHeight)
+{
+	minHeight = FLT_MAX;
+	maxHeight = -FLT_MAX;
+	expandCellHeightRange(corners, u0, v0, minHeight, maxHeight);
+	expandCellHeightRange(corners, u1, v0, minHeight, maxHeight);
+	expandCellHeightRange(corners, u0, v1, minHeight, maxHeight);
+	expandCellHeightRange(corners, u1, v1, minHeight, maxHeight);
+	if (v0 > u0 && v0 < u1)
+	{
+		expandCellHeightRange(corners, v0, v0, minHeight, maxHeight);
+	}
+	if (v1 > u0 && v1 < u1)
+	{
+		expandCellHeightRange(corners, v1, v1, minHeight, maxHeight);
+	}
+	if (u0 > v0 && u0 < v1)
+	{
+		expandCellHeightRange(corners, u0, u0, minHeight, maxHeight);
+	}
+	if (u1 > v0 && u1 < v1)
+	{
+		expandCellHeightRange(corners, u1, u1, minHeight, maxHeight);
+	}
+}
+
+bool rcRasterizeHeightmap(rcContext* context,
+                          const float* heights, const unsigned char* cellAreaIDs,
+                          const int numX, const int numZ, const float* origin, const float spacing,
+                          rcHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	if (numX < 2 || numZ < 2 || spacing <= 0.0f)
+	{
+		return true;
+	}
+
+	const float cellSize = heightfield.cs;
+	const float inverseSpacing = 1.0f / spacing;
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+	const float by = heightfield.bmax[1] - heightfield.bmin[1];
+	const float heightOffset = origin[1] - heightfield.bmin[1];
+	const int numCellsX = numX - 1;
+	const int numCellsZ = numZ - 1;
+
+	// The columns the heightmap covers.
+	const int x0 = rcMax((int)floorf((origin[0] - heightfield.bmin[0]) / cellSize), 0);
+	const int z0 = rcMax((int)floorf((origin[2] - heightfield.bmin[2]) / cellSize), 0);
+	const int x1 = rcMin((int)floorf((origin[0] + (float)numCellsX * spacing - heightfield.bmin[0]) / cellSize), heightfield.width - 1);
+	const int z1 = rcMin((int)floorf((origin[2] + (float)numCellsZ * spacing - heightfield.bmin[2]) / cellSize), heightfield.height - 1);
+
+	for (int z = z0; z <= z1; ++z)
+	{
+		// The extent of the column in heightmap coordinates, clipped to the heightmap.
+		const float columnMinZ = heightfield.bmin[2] + (float)z * cellSize;
+		const float v0 = rcMax((columnMinZ - origin[2]) * inverseSpacing, 0.0f);
+		const float v1 = rcMin((columnMinZ + cellSize - origin[2]) * inverseSpacing, (float)numCellsZ);
+		if (v0 >= v1)
+		{
+			continue;
+		}
+		const int cellZ0 = rcMin((int)v0, numCellsZ - 1);
+		const int cellZ1 = rcMin((int)ceilf(v1) - 1, numCellsZ - 1);
+
+		for (int x = x0; x <= x1; ++x)
+		{
+			const float columnMinX = heightfield.bmin[0] + (float)x * cellSize;
+			const float u0 = rcMax((columnMinX - origin[0]) * inverseSpacing, 0.0f);
+			const float u1 = rcMin((columnMinX + cellSize - origin[0]) * inverseSpacing, (float)numCellsX);
+			if (u0 >= u1)
+			{
+				continue;
+			}
+			const int cellX0 = rcMin((int)u0, numCellsX - 1);
+			const int cellX1 = rcMin((int)ceilf(u1) - 1, numCellsX - 1);
+
+			// The column gets a single span from the lowest to the highest point of the surface inside it.
+			float spanMin = FLT_MAX;
+			float spanMax = -FLT_MAX;
+			for (int cz = cellZ0; cz <= cellZ1; ++cz)
+			{
+				for (int cx = cellX0; cx <= cellX1; ++cx)
+				{
+					const float* row = &heights[cx + cz * numX];
+					const float corners[4] = { row[0], row[1], row[numX], row[numX + 1] };
+					float cellMin;
+					float cellMax;
+					heightmapCellRange(corners,
+					                   rcMax(u0 - (float)cx, 0.0f), rcMin(u1 - (float)cx, 1.0f),
+					                   rcMax(v0 - (float)cz, 0.0f), rcMin(v1 - (float)cz, 1.0f),
+					                   cellMin, cellMax);
+					spanMin = rcMin(spanMin, cellMin);
+					spanMax = rcMax(spanMax, cellMax);
+				}
+			}
+			spanMin += heightOffset;
+			spanMax += heightOffset;
+
+			// Skip the span if it's completely outside the heightfield bounding box
+			if (spanMax < 0.0f)
+			{
+				continue;
+			}
+			if (spanMin > by)
+			{
+				continue;
+			}
+
+			// Clamp the span to the heightfield bounding box.
+			if (spanMin < 0.0f)
+			{
+				spanMin = 0;
+			}
+			if (spanMax > by)
+			{
+				spanMax = by;
+			}
+
+			// Snap the span to the heightfield height grid.
+			unsigned short spanMinCellIndex = (unsigned short)rcClamp((int)floorf(spanMin * inverseCellHeight), 0, RC_SPAN_MAX_HEIGHT);
+			unsigned short spanMaxCellIndex = (unsigned short)rcClamp((int)ceilf(spanMax * inverseCellHeight), (int)spanMinCellIndex + 1, RC_SPAN_MAX_HEIGHT);
+
+			// As with overlapping triangles, the cells whose tops are within the merge threshold of the top of the
+			// span decide its area, and the highest area id among them wins.
+			unsigned char areaID = 0;
+			if (cellZ0 == cellZ1 && cellX0 == cellX1)
+			{
+				areaID = cellAreaIDs[cellX0 + cellZ0 * numCellsX];
+			}
+			else
+			{
+				for (int cz = cellZ0; cz <= cellZ1; ++cz)
+				{
+					for (int cx = cellX0; cx <= cellX1; ++cx)
+					{
+						const float* row = &heights[cx + cz * numX];
+						const float corners[4] = { row[0], row[1], row[numX], row[numX + 1] };
+						float cellMin;
+						float cellMax;
+						heightmapCellRange(corners,
+						                   rcMax(u0 - (float)cx, 0.0f), rcMin(u1 - (float)cx, 1.0f),
+						                   rcMax(v0 - (float)cz, 0.0f), rcMin(v1 - (float)cz, 1.0f),
+						                   cellMin, cellMax);
+						const float top = rcClamp(cellMax + heightOffset, 0.0f, by);
+						const int topCellIndex = rcClamp((int)ceilf(top * inverseCellHeight), 0, RC_SPAN_MAX_HEIGHT);
+						if ((int)spanMaxCellIndex - topCellIndex <= flagMergeThreshold)
+						{
+							areaID = rcMax(areaID, cellAreaIDs[cx + cz * numCellsX]);
+						}
+					}
+				}
+			}
+
+			if (!addSpan(heightfield, x, z, spanMinCellIndex, spanMaxCellIndex, areaID, flagMergeThreshold))
+			{
+				context->log(RC_LOG_ERROR, "rcRasterizeHeightmap: Out of memory.");
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/// Transforms a mesh space point to world space with the transform of an #rcMeshInstance.
+static inline void transformPoint(const float* transform, const float* point, float* result)
+{
+	for (int row = 0; row < 3; ++row)
+	{
+		const float* m = &transform[row * 4];
+		result[row] = m[0] * point[0] + m[1] * point[1] + m[2] * point[2] + m[3];
+	}
+}
+
+/// Checks whether a transform only rotates around the y-axis, scales uniformly and translates.
+/// Such transforms do not change the slopes of the triangles they transform.
+static bool isSlopePreservingTransform(const float* transform)
+{
+	const float scale = transform[5];
+	if (scale <= 0.0f)
+	{
+		return false;
+	}
+	const float tolerance = scale * 1e-5f;
+	return rcAbs(transform[1]) <= tolerance && rcAbs(transform[4]) <= tolerance &&
+		rcAbs(transform[6]) <= tolerance && rcAbs(transform[9]) <= tolerance &&
+		rcAbs(transform[0] - transform[10]) <= tolerance && rcAbs(transform[2] + transform[8]) <= tolerance &&
+		rcAbs(transform[0] * transform[0] + transform[2] * transform[2] - scale * scale) <= tolerance * scale;
+}
+
+bool rcRasterizeMeshInstances(rcContext* context,
+                              const rcInstancedMesh* meshes, const int numMeshes,
+                              const rcMeshInstance* instances, const int numInstances,
+                              const float walkableSlopeAngle,
+                              rcHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	// The mesh space bounds of each mesh, and the offsets of their triangles in the cached area ids.
+	int maxVerts = 0;
+	int maxTris = 0;
+	int totalTris = 0;
+	rcTempVector<float> meshBounds;
+	rcTempVector<int> areaOffsets;
+	if (!meshBounds.reserve(numMeshes * 6) || !areaOffsets.reserve(numMeshes))
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeMeshInstances: Out of memory 'meshBounds' (%d).", numMeshes);
+		return false;
+	}
+	meshBounds.resize(numMeshes * 6);
+	areaOffsets.resize(numMeshes);
+	for (int meshIndex = 0; meshIndex < numMeshes; ++meshIndex)
+	{
+		const rcInstancedMesh& mesh = meshes[meshIndex];
+		maxVerts = rcMax(maxVerts, mesh.numVerts);
+		maxTris = rcMax(maxTris, mesh.numTris);
+		areaOffsets[meshIndex] = totalTris;
+		totalTris += mesh.numTris;
+		if (mesh.numVerts > 0)
+		{
+			rcCalcBounds(mesh.verts, mesh.numVerts, &meshBounds[meshIndex * 6], &meshBounds[meshIndex * 6 + 3]);
+		}
+	}
+
+	// The area ids of the triangles classified in mesh space, filled on first use by a slope preserving instance.
+	rcTempVector<unsigned char> meshAreas;
+	rcTempVector<unsigned char> meshAreasReady;
+	rcTempVector<float> worldVerts;
+	rcTempVector<unsigned char> instanceAreas;
+	rcTempVector<int> flippedTris;
+	if (!meshAreas.reserve(totalTris) || !meshAreasReady.reserve(numMeshes) ||
+		!worldVerts.reserve(maxVerts * 3) || !instanceAreas.reserve(maxTris) || !flippedTris.reserve(maxTris * 3))
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeMeshInstances: Out of memory 'meshAreas' (%d).", totalTris);
+		return false;
+	}
+	meshAreas.resize(totalTris);
+	meshAreasReady.resize(numMeshes, 0);
+	worldVerts.resize(maxVerts * 3);
+	instanceAreas.resize(maxTris);
+	flippedTris.resize(maxTris * 3);
+
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+	for (int instanceIndex = 0; instanceIndex < numInstances; ++instanceIndex)
+	{
+		const rcMeshInstance& instance = instances[instanceIndex];
+		rcAssert(instance.mesh >= 0 && instance.mesh < numMeshes);
+		const rcInstancedMesh& mesh = meshes[instance.mesh];
+		if (mesh.numVerts == 0 || mesh.numTris == 0)
+		{
+			continue;
+		}
+
+		// Skip the instance if the transformed corners of its mesh bounds miss the heightfield.
+		const float* localMin = &meshBounds[instance.mesh * 6];
+		const float* localMax = localMin + 3;
+		float worldMin[3];
+		float worldMax[3];
+		transformPoint(instance.transform, localMin, worldMin);
+		rcVcopy(worldMax, worldMin);
+		for (int corner = 1; corner < 8; ++corner)
+		{
+			const float point[3] = {
+				(corner & 1) ? localMax[0] : localMin[0],
+				(corner & 2) ? localMax[1] : localMin[1],
+				(corner & 4) ? localMax[2] : localMin[2]
+			};
+			float transformed[3];
+			transformPoint(instance.transform, point, transformed);
+			rcVmin(worldMin, transformed);
+			rcVmax(worldMax, transformed);
+		}
+		if (!overlapBounds(worldMin, worldMax, heightfield.bmin, heightfield.bmax))
+		{
+			continue;
+		}
+
+		float* verts = worldVerts.data();
+		for (int vertIndex = 0; vertIndex < mesh.numVerts; ++vertIndex)
+		{
+			transformPoint(instance.transform, &mesh.verts[vertIndex * 3], &verts[vertIndex * 3]);
+		}
+
+		const unsigned char* areas;
+		if (isSlopePreservingTransform(instance.transform))
+		{
+			unsigned char* cachedAreas = &meshAreas[areaOffsets[instance.mesh]];
+			if (!meshAreasReady[instance.mesh])
+			{
+				for (int triIndex = 0; triIndex < mesh.numTris; ++triIndex)
+				{
+					cachedAreas[triIndex] = mesh.triAreaIDs ? mesh.triAreaIDs[triIndex] : RC_NULL_AREA;
+				}
+				rcMarkWalkableTriangles(context, walkableSlopeAngle, mesh.verts, mesh.numVerts, mesh.tris, mesh.numTris, cachedAreas);
+				meshAreasReady[instance.mesh] = 1;
+			}
+			areas = cachedAreas;
+		}
+		else
+		{
+			unsigned char* worldAreas = instanceAreas.data();
+			for (int triIndex = 0; triIndex < mesh.numTris; ++triIndex)
+			{
+				worldAreas[triIndex] = mesh.triAreaIDs ? mesh.triAreaIDs[triIndex] : RC_NULL_AREA;
+			}
+
+			// A mirroring transform reverses the winding of the triangles, which would flip their normals.
+			const float* m = instance.transform;
+			const float determinant =
+				m[0] * (m[5] * m[10] - m[6] * m[9]) -
+				m[1] * (m[4] * m[10] - m[6] * m[8]) +
+				m[2] * (m[4] * m[9] - m[5] * m[8]);
+			const int* tris = mesh.tris;
+			if (determinant < 0.0f)
+			{
+				int* flipped = flippedTris.data();
+				for (int triIndex = 0; triIndex < mesh.numTris; ++triIndex)
+				{
+					flipped[triIndex * 3 + 0] = mesh.tris[triIndex * 3 + 0];
+					flipped[triIndex * 3 + 1] = mesh.tris[triIndex * 3 + 2];
+					flipped[triIndex * 3 + 2] = mesh.tris[triIndex * 3 + 1];
+				}
+				tris = flipped;
+			}
+			rcMarkWalkableTriangles(context, walkableSlopeAngle, verts, mesh.numVerts, tris, mesh.numTris, worldAreas);
+			areas = worldAreas;
+		}
+
+		for (int triIndex = 0; triIndex < mesh.numTris; ++triIndex)
+		{
+			const float* v0 = &verts[mesh.tris[triIndex * 3 + 0] * 3];
+			const float* v1 = &verts[mesh.tris[triIndex * 3 + 1] * 3];
+			const float* v2 = &verts[mesh.tris[triIndex * 3 + 2] * 3];
+			if (!rasterizeTri(v0, v1, v2, areas[triIndex], heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold))
+			{
+				context->log(RC_LOG_ERROR, "rcRasterizeMeshInstances: Out of memory.");
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/// Calculates the columns of the heightfield that a bounding box overlaps.
+/// @returns False if the box is outside the heightfield.
+static bool calcColumnRange(const rcHeightfield& heightfield, const float* boundsMin, const float* boundsMax,
+                            int& minX, int& minZ, int& maxX, int& maxZ)
+{
+	if (!overlapBounds(boundsMin, boundsMax, heightfield.bmin, heightfield.bmax))
+	{
+		return false;
+	}
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	minX = rcMax((int)floorf((boundsMin[0] - heightfield.bmin[0]) * inverseCellSize), 0);
+	minZ = rcMax((int)floorf((boundsMin[2] - heightfield.bmin[2]) * inverseCellSize), 0);
+	maxX = rcMin((int)floorf((boundsMax[0] - heightfield.bmin[0]) * inverseCellSize), heightfield.width - 1);
+	maxZ = rcMin((int)floorf((boundsMax[2] - heightfield.bmin[2]) * inverseCellSize), heightfield.height - 1);
+	return minX <= maxX && minZ <= maxZ;
+}
+
+/// Adds a span between two world space heights to a column, clamped and snapped like the spans of triangles.
+/// @returns False if the span could not be allocated.
+static bool addColumnSpan(rcHeightfield& heightfield, const int x, const int z, const float minY, const float maxY,
+                          const unsigned char areaID, const int flagMergeThreshold)
+{
+	const float by = heightfield.bmax[1] - heightfield.bmin[1];
+	float spanMin = minY - heightfield.bmin[1];
+	float spanMax = maxY - heightfield.bmin[1];
+
+	// Skip the span if it's completely outside the heightfield bounding box
+	if (spanMax < 0.0f || spanMin > by)
+	{
+		return true;
+	}
+
+	// Clamp the span to the heightfield bounding box.
+	spanMin = rcMax(spanMin, 0.0f);
+	spanMax = rcMin(spanMax, by);
+
+	// Snap the span to the heightfield height grid.
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+	const unsigned short spanMinCellIndex = (unsigned short)rcClamp((int)floorf(spanMin * inverseCellHeight), 0, RC_SPAN_MAX_HEIGHT);
+	const unsigned short spanMaxCellIndex = (unsigned short)rcClamp((int)ceilf(spanMax * inverseCellHeight), (int)spanMinCellIndex + 1, RC_SPAN_MAX_HEIGHT);
+
+	return addSpan(heightfield, x, z, spanMinCellIndex, spanMaxCellIndex, areaID, flagMergeThreshold);
+}
+
+bool rcRasterizeBox(rcContext* context, const float* boxMinBounds, const float* boxMaxBounds,
+                    const unsigned char areaID, rcHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	int minX, minZ, maxX, maxZ;
+	if (!calcColumnRange(heightfield, boxMinBounds, boxMaxBounds, minX, minZ, maxX, maxZ))
+	{
+		return true;
+	}
+
+	for (int z = minZ; z <= maxZ; ++z)
+	{
+		for (int x = minX; x <= maxX; ++x)
+		{
+			if (!addColumnSpan(heightfield, x, z, boxMinBounds[1], boxMaxBounds[1], areaID, flagMergeThreshold))
+			{
+				context->log(RC_LOG_ERROR, "rcRasterizeBox: Out of memory.");
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool rcRasterizeCylinder(rcContext* context, const float* position, const float radius, const float height,
+                         const unsigned char areaID, rcHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	const float cylinderMin[3] = { position[0] - radius, position[1], position[2] - radius };
+	const float cylinderMax[3] = { position[0] + radius, position[1] + height, position[2] + radius };
+	int minX, minZ, maxX, maxZ;
+	if (!calcColumnRange(heightfield, cylinderMin, cylinderMax, minX, minZ, maxX, maxZ))
+	{
+		return true;
+	}
+
+	const float cellSize = heightfield.cs;
+	const float radiusSq = radius * radius;
+	for (int z = minZ; z <= maxZ; ++z)
+	{
+		// The distance along z from the axis to the closest point of the row.
+		const float rowMinZ = heightfield.bmin[2] + (float)z * cellSize;
+		const float deltaZ = rcMax(rcMax(rowMinZ - position[2], position[2] - (rowMinZ + cellSize)), 0.0f);
+		for (int x = minX; x <= maxX; ++x)
+		{
+			// Skip the column if its closest point is outside the circle.
+			const float columnMinX = heightfield.bmin[0] + (float)x * cellSize;
+			const float deltaX = rcMax(rcMax(columnMinX - position[0], position[0] - (columnMinX + cellSize)), 0.0f);
+			if (deltaX * deltaX + deltaZ * deltaZ >= radiusSq)
+			{
+				continue;
+			}
+			if (!addColumnSpan(heightfield, x, z, cylinderMin[1], cylinderMax[1], areaID, flagMergeThreshold))
+			{
+				context->log(RC_LOG_ERROR, "rcRasterizeCylinder: Out of memory.");
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/// An edge of a convex hull, with the z-range it spans.
+struct rcHullEdge
+{
+	int vert[2];
+	float minZ;
+	float maxZ;
+};
+
+/// A face of a convex hull, with the plane it lies in and the z-range it spans.
+struct rcHullFace
+{
+	float plane[4];	///< Oriented so that the hull is on its negative side. (nx, ny, nz, d)
+	float minZ;
+	float maxZ;
+};
+
+static int compareHullEdgeVerts(const void* va, const void* vb)
+{
+	const rcHullEdge* a = (const rcHullEdge*)va;
+	const rcHullEdge* b = (const rcHullEdge*)vb;
+	if (a->vert[0] != b->vert[0])
+	{
+		return a->vert[0] < b->vert[0] ? -1 : 1;
+	}
+	if (a->vert[1] != b->vert[1])
+	{
+		return a->vert[1] < b->vert[1] ? -1 : 1;
+	}
+	return 0;
+}
+
+static int compareHullEdgeMinZ(const void* va, const void* vb)
+{
+	const rcHullEdge* a = (const rcHullEdge*)va;
+	const rcHullEdge* b = (const rcHullEdge*)vb;
+	return a->minZ < b->minZ ? -1 : (a->minZ > b->minZ ? 1 : 0);
+}
+
+static int compareHullFaceMinZ(const void* va, const void* vb)
+{
+	const rcHullFace* a = (const rcHullFace*)va;
+	const rcHullFace* b = (const rcHullFace*)vb;
+	return a->minZ < b->minZ ? -1 : (a->minZ > b->minZ ? 1 : 0);
+}
+
+static int compareHullVertZ(const void* va, const void* vb)
+{
+	const float* a = (const float*)va;
+	const float* b = (const float*)vb;
+	return a[2] < b[2] ? -1 : (a[2] > b[2] ? 1 : 0);
+}
+
+/// Extends the height range of the columns of a row whose sides contain @p x, so that a point on the side shared by
+/// two columns counts for both.
+static void addRowHeight(float* columnMinY, float* columnMaxY, const float* lineX, const int numColumns,
+                         const int column, const float x, const float y)
+{
+	for (int c = rcMax(column - 1, 0); c <= rcMin(column + 1, numColumns - 1); ++c)
+	{
+		if (x >= lineX[c] && x <= lineX[c + 1])
+		{
+			columnMinY[c] = rcMin(columnMinY[c], y);
+			columnMaxY[c] = rcMax(columnMaxY[c], y);
+		}
+	}
+}
+
+/// @par
+///
+/// The intersection of the hull with the prism of a column is a convex polytope. Its vertices, and so its lowest and
+/// highest points, are hull vertices inside the prism, crossings of hull edges with the sides of the prism, or the ends
+/// of the intervals the hull covers along the vertical edges of the prism.
+///
+/// The unique edges, the faces and the vertices of the hull are sorted by z and swept row by row, so that each row
+/// only visits the ones its z-range overlaps. The crossings with the sides between the columns of a row, and the
+/// intervals along the vertical edges they share, are found once for both columns.
+bool rcRasterizeConvexHull(rcContext* context, const float* verts, const int numVerts,
+                           const int* tris, const int numTris,
+                           const unsigned char areaID, rcHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	if (numVerts == 0 || numTris == 0)
+	{
+		return true;
+	}
+
+	float hullMin[3];
+	float hullMax[3];
+	rcCalcBounds(verts, numVerts, hullMin, hullMax);
+	int minX, minZ, maxX, maxZ;
+	if (!calcColumnRange(heightfield, hullMin, hullMax, minX, minZ, maxX, maxZ))
+	{
+		return true;
+	}
+	const int numColumns = maxX - minX + 1;
+
+	rcTempVector<rcHullEdge> edges;
+	rcTempVector<rcHullFace> faces;
+	rcTempVector<float> sortedVerts;
+	rcTempVector<int> activeEdges;
+	rcTempVector<int> activeFaces;
+	rcTempVector<float> lineX;
+	rcTempVector<float> columnMinY;
+	rcTempVector<float> columnMaxY;
+	if (!edges.reserve(numTris * 3) || !faces.reserve(numTris) || !sortedVerts.reserve(numVerts * 3) ||
+		!activeEdges.reserve(numTris * 3) || !activeFaces.reserve(numTris) || !lineX.reserve(numColumns + 1) ||
+		!columnMinY.reserve(numColumns) || !columnMaxY.reserve(numColumns))
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeConvexHull: Out of memory (%d).", numTris);
+		return false;
+	}
+
+	// Every edge is shared by two faces of the closed hull, so only keep one copy of each.
+	for (int triIndex = 0; triIndex < numTris; ++triIndex)
+	{
+		for (int edge = 0; edge < 3; ++edge)
+		{
+			const int a = tris[triIndex * 3 + edge];
+			const int b = tris[triIndex * 3 + (edge + 1) % 3];
+			rcHullEdge hullEdge;
+			hullEdge.vert[0] = rcMin(a, b);
+			hullEdge.vert[1] = rcMax(a, b);
+			hullEdge.minZ = rcMin(verts[a * 3 + 2], verts[b * 3 + 2]);
+			hullEdge.maxZ = rcMax(verts[a * 3 + 2], verts[b * 3 + 2]);
+			edges.push_back(hullEdge);
+		}
+	}
+	qsort(&edges[0], (size_t)edges.size(), sizeof(rcHullEdge), compareHullEdgeVerts);
+	int numEdges = 0;
+	for (int i = 0; i < (int)edges.size(); ++i)
+	{
+		if (numEdges == 0 || compareHullEdgeVerts(&edges[numEdges - 1], &edges[i]) != 0)
+		{
+			edges[numEdges++] = edges[i];
+		}
+	}
+	edges.resize(numEdges);
+	qsort(&edges[0], (size_t)edges.size(), sizeof(rcHullEdge), compareHullEdgeMinZ);
+
+	float center[3] = { 0.0f, 0.0f, 0.0f };
+	for (int vertIndex = 0; vertIndex < numVerts; ++vertIndex)
+	{
+		rcVadd(center, center, &verts[vertIndex * 3]);
+	}
+	center[0] /= (float)numVerts;
+	center[1] /= (float)numVerts;
+	center[2] /= (float)numVerts;
+	for (int triIndex = 0; triIndex < numTris; ++triIndex)
+	{
+		const float* v0 = &verts[tris[triIndex * 3 + 0] * 3];
+		const float* v1 = &verts[tris[triIndex * 3 + 1] * 3];
+		const float* v2 = &verts[tris[triIndex * 3 + 2] * 3];
+		rcHullFace face;
+		float e0[3], e1[3];
+		rcVsub(e0, v1, v0);
+		rcVsub(e1, v2, v0);
+		rcVcross(face.plane, e0, e1);
+		face.plane[3] = rcVdot(face.plane, v0);
+		if (rcVdot(face.plane, center) > face.plane[3])
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				face.plane[i] = -face.plane[i];
+			}
+		}
+		face.minZ = rcMin(rcMin(v0[2], v1[2]), v2[2]);
+		face.maxZ = rcMax(rcMax(v0[2], v1[2]), v2[2]);
+		faces.push_back(face);
+	}
+	qsort(&faces[0], (size_t)faces.size(), sizeof(rcHullFace), compareHullFaceMinZ);
+
+	sortedVerts.assign(verts, verts + numVerts * 3);
+	qsort(&sortedVerts[0], (size_t)numVerts, sizeof(float) * 3, compareHullVertZ);
+
+	const float cellSize = heightfield.cs;
+	const float inverseCellSize = 1.0f / cellSize;
+	for (int column = 0; column <= numColumns; ++column)
+	{
+		lineX.push_back(heightfield.bmin[0] + (float)(minX + column) * cellSize);
+	}
+	columnMinY.resize(numColumns);
+	columnMaxY.resize(numColumns);
+
+	int nextEdge = 0;
+	int nextFace = 0;
+	int firstVert = 0;
+	for (int z = minZ; z <= maxZ; ++z)
+	{
+		const float rowMinZ = heightfield.bmin[2] + (float)z * cellSize;
+		const float rowMaxZ = rowMinZ + cellSize;
+		for (int column = 0; column < numColumns; ++column)
+		{
+			columnMinY[column] = FLT_MAX;
+			columnMaxY[column] = -FLT_MAX;
+		}
+
+		// Drop the edges and faces that end before the row, and add the ones that start in it.
+		int numActive = 0;
+		for (int i = 0; i < (int)activeEdges.size(); ++i)
+		{
+			if (edges[activeEdges[i]].maxZ >= rowMinZ)
+			{
+				activeEdges[numActive++] = activeEdges[i];
+			}
+		}
+		activeEdges.resize(numActive);
+		for (; nextEdge < numEdges && edges[nextEdge].minZ <= rowMaxZ; ++nextEdge)
+		{
+			if (edges[nextEdge].maxZ >= rowMinZ)
+			{
+				activeEdges.push_back(nextEdge);
+			}
+		}
+		numActive = 0;
+		for (int i = 0; i < (int)activeFaces.size(); ++i)
+		{
+			if (faces[activeFaces[i]].maxZ >= rowMinZ)
+			{
+				activeFaces[numActive++] = activeFaces[i];
+			}
+		}
+		activeFaces.resize(numActive);
+		for (; nextFace < numTris && faces[nextFace].minZ <= rowMaxZ; ++nextFace)
+		{
+			if (faces[nextFace].maxZ >= rowMinZ)
+			{
+				activeFaces.push_back(nextFace);
+			}
+		}
+
+		// Hull vertices inside the row.
+		while (firstVert < numVerts && sortedVerts[firstVert * 3 + 2] < rowMinZ)
+		{
+			firstVert++;
+		}
+		for (int vertIndex = firstVert; vertIndex < numVerts && sortedVerts[vertIndex * 3 + 2] <= rowMaxZ; ++vertIndex)
+		{
+			const float* v = &sortedVerts[vertIndex * 3];
+			const int column = (int)floorf((v[0] - heightfield.bmin[0]) * inverseCellSize) - minX;
+			addRowHeight(&columnMinY[0], &columnMaxY[0], &lineX[0], numColumns, column, v[0], v[1]);
+		}
+
+		// Crossings of the edges with the sides of the row, and with the sides between its columns.
+		for (int i = 0; i < (int)activeEdges.size(); ++i)
+		{
+			const rcHullEdge& edge = edges[activeEdges[i]];
+			const float* a = &verts[edge.vert[0] * 3];
+			const float* b = &verts[edge.vert[1] * 3];
+			const float sides[2] = { rowMinZ, rowMaxZ };
+			for (int side = 0; side < 2; ++side)
+			{
+				if ((a[2] - sides[side]) * (b[2] - sides[side]) >= 0.0f)
+				{
+					continue;
+				}
+				const float t = (sides[side] - a[2]) / (b[2] - a[2]);
+				const float x = a[0] + t * (b[0] - a[0]);
+				const int column = (int)floorf((x - heightfield.bmin[0]) * inverseCellSize) - minX;
+				addRowHeight(&columnMinY[0], &columnMaxY[0], &lineX[0], numColumns, column, x, a[1] + t * (b[1] - a[1]));
+			}
+
+			const int firstLine = rcMax((int)floorf((rcMin(a[0], b[0]) - heightfield.bmin[0]) * inverseCellSize) - minX, 0);
+			const int lastLine = rcMin((int)ceilf((rcMax(a[0], b[0]) - heightfield.bmin[0]) * inverseCellSize) - minX, numColumns);
+			for (int line = firstLine; line <= lastLine; ++line)
+			{
+				if ((a[0] - lineX[line]) * (b[0] - lineX[line]) >= 0.0f)
+				{
+					continue;
+				}
+				const float t = (lineX[line] - a[0]) / (b[0] - a[0]);
+				const float crossingZ = a[2] + t * (b[2] - a[2]);
+				if (crossingZ < rowMinZ || crossingZ > rowMaxZ)
+				{
+					continue;
+				}
+				const float y = a[1] + t * (b[1] - a[1]);
+				for (int column = rcMax(line - 1, 0); column <= rcMin(line, numColumns - 1); ++column)
+				{
+					columnMinY[column] = rcMin(columnMinY[column], y);
+					columnMaxY[column] = rcMax(columnMaxY[column], y);
+				}
+			}
+		}
+
+		// The intervals along the vertical edges of the columns. A point of the row outside the hull lies outside a
+		// face that overlaps the row, so the faces outside the row can be skipped.
+		for (int line = 0; line <= numColumns; ++line)
+		{
+			for (int side = 0; side < 2; ++side)
+			{
+				if (activeFaces.size() == 0)
+				{
+					continue;
+				}
+				const float cornerX = lineX[line];
+				const float cornerZ = side ? rowMaxZ : rowMinZ;
+				float lower = -FLT_MAX;
+				float upper = FLT_MAX;
+				for (int i = 0; i < (int)activeFaces.size() && lower <= upper; ++i)
+				{
+					const float* plane = faces[activeFaces[i]].plane;
+					const float rest = plane[3] - plane[0] * cornerX - plane[2] * cornerZ;
+					if (plane[1] > 0.0f)
+					{
+						upper = rcMin(upper, rest / plane[1]);
+					}
+					else if (plane[1] < 0.0f)
+					{
+						lower = rcMax(lower, rest / plane[1]);
+					}
+					else if (rest < 0.0f)
+					{
+						upper = -FLT_MAX;
+					}
+				}
+				if (lower > upper)
+				{
+					continue;
+				}
+				for (int column = rcMax(line - 1, 0); column <= rcMin(line, numColumns - 1); ++column)
+				{
+					columnMinY[column] = rcMin(columnMinY[column], lower);
+					columnMaxY[column] = rcMax(columnMaxY[column], upper);
+				}
+			}
+		}
+
+		for (int column = 0; column < numColumns; ++column)
+		{
+			if (columnMinY[column] > columnMaxY[column])
+			{
+				continue;
+			}
+			if (!addColumnSpan(heightfield, minX + column, z, columnMinY[column], columnMaxY[column], areaID, flagMergeThreshold))
+			{
+				context->log(RC_LOG_ERROR, "rcRasterizeConvexHull: Out of memory.");
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
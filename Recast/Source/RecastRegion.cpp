@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <algorithm>
+#include <functional>
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
@@ -38,17 +39,13 @@ struct LevelStackEntry
 };
 }  // namespace
 
-static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* src, unsigned short& maxDist)
+// Marks the spans of rows [miny, maxy) that border another area or unwalkable space with distance zero,
+// and all other spans as not yet reached.
+static void markDistanceBoundaries(const rcCompactHeightfield& chf, unsigned short* src, const int miny, const int maxy)
 {
 	const int w = chf.width;
-	const int h = chf.height;
-
-	// Init distance and points.
-	for (int i = 0; i < chf.spanCount; ++i)
-		src[i] = 0xffff;
 
-	// Mark boundary cells.
-	for (int y = 0; y < h; ++y)
+	for (int y = miny; y < maxy; ++y)
 	{
 		for (int x = 0; x < w; ++x)
 		{
@@ -70,15 +67,19 @@ static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* sr
 							nc++;
 					}
 				}
-				if (nc != 4)
-					src[i] = 0;
+				src[i] = nc != 4 ? 0 : 0xffff;
 			}
 		}
 	}
+}
 
+// First pass of the distance transform over rows [miny, maxy), propagating from the rows below.
+// The rows must be swept in ascending order.
+static void sweepDistanceForward(const rcCompactHeightfield& chf, unsigned short* src, const int miny, const int maxy)
+{
+	const int w = chf.width;
 
-	// Pass 1
-	for (int y = 0; y < h; ++y)
+	for (int y = miny; y < maxy; ++y)
 	{
 		for (int x = 0; x < w; ++x)
 		{
@@ -130,9 +131,17 @@ static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* sr
 			}
 		}
 	}
+}
+
+// Second pass of the distance transform over rows [miny, maxy), propagating from the rows above.
+// The row ranges must be swept in descending order. The distances of the rows are final afterwards.
+// @return The maximum distance within the rows.
+static unsigned short sweepDistanceBackward(const rcCompactHeightfield& chf, unsigned short* src, const int miny, const int maxy)
+{
+	const int w = chf.width;
+	unsigned short maxDist = 0;
 
-	// Pass 2
-	for (int y = h-1; y >= 0; --y)
+	for (int y = maxy-1; y >= miny; --y)
 	{
 		for (int x = w-1; x >= 0; --x)
 		{
@@ -181,25 +190,23 @@ static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* sr
 							src[i] = src[aai]+3;
 					}
 				}
+				maxDist = rcMax(src[i], maxDist);
 			}
 		}
 	}
 
-	maxDist = 0;
-	for (int i = 0; i < chf.spanCount; ++i)
-		maxDist = rcMax(src[i], maxDist);
-
+	return maxDist;
 }
 
-static unsigned short* boxBlur(rcCompactHeightfield& chf, int thr,
-							   unsigned short* src, unsigned short* dst)
+// Blurs the distances of rows [miny, maxy) from src into dst.
+static void boxBlur(const rcCompactHeightfield& chf, int thr,
+					const unsigned short* src, unsigned short* dst, const int miny, const int maxy)
 {
 	const int w = chf.width;
-	const int h = chf.height;
 
 	thr *= 2;
 
-	for (int y = 0; y < h; ++y)
+	for (int y = miny; y < maxy; ++y)
 	{
 		for (int x = 0; x < w; ++x)
 		{
@@ -247,7 +254,6 @@ static unsigned short* boxBlur(rcCompactHeightfield& chf, int thr,
 			}
 		}
 	}
-	return dst;
 }
 
 
@@ -360,7 +366,79 @@ struct DirtyEntry
 	unsigned short region;
 	unsigned short distance2;
 };
-static void expandRegions(int maxIter, unsigned short level,
+
+// Expansion iterations with fewer cells than this are processed on the calling thread.
+static const int RC_EXPAND_PARALLEL_MIN_CELLS = 2048;
+
+struct rcExpandJob
+{
+	const rcCompactHeightfield* chf;
+	const unsigned short* srcReg;
+	const unsigned short* srcDist;
+	LevelStackEntry* stack;
+	rcTempVector<DirtyEntry>* dirtyEntries;	// Per thread.
+	int* failed;							// Per thread.
+};
+
+// Finds the region of each cell in the range of the stack from the regions of the previous iteration.
+// Each cell only reads the regions and writes its own stack entry, so the ranges can be processed in any order.
+static void expandRegionRange(void* userData, const int begin, const int end, const int threadIndex)
+{
+	rcExpandJob& job = *(rcExpandJob*)userData;
+	const rcCompactHeightfield& chf = *job.chf;
+	const unsigned short* srcReg = job.srcReg;
+	const unsigned short* srcDist = job.srcDist;
+	rcTempVector<DirtyEntry>& dirtyEntries = job.dirtyEntries[threadIndex];
+	const int w = chf.width;
+	int failed = 0;
+
+	for (int j = begin; j < end; j++)
+	{
+		LevelStackEntry& entry = job.stack[j];
+		const int x = entry.x;
+		const int y = entry.y;
+		const int i = entry.index;
+		if (i < 0)
+		{
+			failed++;
+			continue;
+		}
+
+		unsigned short r = srcReg[i];
+		unsigned short d2 = 0xffff;
+		const unsigned char area = chf.areas[i];
+		const rcCompactSpan& s = chf.spans[i];
+		for (int dir = 0; dir < 4; ++dir)
+		{
+			if (rcGetCon(s, dir) == RC_NOT_CONNECTED) continue;
+			const int ax = x + rcGetDirOffsetX(dir);
+			const int ay = y + rcGetDirOffsetY(dir);
+			const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
+			if (chf.areas[ai] != area) continue;
+			if (srcReg[ai] > 0 && (srcReg[ai] & RC_BORDER_REG) == 0)
+			{
+				if ((int)srcDist[ai]+2 < (int)d2)
+				{
+					r = srcReg[ai];
+					d2 = srcDist[ai]+2;
+				}
+			}
+		}
+		if (r)
+		{
+			entry.index = -1; // mark as used
+			dirtyEntries.push_back(DirtyEntry(i, r, d2));
+		}
+		else
+		{
+			failed++;
+		}
+	}
+
+	job.failed[threadIndex] += failed;
+}
+
+static void expandRegions(rcContext* ctx, int maxIter, unsigned short level,
 					      rcCompactHeightfield& chf,
 					      unsigned short* srcReg, unsigned short* srcDist,
 					      rcTempVector<LevelStackEntry>& stack,
@@ -399,75 +477,362 @@ static void expandRegions(int maxIter, unsigned short level,
 		}
 	}
 
-	rcTempVector<DirtyEntry> dirtyEntries;
+	if (stack.empty())
+		return;
+
+	// Every iteration only reads the regions of the previous one, so the cells of the stack are independent and
+	// can be processed in parallel. The dirty entries of the threads touch distinct spans.
+	const int nthreads = stack.size() >= RC_EXPAND_PARALLEL_MIN_CELLS ? ctx->getMaxThreads() : 1;
+	rcTempVector<rcTempVector<DirtyEntry> > dirtyEntries;
+	dirtyEntries.resize(nthreads);
+	rcTempVector<int> failed;
+	failed.resize(nthreads);
+
+	rcExpandJob job;
+	job.chf = &chf;
+	job.srcReg = srcReg;
+	job.srcDist = srcDist;
+	job.stack = stack.data();
+	job.dirtyEntries = dirtyEntries.data();
+	job.failed = failed.data();
+
 	int iter = 0;
 	while (stack.size() > 0)
 	{
-		int failed = 0;
-		dirtyEntries.clear();
+		for (int t = 0; t < nthreads; ++t)
+		{
+			dirtyEntries[t].clear();
+			failed[t] = 0;
+		}
+
+		if (nthreads > 1)
+			ctx->parallelFor((int)stack.size(), expandRegionRange, &job);
+		else
+			expandRegionRange(&job, 0, (int)stack.size(), 0);
 
-		for (int j = 0; j < stack.size(); j++)
+		// Copy entries that differ between src and dst to keep them in sync.
+		int nfailed = 0;
+		for (int t = 0; t < nthreads; ++t)
 		{
-			int x = stack[j].x;
-			int y = stack[j].y;
-			int i = stack[j].index;
-			if (i < 0)
+			const DirtyEntry* entries = dirtyEntries[t].data();
+			for (int i = 0; i < dirtyEntries[t].size(); i++)
 			{
-				failed++;
+				int idx = entries[i].index;
+				srcReg[idx] = entries[i].region;
+				srcDist[idx] = entries[i].distance2;
+			}
+			nfailed += failed[t];
+		}
+
+		if (nfailed == stack.size())
+			break;
+
+		if (level > 0)
+		{
+			++iter;
+			if (iter >= maxIter)
+				break;
+		}
+	}
+}
+
+
+
+// The size of the tiles rcBuildRegionsParallel floods new regions in. The tiles do not depend on the number of
+// threads, so neither do the regions. [Units: vx]
+static const int RC_FLOOD_TILE_SIZE = 64;
+
+// The seeds and flooded spans of a tile of the parallel watershed.
+struct rcFloodTile
+{
+	rcFloodTile() : nregs(0), firstReg(0) {}
+	rcTempVector<LevelStackEntry> seeds;	// The seeds of the current level, in stack order.
+	rcTempVector<LevelStackEntry> spans;	// The spans flooded at the current level.
+	int nregs;								// The number of regions flooded at the current level.
+	int firstReg;							// The first provisional region of the tile.
+};
+
+// The state of the parallel watershed that is kept between levels.
+struct rcFloodTiles
+{
+	rcTempVector<rcFloodTile> tiles;
+	rcTempVector<rcTempVector<LevelStackEntry> > stacks;	// Per thread.
+	rcTempVector<int> floodReg;			// Per span, the tile local region flooded at the current level, or 0.
+	rcTempVector<int> parents;			// Per provisional region, the region it was joined with.
+	rcTempVector<unsigned short> regs;	// Per provisional region, its final region id.
+	int tilesX;
+};
+
+struct rcFloodJob
+{
+	const rcCompactHeightfield* chf;
+	const unsigned short* srcReg;
+	unsigned short* srcDist;
+	rcFloodTiles* flood;
+	unsigned short level;
+};
+
+// Floods a region like floodRegion, but only within the bounds of the tile. The region is stored in floodReg, the
+// regions of the previous levels in srcReg are only read. Regions flooded in other tiles are not visible yet;
+// the regions that meet at the tile borders are joined afterwards.
+static bool floodTileRegion(const LevelStackEntry& seed, const int r,
+							const int minx, const int miny, const int maxx, const int maxy,
+							const rcFloodJob& job, rcFloodTile& tile, rcTempVector<LevelStackEntry>& stack)
+{
+	const rcCompactHeightfield& chf = *job.chf;
+	const unsigned short* srcReg = job.srcReg;
+	unsigned short* srcDist = job.srcDist;
+	int* floodReg = job.flood->floodReg.data();
+	const int w = chf.width;
+
+	const unsigned char area = chf.areas[seed.index];
+
+	// Flood fill mark region.
+	stack.clear();
+	stack.push_back(seed);
+	floodReg[seed.index] = r;
+	srcDist[seed.index] = 0;
+
+	const unsigned short lev = job.level >= 2 ? job.level-2 : 0;
+	int count = 0;
+
+	while (!stack.empty())
+	{
+		const LevelStackEntry current = stack.back();
+		stack.pop_back();
+
+		const rcCompactSpan& cs = chf.spans[current.index];
+
+		// Check if any of the neighbours already have a valid region set.
+		bool taken = false;
+		for (int dir = 0; dir < 4 && !taken; ++dir)
+		{
+			// 8 connected
+			if (rcGetCon(cs, dir) == RC_NOT_CONNECTED)
+				continue;
+			const int ax = current.x + rcGetDirOffsetX(dir);
+			const int ay = current.y + rcGetDirOffsetY(dir);
+			const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(cs, dir);
+			if (chf.areas[ai] != area)
 				continue;
+			if (srcReg[ai] & RC_BORDER_REG) // Do not take borders into account.
+				continue;
+			const bool inTile = ax >= minx && ax < maxx && ay >= miny && ay < maxy;
+			if (srcReg[ai] != 0 || (inTile && floodReg[ai] != 0 && floodReg[ai] != r))
+			{
+				taken = true;
+				break;
 			}
 
-			unsigned short r = srcReg[i];
-			unsigned short d2 = 0xffff;
-			const unsigned char area = chf.areas[i];
-			const rcCompactSpan& s = chf.spans[i];
-			for (int dir = 0; dir < 4; ++dir)
+			const rcCompactSpan& as = chf.spans[ai];
+
+			const int dir2 = (dir+1) & 0x3;
+			if (rcGetCon(as, dir2) != RC_NOT_CONNECTED)
 			{
-				if (rcGetCon(s, dir) == RC_NOT_CONNECTED) continue;
-				const int ax = x + rcGetDirOffsetX(dir);
-				const int ay = y + rcGetDirOffsetY(dir);
-				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
-				if (chf.areas[ai] != area) continue;
-				if (srcReg[ai] > 0 && (srcReg[ai] & RC_BORDER_REG) == 0)
-				{
-					if ((int)srcDist[ai]+2 < (int)d2)
-					{
-						r = srcReg[ai];
-						d2 = srcDist[ai]+2;
-					}
-				}
+				const int ax2 = ax + rcGetDirOffsetX(dir2);
+				const int ay2 = ay + rcGetDirOffsetY(dir2);
+				const int ai2 = (int)chf.cells[ax2+ay2*w].index + rcGetCon(as, dir2);
+				if (chf.areas[ai2] != area)
+					continue;
+				const bool inTile2 = ax2 >= minx && ax2 < maxx && ay2 >= miny && ay2 < maxy;
+				if (srcReg[ai2] != 0 || (inTile2 && floodReg[ai2] != 0 && floodReg[ai2] != r))
+					taken = true;
 			}
-			if (r)
+		}
+		if (taken)
+		{
+			floodReg[current.index] = 0;
+			continue;
+		}
+
+		count++;
+		tile.spans.push_back(current);
+
+		// Expand neighbours.
+		for (int dir = 0; dir < 4; ++dir)
+		{
+			if (rcGetCon(cs, dir) == RC_NOT_CONNECTED)
+				continue;
+			const int ax = current.x + rcGetDirOffsetX(dir);
+			const int ay = current.y + rcGetDirOffsetY(dir);
+			if (ax < minx || ax >= maxx || ay < miny || ay >= maxy)
+				continue;
+			const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(cs, dir);
+			if (chf.areas[ai] != area)
+				continue;
+			if (chf.dist[ai] >= lev && srcReg[ai] == 0 && floodReg[ai] == 0)
 			{
-				stack[j].index = -1; // mark as used
-				dirtyEntries.push_back(DirtyEntry(i, r, d2));
+				floodReg[ai] = r;
+				srcDist[ai] = 0;
+				stack.push_back(LevelStackEntry(ax, ay, ai));
 			}
-			else
+		}
+	}
+
+	return count > 0;
+}
+
+static void floodTiles(void* userData, const int begin, const int end, const int threadIndex)
+{
+	const rcFloodJob& job = *(const rcFloodJob*)userData;
+	rcFloodTiles& flood = *job.flood;
+	const int* floodReg = flood.floodReg.data();
+	rcTempVector<LevelStackEntry>& stack = flood.stacks[threadIndex];
+
+	for (int t = begin; t < end; ++t)
+	{
+		rcFloodTile& tile = flood.tiles[t];
+		const int minx = (t % flood.tilesX) * RC_FLOOD_TILE_SIZE;
+		const int miny = (t / flood.tilesX) * RC_FLOOD_TILE_SIZE;
+		const int maxx = rcMin(minx + RC_FLOOD_TILE_SIZE, job.chf->width);
+		const int maxy = rcMin(miny + RC_FLOOD_TILE_SIZE, job.chf->height);
+
+		const LevelStackEntry* seeds = tile.seeds.data();
+		for (int j = 0; j < tile.seeds.size(); ++j)
+		{
+			const int i = seeds[j].index;
+			if (job.srcReg[i] == 0 && floodReg[i] == 0)
 			{
-				failed++;
+				if (floodTileRegion(seeds[j], tile.nregs+1, minx, miny, maxx, maxy, job, tile, stack))
+					tile.nregs++;
 			}
 		}
+	}
+}
 
-		// Copy entries that differ between src and dst to keep them in sync.
-		for (int i = 0; i < dirtyEntries.size(); i++) {
-			int idx = dirtyEntries[i].index;
-			srcReg[idx] = dirtyEntries[i].region;
-			srcDist[idx] = dirtyEntries[i].distance2;
+static int findFloodRoot(int* parents, int r)
+{
+	while (parents[r] != r)
+	{
+		parents[r] = parents[parents[r]];
+		r = parents[r];
+	}
+	return r;
+}
+
+// Floods the new regions of a level from the seeds in the stack, tile by tile in parallel. The regions of the
+// tiles that are connected across tile borders are joined, and the joined regions are given consecutive ids
+// in tile order.
+static bool floodRegionTiles(rcContext* ctx, unsigned short level, const rcCompactHeightfield& chf,
+							 const rcTempVector<LevelStackEntry>& stack,
+							 unsigned short* srcReg, unsigned short* srcDist,
+							 rcFloodTiles& flood, unsigned short& regionId)
+{
+	const int w = chf.width;
+	rcFloodTile* tiles = flood.tiles.data();
+	const int ntiles = (int)flood.tiles.size();
+
+	// Bucket the seeds by tile, keeping the stack order.
+	for (int t = 0; t < ntiles; ++t)
+	{
+		tiles[t].seeds.clear();
+		tiles[t].spans.clear();
+		tiles[t].nregs = 0;
+	}
+	bool hasSeeds = false;
+	for (int j = 0; j < stack.size(); ++j)
+	{
+		const LevelStackEntry& current = stack[j];
+		if (current.index >= 0 && srcReg[current.index] == 0)
+		{
+			const int t = (current.y / RC_FLOOD_TILE_SIZE) * flood.tilesX + current.x / RC_FLOOD_TILE_SIZE;
+			tiles[t].seeds.push_back(current);
+			hasSeeds = true;
 		}
+	}
+	if (!hasSeeds)
+		return true;
+
+	rcFloodJob job;
+	job.chf = &chf;
+	job.srcReg = srcReg;
+	job.srcDist = srcDist;
+	job.flood = &flood;
+	job.level = level;
+	ctx->parallelFor(ntiles, floodTiles, &job);
+
+	int nregs = 0;
+	for (int t = 0; t < ntiles; ++t)
+	{
+		tiles[t].firstReg = nregs;
+		nregs += tiles[t].nregs;
+	}
+	if (nregs == 0)
+		return true;
 
-		if (failed == stack.size())
-			break;
+	if (!flood.parents.reserve(nregs) || !flood.regs.reserve(nregs))
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegionsParallel: Out of memory 'parents' (%d).", nregs);
+		return false;
+	}
+	flood.parents.resize(nregs);
+	flood.regs.resize(nregs);
+	int* parents = flood.parents.data();
+	unsigned short* regs = flood.regs.data();
+	int* floodReg = flood.floodReg.data();
+	for (int r = 0; r < nregs; ++r)
+		parents[r] = r;
+
+	// Join the regions that touch across the borders of their tiles. Each border is visited from the tile before it.
+	for (int t = 0; t < ntiles; ++t)
+	{
+		const LevelStackEntry* spans = tiles[t].spans.data();
+		for (int j = 0; j < tiles[t].spans.size(); ++j)
+		{
+			const LevelStackEntry& current = spans[j];
+			const rcCompactSpan& s = chf.spans[current.index];
+			for (int dir = 1; dir <= 2; ++dir)
+			{
+				if (rcGetCon(s, dir) == RC_NOT_CONNECTED)
+					continue;
+				const int ax = current.x + rcGetDirOffsetX(dir);
+				const int ay = current.y + rcGetDirOffsetY(dir);
+				if ((dir == 1 ? ay : ax) % RC_FLOOD_TILE_SIZE != 0)
+					continue;
+				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
+				if (floodReg[ai] == 0 || chf.areas[ai] != chf.areas[current.index])
+					continue;
+				const int nt = (ay / RC_FLOOD_TILE_SIZE) * flood.tilesX + ax / RC_FLOOD_TILE_SIZE;
+				const int ra = findFloodRoot(parents, tiles[t].firstReg + floodReg[current.index] - 1);
+				const int rb = findFloodRoot(parents, tiles[nt].firstReg + floodReg[ai] - 1);
+				if (ra < rb)
+					parents[rb] = ra;
+				else if (rb < ra)
+					parents[ra] = rb;
+			}
+		}
+	}
 
-		if (level > 0)
+	// Number the joined regions in the order of their first tile.
+	for (int r = 0; r < nregs; ++r)
+	{
+		const int root = findFloodRoot(parents, r);
+		if (root != r)
 		{
-			++iter;
-			if (iter >= maxIter)
-				break;
+			regs[r] = regs[root];
+			continue;
+		}
+		if (regionId == 0xFFFF)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildRegionsParallel: Region ID overflow");
+			return false;
 		}
+		regs[r] = regionId++;
 	}
-}
 
+	for (int t = 0; t < ntiles; ++t)
+	{
+		const LevelStackEntry* spans = tiles[t].spans.data();
+		for (int j = 0; j < tiles[t].spans.size(); ++j)
+		{
+			const int i = spans[j].index;
+			srcReg[i] = regs[tiles[t].firstReg + floodReg[i] - 1];
+			floodReg[i] = 0;
+		}
+	}
 
+	return true;
+}
 
 static void sortCellsByLevel(unsigned short startLevel,
 							  rcCompactHeightfield& chf,
@@ -787,6 +1152,54 @@ static void walkContour(int x, int y, int i, int dir,
 }
 
 
+// The span the contour of a region is walked from.
+struct rcContourStart
+{
+	int x, y, i, dir;
+	unsigned short reg;
+};
+
+struct rcRegionContourJob
+{
+	rcCompactHeightfield* chf;
+	const unsigned short* srcReg;
+	rcRegion* regions;
+	const rcContourStart* starts;
+};
+
+// Walks the contours of the regions in the range to find their neighbours. A walk only reads the heightfield
+// and writes the connections of its own region, so the regions can be walked in parallel.
+static void walkRegionContours(void* userData, const int begin, const int end, const int /*threadIndex*/)
+{
+	rcRegionContourJob& job = *(rcRegionContourJob*)userData;
+	for (int j = begin; j < end; ++j)
+	{
+		const rcContourStart& start = job.starts[j];
+		walkContour(start.x, start.y, start.i, start.dir, *job.chf, job.srcReg, job.regions[start.reg].connections);
+	}
+}
+
+// Schedules a region for another merge check after one of its neighbours changed. Regions after the current one
+// are checked later in the same pass, the others in the next pass, just like in a sweep over all regions.
+static void scheduleMergeCheck(int r, int current, rcTempVector<int>& queue, rcTempVector<int>& nextQueue,
+							   unsigned char* queued)
+{
+	if (r > current)
+	{
+		if ((queued[r] & 1) == 0)
+		{
+			queued[r] |= 1;
+			queue.push_back(r);
+			std::push_heap(queue.begin(), queue.end(), std::greater<int>());
+		}
+	}
+	else if ((queued[r] & 2) == 0)
+	{
+		queued[r] |= 2;
+		nextQueue.push_back(r);
+	}
+}
+
 static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRegionSize,
 								  unsigned short& maxRegionId,
 								  rcCompactHeightfield& chf,
@@ -806,7 +1219,10 @@ static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRe
 	for (int i = 0; i < nreg; ++i)
 		regions.push_back(rcRegion((unsigned short) i));
 
-	// Find edge of a region and find connections around the contour.
+	// Find the first cell of each region that is next to a border, to walk its contour from.
+	rcTempVector<rcContourStart> starts;
+	rcTempVector<unsigned char> hasStart;
+	hasStart.resize(nreg, 0);
 	for (int y = 0; y < h; ++y)
 	{
 		for (int x = 0; x < w; ++x)
@@ -834,32 +1250,34 @@ static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRe
 				}
 
 				// Have found contour
-				if (reg.connections.size() > 0)
+				if (hasStart[r])
 					continue;
 
 				reg.areaType = chf.areas[i];
 
 				// Check if this cell is next to a border.
-				int ndir = -1;
 				for (int dir = 0; dir < 4; ++dir)
 				{
 					if (isSolidEdge(chf, srcReg, x, y, i, dir))
 					{
-						ndir = dir;
+						rcContourStart start = { x, y, i, dir, r };
+						starts.push_back(start);
+						hasStart[r] = 1;
 						break;
 					}
 				}
-
-				if (ndir != -1)
-				{
-					// The cell is at border.
-					// Walk around the contour to find all the neighbours.
-					walkContour(x, y, i, ndir, chf, srcReg, reg.connections);
-				}
 			}
 		}
 	}
 
+	// Walk around the contours to find all the neighbours.
+	rcRegionContourJob contourJob;
+	contourJob.chf = &chf;
+	contourJob.srcReg = srcReg;
+	contourJob.regions = regions.data();
+	contourJob.starts = starts.data();
+	ctx->parallelFor((int)starts.size(), walkRegionContours, &contourJob);
+
 	// Remove too small regions.
 	rcIntArray stack(32);
 	rcIntArray trace(32);
@@ -926,25 +1344,57 @@ static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRe
 		}
 	}
 
-	// Merge too small regions to neighbour regions.
-	int mergeCount = 0 ;
-	do
+	// The regions that have each region in their connections or floors, so that a merge only has to fix up
+	// the regions around it.
+	rcTempVector<rcIntArray> referrers;
+	referrers.resize(nreg);
+	for (int i = 0; i < nreg; ++i)
 	{
-		mergeCount = 0;
-		for (int i = 0; i < nreg; ++i)
+		const rcRegion& reg = regions[i];
+		if (reg.id == 0 || (reg.id & RC_BORDER_REG))
+			continue;
+		for (int j = 0; j < reg.connections.size(); ++j)
 		{
-			rcRegion& reg = regions[i];
-			if (reg.id == 0 || (reg.id & RC_BORDER_REG))
-				continue;
-			if (reg.overlap)
-				continue;
-			if (reg.spanCount == 0)
-				continue;
+			if (reg.connections[j] > 0 && reg.connections[j] < nreg)
+				referrers[reg.connections[j]].push(i);
+		}
+		for (int j = 0; j < reg.floors.size(); ++j)
+			referrers[reg.floors[j]].push(i);
+	}
 
-			// Check to see if the region should be merged.
-			if (reg.spanCount > mergeRegionSize && isRegionConnectedToBorder(reg))
-				continue;
+	// Merge too small regions to neighbour regions.
+	// The regions are checked in passes in the order of their ids, like a sweep over all regions, but a region is
+	// only checked again after a merge changed it or one of its neighbours. A merged region points to the region
+	// it was merged into, the final ids are resolved afterwards.
+	rcTempVector<int> queue;
+	rcTempVector<int> nextQueue;
+	rcTempVector<unsigned char> queued;
+	rcTempVector<int> stamps;
+	rcIntArray mergedNeis;
+	rcIntArray mergedReferrers;
+	int mergeCount = 0;
+	if (!queue.reserve(nreg) || !nextQueue.reserve(nreg))
+	{
+		ctx->log(RC_LOG_ERROR, "mergeAndFilterRegions: Out of memory 'queue' (%d).", nreg);
+		return false;
+	}
+	queued.resize(nreg, 1);
+	stamps.resize(nreg, -1);
+	for (int i = 0; i < nreg; ++i)
+		queue.push_back(i);
 
+	while (!queue.empty())
+	{
+		std::pop_heap(queue.begin(), queue.end(), std::greater<int>());
+		const int i = queue.back();
+		queue.pop_back();
+		queued[i] &= ~1;
+
+		rcRegion& reg = regions[i];
+		if (reg.id != 0 && (reg.id & RC_BORDER_REG) == 0 && !reg.overlap && reg.spanCount != 0 &&
+			// Check to see if the region should be merged.
+			!(reg.spanCount > mergeRegionSize && isRegionConnectedToBorder(reg)))
+		{
 			// Small region with more than 1 connection.
 			// Or region which is not connected to a border at all.
 			// Find smallest neighbour region that connects to this one.
@@ -969,52 +1419,100 @@ static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRe
 				unsigned short oldId = reg.id;
 				rcRegion& target = regions[mergeId];
 
+				// The neighbours of the current region become neighbours of the target.
+				mergedNeis.clear();
+				for (int j = 0; j < reg.connections.size(); ++j)
+					mergedNeis.push(reg.connections[j]);
+				for (int j = 0; j < reg.floors.size(); ++j)
+					mergedNeis.push(reg.floors[j]);
+
 				// Merge neighbours.
 				if (mergeRegions(target, reg))
 				{
+					reg.id = mergeId;
+
 					// Fixup regions pointing to current region.
-					for (int j = 0; j < nreg; ++j)
+					replaceNeighbour(target, oldId, mergeId);
+					const rcIntArray& oldReferrers = referrers[oldId];
+					for (int j = 0; j < oldReferrers.size(); ++j)
 					{
-						if (regions[j].id == 0 || (regions[j].id & RC_BORDER_REG)) continue;
-						// If another region was already merged into current region
-						// change the nid of the previous region too.
-						if (regions[j].id == oldId)
-							regions[j].id = mergeId;
-						// Replace the current region with the new one if the
-						// current regions is neighbour.
-						replaceNeighbour(regions[j], oldId, mergeId);
+						rcRegion& nei = regions[oldReferrers[j]];
+						if (nei.id == 0 || (nei.id & RC_BORDER_REG)) continue;
+						replaceNeighbour(nei, oldId, mergeId);
 					}
+
+					// The referrers of the target are now the live regions that referred to either region.
+					rcIntArray& targetReferrers = referrers[mergeId];
+					mergedReferrers.clear();
 					mergeCount++;
+					for (int k = 0; k < 2; ++k)
+					{
+						const rcIntArray& refs = k == 0 ? targetReferrers : referrers[oldId];
+						for (int j = 0; j < refs.size(); ++j)
+						{
+							const int r = refs[j];
+							if (r == 0 || (r & RC_BORDER_REG) || regions[r].id != r || stamps[r] == mergeCount)
+								continue;
+							stamps[r] = mergeCount;
+							mergedReferrers.push(r);
+						}
+					}
+					targetReferrers.clear();
+					for (int j = 0; j < mergedReferrers.size(); ++j)
+						targetReferrers.push(mergedReferrers[j]);
+					referrers[oldId].clear();
+
+					for (int j = 0; j < mergedNeis.size(); ++j)
+					{
+						const int r = mergedNeis[j];
+						if (r > 0 && r < nreg && r != mergeId)
+							referrers[r].push(mergeId);
+					}
+
+					// Check the target and the regions around it again.
+					scheduleMergeCheck(mergeId, i, queue, nextQueue, queued.data());
+					for (int j = 0; j < mergedReferrers.size(); ++j)
+						scheduleMergeCheck(mergedReferrers[j], i, queue, nextQueue, queued.data());
 				}
 			}
 		}
+
+		if (queue.empty() && !nextQueue.empty())
+		{
+			// Start the next pass.
+			queue.swap(nextQueue);
+			std::sort(queue.begin(), queue.end());
+			for (int j = 0; j < queue.size(); ++j)
+				queued[queue[j]] = 1;
+		}
 	}
-	while (mergeCount > 0);
 
-	// Compress region Ids.
+	// Resolve the regions that were merged into other regions.
 	for (int i = 0; i < nreg; ++i)
 	{
-		regions[i].remap = false;
-		if (regions[i].id == 0) continue;       // Skip nil regions.
-		if (regions[i].id & RC_BORDER_REG) continue;    // Skip external regions.
-		regions[i].remap = true;
+		if (regions[i].id == 0 || (regions[i].id & RC_BORDER_REG))
+			continue;
+		int id = regions[i].id;
+		while (regions[id].id != id)
+		{
+			regions[id].id = regions[regions[id].id].id;
+			id = regions[id].id;
+		}
+		regions[i].id = (unsigned short)id;
 	}
 
+	// Compress region Ids.
+	rcTempVector<unsigned short> newIds;
+	newIds.resize(nreg, 0);
 	unsigned short regIdGen = 0;
 	for (int i = 0; i < nreg; ++i)
 	{
-		if (!regions[i].remap)
-			continue;
-		unsigned short oldId = regions[i].id;
-		unsigned short newId = ++regIdGen;
-		for (int j = i; j < nreg; ++j)
-		{
-			if (regions[j].id == oldId)
-			{
-				regions[j].id = newId;
-				regions[j].remap = false;
-			}
-		}
+		if (regions[i].id == 0) continue;       // Skip nil regions.
+		if (regions[i].id & RC_BORDER_REG) continue;    // Skip external regions.
+		unsigned short& newId = newIds[regions[i].id];
+		if (newId == 0)
+			newId = ++regIdGen;
+		regions[i].id = newId;
 	}
 	maxRegionId = regIdGen;
 
@@ -1247,21 +1745,41 @@ static bool mergeAndFilterLayerRegions(rcContext* ctx, int minRegionArea,
 
 
 
-/// @par
-///
-/// This is usually the second to the last step in creating a fully built
-/// compact heightfield.  This step is required before regions are built
-/// using #rcBuildRegions or #rcBuildRegionsMonotone.
-///
-/// After this step, the distance data is available via the rcCompactHeightfield::maxDistance
-/// and rcCompactHeightfield::dist fields.
-///
-/// @see rcCompactHeightfield, rcBuildRegions, rcBuildRegionsMonotone
-bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf)
+/// The passes of a distance field build, each sweeping all rows of the heightfield.
+enum rcDistanceFieldPass
 {
-	rcAssert(ctx);
+	RC_DISTANCE_MARK_BOUNDARIES,
+	RC_DISTANCE_SWEEP_FORWARD,
+	RC_DISTANCE_SWEEP_BACKWARD,
+	RC_DISTANCE_BLUR,
+	RC_DISTANCE_DONE
+};
 
-	rcScopedTimer timer(ctx, RC_TIMER_BUILD_DISTANCEFIELD);
+/// The state of a distance field build between the calls of #rcStepDistanceField.
+struct rcDistanceFieldBuild
+{
+	inline rcDistanceFieldBuild() : chf(0), src(0), dst(0), pass(RC_DISTANCE_DONE), row(0), maxDist(0) {}
+	inline ~rcDistanceFieldBuild() { reset(); }
+
+	void reset()
+	{
+		rcFree(src);
+		rcFree(dst);
+		src = 0;
+		dst = 0;
+	}
+
+	rcCompactHeightfield* chf;
+	unsigned short* src;	// The distances, handed over to chf.dist when done.
+	unsigned short* dst;	// The blurred distances.
+	int pass;				// The current #rcDistanceFieldPass.
+	int row;				// The next row of the current pass.
+	unsigned short maxDist;
+};
+
+static bool beginDistanceField(rcContext* ctx, rcCompactHeightfield& chf, rcDistanceFieldBuild& build)
+{
+	build.reset();
 
 	if (chf.dist)
 	{
@@ -1269,41 +1787,146 @@ bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf)
 		chf.dist = 0;
 	}
 
-	unsigned short* src = (unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP);
-	if (!src)
+	// The distances outlive the build step in chf.dist, so they are kept in permanent memory.
+	build.src = (unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_PERM);
+	if (!build.src)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildDistanceField: Out of memory 'src' (%d).", chf.spanCount);
 		return false;
 	}
-	unsigned short* dst = (unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP);
-	if (!dst)
+	build.dst = (unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP);
+	if (!build.dst)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildDistanceField: Out of memory 'dst' (%d).", chf.spanCount);
-		rcFree(src);
 		return false;
 	}
 
-	unsigned short maxDist = 0;
+	build.chf = &chf;
+	build.pass = RC_DISTANCE_MARK_BOUNDARIES;
+	build.row = 0;
+	build.maxDist = 0;
+	return true;
+}
 
+// Runs the passes of the build over at most maxRows rows, at least one.
+static void advanceDistanceField(rcContext* ctx, rcDistanceFieldBuild& build, const int maxRows)
+{
+	rcCompactHeightfield& chf = *build.chf;
+	const int h = chf.height;
+
+	int rows = rcMax(maxRows, 1);
+	while (rows > 0 && build.pass != RC_DISTANCE_DONE)
 	{
-		rcScopedTimer timerDist(ctx, RC_TIMER_BUILD_DISTANCEFIELD_DIST);
+		const int miny = build.row;
+		const int maxy = rcMin(miny + rows, h);
 
-		calculateDistanceField(chf, src, maxDist);
-		chf.maxDistance = maxDist;
-	}
+		const rcTimerLabel label = build.pass == RC_DISTANCE_BLUR ? RC_TIMER_BUILD_DISTANCEFIELD_BLUR : RC_TIMER_BUILD_DISTANCEFIELD_DIST;
+		rcScopedTimer timerPass(ctx, label);
 
-	{
-		rcScopedTimer timerBlur(ctx, RC_TIMER_BUILD_DISTANCEFIELD_BLUR);
+		switch (build.pass)
+		{
+		case RC_DISTANCE_MARK_BOUNDARIES:
+			markDistanceBoundaries(chf, build.src, miny, maxy);
+			break;
+		case RC_DISTANCE_SWEEP_FORWARD:
+			sweepDistanceForward(chf, build.src, miny, maxy);
+			break;
+		case RC_DISTANCE_SWEEP_BACKWARD:
+			// The backward sweep starts at the last row.
+			build.maxDist = rcMax(build.maxDist, sweepDistanceBackward(chf, build.src, h-maxy, h-miny));
+			break;
+		case RC_DISTANCE_BLUR:
+			boxBlur(chf, 1, build.src, build.dst, miny, maxy);
+			break;
+		}
 
-		// Blur
-		if (boxBlur(chf, 1, src, dst) != src)
-			rcSwap(src, dst);
+		rows -= maxy - miny;
+		build.row = maxy;
+		if (build.row < h)
+			continue;
 
-		// Store distance.
-		chf.dist = src;
+		build.row = 0;
+		build.pass++;
+		if (build.pass == RC_DISTANCE_BLUR)
+		{
+			chf.maxDistance = build.maxDist;
+		}
+		else if (build.pass == RC_DISTANCE_DONE)
+		{
+			// Store distance.
+			memcpy(build.src, build.dst, sizeof(unsigned short)*chf.spanCount);
+			chf.dist = build.src;
+			build.src = 0;
+		}
 	}
+}
+
+/// @par
+///
+/// This is usually the second to the last step in creating a fully built
+/// compact heightfield.  This step is required before regions are built
+/// using #rcBuildRegions or #rcBuildRegionsMonotone.
+///
+/// After this step, the distance data is available via the rcCompactHeightfield::maxDistance
+/// and rcCompactHeightfield::dist fields.
+///
+/// @see rcCompactHeightfield, rcBuildRegions, rcBuildRegionsMonotone, rcBeginDistanceField
+bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_DISTANCEFIELD);
+
+	rcDistanceFieldBuild build;
+	if (!beginDistanceField(ctx, chf, build))
+		return false;
+	advanceDistanceField(ctx, build, chf.height*RC_DISTANCE_DONE);
+
+	return true;
+}
+
+rcDistanceFieldBuild* rcAllocDistanceFieldBuild()
+{
+	void* mem = rcAlloc(sizeof(rcDistanceFieldBuild), RC_ALLOC_PERM);
+	return mem ? ::new(rcNewTag(), mem) rcDistanceFieldBuild() : 0;
+}
+
+void rcFreeDistanceFieldBuild(rcDistanceFieldBuild* build)
+{
+	if (!build)
+		return;
+	build->~rcDistanceFieldBuild();
+	rcFree(build);
+}
+
+/// @par
+///
+/// Any previous distance field of @p chf is freed. The distances are stored once the build is done.
+///
+/// @see rcStepDistanceField, rcBuildDistanceField
+bool rcBeginDistanceField(rcContext* ctx, rcCompactHeightfield& chf, rcDistanceFieldBuild& build)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_DISTANCEFIELD);
+
+	return beginDistanceField(ctx, chf, build);
+}
+
+/// @par
+///
+/// The distance field is built in four passes over the rows of the heightfield, so a build takes four times the
+/// heightfield height in rows.
+///
+/// @see rcBeginDistanceField
+bool rcStepDistanceField(rcContext* ctx, rcDistanceFieldBuild& build, const int maxRows, bool& done)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_DISTANCEFIELD);
 
-	rcFree(dst);
+	advanceDistanceField(ctx, build, maxRows);
+	done = build.pass == RC_DISTANCE_DONE;
 
 	return true;
 }
@@ -1510,67 +2133,82 @@ bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 	return true;
 }
 
-/// @par
-///
-/// Non-null regions will consist of connected, non-overlapping walkable spans that form a single contour.
-/// Contours will form simple polygons.
-///
-/// If multiple regions form an area that is smaller than @p minRegionArea, then all spans will be
-/// re-assigned to the zero (null) region.
-///
-/// Watershed partitioning can result in smaller than necessary regions, especially in diagonal corridors.
-/// @p mergeRegionArea helps reduce unnecessarily small regions.
-///
-/// See the #rcConfig documentation for more information on the configuration parameters.
-///
-/// The region data will be available via the rcCompactHeightfield::maxRegions
-/// and rcCompactSpan::reg fields.
-///
-/// @warning The distance field must be created using #rcBuildDistanceField before attempting to build regions.
-///
-/// @see rcCompactHeightfield, rcCompactSpan, rcBuildDistanceField, rcBuildRegionsMonotone, rcConfig
-bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
-					const int borderSize, const int minRegionArea, const int mergeRegionArea)
+static const int RC_REGION_LEVEL_STACKS = 8;
+
+// TODO: Figure better formula, expandIters defines how much the
+// watershed "overflows" and simplifies the regions. Tying it to
+// agent radius was usually good indication how greedy it could be.
+//	const int expandIters = 4 + walkableRadius * 2;
+static const int RC_REGION_EXPAND_ITERS = 8;
+
+/// The phases of a watershed region build.
+enum rcRegionsPhase
 {
-	rcAssert(ctx);
+	RC_REGIONS_FLOOD_LEVELS,
+	RC_REGIONS_EXPAND,
+	RC_REGIONS_FILTER,
+	RC_REGIONS_DONE
+};
 
-	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
+/// The state of a watershed region build between the calls of #rcStepRegions.
+struct rcRegionsBuild
+{
+	inline rcRegionsBuild() : chf(0), minRegionArea(0), mergeRegionArea(0), tiledFlood(false), buf(0),
+		regionId(0), level(0), sId(-1), phase(RC_REGIONS_DONE) {}
+	inline ~rcRegionsBuild() { reset(); }
+
+	void reset()
+	{
+		rcFree(buf);
+		buf = 0;
+		for (int i = 0; i < RC_REGION_LEVEL_STACKS; ++i)
+			lvlStacks[i].clear();
+		stack.clear();
+		flood.tiles.clear();
+		flood.floodReg.clear();
+	}
+
+	rcCompactHeightfield* chf;
+	int minRegionArea;
+	int mergeRegionArea;
+	bool tiledFlood;
+	unsigned short* buf;	// The region ids, then the distances of the spans.
+	rcTempVector<LevelStackEntry> lvlStacks[RC_REGION_LEVEL_STACKS];
+	rcTempVector<LevelStackEntry> stack;
+	rcFloodTiles flood;
+	unsigned short regionId;	// The next region id.
+	unsigned short level;		// The level flooded last.
+	int sId;					// The level stack of the last level.
+	int phase;					// The current #rcRegionsPhase.
+};
+
+static bool beginWatershedRegions(rcContext* ctx, rcCompactHeightfield& chf,
+								  const int borderSize, const int minRegionArea, const int mergeRegionArea,
+								  const bool tiledFlood, rcRegionsBuild& build)
+{
+	build.reset();
 
 	const int w = chf.width;
 	const int h = chf.height;
 
-	rcScopedDelete<unsigned short> buf((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount*2, RC_ALLOC_TEMP));
-	if (!buf)
+	build.buf = (unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount*2, RC_ALLOC_TEMP);
+	if (!build.buf)
 	{
 		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'tmp' (%d).", chf.spanCount*4);
 		return false;
 	}
 
-	ctx->startTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
-
-	const int LOG_NB_STACKS = 3;
-	const int NB_STACKS = 1 << LOG_NB_STACKS;
-	rcTempVector<LevelStackEntry> lvlStacks[NB_STACKS];
-	for (int i=0; i<NB_STACKS; ++i)
-		lvlStacks[i].reserve(256);
-
-	rcTempVector<LevelStackEntry> stack;
-	stack.reserve(256);
+	for (int i=0; i<RC_REGION_LEVEL_STACKS; ++i)
+		build.lvlStacks[i].reserve(256);
+	build.stack.reserve(256);
 
-	unsigned short* srcReg = buf;
-	unsigned short* srcDist = buf+chf.spanCount;
+	unsigned short* srcReg = build.buf;
+	unsigned short* srcDist = build.buf+chf.spanCount;
 
 	memset(srcReg, 0, sizeof(unsigned short)*chf.spanCount);
 	memset(srcDist, 0, sizeof(unsigned short)*chf.spanCount);
 
 	unsigned short regionId = 1;
-	unsigned short level = (chf.maxDistance+1) & ~1;
-
-	// TODO: Figure better formula, expandIters defines how much the
-	// watershed "overflows" and simplifies the regions. Tying it to
-	// agent radius was usually good indication how greedy it could be.
-//	const int expandIters = 4 + walkableRadius * 2;
-	const int expandIters = 8;
 
 	if (borderSize > 0)
 	{
@@ -1587,67 +2225,120 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 
 	chf.borderSize = borderSize;
 
-	int sId = -1;
-	while (level > 0)
+	if (tiledFlood)
 	{
-		level = level >= 2 ? level-2 : 0;
-		sId = (sId+1) & (NB_STACKS-1);
+		rcFloodTiles& flood = build.flood;
+		flood.tilesX = (w + RC_FLOOD_TILE_SIZE-1) / RC_FLOOD_TILE_SIZE;
+		const int tilesY = (h + RC_FLOOD_TILE_SIZE-1) / RC_FLOOD_TILE_SIZE;
+		if (!flood.floodReg.reserve(chf.spanCount))
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildRegionsParallel: Out of memory 'floodReg' (%d).", chf.spanCount);
+			return false;
+		}
+		flood.floodReg.resize(chf.spanCount, 0);
+		flood.tiles.resize(flood.tilesX * tilesY);
+		flood.stacks.resize(ctx->getMaxThreads());
+	}
+
+	build.chf = &chf;
+	build.minRegionArea = minRegionArea;
+	build.mergeRegionArea = mergeRegionArea;
+	build.tiledFlood = tiledFlood;
+	build.regionId = regionId;
+	build.level = (chf.maxDistance+1) & ~1;
+	build.sId = -1;
+	build.phase = build.level > 0 ? RC_REGIONS_FLOOD_LEVELS : RC_REGIONS_EXPAND;
+	return true;
+}
 
-//		ctx->startTimer(RC_TIMER_DIVIDE_TO_LEVELS);
+// Expands the regions to the next lower level and floods the new regions of that level.
+static bool floodWatershedLevel(rcContext* ctx, rcRegionsBuild& build)
+{
+	rcCompactHeightfield& chf = *build.chf;
+	unsigned short* srcReg = build.buf;
+	unsigned short* srcDist = build.buf+chf.spanCount;
 
-		if (sId == 0)
-			sortCellsByLevel(level, chf, srcReg, NB_STACKS, lvlStacks, 1);
-		else
-			appendStacks(lvlStacks[sId-1], lvlStacks[sId], srcReg); // copy left overs from last level
+	const unsigned short level = build.level >= 2 ? build.level-2 : 0;
+	const int sId = (build.sId+1) & (RC_REGION_LEVEL_STACKS-1);
+	build.level = level;
+	build.sId = sId;
+	if (level == 0)
+		build.phase = RC_REGIONS_EXPAND;
 
-//		ctx->stopTimer(RC_TIMER_DIVIDE_TO_LEVELS);
+	rcTempVector<LevelStackEntry>* lvlStacks = build.lvlStacks;
 
-		{
-			rcScopedTimer timerExpand(ctx, RC_TIMER_BUILD_REGIONS_EXPAND);
+//	ctx->startTimer(RC_TIMER_DIVIDE_TO_LEVELS);
 
-			// Expand current regions until no empty connected cells found.
-			expandRegions(expandIters, level, chf, srcReg, srcDist, lvlStacks[sId], false);
-		}
+	if (sId == 0)
+		sortCellsByLevel(level, chf, srcReg, RC_REGION_LEVEL_STACKS, lvlStacks, 1);
+	else
+		appendStacks(lvlStacks[sId-1], lvlStacks[sId], srcReg); // copy left overs from last level
 
-		{
-			rcScopedTimer timerFloor(ctx, RC_TIMER_BUILD_REGIONS_FLOOD);
+//	ctx->stopTimer(RC_TIMER_DIVIDE_TO_LEVELS);
+
+	{
+		rcScopedTimer timerExpand(ctx, RC_TIMER_BUILD_REGIONS_EXPAND);
+
+		// Expand current regions until no empty connected cells found.
+		expandRegions(ctx, RC_REGION_EXPAND_ITERS, level, chf, srcReg, srcDist, lvlStacks[sId], false);
+	}
+
+	{
+		rcScopedTimer timerFloor(ctx, RC_TIMER_BUILD_REGIONS_FLOOD);
+
+		// Mark new regions with IDs.
+		if (build.tiledFlood)
+			return floodRegionTiles(ctx, level, chf, lvlStacks[sId], srcReg, srcDist, build.flood, build.regionId);
 
-			// Mark new regions with IDs.
-			for (int j = 0; j<lvlStacks[sId].size(); j++)
+		for (int j = 0; j<lvlStacks[sId].size(); j++)
+		{
+			LevelStackEntry current = lvlStacks[sId][j];
+			int x = current.x;
+			int y = current.y;
+			int i = current.index;
+			if (i >= 0 && srcReg[i] == 0)
 			{
-				LevelStackEntry current = lvlStacks[sId][j];
-				int x = current.x;
-				int y = current.y;
-				int i = current.index;
-				if (i >= 0 && srcReg[i] == 0)
+				if (floodRegion(x, y, i, level, build.regionId, chf, srcReg, srcDist, build.stack))
 				{
-					if (floodRegion(x, y, i, level, regionId, chf, srcReg, srcDist, stack))
+					if (build.regionId == 0xFFFF)
 					{
-						if (regionId == 0xFFFF)
-						{
-							ctx->log(RC_LOG_ERROR, "rcBuildRegions: Region ID overflow");
-							return false;
-						}
-
-						regionId++;
+						ctx->log(RC_LOG_ERROR, "rcBuildRegions: Region ID overflow");
+						return false;
 					}
+
+					build.regionId++;
 				}
 			}
 		}
 	}
 
+	return true;
+}
+
+// Expands the regions over the spans left after the last level.
+static void expandWatershedRegions(rcContext* ctx, rcRegionsBuild& build)
+{
+	rcCompactHeightfield& chf = *build.chf;
+
 	// Expand current regions until no empty connected cells found.
-	expandRegions(expandIters*8, 0, chf, srcReg, srcDist, stack, true);
+	expandRegions(ctx, RC_REGION_EXPAND_ITERS*8, 0, chf, build.buf, build.buf+chf.spanCount, build.stack, true);
 
-	ctx->stopTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
+	build.phase = RC_REGIONS_FILTER;
+}
+
+// Merges and filters the regions and writes them to the heightfield.
+static bool filterWatershedRegions(rcContext* ctx, rcRegionsBuild& build)
+{
+	rcCompactHeightfield& chf = *build.chf;
+	unsigned short* srcReg = build.buf;
 
 	{
 		rcScopedTimer timerFilter(ctx, RC_TIMER_BUILD_REGIONS_FILTER);
 
 		// Merge regions and filter out small regions.
 		rcIntArray overlaps;
-		chf.maxRegions = regionId;
-		if (!mergeAndFilterRegions(ctx, minRegionArea, mergeRegionArea, chf.maxRegions, chf, srcReg, overlaps))
+		chf.maxRegions = build.regionId;
+		if (!mergeAndFilterRegions(ctx, build.minRegionArea, build.mergeRegionArea, chf.maxRegions, chf, srcReg, overlaps))
 			return false;
 
 		// If overlapping regions were found during merging, split those regions.
@@ -1661,9 +2352,141 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 	for (int i = 0; i < chf.spanCount; ++i)
 		chf.spans[i].reg = srcReg[i];
 
+	build.phase = RC_REGIONS_DONE;
+	return true;
+}
+
+// Runs at most maxSteps steps of the build, at least one. A step floods one level, expands the
+// regions after the last level, or filters the regions.
+static bool advanceWatershedRegions(rcContext* ctx, rcRegionsBuild& build, const int maxSteps)
+{
+	for (int n = 0; n < rcMax(maxSteps, 1) && build.phase != RC_REGIONS_DONE; ++n)
+	{
+		if (build.phase == RC_REGIONS_FILTER)
+		{
+			if (!filterWatershedRegions(ctx, build))
+				return false;
+			continue;
+		}
+
+		rcScopedTimer timerWatershed(ctx, RC_TIMER_BUILD_REGIONS_WATERSHED);
+
+		if (build.phase == RC_REGIONS_EXPAND)
+			expandWatershedRegions(ctx, build);
+		else if (!floodWatershedLevel(ctx, build))
+			return false;
+	}
 	return true;
 }
 
+// Builds the watershed regions. With tiledFlood the new regions of each level are flooded tile by tile in parallel.
+static bool buildWatershedRegions(rcContext* ctx, rcCompactHeightfield& chf,
+								  const int borderSize, const int minRegionArea, const int mergeRegionArea,
+								  const bool tiledFlood)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
+
+	rcRegionsBuild build;
+	if (!beginWatershedRegions(ctx, chf, borderSize, minRegionArea, mergeRegionArea, tiledFlood, build))
+		return false;
+
+	// Each level takes one step, plus the expansion and the filtering.
+	return advanceWatershedRegions(ctx, build, build.level/2 + 2);
+}
+
+
+/// @par
+///
+/// Non-null regions will consist of connected, non-overlapping walkable spans that form a single contour.
+/// Contours will form simple polygons.
+///
+/// If multiple regions form an area that is smaller than @p minRegionArea, then all spans will be
+/// re-assigned to the zero (null) region.
+///
+/// Watershed partitioning can result in smaller than necessary regions, especially in diagonal corridors.
+/// @p mergeRegionArea helps reduce unnecessarily small regions.
+///
+/// See the #rcConfig documentation for more information on the configuration parameters.
+///
+/// The region data will be available via the rcCompactHeightfield::maxRegions
+/// and rcCompactSpan::reg fields.
+///
+/// @warning The distance field must be created using #rcBuildDistanceField before attempting to build regions.
+///
+/// @see rcCompactHeightfield, rcCompactSpan, rcBuildDistanceField, rcBuildRegionsMonotone, rcConfig
+bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
+					const int borderSize, const int minRegionArea, const int mergeRegionArea)
+{
+	return buildWatershedRegions(ctx, chf, borderSize, minRegionArea, mergeRegionArea, false);
+}
+
+/// @par
+///
+/// Builds the same kind of regions as #rcBuildRegions, but floods the new regions of each level in parallel,
+/// in tiles of 64 by 64 cells. The regions flooded in neighbouring tiles are joined where they touch, so the
+/// regions can differ slightly from the ones of #rcBuildRegions. The regions do not depend on the number of threads.
+///
+/// @warning The distance field must be created using #rcBuildDistanceField before attempting to build regions.
+///
+/// @see rcBuildRegions, rcContext::parallelFor
+bool rcBuildRegionsParallel(rcContext* ctx, rcCompactHeightfield& chf,
+							const int borderSize, const int minRegionArea, const int mergeRegionArea)
+{
+	return buildWatershedRegions(ctx, chf, borderSize, minRegionArea, mergeRegionArea, true);
+}
+
+rcRegionsBuild* rcAllocRegionsBuild()
+{
+	void* mem = rcAlloc(sizeof(rcRegionsBuild), RC_ALLOC_PERM);
+	return mem ? ::new(rcNewTag(), mem) rcRegionsBuild() : 0;
+}
+
+void rcFreeRegionsBuild(rcRegionsBuild* build)
+{
+	if (!build)
+		return;
+	build->~rcRegionsBuild();
+	rcFree(build);
+}
+
+/// @par
+///
+/// Builds the same regions as #rcBuildRegions. The regions are written to the spans of @p chf once the build is done.
+///
+/// @warning The distance field must be created before attempting to build regions.
+///
+/// @see rcStepRegions, rcBuildRegions
+bool rcBeginRegions(rcContext* ctx, rcCompactHeightfield& chf,
+					const int borderSize, const int minRegionArea, const int mergeRegionArea,
+					rcRegionsBuild& build)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
+
+	return beginWatershedRegions(ctx, chf, borderSize, minRegionArea, mergeRegionArea, false, build);
+}
+
+/// @par
+///
+/// A step floods one distance level of the watershed, two distance units apart. The regions are then expanded over
+/// the remaining spans, and merged and filtered, in one step each.
+///
+/// @see rcBeginRegions
+bool rcStepRegions(rcContext* ctx, rcRegionsBuild& build, const int maxSteps, bool& done)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
+
+	const bool ok = advanceWatershedRegions(ctx, build, maxSteps);
+	done = build.phase == RC_REGIONS_DONE;
+
+	return ok;
+}
+
 
 bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf,
 						 const int borderSize, const int minRegionArea)
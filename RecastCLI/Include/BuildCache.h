@@ -0,0 +1,71 @@
+//
+// Copyright (c) 2024.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+/// Accumulates the 64-bit FNV-1a hash of the inputs of a build.
+class BuildCacheKey {
+public:
+  void add(const void *data, std::size_t size);
+  template <typename T> void add(const T &value) { add(&value, sizeof(T)); }
+
+  std::uint64_t getHash() const { return m_hash; }
+  /// The hash as 16 hexadecimal digits, the name of its cache entry.
+  std::string toString() const;
+
+private:
+  std::uint64_t m_hash{14695981039346656037ull};
+};
+
+/// Statistics of a #BuildCache.
+struct BuildCacheStats {
+  /// The number of lookups that found an entry.
+  int hits{};
+  /// The number of lookups that found no entry.
+  int misses{};
+  /// The number of entries removed to stay under the size limit.
+  int evictions{};
+};
+
+/// A content-addressed cache of build outputs in a local directory. Each entry is a file named after the key of the
+/// inputs it was built from, so an entry is only ever found for identical inputs and never has to be invalidated.
+/// The least recently used entries are removed when the entries exceed the size limit.
+class BuildCache {
+public:
+  /// Opens the cache directory, creating it when it does not exist yet.
+  /// @param[in] sizeLimit The maximum total size of the entries in bytes, or 0 for no limit.
+  bool open(const std::string &directory, std::size_t sizeLimit);
+
+  bool isOpen() const { return !m_directory.empty(); }
+
+  /// Looks up the entry of the key and copies it to the output path. An empty entry records a build without
+  /// output; nothing is copied for it and @p hasOutput is set to false.
+  /// @returns True on a hit.
+  bool fetch(const BuildCacheKey &key, const std::string &outputPath, bool &hasOutput);
+
+  /// Stores the file at the output path as the entry of the key, or an empty entry when the output path is empty.
+  bool store(const BuildCacheKey &key, const std::string &outputPath);
+
+  const BuildCacheStats &getStats() const { return m_stats; }
+
+private:
+  struct Entry {
+    std::size_t size{};
+    std::uint64_t lastUse{};
+  };
+
+  void evict();
+
+  std::string m_directory{};
+  std::size_t m_sizeLimit{};
+  std::size_t m_totalSize{};
+  std::uint64_t m_useCounter{};
+  std::unordered_map<std::string, Entry> m_entries{};
+  BuildCacheStats m_stats{};
+};
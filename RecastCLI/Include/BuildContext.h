@@ -19,14 +19,46 @@
 #ifndef SAMPLEINTERFACES_H
 #define SAMPLEINTERFACES_H
 
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include <Recast.h>
+#include <RecastAlloc.h>
 #include <PerfTimer.h>
 
+/// The hardware counters a BuildContext can sample at its timers. (See: BuildContext::enablePerfCounters)
+enum PerfCounter {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_L1D_READ_MISSES,
+	PERF_LLC_MISSES,
+	PERF_BRANCH_MISSES,
+	PERF_MAX_COUNTERS
+};
+
 /// Recast build context.
+/// Timers are kept per thread, so timers of the same label may nest and run on several threads at once.
 class BuildContext final : public rcContext
 {
-	TimeVal m_startTime[RC_MAX_TIMERS]{};
+	struct TraceEvent {
+		int label;
+		int thread;
+		// True for the work of a thread in a parallelFor, false for a timer.
+		bool work;
+		TimeVal begin;
+		TimeVal end;
+	};
+
 	TimeVal m_accTime[RC_MAX_TIMERS]{};
+	mutable std::mutex m_timerMutex;
+	bool m_tracing{false};
+	TimeVal m_traceStart{};
+	std::vector<TraceEvent> m_traceEvents;
+	int m_perfCounters[PERF_MAX_COUNTERS];
+	bool m_perfEnabled{false};
+	std::int64_t m_accPerfCounters[RC_MAX_TIMERS][PERF_MAX_COUNTERS]{};
 
 	static const int MAX_MESSAGES = 1000;
 	const char* m_messages[MAX_MESSAGES]{};
@@ -34,9 +66,15 @@ class BuildContext final : public rcContext
 	static const int TEXT_POOL_SIZE = 8000;
 	char m_textPool[TEXT_POOL_SIZE]{};
 	int m_textPoolSize;
+	std::mutex m_logMutex;
+
+	int m_maxThreads;
+	std::unique_ptr<rcArena[]> m_tempArenas;
+	int m_tempArenaCount;
 	
 public:
 	BuildContext();
+	~BuildContext() override;
 	
 	/// Dumps the log to stdout.
 	void dumpLog(const char* format, ...)const;
@@ -44,6 +82,33 @@ public:
 	int getLogCount() const;
 	/// Returns log message text.
 	const char* getLogText(int i) const;
+	/// Sets the number of threads parallel build steps may use. 0 uses all hardware threads.
+	void setMaxThreads(int maxThreads);
+	/// Serves the temporary allocations of the build steps from one arena per thread. (See: #rcAllocSetArenas)
+	/// Call after #setMaxThreads. A size of 0 disables the arenas.
+	bool setTempArenaSize(std::size_t bytesPerThread);
+	/// Releases all temporary memory at once. Call between builds, when no temporary memory is in use.
+	void resetTempArenas();
+	/// Tracks the memory usage of each timer. (See: #rcContext::getMemoryStats)
+	/// Routes the Recast allocations through a tracking allocator for the rest of the program, so it must be called
+	/// before anything is allocated through rcAlloc. Temporary blocks served by the arenas are not tracked.
+	void enableMemoryTracking();
+	/// Returns the memory usage of one thread during a timer, with threads identified by their index in parallel build
+	/// steps. The peaks count the bytes in use by that thread alone, including blocks it allocated before the timer.
+	/// @return False if memory tracking is off or the thread is not tracked.
+	bool getThreadMemoryStats(rcTimerLabel label, int threadIndex, rcMemoryStats& stats) const;
+	/// Records every timer and the work of every thread in parallel build steps from now on.
+	/// Timers nest per thread, and threads are identified by their index in parallel build steps.
+	void enableTrace();
+	/// Writes the recorded trace as a Chrome trace event file, which about:tracing and Perfetto can open.
+	bool writeTrace(const char* filePath) const;
+	/// Samples hardware counters at every timer of the thread that calls this, including the work of the worker
+	/// threads of parallel build steps. Only available on Linux, and only when perf events are permitted.
+	/// @return True if at least one counter could be opened.
+	bool enablePerfCounters();
+	/// Returns the accumulated count of a hardware counter during a timer.
+	/// @return False if the counter is not available.
+	bool getPerfCounter(rcTimerLabel label, PerfCounter counter, std::int64_t& value) const;
 	
 protected:	
 	/// Virtual functions for custom implementations.
@@ -54,7 +119,14 @@ protected:
 	void doStartTimer(rcTimerLabel label) override;
 	void doStopTimer(rcTimerLabel label) override;
 	int doGetAccumulatedTime(rcTimerLabel label) const override;
+	bool doGetMemoryStats(rcTimerLabel label, rcMemoryStats& stats) const override;
+	int doGetMaxThreads() const override;
+	void doParallelFor(int count, rcParallelForFunc* func, void* userData) override;
 	///@}
+
+private:
+	// Reads the current values of the counters, -1 for the ones that are not available.
+	void readPerfCounters(std::int64_t* values) const;
 };
 #endif // SAMPLEINTERFACES_H
 
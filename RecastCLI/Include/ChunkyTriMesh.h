@@ -46,8 +46,11 @@ private:
 
 /// Creates partitioned triangle mesh (AABB tree),
 /// where each node contains at max trisPerChunk triangles.
+/// The nodes are split with a binned surface area heuristic over the xz-bounds of the triangles,
+/// and the subtrees of the top levels are built in parallel on up to maxThreads threads, or on the
+/// hardware threads if maxThreads is 0. The tree does not depend on the number of threads.
 bool rcCreateChunkyTriMesh(const float* verts, const int* tris, int ntris,
-                           int trisPerChunk, rcChunkyTriMesh* cm);
+                           int trisPerChunk, rcChunkyTriMesh* cm, int maxThreads = 0);
 
 /// Returns the chunk indices which overlap the input rectable.
 int rcGetChunksOverlappingRect(const rcChunkyTriMesh* cm, float bmin[2], float bmax[2], int* ids, const int maxIds);
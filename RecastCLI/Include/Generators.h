@@ -4,12 +4,134 @@
 
 #pragma once
 
+#include <Recast.h>
+
+#include <vector>
+
 struct rcPolyMeshDetail;
 struct rcPolyMesh;
 struct rcConfig;
 class InputGeom;
 class rcContext;
 
-bool generateTheses(rcContext& context,const InputGeom& pGeom, rcConfig &config, bool filterLowHangingObstacles,bool filterLedgeSpans, bool filterWalkableLowHeightSpans, rcPolyMesh *&pMesh, rcPolyMeshDetail *&pDetailedMesh, int *&bounderies, int &bounderyElementCount);
+bool generateTheses(rcContext& context,const InputGeom& pGeom, rcConfig &config, bool filterLowHangingObstacles,bool filterLedgeSpans, bool filterWalkableLowHeightSpans, rcPolyMesh *&pMesh, rcPolyMeshDetail *&pDetailedMesh, int *&bounderies, int &bounderyElementCount, int detailBuildFlags = 0);
+
+/// Marks the convex volumes of the input geometry in one batch. (See: #rcMarkAreaVolumes)
+bool markConvexVolumes(rcContext &context, const InputGeom &pGeom, rcCompactHeightfield &compactHeightField);
+
+/// Builds a solo mesh with watershed regions, flooded in parallel tiles with @p parallelRegions. (See: #rcBuildRegionsParallel)
+bool generateSingle(rcContext& context, const InputGeom& pGeom, rcConfig& config, bool filterLowHangingObstacles, bool filterLedgeSpans, bool filterWalkableLowHeightSpans, rcPolyMesh*& pMesh, rcPolyMeshDetail*& pDetailedMesh, int detailBuildFlags = 0, bool parallelRegions = false);
+
+/// A solo mesh that keeps its filtered heightfield and its compact heightfield with the regions
+/// between builds, so that an edit of the input geometry only re-rasterizes and re-filters the
+/// heightfield columns the edit touches. The regions are rebuilt in a window around those columns,
+/// padded by the walkable radius and the border of a tiled build. Only the regions in or next to
+/// the window are traced again, and only their polygons and detail meshes are replaced. The other
+/// polygons are left unchanged, so the regions are cut at the window where a full build of the
+/// edited geometry would not cut them. Repeated edits of one place split the regions around it into
+/// more polygons, until the next full build.
+class IncrementalSoloMesh {
+public:
+  IncrementalSoloMesh() = default;
+  ~IncrementalSoloMesh();
+  IncrementalSoloMesh(const IncrementalSoloMesh &) = delete;
+  IncrementalSoloMesh &operator=(const IncrementalSoloMesh &) = delete;
+
+  /// Builds the mesh from scratch. The grid of @p config must be initialized and stays fixed for later rebuilds.
+  bool build(rcContext &context, const rcConfig &config, int filterFlags, const float *verts, int nverts, const int *tris, int ntris, const rcAreaVolume *volumes, int volumeCount, int detailBuildFlags = 0);
+
+  /// Rebuilds the mesh after the triangles inside the changed bounds were moved, added or removed.
+  /// The bounds must contain the triangles both before and after the edit, and any changed volumes.
+  /// Every rebuild takes new region ids. When they run out, the whole mesh is rebuilt once.
+  bool rebuild(rcContext &context, const float *verts, int nverts, const int *tris, int ntris, const rcAreaVolume *volumes, int volumeCount, const float *changedBMin, const float *changedBMax);
+
+  const rcPolyMesh *getPolyMesh() const { return m_pmesh; }
+  const rcPolyMeshDetail *getPolyMeshDetail() const { return m_dmesh; }
+
+private:
+  bool rasterize(rcContext &context, const float *verts, int nverts, const int *tris, int ntris, int minX, int minZ, int maxX, int maxZ);
+  bool buildFromHeightfield(rcContext &context, const rcAreaVolume *volumes, int volumeCount);
+  bool patchFromHeightfield(rcContext &context, const rcAreaVolume *volumes, int volumeCount, int minX, int minZ, int maxX, int maxZ);
+
+  rcConfig m_config{};
+  int m_filterFlags{};
+  int m_detailBuildFlags{};
+  rcHeightfield *m_solid{nullptr};
+  rcCompactHeightfield *m_chf{nullptr};
+  // The number of spans the span arrays of the compact heightfield have room for.
+  int m_chfCapacity{};
+  // Per region id, the columns of its spans. [(minX, maxX, minZ, maxZ) * (maxRegions + 1)]
+  std::vector<int> m_regionBounds;
+  rcPolyMesh *m_pmesh{nullptr};
+  rcPolyMeshDetail *m_dmesh{nullptr};
+};
+
+/// The stages of a #TimeSlicedSoloMesh build, in the order they run.
+enum class SoloMeshStage {
+  Rasterize,
+  Filter,
+  BuildCompactHeightfield,
+  Erode,
+  MarkAreas,
+  BuildDistanceField,
+  BuildRegions,
+  BuildContours,
+  BuildPolyMesh,
+  BuildDetailMesh,
+  Done,
+  Failed
+};
+
+/// A solo mesh build that can be spread over several calls with a time budget each, e.g. one per frame.
+/// The stages are split into batches of triangles, heightfield rows, watershed levels, contours or polygons,
+/// through the time-sliced build functions of Recast for the stages after area marking. Only building the
+/// compact heightfield and eroding it run as a whole. A step overruns its budget by at most one batch. The
+/// build times accumulate in the context timers over all steps. The result is identical to a build in one call.
+class TimeSlicedSoloMesh {
+public:
+  TimeSlicedSoloMesh() = default;
+  ~TimeSlicedSoloMesh();
+  TimeSlicedSoloMesh(const TimeSlicedSoloMesh &) = delete;
+  TimeSlicedSoloMesh &operator=(const TimeSlicedSoloMesh &) = delete;
+
+  /// Prepares a new build. The geometry and volumes are not copied and must stay valid until the build is done.
+  void init(rcContext &context, const rcConfig &config, int filterFlags, const float *verts, int nverts, const int *tris, int ntris, const rcAreaVolume *volumes, int volumeCount, int detailBuildFlags = 0);
+
+  /// Runs build work until @p budgetMicroseconds have passed. At least one batch of work runs per call.
+  /// @returns True when the build is finished or has failed. (See: #getStage)
+  bool step(int budgetMicroseconds);
+
+  SoloMeshStage getStage() const { return m_stage; }
+  const rcPolyMesh *getPolyMesh() const { return m_stage == SoloMeshStage::Done ? m_pmesh : nullptr; }
+  const rcPolyMeshDetail *getPolyMeshDetail() const { return m_stage == SoloMeshStage::Done ? m_dmesh : nullptr; }
+
+private:
+  bool runBatch();
+  void freeIntermediates();
+
+  rcContext *m_context{nullptr};
+  rcConfig m_config{};
+  int m_filterFlags{};
+  int m_detailBuildFlags{};
+  const float *m_verts{nullptr};
+  int m_nverts{};
+  const int *m_tris{nullptr};
+  int m_ntris{};
+  const rcAreaVolume *m_volumes{nullptr};
+  int m_volumeCount{};
 
-bool generateSingle(rcContext& context, const InputGeom& pGeom, rcConfig& config, bool filterLowHangingObstacles, bool filterLedgeSpans, bool filterWalkableLowHeightSpans, rcPolyMesh*& pMesh, rcPolyMeshDetail*& pDetailedMesh);
+  SoloMeshStage m_stage{SoloMeshStage::Done};
+  // The next triangle, heightfield row or volume of the current batched stage.
+  int m_next{};
+  rcHeightfield *m_solid{nullptr};
+  rcCompactHeightfield *m_chf{nullptr};
+  rcContourSet *m_cset{nullptr};
+  rcPolyMesh *m_pmesh{nullptr};
+  rcPolyMeshDetail *m_dmesh{nullptr};
+  // The state of the time-sliced Recast build of the current stage, or null before the stage started.
+  rcDistanceFieldBuild *m_distanceFieldBuild{nullptr};
+  rcRegionsBuild *m_regionsBuild{nullptr};
+  rcContoursBuild *m_contoursBuild{nullptr};
+  rcPolyMeshBuild *m_polyMeshBuild{nullptr};
+  rcPolyMeshDetailBuild *m_detailBuild{nullptr};
+};
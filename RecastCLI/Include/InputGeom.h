@@ -19,6 +19,7 @@
 #ifndef INPUTGEOM_H
 #define INPUTGEOM_H
 
+#include <vector>
 #include "ChunkyTriMesh.h"
 #include "MeshLoaderObj.h"
 
@@ -69,11 +70,47 @@ struct BuildSettings
     float tileSize;
 };
 
+/// Settings of the input cleanup pass. (See: InputGeom::cleanupMesh)
+struct InputCleanupSettings
+{
+    // Vertices closer than this are welded into one. Triangles whose vertices weld together or
+    // that have no area left are dropped as degenerate. Zero only welds identical vertices. [Units: wu]
+    float weldDistance;
+    // Triangles whose bounds miss these bounds are culled. [(x, y, z)] [Units: wu]
+    float boundsMin[3];
+    float boundsMax[3];
+    // Cull the downward facing triangles that have no other geometry below them.
+    bool cullBackFaces;
+};
+
+/// The reduction achieved by the input cleanup pass.
+struct InputCleanupStats
+{
+    int inputVerts;
+    int inputTris;
+    // The number of vertices merged into another vertex.
+    int weldedVerts;
+    // The number of triangles dropped, per reason.
+    int degenerateTris;
+    int duplicateTris;
+    int outOfBoundsTris;
+    int backFaceTris;
+    int outputVerts;
+    int outputTris;
+};
+
 class InputGeom
 {
     rcChunkyTriMesh* m_chunkyMesh;
     rcMeshLoaderObj* m_mesh;
     float m_meshBMin[3], m_meshBMax[3];
+    /// The triangles of the chunks in groups of four, with the coordinates of each vertex stored per
+    /// axis, so that raycastMesh can test four triangles at a time. Built by the first raycastMesh after
+    /// the mesh is loaded or cleaned up, so builds that cast no rays do not hold them.
+    /// [(x, y, z) * 3 * 4 * numPackets]
+    std::vector<float> m_raycastPackets;
+    /// The first packet of each chunk in m_raycastPackets. [Size: m_chunkyMesh->nnodes]
+    std::vector<int> m_chunkPackets;
     BuildSettings m_buildSettings;
     bool m_hasBuildSettings;
 
@@ -98,6 +135,7 @@ class InputGeom
 
     bool loadMesh(class rcContext* ctx, const std::string& filepath);
     bool loadGeomSet(class rcContext* ctx, const std::string& filepath);
+    void buildRaycastPackets();
 public:
     InputGeom();
     ~InputGeom();
@@ -106,6 +144,19 @@ public:
     bool load(class rcContext* ctx, const std::string& filepath);
     bool saveGeomSet(const BuildSettings* settings);
 
+    /// Welds the vertices of the loaded mesh, drops its degenerate and duplicate triangles and culls
+    /// the triangles that cannot affect walkable spans, then rebuilds the chunky mesh.
+    ///
+    /// Welding moves vertices by up to the weld distance, and triangles are only dropped as degenerate
+    /// once they have no area, so thin triangles keep their spans. Duplicates must match in winding,
+    /// so both sides of a two-sided surface are kept.
+    ///
+    /// Triangles outside the bounds are skipped by the rasterizer anyway, so culling them does not
+    /// change the navigation mesh. A back face is only culled when no triangle that faces up or
+    /// sideways overlaps it from below, so it cannot be the ceiling of walkable space. The mesh
+    /// bounds are kept, so the build grid does not move.
+    bool cleanupMesh(class rcContext* ctx, const InputCleanupSettings& settings, InputCleanupStats& stats);
+
     /// Method to return static mesh data.
     const rcMeshLoaderObj* getMesh() const { return m_mesh; }
     const float* getMeshBoundsMin() const { return m_meshBMin; }
@@ -114,6 +165,9 @@ public:
     const float* getNavMeshBoundsMax() const { return m_hasBuildSettings ? m_buildSettings.navMeshBMax : m_meshBMax; }
     const rcChunkyTriMesh* getChunkyMesh() const { return m_chunkyMesh; }
     const BuildSettings* getBuildSettings() const { return m_hasBuildSettings ? &m_buildSettings : 0; }
+    /// Finds the closest hit of the segment with the mesh, as a fraction of the segment in @p tmin.
+    /// The first call after the mesh is loaded or cleaned up builds the raycast packets, so it must not
+    /// run concurrently with other calls.
     bool raycastMesh(const float * src, const float * dst, float& tmin);
 
     /// @name Off-Mesh connections.
@@ -28,6 +28,8 @@ public:
     ~rcMeshLoaderObj();
 
     bool load(const std::string& fileName);
+    /// Replaces the vertices and triangles of the mesh, and recalculates the normals.
+    void setGeometry(const float* verts, int vertCount, const int* tris, int triCount);
 
     const float* getVerts() const { return m_verts; }
     const float* getNormals() const { return m_normals; }
@@ -43,6 +45,7 @@ private:
 
     void addVertex(float x, float y, float z, int& cap);
     void addTriangle(int a, int b, int c, int& cap);
+    void calcNormals();
 
     std::string m_filename;
     float m_scale;
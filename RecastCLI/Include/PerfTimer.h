@@ -27,7 +27,7 @@ typedef __int64 TimeVal;
 #endif
 
 TimeVal getPerfTime();
-int getPerfTimeUsec(TimeVal duration);
+TimeVal getPerfTimeUsec(TimeVal duration);
 
 #endif // PERFTIMER_H
 
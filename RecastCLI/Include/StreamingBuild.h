@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2024.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "BuildCache.h"
+
+struct rcConfig;
+struct rcPolyMesh;
+struct rcPolyMeshDetail;
+class InputGeom;
+class rcContext;
+
+/// Settings of a streaming build.
+struct StreamingBuildSettings {
+  /// The width and depth of a window, excluding its border. [Units: vx]
+  int windowSize{256};
+  /// The smallest window a window that exceeds the memory cap is split into. [Units: vx]
+  int minWindowSize{32};
+  /// The number of times the cell size may be doubled in windows without geometry that needs fine cells, or 0 to build
+  /// every window with the configured cell size.
+  int adaptiveLevels{0};
+  /// The maximum number of bytes Recast may allocate at once through #rcAlloc, or 0 for no limit. The input geometry
+  /// and the CLI's own buffers of a window, such as its triangle areas, are not counted.
+  std::size_t memoryCap{0};
+  /// The filters to apply to the heightfield of each window. (See: #rcFilterSpanFlags)
+  int filterFlags{0};
+  /// The flags to build the detail meshes with. (See: #rcBuildPolyMeshDetailFlags)
+  int detailBuildFlags{0};
+  /// The existing directory the meshes of the windows are written to.
+  std::string outputDirectory{};
+  /// The directory of the build cache, or empty to build every window. (See: #BuildCache)
+  std::string cacheDirectory{};
+  /// The maximum size of the build cache in bytes, or 0 for no limit.
+  std::size_t cacheSizeLimit{0};
+};
+
+/// Statistics of a streaming build.
+struct StreamingBuildStats {
+  /// The number of windows that were built, including the empty ones.
+  int windowCount{};
+  /// The number of windows that were split because they exceeded the memory cap.
+  int splitCount{};
+  /// The number of windows that were built with a coarser cell size.
+  int coarseWindowCount{};
+  /// The number of heightfield columns of the windows that were built, including their borders.
+  std::size_t cellCount{};
+  /// The number of windows with polygons that were written to disk, including the ones taken from the cache.
+  int writtenCount{};
+  /// The total number of polygons of the windows that were built, excluding the ones taken from the cache.
+  int polyCount{};
+  /// The peak number of bytes allocated by Recast during the build.
+  std::size_t peakMemory{};
+  /// The hits, misses and evictions of the build cache.
+  BuildCacheStats cache{};
+};
+
+/// Builds the navigation mesh of the geometry window by window, so that only the heightfields of a single window
+/// are resident at a time. Each window is rasterized with a border of config.walkableRadius + 3 cells from the
+/// triangles the chunky mesh returns for it. The poly mesh and detail mesh of each window are written to
+/// "window_<x>_<z>.bin" in the output directory, where x and z are the cell coordinates of the window. The file of a
+/// window without polygons is removed, so that a rebuild leaves no stale windows behind.
+///
+/// Recast allocations are tracked during the build, on top of the allocator installed before it, so the function is
+/// not reentrant. A window that runs out of the memory cap is split into four smaller windows with its cell size, down
+/// to the minimum window size.
+///
+/// With adaptive levels, each window is the root of a quadtree. A window whose area, including its border, has no steep
+/// triangles, no walkable triangles that rise more than the walkable climb over one of its cells, no open edges of
+/// walkable triangles and no convex volumes is built with a coarser cell size, doubled once for every level it lies
+/// above the bottom of the quadtree. Any other window is split into quadrants down to the
+/// minimum window size, where it is built with the configured cell size. The settings counted in cells are scaled to
+/// the cell size of each window. The windows are built from the finest level up, and the vertices the finer
+/// neighbours of a coarser window have on their shared edges are inserted into its edges before it is written, so that
+/// the seams between levels have no T-junctions against the finer side. Such a window is written with the configured
+/// cell size, in which the inserted vertices lie on whole cells.
+///
+/// With a cache directory, a window whose inputs hash to an entry of the cache is copied from the cache instead of
+/// being built. Split windows are not cached themselves, only the windows they are split into.
+bool generateStreamed(rcContext &context, const InputGeom &pGeom, const rcConfig &config, const StreamingBuildSettings &settings, StreamingBuildStats &stats);
+
+/// Writes the meshes of a window in the format of #generateStreamed.
+bool writeStreamedWindow(const std::string &filePath, const rcPolyMesh &mesh, const rcPolyMeshDetail &detailMesh);
+
+/// Reads a window written by #generateStreamed.
+bool loadStreamedWindow(rcContext &context, const std::string &filePath, rcPolyMesh &mesh, rcPolyMeshDetail &detailMesh);
@@ -0,0 +1,129 @@
+//
+// Copyright (c) 2024.
+//
+
+#include "BuildCache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+void BuildCacheKey::add(const void *data, const std::size_t size) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (std::size_t i = 0; i < size; ++i) {
+    m_hash ^= bytes[i];
+    m_hash *= 1099511628211ull;
+  }
+}
+
+std::string BuildCacheKey::toString() const {
+  static const char digits[] = "0123456789abcdef";
+  std::string name(16, '0');
+  for (int i = 0; i < 16; ++i)
+    name[15 - i] = digits[(m_hash >> (i * 4)) & 0xf];
+  return name;
+}
+
+bool BuildCache::open(const std::string &directory, const std::size_t sizeLimit) {
+  std::error_code error;
+  fs::create_directories(directory, error);
+  if (!fs::is_directory(directory, error))
+    return false;
+
+  m_directory = directory;
+  m_sizeLimit = sizeLimit;
+  m_totalSize = 0;
+  m_entries.clear();
+  m_stats = BuildCacheStats{};
+
+  // Entries are touched on every use, so their modification times order them from the least to the most recently used.
+  std::vector<std::pair<fs::file_time_type, std::string>> files;
+  for (const fs::directory_entry &file : fs::directory_iterator(directory, error)) {
+    const std::string name = file.path().filename().string();
+    if (file.is_regular_file(error) && name.size() == 16)
+      files.emplace_back(file.last_write_time(error), name);
+  }
+  std::sort(files.begin(), files.end());
+  m_useCounter = 0;
+  for (const auto &file : files) {
+    Entry &entry = m_entries[file.second];
+    entry.size = static_cast<std::size_t>(fs::file_size(fs::path{m_directory} / file.second, error));
+    entry.lastUse = ++m_useCounter;
+    m_totalSize += entry.size;
+  }
+  evict();
+  return true;
+}
+
+bool BuildCache::fetch(const BuildCacheKey &key, const std::string &outputPath, bool &hasOutput) {
+  const std::string name = key.toString();
+  const auto it = m_entries.find(name);
+  if (it == m_entries.end()) {
+    m_stats.misses++;
+    return false;
+  }
+
+  std::error_code error;
+  const fs::path entryPath = fs::path{m_directory} / name;
+  hasOutput = it->second.size != 0;
+  if (hasOutput && !fs::copy_file(entryPath, outputPath, fs::copy_options::overwrite_existing, error)) {
+    m_stats.misses++;
+    return false;
+  }
+  fs::last_write_time(entryPath, fs::file_time_type::clock::now(), error);
+  it->second.lastUse = ++m_useCounter;
+  m_stats.hits++;
+  return true;
+}
+
+bool BuildCache::store(const BuildCacheKey &key, const std::string &outputPath) {
+  const std::string name = key.toString();
+  const fs::path entryPath = fs::path{m_directory} / name;
+  const fs::path tempPath = fs::path{m_directory} / (name + ".tmp");
+
+  // Write the entry under a temporary name first, so that an interrupted store never leaves a partial entry behind.
+  std::error_code error;
+  if (outputPath.empty()) {
+    std::ofstream{tempPath};
+  } else if (!fs::copy_file(outputPath, tempPath, fs::copy_options::overwrite_existing, error)) {
+    return false;
+  }
+  fs::rename(tempPath, entryPath, error);
+  if (error) {
+    fs::remove(tempPath, error);
+    return false;
+  }
+
+  Entry &entry = m_entries[name];
+  m_totalSize -= entry.size;
+  entry.size = static_cast<std::size_t>(fs::file_size(entryPath, error));
+  entry.lastUse = ++m_useCounter;
+  m_totalSize += entry.size;
+  evict();
+  return true;
+}
+
+void BuildCache::evict() {
+  if (m_sizeLimit == 0 || m_totalSize <= m_sizeLimit)
+    return;
+
+  std::vector<std::pair<std::uint64_t, std::string>> byUse;
+  byUse.reserve(m_entries.size());
+  for (const auto &entry : m_entries)
+    byUse.emplace_back(entry.second.lastUse, entry.first);
+  std::sort(byUse.begin(), byUse.end());
+
+  std::error_code error;
+  for (const auto &use : byUse) {
+    if (m_totalSize <= m_sizeLimit)
+      break;
+    fs::remove(fs::path{m_directory} / use.second, error);
+    m_totalSize -= m_entries[use.second].size;
+    m_entries.erase(use.second);
+    m_stats.evictions++;
+  }
+}
@@ -1,32 +1,238 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdarg>
+#include <cstdlib>
 #include <cstring>
 
 #include "BuildContext.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include "Recast.h"
 #include "PerfTimer.h"
 
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// The index of this thread in the running parallelFor, 0 for the calling thread. It picks the arena of the thread
+// and identifies the thread in the trace.
+thread_local int t_threadIndex = 0;
+// Whether this thread is running the work of a parallelFor. A parallelFor started from inside one runs serially on
+// the thread, so it keeps using the arena of that thread.
+thread_local bool t_inParallelFor = false;
+
+int getTempArenaIndex() {
+    return t_threadIndex;
+}
+
+// The running timers of this thread with their start times, innermost last. Allocations are attributed to the
+// innermost one, or to NO_TIMER outside of timers. The workers of a parallelFor take over the innermost timer of
+// the calling thread.
+struct RunningTimer {
+    int label;
+    TimeVal start;
+    std::int64_t counters[PERF_MAX_COUNTERS]{};
+};
+const int NO_TIMER = RC_MAX_TIMERS;
+const int MAX_TIMER_DEPTH = 64;
+thread_local RunningTimer t_timerStack[MAX_TIMER_DEPTH];
+thread_local int t_timerDepth = 0;
+
+int getInnermostTimer() {
+    return t_timerDepth > 0 ? t_timerStack[t_timerDepth - 1].label : NO_TIMER;
+}
+
+const char *const TIMER_NAMES[RC_MAX_TIMERS] = {
+    "Total",
+    "Temp",
+    "Rasterize Triangles",
+    "Build Compact Height Field",
+    "Build Contours",
+    "Build Contours Trace",
+    "Build Contours Simplify",
+    "Filter Border",
+    "Filter Walkable",
+    "Median Area",
+    "Filter Low Obstacles",
+    "Build Polymesh",
+    "Merge Polymeshes",
+    "Erode Area",
+    "Mark Box Area",
+    "Mark Cylinder Area",
+    "Mark Convex Area",
+    "Build Distance Field",
+    "Build Distance Field Distance",
+    "Build Distance Field Blur",
+    "Build Regions",
+    "Build Regions Watershed",
+    "Build Regions Expand",
+    "Build Regions Flood",
+    "Build Regions Filter",
+    "Build Layers",
+    "Build Polymesh Detail",
+    "Merge Polymesh Details",
+    "Mark Area Volumes",
+    "Filter Spans",
+};
+
+// Tracked blocks are prefixed with their size, hint, timer and thread, so that a free knows what to subtract from.
+struct AllocationHeader {
+    std::size_t size;
+    int hint;
+    int timer;
+    int thread;
+};
+const std::size_t ALLOCATION_HEADER_SIZE = 32;
+static_assert(sizeof(AllocationHeader) <= ALLOCATION_HEADER_SIZE, "The header must keep the alignment of malloc.");
+
+// Threads past the last tracked one share its counters.
+const int MAX_TRACKED_THREADS = 64;
+
+struct MemoryCounters {
+    std::atomic<std::size_t> current{0};
+    // The highest bytes in use by the whole build, and by this thread alone, at one of the allocations.
+    std::atomic<std::size_t> peak{0};
+    std::atomic<std::size_t> threadPeak{0};
+    std::atomic<int> allocCount{0};
+};
+MemoryCounters s_memory[MAX_TRACKED_THREADS][RC_MAX_TIMERS + 1][2];
+std::atomic<std::size_t> s_liveBytes[2];
+std::atomic<std::size_t> s_threadLiveBytes[MAX_TRACKED_THREADS][2];
+bool s_memoryTracking = false;
+
+void raisePeak(std::atomic<std::size_t> &peak, const std::size_t live) {
+    std::size_t current = peak.load();
+    while (live > current && !peak.compare_exchange_weak(current, live)) {
+    }
+}
+
+void *allocTracked(const size_t size, const rcAllocHint hint) {
+    unsigned char *block = static_cast<unsigned char *>(std::malloc(size + ALLOCATION_HEADER_SIZE));
+    if (!block)
+        return nullptr;
+    const AllocationHeader header{size, hint == RC_ALLOC_TEMP ? 1 : 0, getInnermostTimer(), std::min(t_threadIndex, MAX_TRACKED_THREADS - 1)};
+    std::memcpy(block, &header, sizeof(header));
+
+    const std::size_t live = s_liveBytes[header.hint].fetch_add(size) + size;
+    const std::size_t threadLive = s_threadLiveBytes[header.thread][header.hint].fetch_add(size) + size;
+    MemoryCounters &counters = s_memory[header.thread][header.timer][header.hint];
+    counters.current += size;
+    counters.allocCount++;
+    raisePeak(counters.peak, live);
+    raisePeak(counters.threadPeak, threadLive);
+    return block + ALLOCATION_HEADER_SIZE;
+}
+
+// Blocks freed by another thread still count towards the thread that allocated them.
+void freeTracked(void *ptr) {
+    unsigned char *block = static_cast<unsigned char *>(ptr) - ALLOCATION_HEADER_SIZE;
+    AllocationHeader header;
+    std::memcpy(&header, block, sizeof(header));
+    s_liveBytes[header.hint] -= header.size;
+    s_threadLiveBytes[header.thread][header.hint] -= header.size;
+    s_memory[header.thread][header.timer][header.hint].current -= header.size;
+    std::free(block);
+}
+
+// Sums the usage of all threads. The peak of the whole build is the highest one any thread saw.
+void getMemoryUsage(const int label, const int hint, rcMemoryUsage &usage) {
+    usage.currentBytes = 0;
+    usage.peakBytes = 0;
+    usage.allocCount = 0;
+    for (const MemoryCounters (&threadCounters)[RC_MAX_TIMERS + 1][2] : s_memory) {
+        const MemoryCounters &counters = threadCounters[label][hint];
+        usage.currentBytes += counters.current;
+        usage.peakBytes = std::max<std::size_t>(usage.peakBytes, counters.peak);
+        usage.allocCount += counters.allocCount;
+    }
+}
+
+void getThreadMemoryUsage(const MemoryCounters &counters, rcMemoryUsage &usage) {
+    usage.currentBytes = counters.current;
+    usage.peakBytes = counters.threadPeak;
+    usage.allocCount = counters.allocCount;
+}
+
+// Opens a counter of the calling thread that includes the threads it creates later, or returns -1.
+int openPerfCounter(const PerfCounter counter) {
+#if defined(__linux__)
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // The kernel multiplexes the counters when there are more than the hardware has, so read how long each one ran.
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    switch (counter) {
+    case PERF_CYCLES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PERF_INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PERF_L1D_READ_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        break;
+    case PERF_LLC_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    default:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    }
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+    (void)counter;
+    return -1;
+#endif
+}
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 BuildContext::BuildContext() : m_messageCount(0),
-                               m_textPoolSize(0) {
+                               m_textPoolSize(0),
+                               m_maxThreads(1),
+                               m_tempArenaCount(0) {
   std::memset(m_messages, 0, sizeof(char *) * MAX_MESSAGES);
+  std::fill(m_perfCounters, m_perfCounters + PERF_MAX_COUNTERS, -1);
 
   resetTimers();
 }
 
+BuildContext::~BuildContext() {
+  setTempArenaSize(0);
+#if defined(__linux__)
+  for (const int fd : m_perfCounters) {
+    if (fd >= 0)
+      close(fd);
+  }
+#endif
+}
+
 // Virtual functions for custom implementations.
 void BuildContext::doResetLog() {
+    std::lock_guard<std::mutex> lock(m_logMutex);
     m_messageCount = 0;
     m_textPoolSize = 0;
 }
 
 void BuildContext::doLog(const rcLogCategory category, const char *msg, const int len) {
     if (!len) return;
+    std::lock_guard<std::mutex> lock(m_logMutex);
     if (m_messageCount >= MAX_MESSAGES)
         return;
     char *dst = &m_textPool[m_textPoolSize];
@@ -47,26 +253,235 @@ void BuildContext::doLog(const rcLogCategory category, const char *msg, const in
 }
 
 void BuildContext::doResetTimers() {
+    std::lock_guard<std::mutex> lock(m_timerMutex);
     for (int i = 0; i < RC_MAX_TIMERS; ++i) {
         m_accTime[i] = -1ll;
     }
+    // Blocks that are still in use keep counting towards the current bytes of their timer.
+    for (MemoryCounters (&threadCounters)[RC_MAX_TIMERS + 1][2] : s_memory) {
+        for (MemoryCounters (&timerCounters)[2] : threadCounters) {
+            for (MemoryCounters &counters : timerCounters) {
+                counters.peak = 0;
+                counters.threadPeak = 0;
+                counters.allocCount = 0;
+            }
+        }
+    }
+    std::memset(m_accPerfCounters, 0, sizeof(m_accPerfCounters));
 }
 
 void BuildContext::doStartTimer(const rcTimerLabel label) {
-    m_startTime[label] = getPerfTime();
+    if (t_timerDepth >= MAX_TIMER_DEPTH)
+        return;
+    RunningTimer &timer = t_timerStack[t_timerDepth++];
+    timer.label = label;
+    // The counters belong to the calling thread, the workers are included through it.
+    if (m_perfEnabled && t_threadIndex == 0)
+        readPerfCounters(timer.counters);
+    else
+        std::fill(timer.counters, timer.counters + PERF_MAX_COUNTERS, -1);
+    timer.start = getPerfTime();
 }
 
 void BuildContext::doStopTimer(const rcTimerLabel label) {
     const TimeVal endTime = getPerfTime();
-    const TimeVal deltaTime = endTime - m_startTime[label];
-    if (m_accTime[label] == -1)
-        m_accTime[label] = deltaTime;
-    else
-        m_accTime[label] += deltaTime;
+    int index = t_timerDepth - 1;
+    while (index >= 0 && t_timerStack[index].label != label)
+        index--;
+    if (index < 0)
+        return;
+    const TimeVal startTime = t_timerStack[index].start;
+    std::int64_t counters[PERF_MAX_COUNTERS];
+    if (m_perfEnabled && t_threadIndex == 0) {
+        readPerfCounters(counters);
+        for (int i = 0; i < PERF_MAX_COUNTERS; ++i)
+            counters[i] = counters[i] >= 0 && t_timerStack[index].counters[i] >= 0 ? counters[i] - t_timerStack[index].counters[i] : 0;
+    } else {
+        std::fill(counters, counters + PERF_MAX_COUNTERS, 0);
+    }
+    std::copy(t_timerStack + index + 1, t_timerStack + t_timerDepth, t_timerStack + index);
+    t_timerDepth--;
+
+    // A timer nested in a running timer with the same label is already part of the outer one.
+    bool nested = false;
+    for (int i = 0; i < index && !nested; ++i)
+        nested = t_timerStack[i].label == label;
+
+    std::lock_guard<std::mutex> lock(m_timerMutex);
+    if (!nested) {
+        if (m_accTime[label] == -1)
+            m_accTime[label] = endTime - startTime;
+        else
+            m_accTime[label] += endTime - startTime;
+        for (int i = 0; i < PERF_MAX_COUNTERS; ++i)
+            m_accPerfCounters[label][i] += counters[i];
+    }
+    if (m_tracing)
+        m_traceEvents.push_back(TraceEvent{label, t_threadIndex, false, startTime, endTime});
 }
 
 int BuildContext::doGetAccumulatedTime(const rcTimerLabel label) const {
-    return getPerfTimeUsec(m_accTime[label]);
+    std::lock_guard<std::mutex> lock(m_timerMutex);
+    return static_cast<int>(getPerfTimeUsec(m_accTime[label]));
+}
+
+bool BuildContext::enablePerfCounters() {
+    bool opened = false;
+    for (int i = 0; i < PERF_MAX_COUNTERS; ++i) {
+        if (m_perfCounters[i] < 0)
+            m_perfCounters[i] = openPerfCounter(static_cast<PerfCounter>(i));
+        opened |= m_perfCounters[i] >= 0;
+    }
+    m_perfEnabled = opened;
+    return opened;
+}
+
+void BuildContext::readPerfCounters(std::int64_t *values) const {
+    for (int i = 0; i < PERF_MAX_COUNTERS; ++i) {
+        values[i] = -1;
+#if defined(__linux__)
+        // The value, the time the counter was enabled and the time it was running, in nanoseconds.
+        std::uint64_t data[3];
+        if (m_perfCounters[i] >= 0 && read(m_perfCounters[i], data, sizeof(data)) == sizeof(data)) {
+            // Extrapolate a multiplexed counter to the whole time it was enabled.
+            if (data[2] != 0 && data[2] < data[1])
+                data[0] = static_cast<std::uint64_t>(static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]));
+            values[i] = data[2] != 0 ? static_cast<std::int64_t>(data[0]) : 0;
+        }
+#endif
+    }
+}
+
+bool BuildContext::getPerfCounter(const rcTimerLabel label, const PerfCounter counter, std::int64_t &value) const {
+    std::lock_guard<std::mutex> lock(m_timerMutex);
+    if (m_perfCounters[counter] < 0 || m_accTime[label] == -1)
+        return false;
+    value = m_accPerfCounters[label][counter];
+    return true;
+}
+
+void BuildContext::enableTrace() {
+    std::lock_guard<std::mutex> lock(m_timerMutex);
+    m_tracing = true;
+    m_traceEvents.clear();
+    m_traceStart = getPerfTime();
+}
+
+bool BuildContext::writeTrace(const char *filePath) const {
+    FILE *file = std::fopen(filePath, "w");
+    if (!file)
+        return false;
+    std::lock_guard<std::mutex> lock(m_timerMutex);
+    std::fprintf(file, "{\"traceEvents\":[\n");
+    for (int thread = 0; thread < m_maxThreads; ++thread)
+        std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}},\n", thread, thread == 0 ? "Calling thread" : "Worker", thread);
+    for (std::size_t i = 0; i < m_traceEvents.size(); ++i) {
+        const TraceEvent &event = m_traceEvents[i];
+        std::fprintf(file, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}%s\n",
+                     TIMER_NAMES[event.label], event.work ? "work" : "timer", event.thread, static_cast<long long>(getPerfTimeUsec(event.begin - m_traceStart)),
+                     static_cast<long long>(getPerfTimeUsec(event.end - event.begin)), i + 1 < m_traceEvents.size() ? "," : "");
+    }
+    std::fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+    return std::fclose(file) == 0;
+}
+
+bool BuildContext::doGetMemoryStats(const rcTimerLabel label, rcMemoryStats &stats) const {
+    if (!s_memoryTracking)
+        return false;
+    getMemoryUsage(label, 0, stats.perm);
+    getMemoryUsage(label, 1, stats.temp);
+    return true;
+}
+
+bool BuildContext::getThreadMemoryStats(const rcTimerLabel label, const int threadIndex, rcMemoryStats &stats) const {
+    if (!s_memoryTracking || !m_timerEnabled || threadIndex < 0 || threadIndex >= MAX_TRACKED_THREADS)
+        return false;
+    getThreadMemoryUsage(s_memory[threadIndex][label][0], stats.perm);
+    getThreadMemoryUsage(s_memory[threadIndex][label][1], stats.temp);
+    return true;
+}
+
+void BuildContext::enableMemoryTracking() {
+    rcAllocSetCustom(allocTracked, freeTracked);
+    s_memoryTracking = true;
+}
+
+void BuildContext::setMaxThreads(const int maxThreads) {
+    m_maxThreads = maxThreads > 0 ? maxThreads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+bool BuildContext::setTempArenaSize(const std::size_t bytesPerThread) {
+    rcAllocSetArenas(nullptr, 0, nullptr);
+    m_tempArenas.reset();
+    m_tempArenaCount = 0;
+    if (bytesPerThread == 0)
+        return true;
+
+    m_tempArenas.reset(new rcArena[m_maxThreads]);
+    for (int i = 0; i < m_maxThreads; ++i) {
+        if (!m_tempArenas[i].init(bytesPerThread)) {
+            m_tempArenas.reset();
+            return false;
+        }
+    }
+    m_tempArenaCount = m_maxThreads;
+    rcAllocSetArenas(m_tempArenas.get(), m_tempArenaCount, getTempArenaIndex);
+    return true;
+}
+
+void BuildContext::resetTempArenas() {
+    for (int i = 0; i < m_tempArenaCount; ++i)
+        m_tempArenas[i].reset();
+}
+
+int BuildContext::doGetMaxThreads() const {
+    return m_maxThreads;
+}
+
+void BuildContext::doParallelFor(const int count, rcParallelForFunc *func, void *userData) {
+    if (t_inParallelFor) {
+        if (count > 0)
+            func(userData, 0, count, t_threadIndex);
+        return;
+    }
+
+    const int threadCount = std::min(m_maxThreads, count);
+    // Hand out small batches so threads that draw cheap items pick up more work.
+    const int batchSize = std::max(1, count / (threadCount * 8));
+    const int timer = getInnermostTimer();
+    std::atomic<int> nextItem{0};
+    const auto worker = [&](const int threadIndex) {
+        const int previousThreadIndex = t_threadIndex;
+        t_threadIndex = threadIndex;
+        t_inParallelFor = true;
+        const TimeVal startTime = getPerfTime();
+        if (threadIndex != 0 && timer != NO_TIMER) {
+            t_timerStack[0] = RunningTimer{timer, startTime};
+            t_timerDepth = 1;
+        }
+        for (;;) {
+            const int begin = nextItem.fetch_add(batchSize);
+            if (begin >= count)
+                break;
+            func(userData, begin, std::min(begin + batchSize, count), threadIndex);
+        }
+        // The work of each thread shows up in the trace below the timer that started the parallelFor.
+        if (m_tracing && timer != NO_TIMER) {
+            const TimeVal endTime = getPerfTime();
+            std::lock_guard<std::mutex> lock(m_timerMutex);
+            m_traceEvents.push_back(TraceEvent{timer, threadIndex, true, startTime, endTime});
+        }
+        t_inParallelFor = false;
+        t_threadIndex = previousThreadIndex;
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (int i = 1; i < threadCount; ++i)
+        threads.emplace_back(worker, i);
+    worker(0);
+    for (std::thread &thread : threads)
+        thread.join();
 }
 
 void BuildContext::dumpLog(const char *format, ...) const {
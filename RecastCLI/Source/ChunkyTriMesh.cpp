@@ -20,6 +20,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
 
 struct BoundsItem
 {
@@ -28,30 +31,20 @@ struct BoundsItem
     int i;
 };
 
-static int compareItemX(const void* va, const void* vb)
-{
-    const BoundsItem* a = static_cast<const BoundsItem *>(va);
-    const BoundsItem* b = static_cast<const BoundsItem *>(vb);
-    if (a->bmin[0] < b->bmin[0])
-        return -1;
-    if (a->bmin[0] > b->bmin[0])
-        return 1;
-    return 0;
-}
+// The number of bins the centroids are sorted into along each axis to find the split with the lowest cost.
+static const int SAH_BINS = 16;
+// Subtrees with at least this many triangles are built on their own thread.
+static const int PARALLEL_BUILD_MIN_TRIS = 16384;
 
-static int compareItemY(const void* va, const void* vb)
+/// The nodes and triangles of a subtree. The triangle offsets of its leaves are relative to
+/// the subtree, so that subtrees built on other threads can be appended to their parent.
+struct ChunkyTree
 {
-    const BoundsItem* a = static_cast<const BoundsItem *>(va);
-    const BoundsItem* b = static_cast<const BoundsItem *>(vb);
-    if (a->bmin[1] < b->bmin[1])
-        return -1;
-    if (a->bmin[1] > b->bmin[1])
-        return 1;
-    return 0;
-}
+    std::vector<rcChunkyTriMeshNode> nodes;
+    std::vector<int> tris;
+};
 
-static void calcExtends(const BoundsItem* items, const int /*nitems*/,
-                        const int imin, const int imax,
+static void calcExtends(const BoundsItem* items, const int imin, const int imax,
                         float* bmin, float* bmax)
 {
     bmin[0] = items[imin].bmin[0];
@@ -76,89 +69,175 @@ inline int longestAxis(float x, float y)
     return y > x ? 1 : 0;
 }
 
-static void subdivide(BoundsItem* items, int nitems, int imin, int imax, int trisPerChunk,
-                      int& curNode, rcChunkyTriMeshNode* nodes, const int maxNodes,
-                      int& curTri, int* outTris, const int* inTris)
+inline float centroid(const BoundsItem& it, const int axis)
 {
-    int inum = imax - imin;
-    int icur = curNode;
+    return (it.bmin[axis] + it.bmax[axis]) * 0.5f;
+}
 
-    if (curNode >= maxNodes)
-        return;
+/// Partitions the items at the split with the lowest surface area heuristic cost. The queries are
+/// rectangles and segments on the xz-plane, so the cost of a child is its triangle count times the
+/// half perimeter of its bounds. Falls back to a median split when all centroids share a bin.
+/// @returns The index of the first item of the right child.
+static int splitItems(BoundsItem* items, const int imin, const int imax, const float* bmin, const float* bmax)
+{
+    float cmin[2] = { centroid(items[imin], 0), centroid(items[imin], 1) };
+    float cmax[2] = { cmin[0], cmin[1] };
+    for (int i = imin+1; i < imax; ++i)
+    {
+        for (int axis = 0; axis < 2; ++axis)
+        {
+            const float c = centroid(items[i], axis);
+            if (c < cmin[axis]) cmin[axis] = c;
+            if (c > cmax[axis]) cmax[axis] = c;
+        }
+    }
+
+    float bestCost = 0.0f;
+    int bestAxis = -1;
+    int bestBin = 0;
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        const float extent = cmax[axis] - cmin[axis];
+        if (extent <= 0.0f)
+            continue;
+        const float scale = SAH_BINS / extent;
+
+        int counts[SAH_BINS] = {};
+        float binMin[SAH_BINS][2], binMax[SAH_BINS][2];
+        for (int b = 0; b < SAH_BINS; ++b)
+        {
+            binMin[b][0] = binMin[b][1] = 1e30f;
+            binMax[b][0] = binMax[b][1] = -1e30f;
+        }
+        for (int i = imin; i < imax; ++i)
+        {
+            const BoundsItem& it = items[i];
+            const int b = std::min((int)((centroid(it, axis) - cmin[axis]) * scale), SAH_BINS-1);
+            counts[b]++;
+            for (int k = 0; k < 2; ++k)
+            {
+                binMin[b][k] = std::min(binMin[b][k], it.bmin[k]);
+                binMax[b][k] = std::max(binMax[b][k], it.bmax[k]);
+            }
+        }
 
-    rcChunkyTriMeshNode& node = nodes[curNode++];
+        // Sweep from the right to get the cost of every right side, then from the left to combine.
+        float rightCost[SAH_BINS];
+        float rmin[2] = { 1e30f, 1e30f }, rmax[2] = { -1e30f, -1e30f };
+        int rightCount = 0;
+        for (int b = SAH_BINS-1; b > 0; --b)
+        {
+            rightCount += counts[b];
+            for (int k = 0; k < 2; ++k)
+            {
+                rmin[k] = std::min(rmin[k], binMin[b][k]);
+                rmax[k] = std::max(rmax[k], binMax[b][k]);
+            }
+            rightCost[b] = rightCount ? rightCount * ((rmax[0]-rmin[0]) + (rmax[1]-rmin[1])) : 0.0f;
+        }
+        float lmin[2] = { 1e30f, 1e30f }, lmax[2] = { -1e30f, -1e30f };
+        int leftCount = 0;
+        for (int b = 0; b < SAH_BINS-1; ++b)
+        {
+            leftCount += counts[b];
+            for (int k = 0; k < 2; ++k)
+            {
+                lmin[k] = std::min(lmin[k], binMin[b][k]);
+                lmax[k] = std::max(lmax[k], binMax[b][k]);
+            }
+            if (leftCount == 0 || leftCount == imax-imin)
+                continue;
+            const float cost = leftCount * ((lmax[0]-lmin[0]) + (lmax[1]-lmin[1])) + rightCost[b+1];
+            if (bestAxis == -1 || cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    if (bestAxis == -1)
+    {
+        const int axis = longestAxis(bmax[0] - bmin[0], bmax[1] - bmin[1]);
+        const int isplit = imin + (imax-imin)/2;
+        std::nth_element(items+imin, items+isplit, items+imax, [axis](const BoundsItem& a, const BoundsItem& b) {
+            return a.bmin[axis] < b.bmin[axis];
+        });
+        return isplit;
+    }
+
+    const float scale = SAH_BINS / (cmax[bestAxis] - cmin[bestAxis]);
+    const float origin = cmin[bestAxis];
+    BoundsItem* mid = std::partition(items+imin, items+imax, [bestAxis, bestBin, scale, origin](const BoundsItem& it) {
+        return std::min((int)((centroid(it, bestAxis) - origin) * scale), SAH_BINS-1) <= bestBin;
+    });
+    return (int)(mid - items);
+}
+
+static void subdivide(BoundsItem* items, const int imin, const int imax, const int trisPerChunk,
+                      const int* inTris, ChunkyTree& tree, const int parallelDepth)
+{
+    const int inum = imax - imin;
+    const int icur = (int)tree.nodes.size();
+    tree.nodes.push_back(rcChunkyTriMeshNode());
+    calcExtends(items, imin, imax, tree.nodes[icur].bmin, tree.nodes[icur].bmax);
 
     if (inum <= trisPerChunk)
     {
         // Leaf
-        calcExtends(items, nitems, imin, imax, node.bmin, node.bmax);
+        tree.nodes[icur].i = (int)tree.tris.size()/3;
+        tree.nodes[icur].n = inum;
 
         // Copy triangles.
-        node.i = curTri;
-        node.n = inum;
-
         for (int i = imin; i < imax; ++i)
         {
             const int* src = &inTris[items[i].i*3];
-            int* dst = &outTris[curTri*3];
-            curTri++;
-            dst[0] = src[0];
-            dst[1] = src[1];
-            dst[2] = src[2];
+            tree.tris.insert(tree.tris.end(), src, src+3);
         }
+        return;
     }
-    else
-    {
-        // Split
-        calcExtends(items, nitems, imin, imax, node.bmin, node.bmax);
 
-        int	axis = longestAxis(node.bmax[0] - node.bmin[0],
-                                  node.bmax[1] - node.bmin[1]);
+    // Split
+    const float bmin[2] = { tree.nodes[icur].bmin[0], tree.nodes[icur].bmin[1] };
+    const float bmax[2] = { tree.nodes[icur].bmax[0], tree.nodes[icur].bmax[1] };
+    const int isplit = splitItems(items, imin, imax, bmin, bmax);
 
-        if (axis == 0)
-        {
-            // Sort along x-axis
-            qsort(items+imin, static_cast<size_t>(inum), sizeof(BoundsItem), compareItemX);
-        }
-        else if (axis == 1)
+    if (parallelDepth > 0 && inum >= PARALLEL_BUILD_MIN_TRIS)
+    {
+        // Build the right child on another thread and append it after the left one.
+        ChunkyTree right;
+        std::thread worker([&]() { subdivide(items, isplit, imax, trisPerChunk, inTris, right, parallelDepth-1); });
+        subdivide(items, imin, isplit, trisPerChunk, inTris, tree, parallelDepth-1);
+        worker.join();
+
+        const int triOffset = (int)tree.tris.size()/3;
+        for (rcChunkyTriMeshNode node : right.nodes)
         {
-            // Sort along y-axis
-            qsort(items+imin, static_cast<size_t>(inum), sizeof(BoundsItem), compareItemY);
+            if (node.i >= 0)
+                node.i += triOffset;
+            tree.nodes.push_back(node);
         }
-
-        int isplit = imin+inum/2;
-
+        tree.tris.insert(tree.tris.end(), right.tris.begin(), right.tris.end());
+    }
+    else
+    {
         // Left
-        subdivide(items, nitems, imin, isplit, trisPerChunk, curNode, nodes, maxNodes, curTri, outTris, inTris);
+        subdivide(items, imin, isplit, trisPerChunk, inTris, tree, parallelDepth);
         // Right
-        subdivide(items, nitems, isplit, imax, trisPerChunk, curNode, nodes, maxNodes, curTri, outTris, inTris);
-
-        int iescape = curNode - icur;
-        // Negative index means escape.
-        node.i = -iescape;
+        subdivide(items, isplit, imax, trisPerChunk, inTris, tree, parallelDepth);
     }
+
+    const int iescape = (int)tree.nodes.size() - icur;
+    // Negative index means escape.
+    tree.nodes[icur].i = -iescape;
 }
 
 bool rcCreateChunkyTriMesh(const float* verts, const int* tris, int ntris,
-                           int trisPerChunk, rcChunkyTriMesh* cm)
+                           int trisPerChunk, rcChunkyTriMesh* cm, int maxThreads)
 {
-    int nchunks = (ntris + trisPerChunk-1) / trisPerChunk;
-
-    cm->nodes = new rcChunkyTriMeshNode[nchunks*4];
-    if (!cm->nodes)
-        return false;
-
-    cm->tris = new int[ntris*3];
-    if (!cm->tris)
-        return false;
-
-    cm->ntris = ntris;
-
     // Build tree
-    BoundsItem* items = new BoundsItem[ntris];
-    if (!items)
-        return false;
-
+    std::vector<BoundsItem> items(ntris);
     for (int i = 0; i < ntris; i++)
     {
         const int* t = &tris[i*3];
@@ -178,13 +257,29 @@ bool rcCreateChunkyTriMesh(const float* verts, const int* tris, int ntris,
         }
     }
 
-    int curTri = 0;
-    int curNode = 0;
-    subdivide(items, ntris, 0, ntris, trisPerChunk, curNode, cm->nodes, nchunks*4, curTri, cm->tris, tris);
+    // Split the work over the threads by building the subtrees of the top levels in parallel.
+    int parallelDepth = 0;
+    for (unsigned int threads = maxThreads > 0 ? (unsigned int)maxThreads : std::thread::hardware_concurrency(); threads > 1; threads /= 2)
+        parallelDepth++;
+
+    ChunkyTree tree;
+    tree.nodes.reserve((ntris + trisPerChunk-1) / trisPerChunk * 4);
+    tree.tris.reserve(ntris*3);
+    if (ntris > 0)
+        subdivide(items.data(), 0, ntris, trisPerChunk, tris, tree, parallelDepth);
+
+    cm->nodes = new rcChunkyTriMeshNode[tree.nodes.size()];
+    if (!cm->nodes)
+        return false;
 
-    delete [] items;
+    cm->tris = new int[ntris*3];
+    if (!cm->tris)
+        return false;
 
-    cm->nnodes = curNode;
+    std::copy(tree.nodes.begin(), tree.nodes.end(), cm->nodes);
+    std::copy(tree.tris.begin(), tree.tris.end(), cm->tris);
+    cm->ntris = ntris;
+    cm->nnodes = (int)tree.nodes.size();
 
     // Calc max tris per node.
     cm->maxTrisPerChunk = 0;
@@ -246,31 +341,45 @@ int rcGetChunksOverlappingRect(const rcChunkyTriMesh* cm,
 
 
 
-static bool checkOverlapSegment(const float p[2], const float q[2],
-                                const float bmin[2], const float bmax[2])
+/// A segment on the xz-plane, prepared for repeated slab tests.
+struct SegmentSlabs
+{
+    float p[2];
+    float ood[2];
+    bool parallel[2];
+};
+
+static void initSegmentSlabs(const float p[2], const float q[2], SegmentSlabs& seg)
 {
     static const float EPSILON = 1e-6f;
 
+    for (int i = 0; i < 2; i++)
+    {
+        const float d = q[i] - p[i];
+        seg.p[i] = p[i];
+        seg.parallel[i] = fabsf(d) < EPSILON;
+        seg.ood[i] = seg.parallel[i] ? 0.0f : 1.0f / d;
+    }
+}
+
+static bool checkOverlapSegment(const SegmentSlabs& seg, const float bmin[2], const float bmax[2])
+{
     float tmin = 0;
     float tmax = 1;
-    float d[2];
-    d[0] = q[0] - p[0];
-    d[1] = q[1] - p[1];
 
     for (int i = 0; i < 2; i++)
     {
-        if (fabsf(d[i]) < EPSILON)
+        if (seg.parallel[i])
         {
             // Ray is parallel to slab. No hit if origin not within slab
-            if (p[i] < bmin[i] || p[i] > bmax[i])
+            if (seg.p[i] < bmin[i] || seg.p[i] > bmax[i])
                 return false;
         }
         else
         {
             // Compute intersection t value of ray with near and far plane of slab
-            float ood = 1.0f / d[i];
-            float t1 = (bmin[i] - p[i]) * ood;
-            float t2 = (bmax[i] - p[i]) * ood;
+            float t1 = (bmin[i] - seg.p[i]) * seg.ood[i];
+            float t2 = (bmax[i] - seg.p[i]) * seg.ood[i];
             if (t1 > t2) { float tmp = t1; t1 = t2; t2 = tmp; }
             if (t1 > tmin) tmin = t1;
             if (t2 < tmax) tmax = t2;
@@ -284,13 +393,16 @@ int rcGetChunksOverlappingSegment(const rcChunkyTriMesh* cm,
                                   float p[2], float q[2],
                                   int* ids, const int maxIds)
 {
+    SegmentSlabs seg;
+    initSegmentSlabs(p, q, seg);
+
     // Traverse tree
     int i = 0;
     int n = 0;
     while (i < cm->nnodes)
     {
         const rcChunkyTriMeshNode* node = &cm->nodes[i];
-        const bool overlap = checkOverlapSegment(p, q, node->bmin, node->bmax);
+        const bool overlap = checkOverlapSegment(seg, node->bmin, node->bmax);
         const bool isLeafNode = node->i >= 0;
 
         if (isLeafNode && overlap)
@@ -3,19 +3,64 @@
 //
 
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <cstring>
 #include <new>
+#include <utility>
+#include <vector>
 
 #include <InputGeom.h>
 #include <Recast.h>
+#include <RecastAlloc.h>
 #include <RecastDump.h>
 
 #include "MeshLoaderObj.h"
 #include "Generators.h"
+#include "PerfTimer.h"
 
 #include <new>
 
-bool generateTheses(rcContext &context, const InputGeom &pGeom, rcConfig &config, const bool filterLowHangingObstacles, const bool filterLedgeSpans, const bool filterWalkableLowHeightSpans, rcPolyMesh *&pMesh, rcPolyMeshDetail *&pDetailedMesh, int *&bounderies, int &bounderyElementCount) {
+namespace {
+/// Returns the number of bytes used by the vertex, polygon, region, flag and area arrays of the mesh.
+std::size_t polyMeshMemoryUsage(const rcPolyMesh &mesh) {
+  const std::size_t polyCount = static_cast<std::size_t>(mesh.maxpolys);
+  return sizeof(rcMeshIndex) * static_cast<std::size_t>(mesh.nverts) * 3 +
+         sizeof(rcMeshIndex) * polyCount * 2 * static_cast<std::size_t>(mesh.nvp) +
+         (sizeof(unsigned short) * 2 + sizeof(unsigned char)) * polyCount;
+}
+
+/// Applies the enabled span filters in a single sweep over the heightfield.
+void filterWalkableSpans(rcContext &context, const rcConfig &config, const bool filterLowHangingObstacles, const bool filterLedgeSpans, const bool filterWalkableLowHeightSpans, rcHeightfield &solid) {
+  int filterFlags = 0;
+  if (filterLowHangingObstacles)
+    filterFlags |= RC_FILTER_LOW_HANGING_OBSTACLES;
+  if (filterLedgeSpans)
+    filterFlags |= RC_FILTER_LEDGE_SPANS;
+  if (filterWalkableLowHeightSpans)
+    filterFlags |= RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS;
+  rcFilterWalkableSpans(&context, filterFlags, config.walkableHeight, config.walkableClimb, solid);
+}
+} // namespace
+
+bool markConvexVolumes(rcContext &context, const InputGeom &pGeom, rcCompactHeightfield &compactHeightField) {
+  const ConvexVolume *vols = pGeom.getConvexVolumes();
+  std::vector<rcAreaVolume> volumes(static_cast<std::size_t>(pGeom.getConvexVolumeCount()));
+  for (std::size_t i = 0; i < volumes.size(); ++i) {
+    rcAreaVolume &volume = volumes[i];
+    std::memset(&volume, 0, sizeof(volume));
+    volume.type = RC_AREA_VOLUME_CONVEX;
+    volume.areaId = static_cast<unsigned char>(vols[i].area);
+    volume.verts = vols[i].verts;
+    volume.nverts = vols[i].nverts;
+    volume.minY = vols[i].hmin;
+    volume.maxY = vols[i].hmax;
+  }
+  return rcMarkAreaVolumes(&context, volumes.data(), static_cast<int>(volumes.size()), compactHeightField);
+}
+
+bool generateTheses(rcContext &context, const InputGeom &pGeom, rcConfig &config, const bool filterLowHangingObstacles, const bool filterLedgeSpans, const bool filterWalkableLowHeightSpans, rcPolyMesh *&pMesh, rcPolyMeshDetail *&pDetailedMesh, int *&bounderies, int &bounderyElementCount, const int detailBuildFlags) {
   if (!pGeom.getMesh()) {
     context.log(RC_LOG_ERROR, "buildNavigation: Input mesh is not specified.");
     return false;
@@ -91,12 +136,7 @@ bool generateTheses(rcContext &context, const InputGeom &pGeom, rcConfig &config
   // Once all geometry is rasterized, we do initial pass of filtering to
   // remove unwanted overhangs caused by the conservative rasterization
   // as well as filter spans where the character cannot possibly stand.
-  if (filterLowHangingObstacles)
-    rcFilterLowHangingWalkableObstacles(&context, config.walkableClimb, *m_solid);
-  if (filterLedgeSpans)
-    rcFilterLedgeSpans(&context, config.walkableHeight, config.walkableClimb, *m_solid);
-  if (filterWalkableLowHeightSpans)
-    rcFilterWalkableLowHeightSpans(&context, config.walkableHeight, *m_solid);
+  filterWalkableSpans(context, config, filterLowHangingObstacles, filterLedgeSpans, filterWalkableLowHeightSpans, *m_solid);
 
   //
   // Step 4. Partition walkable surface to simple regions.
@@ -126,9 +166,10 @@ bool generateTheses(rcContext &context, const InputGeom &pGeom, rcConfig &config
   }
 
   // (Optional) Mark areas.
-  const ConvexVolume *vols = pGeom.getConvexVolumes();
-  for (int i = 0; i < pGeom.getConvexVolumeCount(); ++i)
-    rcMarkConvexPolyArea(&context, vols[i].verts, vols[i].nverts, vols[i].hmin, vols[i].hmax, static_cast<unsigned char>(vols[i].area), *m_chf);
+  if (!markConvexVolumes(context, pGeom, *m_chf)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not mark area volumes.");
+    return false;
+  }
 
   // Partition the heightfield so that we can use simple algorithm later to triangulate the walkable areas.
   // There are 3 partitioning methods, each with some pros and cons:
@@ -194,7 +235,7 @@ bool generateTheses(rcContext &context, const InputGeom &pGeom, rcConfig &config
     return false;
   }
 
-  if (!rcBuildPolyMeshDetail(&context, *pMesh, *m_chf, config.detailSampleDist, config.detailSampleMaxError, *pDetailedMesh)) {
+  if (!rcBuildPolyMeshDetail(&context, *pMesh, *m_chf, config.detailSampleDist, config.detailSampleMaxError, *pDetailedMesh, detailBuildFlags)) {
     context.log(RC_LOG_ERROR, "buildNavigation: Could not build detail mesh.");
     return false;
   }
@@ -208,12 +249,12 @@ bool generateTheses(rcContext &context, const InputGeom &pGeom, rcConfig &config
 
   // Show performance stats.
   duLogBuildTimes(context, context.getAccumulatedTime(RC_TIMER_TOTAL));
-  context.log(RC_LOG_PROGRESS, ">> Polymesh: %d vertices  %d polygons", pMesh->nverts, pMesh->npolys);
+  context.log(RC_LOG_PROGRESS, ">> Polymesh: %d vertices  %d polygons  %.1f KB (%d-bit indices)", pMesh->nverts, pMesh->npolys, static_cast<float>(polyMeshMemoryUsage(*pMesh)) / 1024.0f, static_cast<int>(sizeof(rcMeshIndex) * 8));
 
   return true;
 }
 
-bool generateSingle(rcContext& context, const InputGeom& pGeom, rcConfig& config, const bool filterLowHangingObstacles, const bool filterLedgeSpans, const bool filterWalkableLowHeightSpans, rcPolyMesh*& pMesh, rcPolyMeshDetail*& pDetailedMesh) {
+bool generateSingle(rcContext& context, const InputGeom& pGeom, rcConfig& config, const bool filterLowHangingObstacles, const bool filterLedgeSpans, const bool filterWalkableLowHeightSpans, rcPolyMesh*& pMesh, rcPolyMeshDetail*& pDetailedMesh, const int detailBuildFlags, const bool parallelRegions) {
   if ( !pGeom.getMesh()) {
     context.log(RC_LOG_ERROR, "buildNavigation: Input mesh is not specified.");
     return false;
@@ -295,12 +336,7 @@ rcHeightfield *m_solid = rcAllocHeightfield();
   // Once all geometry is rasterized, we do initial pass of filtering to
   // remove unwanted overhangs caused by the conservative rasterization
   // as well as filter spans where the character cannot possibly stand.
-  if (filterLowHangingObstacles)
-    rcFilterLowHangingWalkableObstacles(&context, config.walkableClimb, *m_solid);
-  if (filterLedgeSpans)
-    rcFilterLedgeSpans(&context, config.walkableHeight, config.walkableClimb, *m_solid);
-  if (filterWalkableLowHeightSpans)
-    rcFilterWalkableLowHeightSpans(&context, config.walkableHeight, *m_solid);
+  filterWalkableSpans(context, config, filterLowHangingObstacles, filterLedgeSpans, filterWalkableLowHeightSpans, *m_solid);
 
   //
   // Step 4. Partition walkable surface to simple regions.
@@ -331,9 +367,10 @@ rcHeightfield *m_solid = rcAllocHeightfield();
   }
 
   // (Optional) Mark areas.
-  const ConvexVolume *vols = pGeom.getConvexVolumes();
-  for (int i = 0; i < pGeom.getConvexVolumeCount(); ++i)
-    rcMarkConvexPolyArea(&context, vols[i].verts, vols[i].nverts, vols[i].hmin, vols[i].hmax, static_cast<unsigned char>(vols[i].area), *compactHeightField);
+  if (!markConvexVolumes(context, pGeom, *compactHeightField)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not mark area volumes.");
+    return false;
+  }
 
   // Partition the heightfield so that we can use simple algorithm later to triangulate the walkable areas.
   // There are 3 partitioning methods, each with some pros and cons:
@@ -368,7 +405,8 @@ rcHeightfield *m_solid = rcAllocHeightfield();
   }
 
   // Partition the walkable surface into simple regions without holes.
-  if (!rcBuildRegions(&context, *compactHeightField, 0, config.minRegionArea, config.mergeRegionArea)) {
+  const bool regionsBuilt = parallelRegions ? rcBuildRegionsParallel(&context, *compactHeightField, 0, config.minRegionArea, config.mergeRegionArea) : rcBuildRegions(&context, *compactHeightField, 0, config.minRegionArea, config.mergeRegionArea);
+  if (!regionsBuilt) {
     context.log(RC_LOG_ERROR, "buildNavigation: Could not build watershed regions.");
     return false;
   }
@@ -413,7 +451,7 @@ rcHeightfield *m_solid = rcAllocHeightfield();
     return false;
   }
 
-  if (!rcBuildPolyMeshDetail(&context, *pMesh, *compactHeightField, config.detailSampleDist, config.detailSampleMaxError, *pDetailedMesh)) {
+  if (!rcBuildPolyMeshDetail(&context, *pMesh, *compactHeightField, config.detailSampleDist, config.detailSampleMaxError, *pDetailedMesh, detailBuildFlags)) {
     context.log(RC_LOG_ERROR, "buildNavigation: Could not build detail mesh.");
     return false;
   }
@@ -434,6 +472,967 @@ rcHeightfield *m_solid = rcAllocHeightfield();
 
   // Show performance stats.
   duLogBuildTimes(context, context.getAccumulatedTime(RC_TIMER_TOTAL));
-  context.log(RC_LOG_PROGRESS, ">> Polymesh: %d vertices  %d polygons", pMesh->nverts, pMesh->npolys);
+  context.log(RC_LOG_PROGRESS, ">> Polymesh: %d vertices  %d polygons  %.1f KB (%d-bit indices)", pMesh->nverts, pMesh->npolys, static_cast<float>(polyMeshMemoryUsage(*pMesh)) / 1024.0f, static_cast<int>(sizeof(rcMeshIndex) * 8));
+  return true;
+}
+
+namespace {
+/// Frees the intermediate results of an incremental rebuild on every return.
+struct PatchData {
+  rcHeightfield *windowSolid{nullptr};
+  rcCompactHeightfield *windowChf{nullptr};
+  rcContourSet *cset{nullptr};
+  rcPolyMesh *pmesh{nullptr};
+  rcPolyMeshDetail *dmesh{nullptr};
+  rcPolyMesh *keptMesh{nullptr};
+  rcPolyMeshDetail *keptDetailMesh{nullptr};
+  rcPolyMesh *mergedMesh{nullptr};
+  rcPolyMeshDetail *mergedDetailMesh{nullptr};
+  ~PatchData() {
+    rcFreeHeightField(windowSolid);
+    rcFreeCompactHeightfield(windowChf);
+    rcFreeContourSet(cset);
+    rcFreePolyMesh(pmesh);
+    rcFreePolyMeshDetail(dmesh);
+    rcFreePolyMesh(keptMesh);
+    rcFreePolyMeshDetail(keptDetailMesh);
+    rcFreePolyMesh(mergedMesh);
+    rcFreePolyMeshDetail(mergedDetailMesh);
+  }
+};
+
+/// A rectangle of heightfield columns. (Max inclusive)
+struct ColumnRect {
+  int minX, minZ, maxX, maxZ;
+  bool contains(const int x, const int z) const { return x >= minX && x <= maxX && z >= minZ && z <= maxZ; }
+};
+
+/// Copies the spans of the heightfield columns under @p window into @p windowSolid, whose column (0, 0) is the
+/// column (window.minX, window.minZ). The columns of the window outside the heightfield stay empty.
+bool copyWindowColumns(rcContext &context, const rcHeightfield &solid, const ColumnRect &window, rcHeightfield &windowSolid) {
+  const float windowBMin[3] = {solid.bmin[0] + static_cast<float>(window.minX) * solid.cs, solid.bmin[1], solid.bmin[2] + static_cast<float>(window.minZ) * solid.cs};
+  const float windowBMax[3] = {solid.bmin[0] + static_cast<float>(window.maxX + 1) * solid.cs, solid.bmax[1], solid.bmin[2] + static_cast<float>(window.maxZ + 1) * solid.cs};
+  if (!rcCreateHeightfield(&context, windowSolid, window.maxX - window.minX + 1, window.maxZ - window.minZ + 1, windowBMin, windowBMax, solid.cs, solid.ch))
+    return false;
+  for (int z = std::max(window.minZ, 0); z <= std::min(window.maxZ, solid.height - 1); ++z) {
+    for (int x = std::max(window.minX, 0); x <= std::min(window.maxX, solid.width - 1); ++x) {
+      // The spans of a column never touch, so adding them in order recreates the column.
+      for (const rcSpan *span = solid.spans[x + z * solid.width]; span; span = span->next) {
+        if (!rcAddSpan(&context, windowSolid, x - window.minX, z - window.minZ, static_cast<unsigned short>(span->smin), static_cast<unsigned short>(span->smax), static_cast<unsigned char>(span->area), 0))
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// Replaces the columns of @p core in @p chf with the columns of @p windowChf, whose column (0, 0) is the column
+/// (windowX, windowZ). The window's region ids are offset past the regions of @p chf. The connections of the ring
+/// of columns around the core lead into the replaced columns, so they come from the window too. The new spans are
+/// appended to the span arrays, which have room for @p capacity spans, and the replaced spans are left unused.
+/// When the arrays are full, they are reallocated without the unused spans.
+bool replaceCompactColumns(rcContext &context, rcCompactHeightfield &chf, int &capacity, const rcCompactHeightfield &windowChf, const int windowX, const int windowZ, const ColumnRect &core) {
+  const int width = chf.width;
+  const int height = chf.height;
+  const ColumnRect ring{core.minX - 1, core.minZ - 1, core.maxX + 1, core.maxZ + 1};
+  const auto windowCell = [&](const int x, const int z) -> const rcCompactCell & { return windowChf.cells[(x - windowX) + (z - windowZ) * windowChf.width]; };
+
+  int addedSpans = 0;
+  for (int z = core.minZ; z <= core.maxZ; ++z) {
+    for (int x = core.minX; x <= core.maxX; ++x)
+      addedSpans += static_cast<int>(windowCell(x, z).count);
+  }
+
+  if (chf.spanCount + addedSpans > capacity) {
+    int usedSpans = 0;
+    for (int z = 0; z < height; ++z) {
+      for (int x = 0; x < width; ++x)
+        usedSpans += core.contains(x, z) ? 0 : static_cast<int>(chf.cells[x + z * width].count);
+    }
+    // The span indices of the cells have 24 bits.
+    const int maxSpans = 1 << 24;
+    if (usedSpans + addedSpans > maxSpans) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Too many spans (%d).", usedSpans + addedSpans);
+      return false;
+    }
+    const int newCapacity = std::min((usedSpans + addedSpans) * 2, maxSpans);
+    rcCompactSpan *spans = static_cast<rcCompactSpan *>(rcAlloc(sizeof(rcCompactSpan) * static_cast<std::size_t>(newCapacity), RC_ALLOC_PERM));
+    unsigned short *dist = static_cast<unsigned short *>(rcAlloc(sizeof(unsigned short) * static_cast<std::size_t>(newCapacity), RC_ALLOC_PERM));
+    unsigned char *areas = static_cast<unsigned char *>(rcAlloc(sizeof(unsigned char) * static_cast<std::size_t>(newCapacity), RC_ALLOC_PERM));
+    if (!spans || !dist || !areas) {
+      rcFree(spans);
+      rcFree(dist);
+      rcFree(areas);
+      context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'chf' (%d).", newCapacity);
+      return false;
+    }
+    int next = 0;
+    for (int z = 0; z < height; ++z) {
+      for (int x = 0; x < width; ++x) {
+        rcCompactCell &cell = chf.cells[x + z * width];
+        const int count = core.contains(x, z) ? 0 : static_cast<int>(cell.count);
+        std::memcpy(&spans[next], &chf.spans[cell.index], sizeof(rcCompactSpan) * static_cast<std::size_t>(count));
+        std::memcpy(&dist[next], &chf.dist[cell.index], sizeof(unsigned short) * static_cast<std::size_t>(count));
+        std::memcpy(&areas[next], &chf.areas[cell.index], sizeof(unsigned char) * static_cast<std::size_t>(count));
+        cell.index = static_cast<unsigned int>(next);
+        next += count;
+      }
+    }
+    rcFree(chf.spans);
+    rcFree(chf.dist);
+    rcFree(chf.areas);
+    chf.spans = spans;
+    chf.dist = dist;
+    chf.areas = areas;
+    chf.spanCount = next;
+    capacity = newCapacity;
+  } else {
+    for (int z = core.minZ; z <= core.maxZ; ++z) {
+      for (int x = core.minX; x <= core.maxX; ++x) {
+        const rcCompactCell &cell = chf.cells[x + z * width];
+        for (int i = static_cast<int>(cell.index), ni = static_cast<int>(cell.index + cell.count); i < ni; ++i) {
+          chf.spans[i].reg = 0;
+          chf.areas[i] = RC_NULL_AREA;
+        }
+      }
+    }
+  }
+
+  for (int z = core.minZ; z <= core.maxZ; ++z) {
+    for (int x = core.minX; x <= core.maxX; ++x) {
+      const rcCompactCell &source = windowCell(x, z);
+      rcCompactCell &cell = chf.cells[x + z * width];
+      cell.index = static_cast<unsigned int>(chf.spanCount);
+      cell.count = source.count;
+      for (int i = static_cast<int>(source.index), ni = static_cast<int>(source.index + source.count); i < ni; ++i) {
+        rcCompactSpan &span = chf.spans[chf.spanCount];
+        span = windowChf.spans[i];
+        span.reg = span.reg && !(span.reg & RC_BORDER_REG) ? static_cast<unsigned short>(chf.maxRegions + span.reg) : 0;
+        chf.dist[chf.spanCount] = windowChf.dist[i];
+        chf.areas[chf.spanCount] = windowChf.areas[i];
+        ++chf.spanCount;
+      }
+    }
+  }
+  for (int z = std::max(ring.minZ, 0); z <= std::min(ring.maxZ, height - 1); ++z) {
+    for (int x = std::max(ring.minX, 0); x <= std::min(ring.maxX, width - 1); ++x) {
+      if (core.contains(x, z))
+        continue;
+      const rcCompactCell &cell = chf.cells[x + z * width];
+      const rcCompactCell &source = windowCell(x, z);
+      if (source.count != cell.count) {
+        context.log(RC_LOG_ERROR, "buildNavigation: Column (%d, %d) outside the rebuilt columns has changed.", x, z);
+        return false;
+      }
+      for (int i = 0; i < static_cast<int>(cell.count); ++i)
+        chf.spans[cell.index + i].con = windowChf.spans[source.index + i].con;
+    }
+  }
+  chf.maxDistance = std::max(chf.maxDistance, windowChf.maxDistance);
+  chf.maxRegions = static_cast<unsigned short>(chf.maxRegions + windowChf.maxRegions);
+  return true;
+}
+
+/// Copies the polygons of @p mesh whose region is not removed, with their vertices and detail meshes. The
+/// polygons are not linked, as merging the meshes rebuilds the links.
+bool copyKeptPolys(rcContext &context, const rcPolyMesh &mesh, const rcPolyMeshDetail &detailMesh, const std::vector<unsigned char> &removedRegions, rcPolyMesh &kept, rcPolyMeshDetail &keptDetail) {
+  const int nvp = mesh.nvp;
+  const auto isKept = [&](const int poly) { return mesh.regs[poly] >= removedRegions.size() || !removedRegions[mesh.regs[poly]]; };
+
+  // Keep the vertices in their original order.
+  std::vector<int> vertRemap(static_cast<std::size_t>(mesh.nverts), -1);
+  int polyCount = 0;
+  int detailVertCount = 0;
+  int detailTriCount = 0;
+  for (int i = 0; i < mesh.npolys; ++i) {
+    if (!isKept(i))
+      continue;
+    const rcMeshIndex *poly = &mesh.polys[i * 2 * nvp];
+    for (int j = 0; j < nvp && poly[j] != RC_MESH_NULL_IDX; ++j)
+      vertRemap[poly[j]] = 0;
+    ++polyCount;
+    detailVertCount += static_cast<int>(detailMesh.meshes[i * 4 + 1]);
+    detailTriCount += static_cast<int>(detailMesh.meshes[i * 4 + 3]);
+  }
+  int vertCount = 0;
+  for (int &remap : vertRemap) {
+    if (remap == 0)
+      remap = vertCount++;
+  }
+
+  kept.nverts = vertCount;
+  kept.npolys = polyCount;
+  kept.maxpolys = polyCount;
+  kept.nvp = nvp;
+  rcVcopy(kept.bmin, mesh.bmin);
+  rcVcopy(kept.bmax, mesh.bmax);
+  kept.cs = mesh.cs;
+  kept.ch = mesh.ch;
+  kept.borderSize = mesh.borderSize;
+  kept.maxEdgeError = mesh.maxEdgeError;
+  kept.verts = static_cast<rcMeshIndex *>(rcAlloc(sizeof(rcMeshIndex) * static_cast<std::size_t>(std::max(vertCount, 1) * 3), RC_ALLOC_PERM));
+  kept.polys = static_cast<rcMeshIndex *>(rcAlloc(sizeof(rcMeshIndex) * static_cast<std::size_t>(std::max(polyCount, 1) * 2 * nvp), RC_ALLOC_PERM));
+  kept.regs = static_cast<unsigned short *>(rcAlloc(sizeof(unsigned short) * static_cast<std::size_t>(std::max(polyCount, 1)), RC_ALLOC_PERM));
+  kept.flags = static_cast<unsigned short *>(rcAlloc(sizeof(unsigned short) * static_cast<std::size_t>(std::max(polyCount, 1)), RC_ALLOC_PERM));
+  kept.areas = static_cast<unsigned char *>(rcAlloc(sizeof(unsigned char) * static_cast<std::size_t>(std::max(polyCount, 1)), RC_ALLOC_PERM));
+  keptDetail.nmeshes = polyCount;
+  keptDetail.nverts = detailVertCount;
+  keptDetail.ntris = detailTriCount;
+  keptDetail.meshes = static_cast<unsigned int *>(rcAlloc(sizeof(unsigned int) * static_cast<std::size_t>(std::max(polyCount, 1) * 4), RC_ALLOC_PERM));
+  keptDetail.verts = static_cast<float *>(rcAlloc(sizeof(float) * static_cast<std::size_t>(std::max(detailVertCount, 1) * 3), RC_ALLOC_PERM));
+  keptDetail.tris = static_cast<unsigned char *>(rcAlloc(sizeof(unsigned char) * static_cast<std::size_t>(std::max(detailTriCount, 1) * 4), RC_ALLOC_PERM));
+  if (!kept.verts || !kept.polys || !kept.regs || !kept.flags || !kept.areas || !keptDetail.meshes || !keptDetail.verts || !keptDetail.tris) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'kept polys' (%d).", polyCount);
+    return false;
+  }
+
+  for (int i = 0; i < mesh.nverts; ++i) {
+    if (vertRemap[i] >= 0)
+      std::memcpy(&kept.verts[vertRemap[i] * 3], &mesh.verts[i * 3], sizeof(rcMeshIndex) * 3);
+  }
+  int polyIndex = 0;
+  int detailVertIndex = 0;
+  int detailTriIndex = 0;
+  for (int i = 0; i < mesh.npolys; ++i) {
+    if (!isKept(i))
+      continue;
+    const rcMeshIndex *poly = &mesh.polys[i * 2 * nvp];
+    rcMeshIndex *keptPoly = &kept.polys[polyIndex * 2 * nvp];
+    for (int j = 0; j < nvp * 2; ++j)
+      keptPoly[j] = j < nvp && poly[j] != RC_MESH_NULL_IDX ? static_cast<rcMeshIndex>(vertRemap[poly[j]]) : RC_MESH_NULL_IDX;
+    kept.regs[polyIndex] = mesh.regs[i];
+    kept.flags[polyIndex] = mesh.flags[i];
+    kept.areas[polyIndex] = mesh.areas[i];
+
+    const unsigned int *subMesh = &detailMesh.meshes[i * 4];
+    unsigned int *keptSubMesh = &keptDetail.meshes[polyIndex * 4];
+    keptSubMesh[0] = static_cast<unsigned int>(detailVertIndex);
+    keptSubMesh[1] = subMesh[1];
+    keptSubMesh[2] = static_cast<unsigned int>(detailTriIndex);
+    keptSubMesh[3] = subMesh[3];
+    std::memcpy(&keptDetail.verts[detailVertIndex * 3], &detailMesh.verts[subMesh[0] * 3], sizeof(float) * 3 * subMesh[1]);
+    std::memcpy(&keptDetail.tris[detailTriIndex * 4], &detailMesh.tris[subMesh[2] * 4], sizeof(unsigned char) * 4 * subMesh[3]);
+    detailVertIndex += static_cast<int>(subMesh[1]);
+    detailTriIndex += static_cast<int>(subMesh[3]);
+    ++polyIndex;
+  }
+  return true;
+}
+} // namespace
+
+IncrementalSoloMesh::~IncrementalSoloMesh() {
+  rcFreeHeightField(m_solid);
+  rcFreeCompactHeightfield(m_chf);
+  rcFreePolyMesh(m_pmesh);
+  rcFreePolyMeshDetail(m_dmesh);
+}
+
+bool IncrementalSoloMesh::build(rcContext &context, const rcConfig &config, const int filterFlags, const float *verts, const int nverts, const int *tris, const int ntris, const rcAreaVolume *volumes, const int volumeCount, const int detailBuildFlags) {
+  m_config = config;
+  m_filterFlags = filterFlags;
+  m_detailBuildFlags = detailBuildFlags;
+
+  context.resetTimers();
+  rcScopedTimer totalTimer(&context, RC_TIMER_TOTAL);
+
+  rcFreeHeightField(m_solid);
+  m_solid = rcAllocHeightfield();
+  if (!m_solid) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
+    return false;
+  }
+  if (!rcCreateHeightfield(&context, *m_solid, m_config.width, m_config.height, m_config.bmin, m_config.bmax, m_config.cs, m_config.ch)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
+    return false;
+  }
+  if (!rasterize(context, verts, nverts, tris, ntris, 0, 0, m_config.width - 1, m_config.height - 1))
+    return false;
+  return buildFromHeightfield(context, volumes, volumeCount);
+}
+
+bool IncrementalSoloMesh::rebuild(rcContext &context, const float *verts, const int nverts, const int *tris, const int ntris, const rcAreaVolume *volumes, const int volumeCount, const float *changedBMin, const float *changedBMax) {
+  if (!m_solid || !m_chf || !m_pmesh || !m_dmesh) {
+    context.log(RC_LOG_ERROR, "buildNavigation: The incremental mesh has not been built.");
+    return false;
+  }
+
+  context.resetTimers();
+  rcScopedTimer totalTimer(&context, RC_TIMER_TOTAL);
+
+  // The columns the changed triangles may have been rasterized into, with a cell of slack for rounding.
+  // The ring of columns around them is rebuilt too, as their ledge status depends on the changed columns.
+  const float inverseCellSize = 1.0f / m_config.cs;
+  const int minX = static_cast<int>(std::floor((changedBMin[0] - m_config.bmin[0]) * inverseCellSize)) - 2;
+  const int minZ = static_cast<int>(std::floor((changedBMin[2] - m_config.bmin[2]) * inverseCellSize)) - 2;
+  const int maxX = static_cast<int>(std::floor((changedBMax[0] - m_config.bmin[0]) * inverseCellSize)) + 2;
+  const int maxZ = static_cast<int>(std::floor((changedBMax[2] - m_config.bmin[2]) * inverseCellSize)) + 2;
+
+  rcClearHeightfieldColumns(&context, *m_solid, minX, minZ, maxX, maxZ);
+  if (!rasterize(context, verts, nverts, tris, ntris, minX, minZ, maxX, maxZ))
+    return false;
+  if (!patchFromHeightfield(context, volumes, volumeCount, minX, minZ, maxX, maxZ))
+    return false;
+
+  context.log(RC_LOG_PROGRESS, "buildNavigation: Rebuilt columns (%d, %d) - (%d, %d).", minX, minZ, maxX, maxZ);
   return true;
 }
+
+bool IncrementalSoloMesh::rasterize(rcContext &context, const float *verts, const int nverts, const int *tris, const int ntris, const int minX, const int minZ, const int maxX, const int maxZ) {
+  // Only the triangles overlapping the columns are marked and rasterized, in their original order,
+  // so that the spans are merged in the same order as in a full build.
+  const float rectMinX = m_config.bmin[0] + static_cast<float>(minX - 1) * m_config.cs;
+  const float rectMinZ = m_config.bmin[2] + static_cast<float>(minZ - 1) * m_config.cs;
+  const float rectMaxX = m_config.bmin[0] + static_cast<float>(maxX + 2) * m_config.cs;
+  const float rectMaxZ = m_config.bmin[2] + static_cast<float>(maxZ + 2) * m_config.cs;
+  std::vector<int> rectTris;
+  for (int i = 0; i < ntris; ++i) {
+    const float *v0 = &verts[tris[i * 3 + 0] * 3];
+    const float *v1 = &verts[tris[i * 3 + 1] * 3];
+    const float *v2 = &verts[tris[i * 3 + 2] * 3];
+    if (std::max({v0[0], v1[0], v2[0]}) < rectMinX || std::min({v0[0], v1[0], v2[0]}) > rectMaxX ||
+        std::max({v0[2], v1[2], v2[2]}) < rectMinZ || std::min({v0[2], v1[2], v2[2]}) > rectMaxZ)
+      continue;
+    rectTris.insert(rectTris.end(), &tris[i * 3], &tris[i * 3] + 3);
+  }
+
+  const int rectTriCount = static_cast<int>(rectTris.size() / 3);
+  std::vector<unsigned char> triareas(static_cast<std::size_t>(rectTriCount), 0);
+  rcMarkWalkableTriangles(&context, m_config.walkableSlopeAngle, verts, nverts, rectTris.data(), rectTriCount, triareas.data());
+  if (!rcRasterizeTrianglesInColumns(&context, verts, nverts, rectTris.data(), triareas.data(), rectTriCount, *m_solid, minX, minZ, maxX, maxZ, m_config.walkableClimb)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not rasterize triangles.");
+    return false;
+  }
+
+  rcFilterWalkableSpansInColumns(&context, m_filterFlags, m_config.walkableHeight, m_config.walkableClimb, minX, minZ, maxX, maxZ, *m_solid);
+  return true;
+}
+
+
+bool IncrementalSoloMesh::buildFromHeightfield(rcContext &context, const rcAreaVolume *volumes, const int volumeCount) {
+  rcFreeCompactHeightfield(m_chf);
+  m_chf = rcAllocCompactHeightfield();
+  if (!m_chf) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
+    return false;
+  }
+  // Release the contours on every return. The compact heightfield is kept for the rebuilds.
+  struct Intermediates {
+    rcContourSet *cset;
+    ~Intermediates() { rcFreeContourSet(cset); }
+  } intermediates{nullptr};
+
+  if (!rcBuildCompactHeightfield(&context, m_config.walkableHeight, m_config.walkableClimb, *m_solid, *m_chf)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
+    return false;
+  }
+  if (!rcErodeWalkableArea(&context, m_config.walkableRadius, *m_chf)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not erode.");
+    return false;
+  }
+  if (!rcMarkAreaVolumes(&context, volumes, volumeCount, *m_chf)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not mark area volumes.");
+    return false;
+  }
+  if (!rcBuildDistanceField(&context, *m_chf)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not build distance field.");
+    return false;
+  }
+  if (!rcBuildRegions(&context, *m_chf, 0, m_config.minRegionArea, m_config.mergeRegionArea)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not build watershed regions.");
+    return false;
+  }
+  m_chfCapacity = m_chf->spanCount;
+  m_regionBounds.assign((static_cast<std::size_t>(m_chf->maxRegions) + 1) * 4, 0);
+  for (int reg = 0; reg <= m_chf->maxRegions; ++reg) {
+    m_regionBounds[reg * 4 + 0] = m_chf->width;
+    m_regionBounds[reg * 4 + 1] = -1;
+    m_regionBounds[reg * 4 + 2] = m_chf->height;
+    m_regionBounds[reg * 4 + 3] = -1;
+  }
+  for (int z = 0; z < m_chf->height; ++z) {
+    for (int x = 0; x < m_chf->width; ++x) {
+      const rcCompactCell &cell = m_chf->cells[x + z * m_chf->width];
+      for (int i = static_cast<int>(cell.index), ni = static_cast<int>(cell.index + cell.count); i < ni; ++i) {
+        int *bounds = &m_regionBounds[m_chf->spans[i].reg * 4];
+        bounds[0] = std::min(bounds[0], x);
+        bounds[1] = std::max(bounds[1], x);
+        bounds[2] = std::min(bounds[2], z);
+        bounds[3] = std::max(bounds[3], z);
+      }
+    }
+  }
+
+  intermediates.cset = rcAllocContourSet();
+  if (!intermediates.cset) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'cset'.");
+    return false;
+  }
+  if (!rcBuildContours(&context, *m_chf, m_config.maxSimplificationError, m_config.maxEdgeLen, *intermediates.cset)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not create contours.");
+    return false;
+  }
+
+  rcFreePolyMesh(m_pmesh);
+  m_pmesh = rcAllocPolyMesh();
+  if (!m_pmesh) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'pmesh'.");
+    return false;
+  }
+  if (!rcBuildPolyMesh(&context, *intermediates.cset, m_config.maxVertsPerPoly, *m_pmesh)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not triangulate contours.");
+    return false;
+  }
+
+  rcFreePolyMeshDetail(m_dmesh);
+  m_dmesh = rcAllocPolyMeshDetail();
+  if (!m_dmesh) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'pmdtl'.");
+    return false;
+  }
+  if (!rcBuildPolyMeshDetail(&context, *m_pmesh, *m_chf, m_config.detailSampleDist, m_config.detailSampleMaxError, *m_dmesh, m_detailBuildFlags)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not build detail mesh.");
+    return false;
+  }
+  return true;
+}
+
+bool IncrementalSoloMesh::patchFromHeightfield(rcContext &context, const rcAreaVolume *volumes, const int volumeCount, const int minX, const int minZ, const int maxX, const int maxZ) {
+  // Erosion changes the areas up to the walkable radius away from the changed columns, and the blur of the
+  // distance field reaches a cell further. The regions of these core columns are rebuilt in a window with the
+  // border of a tiled build around them, so that erosion and the distance field see the columns around the core.
+  const int grow = m_config.walkableRadius + 1;
+  const ColumnRect core{std::max(minX - grow, 0), std::max(minZ - grow, 0), std::min(maxX + grow, m_chf->width - 1), std::min(maxZ + grow, m_chf->height - 1)};
+  if (core.minX > core.maxX || core.minZ > core.maxZ)
+    return true;
+  const int borderSize = m_config.walkableRadius + 3;
+  const ColumnRect window{core.minX - borderSize, core.minZ - borderSize, core.maxX + borderSize, core.maxZ + borderSize};
+
+  PatchData data;
+  data.windowSolid = rcAllocHeightfield();
+  data.windowChf = rcAllocCompactHeightfield();
+  if (!data.windowSolid || !data.windowChf) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'window'.");
+    return false;
+  }
+  if (!copyWindowColumns(context, *m_solid, window, *data.windowSolid)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not copy the window columns.");
+    return false;
+  }
+  if (!rcBuildCompactHeightfield(&context, m_config.walkableHeight, m_config.walkableClimb, *data.windowSolid, *data.windowChf)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
+    return false;
+  }
+  if (!rcErodeWalkableArea(&context, m_config.walkableRadius, *data.windowChf)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not erode.");
+    return false;
+  }
+  if (!rcMarkAreaVolumes(&context, volumes, volumeCount, *data.windowChf)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not mark area volumes.");
+    return false;
+  }
+  if (!rcBuildDistanceField(&context, *data.windowChf)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not build distance field.");
+    return false;
+  }
+  if (!rcBuildRegions(&context, *data.windowChf, borderSize, m_config.minRegionArea, m_config.mergeRegionArea)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not build watershed regions.");
+    return false;
+  }
+
+  // The region ids of the window are appended to the ones in use, which run out after many rebuilds.
+  const int regionBase = m_chf->maxRegions;
+  if (regionBase + data.windowChf->maxRegions >= RC_BORDER_REG) {
+    context.log(RC_LOG_PROGRESS, "buildNavigation: Out of region ids, rebuilding the whole mesh.");
+    return buildFromHeightfield(context, volumes, volumeCount);
+  }
+  rcCompactHeightfield &chf = *m_chf;
+  const int width = chf.width;
+  const int height = chf.height;
+
+  // The old regions with spans in or next to the core lose their polygons (1). Outside the core they keep their
+  // spans, as the core cuts them.
+  std::vector<unsigned char> removedRegions(static_cast<std::size_t>(regionBase) + 1, 0);
+  for (int z = std::max(core.minZ - 1, 0); z <= std::min(core.maxZ + 1, height - 1); ++z) {
+    for (int x = std::max(core.minX - 1, 0); x <= std::min(core.maxX + 1, width - 1); ++x) {
+      const rcCompactCell &cell = chf.cells[x + z * width];
+      for (int i = static_cast<int>(cell.index), ni = static_cast<int>(cell.index + cell.count); i < ni; ++i) {
+        if (chf.spans[i].reg)
+          removedRegions[chf.spans[i].reg] = 1;
+      }
+    }
+  }
+
+  // The compact heightfield is patched in place from here on. If the rebuild fails, it no longer matches the mesh
+  // and is dropped, so that further rebuilds fail until the next build.
+  struct DropOnFailure {
+    rcCompactHeightfield *&chf;
+    bool done;
+    ~DropOnFailure() {
+      if (!done) {
+        rcFreeCompactHeightfield(chf);
+        chf = nullptr;
+      }
+    }
+  } dropOnFailure{m_chf, false};
+  if (!replaceCompactColumns(context, chf, m_chfCapacity, *data.windowChf, window.minX, window.minZ, core))
+    return false;
+
+  const auto clearBounds = [this, width, height](const int reg) {
+    int *bounds = &m_regionBounds[reg * 4];
+    bounds[0] = width;
+    bounds[1] = -1;
+    bounds[2] = height;
+    bounds[3] = -1;
+  };
+  const auto addToBounds = [this](const int reg, const int x, const int z) {
+    int *bounds = &m_regionBounds[reg * 4];
+    bounds[0] = std::min(bounds[0], x);
+    bounds[1] = std::max(bounds[1], x);
+    bounds[2] = std::min(bounds[2], z);
+    bounds[3] = std::max(bounds[3], z);
+  };
+  const auto addBoundsToRect = [this](const int reg, ColumnRect &rect) {
+    const int *bounds = &m_regionBounds[reg * 4];
+    rect = {std::min(rect.minX, bounds[0]), std::min(rect.minZ, bounds[2]), std::max(rect.maxX, bounds[1]), std::max(rect.maxZ, bounds[3])};
+  };
+  m_regionBounds.resize((static_cast<std::size_t>(chf.maxRegions) + 1) * 4);
+  for (int reg = regionBase + 1; reg <= chf.maxRegions; ++reg)
+    clearBounds(reg);
+  for (int z = core.minZ; z <= core.maxZ; ++z) {
+    for (int x = core.minX; x <= core.maxX; ++x) {
+      const rcCompactCell &cell = chf.cells[x + z * width];
+      for (int i = static_cast<int>(cell.index), ni = static_cast<int>(cell.index + cell.count); i < ni; ++i) {
+        if (chf.spans[i].reg)
+          addToBounds(chf.spans[i].reg, x, z);
+      }
+    }
+  }
+
+  // The cut regions are split into pieces along the lines of the core's edges, and into the parts that fell apart.
+  // The pieces are traced as separate regions. Otherwise a region around the core would meet a new region on up
+  // to three sides, and the portal edge between them would run straight through the core, as portal edges only
+  // get vertices where the neighbouring region changes. The first piece keeps the id and the others get new ones.
+  // That changes the region ids along the outlines of their neighbours, whose polygons are replaced too (2).
+  const auto sideOf = [&core](const int x, const int z) {
+    const int sideX = x < core.minX ? 0 : (x > core.maxX ? 2 : 1);
+    const int sideZ = z < core.minZ ? 0 : (z > core.maxZ ? 2 : 1);
+    return sideX + sideZ * 3;
+  };
+  ColumnRect cutRect{width, height, -1, -1};
+  for (int reg = 1; reg <= regionBase; ++reg) {
+    if (removedRegions[reg] == 1) {
+      addBoundsToRect(reg, cutRect);
+      clearBounds(reg);
+    }
+  }
+  // The spans of a piece are marked as visited with the border flag, which a solo mesh does not use otherwise.
+  int maxRegions = chf.maxRegions;
+  std::vector<unsigned char> regionCut(static_cast<std::size_t>(regionBase) + 1, 0);
+  std::vector<int> stack;
+  for (int z = cutRect.minZ; z <= cutRect.maxZ; ++z) {
+    for (int x = cutRect.minX; x <= cutRect.maxX; ++x) {
+      if (core.contains(x, z))
+        continue;
+      const rcCompactCell &cell = chf.cells[x + z * width];
+      for (int i = static_cast<int>(cell.index), ni = static_cast<int>(cell.index + cell.count); i < ni; ++i) {
+        const unsigned short reg = chf.spans[i].reg;
+        if (!reg || reg > regionBase || removedRegions[reg] != 1)
+          continue;
+        unsigned short pieceReg = reg;
+        if (regionCut[reg]) {
+          if (maxRegions + 1 >= RC_BORDER_REG) {
+            context.log(RC_LOG_PROGRESS, "buildNavigation: Out of region ids, rebuilding the whole mesh.");
+            dropOnFailure.done = true;
+            return buildFromHeightfield(context, volumes, volumeCount);
+          }
+          pieceReg = static_cast<unsigned short>(++maxRegions);
+          m_regionBounds.resize((static_cast<std::size_t>(maxRegions) + 1) * 4);
+          clearBounds(pieceReg);
+        }
+        regionCut[reg] = 1;
+
+        const unsigned short visitedReg = static_cast<unsigned short>(pieceReg | RC_BORDER_REG);
+        chf.spans[i].reg = visitedReg;
+        stack.assign({x, z, i});
+        while (!stack.empty()) {
+          const int si = stack.back();
+          const int sz = stack[stack.size() - 2];
+          const int sx = stack[stack.size() - 3];
+          stack.resize(stack.size() - 3);
+          addToBounds(pieceReg, sx, sz);
+          const rcCompactSpan &span = chf.spans[si];
+          for (int dir = 0; dir < 4; ++dir) {
+            if (rcGetCon(span, dir) == RC_NOT_CONNECTED)
+              continue;
+            const int ax = sx + rcGetDirOffsetX(dir);
+            const int az = sz + rcGetDirOffsetY(dir);
+            const int ai = static_cast<int>(chf.cells[ax + az * width].index) + rcGetCon(span, dir);
+            const unsigned short neighbourReg = chf.spans[ai].reg;
+            if (neighbourReg == reg && sideOf(ax, az) == sideOf(sx, sz)) {
+              chf.spans[ai].reg = visitedReg;
+              stack.insert(stack.end(), {ax, az, ai});
+            } else if (pieceReg != reg) {
+              const int otherReg = neighbourReg & ~RC_BORDER_REG;
+              if (otherReg && otherReg <= regionBase && !removedRegions[otherReg])
+                removedRegions[otherReg] = 2;
+            }
+          }
+        }
+      }
+    }
+  }
+  for (int z = cutRect.minZ; z <= cutRect.maxZ; ++z) {
+    for (int x = cutRect.minX; x <= cutRect.maxX; ++x) {
+      const rcCompactCell &cell = chf.cells[x + z * width];
+      for (int i = static_cast<int>(cell.index), ni = static_cast<int>(cell.index + cell.count); i < ni; ++i)
+        chf.spans[i].reg &= static_cast<unsigned short>(~RC_BORDER_REG);
+    }
+  }
+  chf.maxRegions = static_cast<unsigned short>(maxRegions);
+
+  // Trace the regions that lost their polygons, the pieces and the new regions of the core.
+  std::vector<unsigned char> traceRegions(static_cast<std::size_t>(maxRegions) + 1, 1);
+  traceRegions[0] = 0;
+  for (int reg = 1; reg <= regionBase; ++reg)
+    traceRegions[reg] = removedRegions[reg] != 0;
+  ColumnRect traced{width, height, -1, -1};
+  for (int reg = 1; reg <= maxRegions; ++reg) {
+    if (traceRegions[reg])
+      addBoundsToRect(reg, traced);
+  }
+
+  data.cset = rcAllocContourSet();
+  if (!data.cset) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'cset'.");
+    return false;
+  }
+  if (!rcBuildContoursInColumns(&context, chf, traceRegions.data(), traced.minX, traced.minZ, traced.maxX, traced.maxZ, m_config.maxSimplificationError, m_config.maxEdgeLen, *data.cset)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not create contours.");
+    return false;
+  }
+  if (data.cset->nconts > 0) {
+    data.pmesh = rcAllocPolyMesh();
+    data.dmesh = rcAllocPolyMeshDetail();
+    if (!data.pmesh || !data.dmesh) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'pmesh'.");
+      return false;
+    }
+    if (!rcBuildPolyMesh(&context, *data.cset, m_config.maxVertsPerPoly, *data.pmesh)) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Could not triangulate contours.");
+      return false;
+    }
+    if (!rcBuildPolyMeshDetail(&context, *data.pmesh, chf, m_config.detailSampleDist, m_config.detailSampleMaxError, *data.dmesh, m_detailBuildFlags)) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Could not build detail mesh.");
+      return false;
+    }
+  }
+
+  // Merge the new polygons after the kept ones, which keep their order and vertices.
+  data.keptMesh = rcAllocPolyMesh();
+  data.keptDetailMesh = rcAllocPolyMeshDetail();
+  data.mergedMesh = rcAllocPolyMesh();
+  data.mergedDetailMesh = rcAllocPolyMeshDetail();
+  if (!data.keptMesh || !data.keptDetailMesh || !data.mergedMesh || !data.mergedDetailMesh) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'pmesh'.");
+    return false;
+  }
+  if (!copyKeptPolys(context, *m_pmesh, *m_dmesh, removedRegions, *data.keptMesh, *data.keptDetailMesh))
+    return false;
+  rcPolyMesh *meshes[] = {data.keptMesh, data.pmesh};
+  rcPolyMeshDetail *detailMeshes[] = {data.keptDetailMesh, data.dmesh};
+  const int meshCount = data.pmesh ? 2 : 1;
+  if (!rcMergePolyMeshes(&context, meshes, meshCount, *data.mergedMesh)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not merge polymeshes.");
+    return false;
+  }
+  data.mergedMesh->maxpolys = data.mergedMesh->npolys;
+  data.mergedMesh->borderSize = m_pmesh->borderSize;
+  data.mergedMesh->maxEdgeError = m_pmesh->maxEdgeError;
+  if (!rcMergePolyMeshDetails(&context, detailMeshes, meshCount, *data.mergedDetailMesh)) {
+    context.log(RC_LOG_ERROR, "buildNavigation: Could not merge detail meshes.");
+    return false;
+  }
+
+  dropOnFailure.done = true;
+  std::swap(m_pmesh, data.mergedMesh);
+  std::swap(m_dmesh, data.mergedDetailMesh);
+  return true;
+}
+
+namespace {
+// The batch sizes of the time-sliced stages. A batch takes well below a millisecond on typical input.
+const int RASTERIZE_BATCH_TRIS = 2048;
+const int FILTER_BATCH_ROWS = 32;
+const int MARK_AREAS_BATCH_VOLUMES = 16;
+const int DISTANCE_FIELD_BATCH_ROWS = 32;
+const int REGIONS_BATCH_LEVELS = 2;
+const int CONTOURS_BATCH_ROWS = 32;
+const int POLY_MESH_BATCH_ITEMS = 64;
+const int DETAIL_MESH_BATCH_POLYS = 64;
+} // namespace
+
+TimeSlicedSoloMesh::~TimeSlicedSoloMesh() {
+  freeIntermediates();
+  rcFreePolyMesh(m_pmesh);
+  rcFreePolyMeshDetail(m_dmesh);
+}
+
+void TimeSlicedSoloMesh::freeIntermediates() {
+  rcFreeHeightField(m_solid);
+  rcFreeCompactHeightfield(m_chf);
+  rcFreeContourSet(m_cset);
+  rcFreeDistanceFieldBuild(m_distanceFieldBuild);
+  rcFreeRegionsBuild(m_regionsBuild);
+  rcFreeContoursBuild(m_contoursBuild);
+  rcFreePolyMeshBuild(m_polyMeshBuild);
+  rcFreePolyMeshDetailBuild(m_detailBuild);
+  m_solid = nullptr;
+  m_chf = nullptr;
+  m_cset = nullptr;
+  m_distanceFieldBuild = nullptr;
+  m_regionsBuild = nullptr;
+  m_contoursBuild = nullptr;
+  m_polyMeshBuild = nullptr;
+  m_detailBuild = nullptr;
+}
+
+void TimeSlicedSoloMesh::init(rcContext &context, const rcConfig &config, const int filterFlags, const float *verts, const int nverts, const int *tris, const int ntris, const rcAreaVolume *volumes, const int volumeCount, const int detailBuildFlags) {
+  freeIntermediates();
+  rcFreePolyMesh(m_pmesh);
+  rcFreePolyMeshDetail(m_dmesh);
+  m_pmesh = nullptr;
+  m_dmesh = nullptr;
+
+  m_context = &context;
+  m_config = config;
+  m_filterFlags = filterFlags;
+  m_detailBuildFlags = detailBuildFlags;
+  m_verts = verts;
+  m_nverts = nverts;
+  m_tris = tris;
+  m_ntris = ntris;
+  m_volumes = volumes;
+  m_volumeCount = volumeCount;
+  m_stage = SoloMeshStage::Rasterize;
+  m_next = 0;
+
+  context.resetTimers();
+}
+
+bool TimeSlicedSoloMesh::step(const int budgetMicroseconds) {
+  if (m_stage == SoloMeshStage::Done || m_stage == SoloMeshStage::Failed)
+    return true;
+
+  const TimeVal startTime = getPerfTime();
+  m_context->startTimer(RC_TIMER_TOTAL);
+  do {
+    if (!runBatch()) {
+      freeIntermediates();
+      m_stage = SoloMeshStage::Failed;
+    }
+  } while (m_stage != SoloMeshStage::Done && m_stage != SoloMeshStage::Failed && getPerfTimeUsec(getPerfTime() - startTime) < budgetMicroseconds);
+  m_context->stopTimer(RC_TIMER_TOTAL);
+
+  return m_stage == SoloMeshStage::Done || m_stage == SoloMeshStage::Failed;
+}
+
+bool TimeSlicedSoloMesh::runBatch() {
+  rcContext &context = *m_context;
+  switch (m_stage) {
+  case SoloMeshStage::Rasterize: {
+    if (!m_solid) {
+      m_solid = rcAllocHeightfield();
+      if (!m_solid) {
+        context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
+        return false;
+      }
+      if (!rcCreateHeightfield(&context, *m_solid, m_config.width, m_config.height, m_config.bmin, m_config.bmax, m_config.cs, m_config.ch)) {
+        context.log(RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
+        return false;
+      }
+    }
+    // Batches of triangles are rasterized in their original order, so the spans merge as in a single call.
+    const int count = std::min(RASTERIZE_BATCH_TRIS, m_ntris - m_next);
+    const int *tris = m_tris + m_next * 3;
+    unsigned char triareas[RASTERIZE_BATCH_TRIS] = {};
+    rcMarkWalkableTriangles(&context, m_config.walkableSlopeAngle, m_verts, m_nverts, tris, count, triareas);
+    if (!rcRasterizeTriangles(&context, m_verts, m_nverts, tris, triareas, count, *m_solid, m_config.walkableClimb)) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Could not rasterize triangles.");
+      return false;
+    }
+    m_next += count;
+    if (m_next >= m_ntris) {
+      m_stage = SoloMeshStage::Filter;
+      m_next = 0;
+    }
+    return true;
+  }
+  case SoloMeshStage::Filter: {
+    // The filters only read the span heights of neighbouring rows, so filtering bands of rows is exact.
+    const int lastRow = std::min(m_next + FILTER_BATCH_ROWS, m_config.height) - 1;
+    rcFilterWalkableSpansInColumns(&context, m_filterFlags, m_config.walkableHeight, m_config.walkableClimb, 0, m_next, m_config.width - 1, lastRow, *m_solid);
+    m_next = lastRow + 1;
+    if (m_next >= m_config.height)
+      m_stage = SoloMeshStage::BuildCompactHeightfield;
+    return true;
+  }
+  case SoloMeshStage::BuildCompactHeightfield:
+    m_chf = rcAllocCompactHeightfield();
+    if (!m_chf) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
+      return false;
+    }
+    if (!rcBuildCompactHeightfield(&context, m_config.walkableHeight, m_config.walkableClimb, *m_solid, *m_chf)) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
+      return false;
+    }
+    rcFreeHeightField(m_solid);
+    m_solid = nullptr;
+    m_stage = SoloMeshStage::Erode;
+    return true;
+  case SoloMeshStage::Erode:
+    if (!rcErodeWalkableArea(&context, m_config.walkableRadius, *m_chf)) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Could not erode.");
+      return false;
+    }
+    m_stage = SoloMeshStage::MarkAreas;
+    m_next = 0;
+    return true;
+  case SoloMeshStage::MarkAreas: {
+    // Later volumes overwrite earlier ones, which batches in order preserve.
+    const int count = std::min(MARK_AREAS_BATCH_VOLUMES, m_volumeCount - m_next);
+    if (count > 0 && !rcMarkAreaVolumes(&context, m_volumes + m_next, count, *m_chf)) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Could not mark area volumes.");
+      return false;
+    }
+    m_next += count;
+    if (m_next >= m_volumeCount)
+      m_stage = SoloMeshStage::BuildDistanceField;
+    return true;
+  }
+  case SoloMeshStage::BuildDistanceField: {
+    // Each build of the later stages is started in a batch of its own.
+    if (!m_distanceFieldBuild) {
+      m_distanceFieldBuild = rcAllocDistanceFieldBuild();
+      if (!m_distanceFieldBuild || !rcBeginDistanceField(&context, *m_chf, *m_distanceFieldBuild)) {
+        context.log(RC_LOG_ERROR, "buildNavigation: Could not build distance field.");
+        return false;
+      }
+      return true;
+    }
+    bool done = false;
+    if (!rcStepDistanceField(&context, *m_distanceFieldBuild, DISTANCE_FIELD_BATCH_ROWS, done)) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Could not build distance field.");
+      return false;
+    }
+    if (done) {
+      rcFreeDistanceFieldBuild(m_distanceFieldBuild);
+      m_distanceFieldBuild = nullptr;
+      m_stage = SoloMeshStage::BuildRegions;
+    }
+    return true;
+  }
+  case SoloMeshStage::BuildRegions: {
+    if (!m_regionsBuild) {
+      m_regionsBuild = rcAllocRegionsBuild();
+      if (!m_regionsBuild || !rcBeginRegions(&context, *m_chf, 0, m_config.minRegionArea, m_config.mergeRegionArea, *m_regionsBuild)) {
+        context.log(RC_LOG_ERROR, "buildNavigation: Could not build watershed regions.");
+        return false;
+      }
+      return true;
+    }
+    bool done = false;
+    if (!rcStepRegions(&context, *m_regionsBuild, REGIONS_BATCH_LEVELS, done)) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Could not build watershed regions.");
+      return false;
+    }
+    if (done) {
+      rcFreeRegionsBuild(m_regionsBuild);
+      m_regionsBuild = nullptr;
+      m_stage = SoloMeshStage::BuildContours;
+    }
+    return true;
+  }
+  case SoloMeshStage::BuildContours: {
+    if (!m_contoursBuild) {
+      m_cset = rcAllocContourSet();
+      m_contoursBuild = rcAllocContoursBuild();
+      if (!m_cset || !m_contoursBuild) {
+        context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'cset'.");
+        return false;
+      }
+      if (!rcBeginContours(&context, *m_chf, m_config.maxSimplificationError, m_config.maxEdgeLen, *m_cset, *m_contoursBuild)) {
+        context.log(RC_LOG_ERROR, "buildNavigation: Could not create contours.");
+        return false;
+      }
+      return true;
+    }
+    bool done = false;
+    if (!rcStepContours(&context, *m_contoursBuild, CONTOURS_BATCH_ROWS, done)) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Could not create contours.");
+      return false;
+    }
+    if (done) {
+      rcFreeContoursBuild(m_contoursBuild);
+      m_contoursBuild = nullptr;
+      m_stage = SoloMeshStage::BuildPolyMesh;
+    }
+    return true;
+  }
+  case SoloMeshStage::BuildPolyMesh: {
+    if (!m_polyMeshBuild) {
+      m_pmesh = rcAllocPolyMesh();
+      m_polyMeshBuild = rcAllocPolyMeshBuild();
+      if (!m_pmesh || !m_polyMeshBuild) {
+        context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'pmesh'.");
+        return false;
+      }
+      if (!rcBeginPolyMesh(&context, *m_cset, m_config.maxVertsPerPoly, *m_pmesh, *m_polyMeshBuild)) {
+        context.log(RC_LOG_ERROR, "buildNavigation: Could not triangulate contours.");
+        return false;
+      }
+      return true;
+    }
+    bool done = false;
+    if (!rcStepPolyMesh(&context, *m_polyMeshBuild, POLY_MESH_BATCH_ITEMS, done)) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Could not triangulate contours.");
+      return false;
+    }
+    if (done) {
+      rcFreePolyMeshBuild(m_polyMeshBuild);
+      m_polyMeshBuild = nullptr;
+      rcFreeContourSet(m_cset);
+      m_cset = nullptr;
+      m_stage = SoloMeshStage::BuildDetailMesh;
+    }
+    return true;
+  }
+  case SoloMeshStage::BuildDetailMesh: {
+    if (!m_detailBuild) {
+      m_dmesh = rcAllocPolyMeshDetail();
+      m_detailBuild = rcAllocPolyMeshDetailBuild();
+      if (!m_dmesh || !m_detailBuild) {
+        context.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'pmdtl'.");
+        return false;
+      }
+      if (!rcBeginPolyMeshDetail(&context, *m_pmesh, *m_chf, m_config.detailSampleDist, m_config.detailSampleMaxError, *m_dmesh, *m_detailBuild, m_detailBuildFlags)) {
+        context.log(RC_LOG_ERROR, "buildNavigation: Could not build detail mesh.");
+        return false;
+      }
+      return true;
+    }
+    bool done = false;
+    if (!rcStepPolyMeshDetail(&context, *m_detailBuild, DETAIL_MESH_BATCH_POLYS, done)) {
+      context.log(RC_LOG_ERROR, "buildNavigation: Could not build detail mesh.");
+      return false;
+    }
+    if (done) {
+      freeIntermediates();
+      m_stage = SoloMeshStage::Done;
+    }
+    return true;
+  }
+  default:
+    return true;
+  }
+}
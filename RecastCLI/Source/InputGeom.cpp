@@ -21,7 +21,10 @@
 #include <ctype.h>
 #include <string.h>
 #include <algorithm>
+#include <unordered_map>
+#include <vector>
 #include "Recast.h"
+#include "RecastSIMD.h"
 #include "InputGeom.h"
 #include "ChunkyTriMesh.h"
 #include "MeshLoaderObj.h"
@@ -29,44 +32,59 @@
 #include "RecastDebugDraw.h"
 #include "DetourNavMesh.h"
 
-static bool intersectSegmentTriangle(const float* sp, const float* sq,
-                                     const float* a, const float* b, const float* c,
-                                     float &t)
-{
-    float v, w;
-    float ab[3], ac[3], qp[3], ap[3], norm[3], e[3];
-    rcVsub(ab, b, a);
-    rcVsub(ac, c, a);
-    rcVsub(qp, sp, sq);
-
-    // Compute triangle normal. Can be precalculated or cached if
-    // intersecting multiple segments against the same triangle
-    rcVcross(norm, ab, ac);
-
-    // Compute denominator d. If d <= 0, segment is parallel to or points
-    // away from triangle, so exit early
-    float d = rcVdot(qp, norm);
-    if (d <= 0.0f) return false;
-
-    // Compute intersection t value of pq with plane of triangle. A ray
-    // intersects iff 0 <= t. Segment intersects iff 0 <= t <= 1. Delay
-    // dividing by d until intersection has been found to pierce triangle
-    rcVsub(ap, sp, a);
-    t = rcVdot(ap, norm);
-    if (t < 0.0f) return false;
-    if (t > d) return false; // For segment; exclude this code line for a ray test
-
-    // Compute barycentric coordinate components and test if within bounds
-    rcVcross(e, qp, ap);
-    v = rcVdot(ac, e);
-    if (v < 0.0f || v > d) return false;
-    w = -rcVdot(ab, e);
-    if (w < 0.0f || v + w > d) return false;
-
-    // Segment/ray intersects triangle. Perform delayed division
-    t /= d;
+/// The number of floats of four triangles with the coordinates of each vertex stored per axis.
+static const int RAYCAST_PACKET_SIZE = 3*3*4;
 
-    return true;
+/// Intersects the segment with four triangles at once.
+/// @param[out] t The parameter of the intersection along the segment, for each triangle that is hit.
+/// @returns A bit mask of the triangles the segment intersects.
+static int intersectSegmentTriangles(const float* sp, const float* sq, const float* packet, float* t)
+{
+    rcFloats4 a[3], b[3], c[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        a[k] = rcLoadFloats4(&packet[(0*3+k)*4]);
+        b[k] = rcLoadFloats4(&packet[(1*3+k)*4]);
+        c[k] = rcLoadFloats4(&packet[(2*3+k)*4]);
+    }
+    // Compute the triangle normals, the vectors to the segment start and the edge terms of the
+    // barycentric coordinates.
+    rcFloats4 ab[3], ac[3], qp[3], ap[3], norm[3], e[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        ab[k] = rcSubFloats4(b[k], a[k]);
+        ac[k] = rcSubFloats4(c[k], a[k]);
+        qp[k] = rcSplatFloats4(sp[k] - sq[k]);
+        ap[k] = rcSubFloats4(rcSplatFloats4(sp[k]), a[k]);
+    }
+    norm[0] = rcSubFloats4(rcMulFloats4(ab[1], ac[2]), rcMulFloats4(ab[2], ac[1]));
+    norm[1] = rcSubFloats4(rcMulFloats4(ab[2], ac[0]), rcMulFloats4(ab[0], ac[2]));
+    norm[2] = rcSubFloats4(rcMulFloats4(ab[0], ac[1]), rcMulFloats4(ab[1], ac[0]));
+    e[0] = rcSubFloats4(rcMulFloats4(qp[1], ap[2]), rcMulFloats4(qp[2], ap[1]));
+    e[1] = rcSubFloats4(rcMulFloats4(qp[2], ap[0]), rcMulFloats4(qp[0], ap[2]));
+    e[2] = rcSubFloats4(rcMulFloats4(qp[0], ap[1]), rcMulFloats4(qp[1], ap[0]));
+
+    // Compute denominator d, the intersection t value of pq with the plane of the triangle scaled by d,
+    // and the barycentric coordinate components, also scaled by d.
+    float d[4], tn[4], v[4], w[4];
+    rcStoreFloats4(d, rcAddFloats4(rcAddFloats4(rcMulFloats4(qp[0], norm[0]), rcMulFloats4(qp[1], norm[1])), rcMulFloats4(qp[2], norm[2])));
+    rcStoreFloats4(tn, rcAddFloats4(rcAddFloats4(rcMulFloats4(ap[0], norm[0]), rcMulFloats4(ap[1], norm[1])), rcMulFloats4(ap[2], norm[2])));
+    rcStoreFloats4(v, rcAddFloats4(rcAddFloats4(rcMulFloats4(ac[0], e[0]), rcMulFloats4(ac[1], e[1])), rcMulFloats4(ac[2], e[2])));
+    rcStoreFloats4(w, rcAddFloats4(rcAddFloats4(rcMulFloats4(ab[0], e[0]), rcMulFloats4(ab[1], e[1])), rcMulFloats4(ab[2], e[2])));
+
+    // If d <= 0, the segment is parallel to or points away from the triangle. The segment intersects
+    // iff 0 <= t <= 1 and the barycentric coordinates are within bounds. Dividing by d is delayed
+    // until the intersection has been found to pierce the triangle.
+    int hits = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        const float wi = -w[i];
+        if (d[i] <= 0.0f || tn[i] < 0.0f || tn[i] > d[i] || v[i] < 0.0f || v[i] > d[i] || wi < 0.0f || v[i] + wi > d[i])
+            continue;
+        t[i] = tn[i] / d[i];
+        hits |= 1 << i;
+    }
+    return hits;
 }
 
 static char* parseRow(char* buf, const char * bufEnd, char* row, int len)
@@ -157,10 +175,47 @@ bool InputGeom::loadMesh(rcContext* ctx, const std::string& filepath)
         ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Failed to build chunky mesh.");
         return false;
     }
+    // The raycast packets are built by the first raycastMesh.
+    std::vector<float>().swap(m_raycastPackets);
+    std::vector<int>().swap(m_chunkPackets);
 
     return true;
 }
 
+void InputGeom::buildRaycastPackets()
+{
+    const float* verts = m_mesh->getVerts();
+    m_chunkPackets.assign(m_chunkyMesh->nnodes, 0);
+    int npackets = 0;
+    for (int i = 0; i < m_chunkyMesh->nnodes; ++i)
+    {
+        const rcChunkyTriMeshNode& node = m_chunkyMesh->nodes[i];
+        m_chunkPackets[i] = npackets;
+        if (node.i >= 0)
+            npackets += (node.n + 3) / 4;
+    }
+
+    // The packets are padded with triangles of zero area, which the segment never intersects.
+    m_raycastPackets.assign((size_t)npackets*RAYCAST_PACKET_SIZE, 0.0f);
+    for (int i = 0; i < m_chunkyMesh->nnodes; ++i)
+    {
+        const rcChunkyTriMeshNode& node = m_chunkyMesh->nodes[i];
+        if (node.i < 0)
+            continue;
+        const int* tris = &m_chunkyMesh->tris[node.i*3];
+        for (int j = 0; j < node.n; ++j)
+        {
+            float* packet = &m_raycastPackets[(size_t)(m_chunkPackets[i] + j/4)*RAYCAST_PACKET_SIZE];
+            for (int vert = 0; vert < 3; ++vert)
+            {
+                const float* v = &verts[tris[j*3+vert]*3];
+                for (int k = 0; k < 3; ++k)
+                    packet[(vert*3+k)*4 + j%4] = v[k];
+            }
+        }
+    }
+}
+
 bool InputGeom::loadGeomSet(rcContext* ctx, const std::string& filepath)
 {
     char* buf = 0;
@@ -384,6 +439,257 @@ bool InputGeom::saveGeomSet(const BuildSettings* settings)
     return true;
 }
 
+/// Calculates the bounds of a triangle.
+/// @returns True if the triangle faces down.
+static bool calcTriBounds(const float* verts, const int* tri, float* tmin, float* tmax)
+{
+    const float* va = &verts[tri[0]*3];
+    const float* vb = &verts[tri[1]*3];
+    const float* vc = &verts[tri[2]*3];
+    rcVcopy(tmin, va);
+    rcVcopy(tmax, va);
+    rcVmin(tmin, vb);
+    rcVmax(tmax, vb);
+    rcVmin(tmin, vc);
+    rcVmax(tmax, vc);
+    float e0[3], e1[3], n[3];
+    rcVsub(e0, vb, va);
+    rcVsub(e1, vc, va);
+    rcVcross(n, e0, e1);
+    return n[1] < 0.0f;
+}
+
+static long long weldCellKey(const int x, const int y, const int z)
+{
+    return ((long long)(x & 0x1fffff) << 42) | ((long long)(y & 0x1fffff) << 21) | (long long)(z & 0x1fffff);
+}
+
+bool InputGeom::cleanupMesh(rcContext* ctx, const InputCleanupSettings& settings, InputCleanupStats& stats)
+{
+    if (!m_mesh)
+        return false;
+
+    const float* verts = m_mesh->getVerts();
+    const int* tris = m_mesh->getTris();
+    const int nverts = m_mesh->getVertCount();
+    const int ntris = m_mesh->getTriCount();
+    memset(&stats, 0, sizeof(stats));
+    stats.inputVerts = nverts;
+    stats.inputTris = ntris;
+
+    // Weld the vertices. Each vertex is merged into the first vertex within the weld distance,
+    // which is found through a hash grid with cells the size of the weld distance.
+    const float weldDist = settings.weldDistance;
+    const float weldDistSqr = weldDist*weldDist;
+    const float icell = weldDist > 0.0f ? 1.0f/weldDist : 1.0f;
+    std::vector<float> weldedVerts;
+    std::vector<int> remap(nverts);
+    std::vector<int> next;
+    std::unordered_map<long long, int> cells;
+    weldedVerts.reserve(nverts*3);
+    for (int i = 0; i < nverts; ++i)
+    {
+        const float* v = &verts[i*3];
+        const int cx = (int)floorf(v[0]*icell);
+        const int cy = (int)floorf(v[1]*icell);
+        const int cz = (int)floorf(v[2]*icell);
+        int found = -1;
+        for (int dz = -1; dz <= 1 && found == -1; ++dz)
+        {
+            for (int dy = -1; dy <= 1 && found == -1; ++dy)
+            {
+                for (int dx = -1; dx <= 1 && found == -1; ++dx)
+                {
+                    const auto it = cells.find(weldCellKey(cx+dx, cy+dy, cz+dz));
+                    for (int j = it != cells.end() ? it->second : -1; j != -1; j = next[j])
+                    {
+                        if (rcVdistSqr(v, weldedVerts.data() + j*3) <= weldDistSqr)
+                        {
+                            found = j;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        if (found == -1)
+        {
+            found = (int)next.size();
+            weldedVerts.insert(weldedVerts.end(), v, v+3);
+            int& head = cells.emplace(weldCellKey(cx, cy, cz), -1).first->second;
+            next.push_back(head);
+            head = found;
+        }
+        remap[i] = found;
+    }
+    stats.weldedVerts = nverts - (int)next.size();
+
+    // Drop the degenerate triangles and cull the ones outside the bounds.
+    std::vector<int> keptTris;
+    keptTris.reserve(ntris*3);
+    for (int i = 0; i < ntris; ++i)
+    {
+        const int a = remap[tris[i*3+0]];
+        const int b = remap[tris[i*3+1]];
+        const int c = remap[tris[i*3+2]];
+        const float* va = weldedVerts.data() + a*3;
+        const float* vb = weldedVerts.data() + b*3;
+        const float* vc = weldedVerts.data() + c*3;
+        if (a == b || b == c || c == a)
+        {
+            stats.degenerateTris++;
+            continue;
+        }
+        // Only drop triangles without area, so that thin triangles still rasterize as before.
+        float e0[3], e1[3], n[3];
+        rcVsub(e0, vb, va);
+        rcVsub(e1, vc, va);
+        rcVcross(n, e0, e1);
+        if (rcVdot(n, n) == 0.0f)
+        {
+            stats.degenerateTris++;
+            continue;
+        }
+        float tmin[3], tmax[3];
+        const int tri[3] = {a, b, c};
+        calcTriBounds(weldedVerts.data(), tri, tmin, tmax);
+        if (tmin[0] > settings.boundsMax[0] || tmax[0] < settings.boundsMin[0] ||
+            tmin[1] > settings.boundsMax[1] || tmax[1] < settings.boundsMin[1] ||
+            tmin[2] > settings.boundsMax[2] || tmax[2] < settings.boundsMin[2])
+        {
+            stats.outOfBoundsTris++;
+            continue;
+        }
+        keptTris.push_back(a);
+        keptTris.push_back(b);
+        keptTris.push_back(c);
+    }
+
+    // Drop the triangles that use the same vertices in the same winding as an earlier triangle. The key of a
+    // triangle is rotated to start at its smallest vertex, so a twin with the opposite winding, which faces
+    // the other way, is kept.
+    {
+        const int nkept = (int)keptTris.size()/3;
+        std::vector<int> order(nkept);
+        std::vector<int> keys(nkept*3);
+        for (int i = 0; i < nkept; ++i)
+        {
+            order[i] = i;
+            int* key = keys.data() + i*3;
+            const int* tri = keptTris.data() + i*3;
+            const int first = tri[0] < tri[1] ? (tri[0] < tri[2] ? 0 : 2) : (tri[1] < tri[2] ? 1 : 2);
+            for (int j = 0; j < 3; ++j)
+                key[j] = tri[(first+j) % 3];
+        }
+        std::sort(order.begin(), order.end(), [&keys](const int a, const int b) {
+            return std::lexicographical_compare(keys.data() + a*3, keys.data() + a*3+3, keys.data() + b*3, keys.data() + b*3+3) ||
+                   (std::equal(keys.data() + a*3, keys.data() + a*3+3, keys.data() + b*3) && a < b);
+        });
+        std::vector<char> duplicate(nkept, 0);
+        for (int i = 1; i < nkept; ++i)
+        {
+            if (std::equal(keys.data() + order[i]*3, keys.data() + order[i]*3+3, keys.data() + order[i-1]*3))
+                duplicate[order[i]] = 1;
+        }
+        std::vector<int> uniqueTris;
+        uniqueTris.reserve(keptTris.size());
+        for (int i = 0; i < nkept; ++i)
+        {
+            if (duplicate[i])
+                stats.duplicateTris++;
+            else
+                uniqueTris.insert(uniqueTris.end(), keptTris.data() + i*3, keptTris.data() + i*3+3);
+        }
+        keptTris.swap(uniqueTris);
+    }
+
+    // Cull the downward facing triangles without any floor below them. Only triangles that face up or
+    // sideways count as floors, and a floor counts when its bounds overlap the back face and reach below its top.
+    if (settings.cullBackFaces && !keptTris.empty())
+    {
+        const int nkept = (int)keptTris.size()/3;
+        rcChunkyTriMesh chunks;
+        if (!rcCreateChunkyTriMesh(weldedVerts.data(), keptTris.data(), nkept, 256, &chunks))
+        {
+            ctx->log(RC_LOG_ERROR, "cleanupMesh: Failed to build chunky mesh.");
+            return false;
+        }
+        std::vector<int> ids(chunks.nnodes);
+        std::vector<int> culledTris;
+        culledTris.reserve(keptTris.size());
+        for (int i = 0; i < nkept; ++i)
+        {
+            const int* tri = keptTris.data() + i*3;
+            float tmin[3], tmax[3];
+            bool hasFloor = !calcTriBounds(weldedVerts.data(), tri, tmin, tmax);
+            if (!hasFloor)
+            {
+                float rmin[2] = {tmin[0], tmin[2]};
+                float rmax[2] = {tmax[0], tmax[2]};
+                const int nids = rcGetChunksOverlappingRect(&chunks, rmin, rmax, ids.data(), (int)ids.size());
+                for (int j = 0; j < nids && !hasFloor; ++j)
+                {
+                    const rcChunkyTriMeshNode& node = chunks.nodes[ids[j]];
+                    for (int k = 0; k < node.n; ++k)
+                    {
+                        const int* other = &chunks.tris[(node.i+k)*3];
+                        float omin[3], omax[3];
+                        if (calcTriBounds(weldedVerts.data(), other, omin, omax) || omin[1] >= tmax[1] ||
+                            omin[0] > tmax[0] || omax[0] < tmin[0] || omin[2] > tmax[2] || omax[2] < tmin[2])
+                            continue;
+                        hasFloor = true;
+                        break;
+                    }
+                }
+            }
+            if (hasFloor)
+                culledTris.insert(culledTris.end(), tri, tri+3);
+            else
+                stats.backFaceTris++;
+        }
+        keptTris.swap(culledTris);
+    }
+
+    if (keptTris.empty())
+    {
+        ctx->log(RC_LOG_ERROR, "cleanupMesh: No triangles left.");
+        return false;
+    }
+
+    // Compact the vertices to the ones the remaining triangles use.
+    std::vector<int> vertIds(next.size(), -1);
+    std::vector<float> outVerts;
+    outVerts.reserve(weldedVerts.size());
+    for (int& v : keptTris)
+    {
+        if (vertIds[v] == -1)
+        {
+            vertIds[v] = (int)outVerts.size()/3;
+            outVerts.insert(outVerts.end(), weldedVerts.data() + v*3, weldedVerts.data() + v*3+3);
+        }
+        v = vertIds[v];
+    }
+    stats.outputVerts = (int)outVerts.size()/3;
+    stats.outputTris = (int)keptTris.size()/3;
+
+    m_mesh->setGeometry(outVerts.data(), stats.outputVerts, keptTris.data(), stats.outputTris);
+
+    delete m_chunkyMesh;
+    m_chunkyMesh = new rcChunkyTriMesh;
+    if (!rcCreateChunkyTriMesh(m_mesh->getVerts(), m_mesh->getTris(), m_mesh->getTriCount(), 256, m_chunkyMesh))
+    {
+        ctx->log(RC_LOG_ERROR, "cleanupMesh: Failed to build chunky mesh.");
+        return false;
+    }
+    std::vector<float>().swap(m_raycastPackets);
+    std::vector<int>().swap(m_chunkPackets);
+
+    ctx->log(RC_LOG_PROGRESS, "cleanupMesh: %d of %d triangles kept (%d degenerate, %d duplicate, %d out of bounds, %d back faces), %d vertices welded.",
+             stats.outputTris, stats.inputTris, stats.degenerateTris, stats.duplicateTris, stats.outOfBoundsTris, stats.backFaceTris, stats.weldedVerts);
+
+    return true;
+}
+
 static bool isectSegAABB(const float* sp, const float* sq,
                          const float* amin, const float* amax,
                          float& tmin, float& tmax)
@@ -422,6 +728,9 @@ static bool isectSegAABB(const float* sp, const float* sq,
 
 bool InputGeom::raycastMesh(const float * src, const float * dst, float& tmin)
 {
+    if (m_chunkPackets.empty())
+        buildRaycastPackets();
+
     // Prune hit ray.
     float btmin, btmax;
     if (!isectSegAABB(src, dst, m_meshBMin, m_meshBMax, btmin, btmax))
@@ -437,26 +746,41 @@ bool InputGeom::raycastMesh(const float * src, const float * dst, float& tmin)
     if (!ncid)
         return false;
 
+    // Visit the chunks in the order the segment enters them, so that the chunks behind the closest hit can be skipped.
+    std::pair<float, int> chunks[512];
+    for (int i = 0; i < ncid; ++i)
+    {
+        const rcChunkyTriMeshNode& node = m_chunkyMesh->nodes[cid[i]];
+        float amin[3] = {node.bmin[0], m_meshBMin[1], node.bmin[1]};
+        float amax[3] = {node.bmax[0], m_meshBMax[1], node.bmax[1]};
+        float enter, leave;
+        if (!isectSegAABB(src, dst, amin, amax, enter, leave))
+            enter = 0.0f;
+        chunks[i] = std::make_pair(enter, cid[i]);
+    }
+    std::sort(chunks, chunks + ncid);
+
     tmin = 1.0f;
     bool hit = false;
-    const float* verts = m_mesh->getVerts();
 
     for (int i = 0; i < ncid; ++i)
     {
-        const rcChunkyTriMeshNode& node = m_chunkyMesh->nodes[cid[i]];
-        const int* tris = &m_chunkyMesh->tris[node.i*3];
-        const int ntris = node.n;
+        if (hit && chunks[i].first > tmin)
+            break;
+        const rcChunkyTriMeshNode& node = m_chunkyMesh->nodes[chunks[i].second];
+        const float* packets = &m_raycastPackets[(size_t)m_chunkPackets[chunks[i].second]*RAYCAST_PACKET_SIZE];
+        const int npackets = (node.n + 3) / 4;
 
-        for (int j = 0; j < ntris*3; j += 3)
+        for (int j = 0; j < npackets; ++j)
         {
-            float t = 1;
-            if (intersectSegmentTriangle(src, dst,
-                                         &verts[tris[j]*3],
-                                         &verts[tris[j+1]*3],
-                                         &verts[tris[j+2]*3], t))
+            float t[4] = {};
+            const int hits = intersectSegmentTriangles(src, dst, &packets[j*RAYCAST_PACKET_SIZE], t);
+            for (int k = 0; k < 4; ++k)
             {
-                if (t < tmin)
-                    tmin = t;
+                if (!(hits & (1 << k)))
+                    continue;
+                if (t[k] < tmin)
+                    tmin = t[k];
                 hit = true;
             }
         }
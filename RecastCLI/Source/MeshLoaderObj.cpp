@@ -212,7 +212,28 @@ bool rcMeshLoaderObj::load(const std::string& filename)
 
     delete [] buf;
 
-    // Calculate normals.
+    calcNormals();
+
+    m_filename = filename;
+    return true;
+}
+
+void rcMeshLoaderObj::setGeometry(const float* verts, const int vertCount, const int* tris, const int triCount)
+{
+    delete [] m_verts;
+    delete [] m_tris;
+    delete [] m_normals;
+    m_verts = new float[vertCount*3];
+    m_tris = new int[triCount*3];
+    memcpy(m_verts, verts, vertCount*3*sizeof(float));
+    memcpy(m_tris, tris, triCount*3*sizeof(int));
+    m_vertCount = vertCount;
+    m_triCount = triCount;
+    calcNormals();
+}
+
+void rcMeshLoaderObj::calcNormals()
+{
     m_normals = new float[m_triCount*3];
     for (int i = 0; i < m_triCount*3; i += 3)
     {
@@ -238,7 +259,4 @@ bool rcMeshLoaderObj::load(const std::string& filename)
             n[2] *= d;
         }
     }
-
-    m_filename = filename;
-    return true;
 }
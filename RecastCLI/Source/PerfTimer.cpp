@@ -30,12 +30,12 @@ TimeVal getPerfTime()
 	return count;
 }
 
-int getPerfTimeUsec(const TimeVal duration)
+TimeVal getPerfTimeUsec(const TimeVal duration)
 {
 	static __int64 freq = 0;
 	if (freq == 0)
 		QueryPerformanceFrequency(reinterpret_cast<LARGE_INTEGER*>(&freq));
-	return static_cast<int>(duration * 1000000 / freq);
+	return duration * 1000000 / freq;
 }
 
 #else
@@ -51,9 +51,9 @@ TimeVal getPerfTime()
 	return (TimeVal)now.tv_sec*1000000L + (TimeVal)now.tv_usec;
 }
 
-int getPerfTimeUsec(const TimeVal duration)
+TimeVal getPerfTimeUsec(const TimeVal duration)
 {
-	return (int)duration;
+	return duration;
 }
 
 #endif
@@ -0,0 +1,1047 @@
+//
+// Copyright (c) 2024.
+//
+
+#include "StreamingBuild.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Recast.h>
+#include <RecastAlloc.h>
+
+#include "BuildCache.h"
+#include "ChunkyTriMesh.h"
+#include "Generators.h"
+#include "InputGeom.h"
+#include "MeshLoaderObj.h"
+
+namespace {
+const std::uint32_t STREAMED_WINDOW_MAGIC = 'R' << 24 | 'C' << 16 | 'S' << 8 | 'W';
+const std::uint32_t STREAMED_WINDOW_VERSION = 1;
+// Bump when the build of a window changes, so that the cache no longer returns the windows of the old build.
+const std::uint32_t STREAMED_WINDOW_BUILD_VERSION = 3;
+
+// Recast allocations are prefixed with their size, so that the tracking allocator knows how much a free releases.
+const std::size_t ALLOCATION_HEADER_SIZE = 16;
+
+std::atomic<std::size_t> s_allocatedBytes{0};
+std::atomic<std::size_t> s_peakBytes{0};
+std::atomic<bool> s_capExceeded{false};
+std::size_t s_memoryCap = 0;
+// The allocator installed before the streamed build, which serves the tracked blocks, so that an allocator that
+// tracks memory itself keeps seeing them.
+rcAllocFunc *s_baseAlloc = nullptr;
+rcFreeFunc *s_baseFree = nullptr;
+
+void *allocTracked(const size_t size, const rcAllocHint hint) {
+  const std::size_t allocated = s_allocatedBytes.fetch_add(size) + size;
+  if (s_memoryCap != 0 && allocated > s_memoryCap) {
+    s_allocatedBytes.fetch_sub(size);
+    s_capExceeded = true;
+    return nullptr;
+  }
+  std::size_t peak = s_peakBytes.load();
+  while (allocated > peak && !s_peakBytes.compare_exchange_weak(peak, allocated)) {
+  }
+
+  unsigned char *block = static_cast<unsigned char *>(s_baseAlloc(size + ALLOCATION_HEADER_SIZE, hint));
+  if (!block) {
+    s_allocatedBytes.fetch_sub(size);
+    return nullptr;
+  }
+  std::memcpy(block, &size, sizeof(size));
+  return block + ALLOCATION_HEADER_SIZE;
+}
+
+void freeTracked(void *ptr) {
+  unsigned char *block = static_cast<unsigned char *>(ptr) - ALLOCATION_HEADER_SIZE;
+  std::size_t size;
+  std::memcpy(&size, block, sizeof(size));
+  s_allocatedBytes.fetch_sub(size);
+  s_baseFree(block);
+}
+
+/// Routes the Recast allocations through the tracking allocator while in scope, and restores the previous allocator
+/// afterwards.
+struct ScopedAllocationTracking {
+  explicit ScopedAllocationTracking(const std::size_t memoryCap) {
+    s_allocatedBytes = 0;
+    s_peakBytes = 0;
+    s_capExceeded = false;
+    s_memoryCap = memoryCap;
+    rcAllocGetCustom(&s_baseAlloc, &s_baseFree);
+    rcAllocSetCustom(allocTracked, freeTracked);
+  }
+  ~ScopedAllocationTracking() { rcAllocSetCustom(s_baseAlloc, s_baseFree); }
+};
+
+/// Frees the intermediate and final results of a window on every return.
+struct WindowData {
+  rcHeightfield *solid{nullptr};
+  rcCompactHeightfield *chf{nullptr};
+  rcContourSet *cset{nullptr};
+  rcPolyMesh *pmesh{nullptr};
+  rcPolyMeshDetail *dmesh{nullptr};
+  ~WindowData() {
+    rcFreeHeightField(solid);
+    rcFreeCompactHeightfield(chf);
+    rcFreeContourSet(cset);
+    rcFreePolyMesh(pmesh);
+    rcFreePolyMeshDetail(dmesh);
+  }
+};
+
+template <typename T> void writeArray(std::ofstream &file, const T *data, const std::size_t count) {
+  file.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(sizeof(T) * count));
+}
+
+template <typename T> bool readArray(std::ifstream &file, T *data, const std::size_t count) {
+  return static_cast<bool>(file.read(reinterpret_cast<char *>(data), static_cast<std::streamsize>(sizeof(T) * count)));
+}
+
+/// A window to build: its origin and size in cells of the configured cell size, and the number of times its cell size
+/// is doubled.
+struct WindowRect {
+  int originX;
+  int originZ;
+  int sizeX;
+  int sizeZ;
+  int level;
+};
+
+/// A vertex on a portal edge of a built window: its cell coordinate along the boundary line it lies on, its height in
+/// cells, and the level of the window.
+struct BoundaryVertex {
+  int along;
+  int y;
+  int level;
+};
+
+/// The vertices the finer neighbours of a window have on its boundary, by portal direction, as cells along the boundary
+/// from its start and heights in cells.
+using SeamVertices = std::array<std::vector<std::array<int, 2>>, 4>;
+
+/// Hashes a vertex position by its bits. Positions are hashed with -0 turned into 0, so that equal positions hash the
+/// same.
+struct VertexPositionHash {
+  std::size_t operator()(const std::array<float, 3> &position) const {
+    std::uint32_t bits[3];
+    std::memcpy(bits, position.data(), sizeof(bits));
+    return static_cast<std::size_t>(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+  }
+};
+
+/// The state shared by the windows of a build.
+struct StreamedBuild {
+  rcContext &context;
+  const InputGeom &pGeom;
+  const rcConfig &config;
+  const StreamingBuildSettings &settings;
+  BuildCache *cache;
+  StreamingBuildStats &stats;
+  /// The walkable area of each triangle of the chunky mesh, classified once for the whole build.
+  std::vector<unsigned char> triareas;
+  /// The id of each mesh vertex, shared by the vertices at the same position. Only set with adaptive levels.
+  std::vector<int> vertexIds;
+  /// The portal edge vertices of the windows built so far, by the cell coordinate of the boundary line they lie on, for
+  /// the lines along z and the lines along x. Only kept with adaptive levels.
+  std::unordered_map<int, std::vector<BoundaryVertex>> linesX;
+  std::unordered_map<int, std::vector<BoundaryVertex>> linesZ;
+};
+
+/// Hashes everything the mesh of a window is built from: the window config, the build flags, the triangles of the
+/// overlapping chunks with their areas, the convex volumes overlapping the window and the seam vertices of its finer
+/// neighbours.
+BuildCacheKey hashWindowInputs(const StreamedBuild &build, const rcConfig &windowConfig, const int *chunkIds, const int chunkCount, const SeamVertices &seams) {
+  BuildCacheKey key;
+  key.add(STREAMED_WINDOW_BUILD_VERSION);
+  key.add(STREAMED_WINDOW_VERSION);
+  key.add(static_cast<std::uint32_t>(sizeof(rcMeshIndex)));
+  // rcConfig only holds 4-byte fields, so it has no padding to hash.
+  key.add(windowConfig);
+  key.add(build.settings.filterFlags);
+  key.add(build.settings.detailBuildFlags);
+
+  const float *verts = build.pGeom.getMesh()->getVerts();
+  const rcChunkyTriMesh &chunkyMesh = *build.pGeom.getChunkyMesh();
+  for (int i = 0; i < chunkCount; ++i) {
+    const rcChunkyTriMeshNode &node = chunkyMesh.nodes[chunkIds[i]];
+    const int *tris = &chunkyMesh.tris[node.i * 3];
+    for (int j = 0; j < node.n * 3; ++j)
+      key.add(&verts[tris[j] * 3], sizeof(float) * 3);
+    key.add(&build.triareas[static_cast<std::size_t>(node.i)], static_cast<std::size_t>(node.n));
+  }
+
+  const ConvexVolume *volumes = build.pGeom.getConvexVolumes();
+  for (int i = 0; i < build.pGeom.getConvexVolumeCount(); ++i) {
+    const ConvexVolume &volume = volumes[i];
+    float minX = volume.verts[0], maxX = volume.verts[0], minZ = volume.verts[2], maxZ = volume.verts[2];
+    for (int j = 1; j < volume.nverts; ++j) {
+      minX = std::min(minX, volume.verts[j * 3 + 0]);
+      maxX = std::max(maxX, volume.verts[j * 3 + 0]);
+      minZ = std::min(minZ, volume.verts[j * 3 + 2]);
+      maxZ = std::max(maxZ, volume.verts[j * 3 + 2]);
+    }
+    if (maxX < windowConfig.bmin[0] || minX > windowConfig.bmax[0] || maxZ < windowConfig.bmin[2] || minZ > windowConfig.bmax[2])
+      continue;
+    key.add(volume.verts, sizeof(float) * 3 * static_cast<std::size_t>(volume.nverts));
+    key.add(volume.hmin);
+    key.add(volume.hmax);
+    key.add(volume.area);
+  }
+
+  for (const std::vector<std::array<int, 2>> &seam : seams) {
+    key.add(static_cast<std::uint32_t>(seam.size()));
+    key.add(seam.data(), sizeof(std::array<int, 2>) * seam.size());
+  }
+  return key;
+}
+
+/// Returns the highest level up to @p level at which the window size is a whole number of cells.
+int alignedLevel(const int sizeX, const int sizeZ, int level) {
+  while (level > 0 && (sizeX % (1 << level) != 0 || sizeZ % (1 << level) != 0))
+    level--;
+  return level;
+}
+
+/// Returns the config of the window with the given cell origin and size, with its cell size doubled @p level times.
+/// The settings counted in cells are scaled to keep their size in world units, rounding the agent radius up and
+/// keeping a maximum edge length of at least one cell, so that coarse windows do not simplify their contours more
+/// loosely than fine ones.
+rcConfig makeWindowConfig(const rcConfig &config, const int originX, const int originZ, const int sizeX, const int sizeZ, const int level) {
+  const int scale = 1 << level;
+  rcConfig windowConfig = config;
+  windowConfig.cs = config.cs * static_cast<float>(scale);
+  windowConfig.walkableRadius = (config.walkableRadius + scale - 1) / scale;
+  windowConfig.maxEdgeLen = config.maxEdgeLen > 0 ? std::max(config.maxEdgeLen / scale, 1) : 0;
+  windowConfig.maxSimplificationError = config.maxSimplificationError / static_cast<float>(scale);
+  windowConfig.minRegionArea = config.minRegionArea / (scale * scale);
+  windowConfig.mergeRegionArea = config.mergeRegionArea / (scale * scale);
+  windowConfig.borderSize = windowConfig.walkableRadius + 3;
+  windowConfig.width = sizeX / scale + windowConfig.borderSize * 2;
+  windowConfig.height = sizeZ / scale + windowConfig.borderSize * 2;
+  windowConfig.bmin[0] = config.bmin[0] + static_cast<float>(originX - windowConfig.borderSize * scale) * config.cs;
+  windowConfig.bmin[2] = config.bmin[2] + static_cast<float>(originZ - windowConfig.borderSize * scale) * config.cs;
+  windowConfig.bmax[0] = windowConfig.bmin[0] + static_cast<float>(windowConfig.width) * windowConfig.cs;
+  windowConfig.bmax[2] = windowConfig.bmin[2] + static_cast<float>(windowConfig.height) * windowConfig.cs;
+  return windowConfig;
+}
+
+/// Marks the walkable triangles of the chunky mesh once for the whole build, as the slope limit is the same at every
+/// level.
+void classifyTriangles(StreamedBuild &build) {
+  const rcMeshLoaderObj &mesh = *build.pGeom.getMesh();
+  const rcChunkyTriMesh &chunkyMesh = *build.pGeom.getChunkyMesh();
+  build.triareas.assign(static_cast<std::size_t>(chunkyMesh.ntris), 0);
+  rcMarkWalkableTriangles(&build.context, build.config.walkableSlopeAngle, mesh.getVerts(), mesh.getVertCount(), chunkyMesh.tris, chunkyMesh.ntris, build.triareas.data());
+}
+
+/// Gives the mesh vertices at the same position the same id, so that edges can be matched by vertex position.
+void weldVertices(StreamedBuild &build) {
+  const rcMeshLoaderObj &mesh = *build.pGeom.getMesh();
+  const float *verts = mesh.getVerts();
+  std::unordered_map<std::array<float, 3>, int, VertexPositionHash> ids;
+  ids.reserve(static_cast<std::size_t>(mesh.getVertCount()));
+  build.vertexIds.resize(static_cast<std::size_t>(mesh.getVertCount()));
+  for (int i = 0; i < mesh.getVertCount(); ++i) {
+    const std::array<float, 3> position{verts[i * 3 + 0] + 0.0f, verts[i * 3 + 1] + 0.0f, verts[i * 3 + 2] + 0.0f};
+    build.vertexIds[i] = ids.emplace(position, static_cast<int>(ids.size())).first->second;
+  }
+}
+
+/// Finds the chunks overlapping the window.
+/// @returns The number of chunks.
+int findWindowChunks(const StreamedBuild &build, const rcConfig &windowConfig, std::vector<int> &chunkIds) {
+  const rcChunkyTriMesh &chunkyMesh = *build.pGeom.getChunkyMesh();
+  float rectMin[2] = {windowConfig.bmin[0], windowConfig.bmin[2]};
+  float rectMax[2] = {windowConfig.bmax[0], windowConfig.bmax[2]};
+  chunkIds.resize(static_cast<std::size_t>(chunkyMesh.nnodes));
+  return rcGetChunksOverlappingRect(&chunkyMesh, rectMin, rectMax, chunkIds.data(), static_cast<int>(chunkIds.size()));
+}
+
+/// Returns whether the xz-bounds of the points overlap the xz-bounds of the window.
+bool overlapsWindow(const rcConfig &windowConfig, const float *const *points, const int pointCount) {
+  float minX = points[0][0], maxX = points[0][0], minZ = points[0][2], maxZ = points[0][2];
+  for (int i = 1; i < pointCount; ++i) {
+    minX = std::min(minX, points[i][0]);
+    maxX = std::max(maxX, points[i][0]);
+    minZ = std::min(minZ, points[i][2]);
+    maxZ = std::max(maxZ, points[i][2]);
+  }
+  return maxX >= windowConfig.bmin[0] && minX <= windowConfig.bmax[0] && maxZ >= windowConfig.bmin[2] && minZ <= windowConfig.bmax[2];
+}
+
+/// Returns whether a walkable triangle rises more than the walkable climb over one cell of the window, which would
+/// cut the connections between its cells and let the ledge filter remove them.
+bool isSteeperThanCells(const float *const *points, const rcConfig &windowConfig) {
+  float e0[3], e1[3], normal[3];
+  rcVsub(e0, points[1], points[0]);
+  rcVsub(e1, points[2], points[0]);
+  rcVcross(normal, e0, e1);
+  // tan(slope) * cs > climb, without normalizing the normal.
+  const float horizontalSqr = normal[0] * normal[0] + normal[2] * normal[2];
+  const float climb = static_cast<float>(windowConfig.walkableClimb) * windowConfig.ch;
+  return horizontalSqr * windowConfig.cs * windowConfig.cs > climb * climb * normal[1] * normal[1];
+}
+
+/// Returns whether the window, including its border, overlaps geometry that needs the configured cell size: a steep
+/// triangle, a walkable triangle that rises more than the walkable climb over one cell of the window, an open edge of
+/// the walkable triangles or a convex volume. Edges are matched by welded vertex ids, so that duplicated vertices do
+/// not count as open edges.
+bool needsFineCells(const StreamedBuild &build, const rcConfig &windowConfig) {
+  const ConvexVolume *volumes = build.pGeom.getConvexVolumes();
+  for (int i = 0; i < build.pGeom.getConvexVolumeCount(); ++i) {
+    const ConvexVolume &volume = volumes[i];
+    const float *points[MAX_CONVEXVOL_PTS];
+    for (int j = 0; j < volume.nverts; ++j)
+      points[j] = &volume.verts[j * 3];
+    if (volume.nverts > 0 && overlapsWindow(windowConfig, points, volume.nverts))
+      return true;
+  }
+
+  std::vector<int> chunkIds;
+  const int chunkCount = findWindowChunks(build, windowConfig, chunkIds);
+  const float *verts = build.pGeom.getMesh()->getVerts();
+  const rcChunkyTriMesh &chunkyMesh = *build.pGeom.getChunkyMesh();
+  std::vector<std::pair<int, int>> edges;
+  std::vector<std::pair<const float *, const float *>> edgeVerts;
+  for (int i = 0; i < chunkCount; ++i) {
+    const rcChunkyTriMeshNode &node = chunkyMesh.nodes[chunkIds[i]];
+    for (int j = 0; j < node.n; ++j) {
+      const int *tri = &chunkyMesh.tris[(node.i + j) * 3];
+      const float *points[3] = {&verts[tri[0] * 3], &verts[tri[1] * 3], &verts[tri[2] * 3]};
+      const bool walkable = build.triareas[static_cast<std::size_t>(node.i + j)] != RC_NULL_AREA;
+      if ((!walkable || isSteeperThanCells(points, windowConfig)) && overlapsWindow(windowConfig, points, 3))
+        return true;
+      if (!walkable)
+        continue;
+      for (int k = 0; k < 3; ++k) {
+        const int a = build.vertexIds[tri[k]], b = build.vertexIds[tri[(k + 1) % 3]];
+        edges.emplace_back(std::min(a, b), std::max(a, b));
+        edgeVerts.emplace_back(points[k], points[(k + 1) % 3]);
+      }
+    }
+  }
+
+  // An edge of a single walkable triangle borders unwalkable space, so the window needs fine cells where it lies.
+  std::vector<int> order(edges.size());
+  for (std::size_t i = 0; i < order.size(); ++i)
+    order[i] = static_cast<int>(i);
+  std::sort(order.begin(), order.end(), [&](const int a, const int b) { return edges[a] < edges[b]; });
+  for (std::size_t i = 0; i < order.size();) {
+    std::size_t j = i + 1;
+    while (j < order.size() && edges[order[j]] == edges[order[i]])
+      ++j;
+    const float *points[2] = {edgeVerts[order[i]].first, edgeVerts[order[i]].second};
+    if (j - i == 1 && overlapsWindow(windowConfig, points, 2))
+      return true;
+    i = j;
+  }
+  return false;
+}
+
+/// Returns the cell coordinate of the boundary line of the window in the given portal direction.
+int boundaryLine(const WindowRect &rect, const int dir) {
+  switch (dir) {
+  case 0:
+    return rect.originX;
+  case 1:
+    return rect.originZ + rect.sizeZ;
+  case 2:
+    return rect.originX + rect.sizeX;
+  default:
+    return rect.originZ;
+  }
+}
+
+/// Returns the cell coordinate of a mesh vertex along the boundary line in the given portal direction.
+int alongBoundary(const rcMeshIndex *vertex, const int dir) { return static_cast<int>(dir == 0 || dir == 2 ? vertex[2] : vertex[0]); }
+
+/// Adds the vertices on the portal edges of the window to the boundary lines of the build.
+void addBoundaryVertices(StreamedBuild &build, const WindowRect &rect, const rcPolyMesh &mesh) {
+  const int unit = static_cast<int>(std::lround(mesh.cs / build.config.cs));
+  const int nvp = mesh.nvp;
+  for (int i = 0; i < mesh.npolys; ++i) {
+    const rcMeshIndex *poly = &mesh.polys[i * 2 * nvp];
+    for (int j = 0; j < nvp && poly[j] != RC_MESH_NULL_IDX; ++j) {
+      const rcMeshIndex neighbour = poly[nvp + j];
+      if (neighbour == RC_MESH_NULL_IDX || !(neighbour & RC_MESH_PORTAL_FLAG))
+        continue;
+      const int dir = static_cast<int>(neighbour & 0xf);
+      const int nj = j + 1 < nvp && poly[j + 1] != RC_MESH_NULL_IDX ? j + 1 : 0;
+      const int start = dir == 0 || dir == 2 ? rect.originZ : rect.originX;
+      std::vector<BoundaryVertex> &line = (dir == 0 || dir == 2 ? build.linesX : build.linesZ)[boundaryLine(rect, dir)];
+      for (const int k : {j, nj}) {
+        const rcMeshIndex *vertex = &mesh.verts[poly[k] * 3];
+        line.push_back({start + alongBoundary(vertex, dir) * unit, static_cast<int>(vertex[1]), rect.level});
+      }
+    }
+  }
+}
+
+/// Finds the vertices that the finer windows built before the window have strictly inside its boundary lines. Of the
+/// vertices the neighbours have at the same cell, the first one is kept.
+void findSeamVertices(const StreamedBuild &build, const WindowRect &rect, SeamVertices &seams) {
+  for (int dir = 0; dir < 4; ++dir) {
+    const std::unordered_map<int, std::vector<BoundaryVertex>> &lines = dir == 0 || dir == 2 ? build.linesX : build.linesZ;
+    const auto line = lines.find(boundaryLine(rect, dir));
+    if (line == lines.end())
+      continue;
+    const int start = dir == 0 || dir == 2 ? rect.originZ : rect.originX;
+    const int length = dir == 0 || dir == 2 ? rect.sizeZ : rect.sizeX;
+    std::vector<std::array<int, 2>> &seam = seams[dir];
+    for (const BoundaryVertex &vertex : line->second) {
+      if (vertex.level < rect.level && vertex.along > start && vertex.along < start + length)
+        seam.push_back({vertex.along - start, vertex.y});
+    }
+    const auto byAlong = [](const std::array<int, 2> &a, const std::array<int, 2> &b) { return a[0] < b[0]; };
+    std::stable_sort(seam.begin(), seam.end(), byAlong);
+    seam.erase(std::unique(seam.begin(), seam.end(), [](const std::array<int, 2> &a, const std::array<int, 2> &b) { return a[0] == b[0]; }), seam.end());
+  }
+}
+
+/// Returns twice the signed area of the polygon of the given points. [Units: cells^2]
+long long polygonArea(const std::vector<std::array<int, 2>> &points, const std::vector<int> &ids) {
+  long long area = 0;
+  for (std::size_t i = 0, j = ids.size() - 1; i < ids.size(); j = i++)
+    area += static_cast<long long>(points[ids[j]][0]) * points[ids[i]][1] - static_cast<long long>(points[ids[i]][0]) * points[ids[j]][1];
+  return area;
+}
+
+/// Splits the convex polygon of the points into convex pieces of at most @p maxVerts points that all have an area.
+/// The points may be collinear along the edges of the polygon. The pieces keep the winding of the polygon.
+/// @returns False if the polygon has no area.
+bool splitConvexPolygon(const std::vector<std::array<int, 2>> &points, const int maxVerts, std::vector<std::vector<int>> &pieces) {
+  std::vector<int> remaining(points.size());
+  for (std::size_t i = 0; i < remaining.size(); ++i)
+    remaining[i] = static_cast<int>(i);
+  while (static_cast<int>(remaining.size()) > maxVerts) {
+    // Cut off the largest run of points that leaves an area on both sides of the cut.
+    const int count = static_cast<int>(remaining.size());
+    bool cut = false;
+    for (int pieceCount = maxVerts; pieceCount >= 3 && !cut; --pieceCount) {
+      for (int start = 0; start < count && !cut; ++start) {
+        std::vector<int> piece, rest;
+        for (int k = 0; k < pieceCount; ++k)
+          piece.push_back(remaining[(start + k) % count]);
+        for (int k = pieceCount - 1; k <= count; ++k)
+          rest.push_back(remaining[(start + k) % count]);
+        if (polygonArea(points, piece) != 0 && polygonArea(points, rest) != 0) {
+          pieces.push_back(piece);
+          remaining.swap(rest);
+          cut = true;
+        }
+      }
+    }
+    if (!cut)
+      return false;
+  }
+  if (polygonArea(points, remaining) == 0)
+    return false;
+  pieces.push_back(remaining);
+  return true;
+}
+
+// Matches DT_DETAIL_EDGE_BOUNDARY.
+const int DETAIL_EDGE_BOUNDARY = 0x1;
+
+/// Splits the detail triangle with the boundary edge the detail vertex lies on into two triangles at the vertex. When
+/// the detail mesh already has a boundary vertex there, such as a height sample of the polygon edge, the triangles use
+/// the detail vertex in its place instead.
+/// @returns False if no boundary edge passes through the vertex.
+bool splitDetailTriangle(const std::vector<float> &verts, std::vector<unsigned char> &tris, const int vertex, const float tolerance) {
+  const float *point = &verts[vertex * 3];
+  for (std::size_t i = 0; i < tris.size(); i += 4) {
+    for (int e = 0; e < 3; ++e) {
+      const unsigned char a = tris[i + e];
+      if (((tris[i + 3] >> (e * 2)) & DETAIL_EDGE_BOUNDARY) == 0 || a == vertex)
+        continue;
+      if (std::fabs(verts[a * 3 + 0] - point[0]) > tolerance || std::fabs(verts[a * 3 + 2] - point[2]) > tolerance)
+        continue;
+      for (std::size_t j = 0; j < tris.size(); ++j) {
+        if (j % 4 != 3 && tris[j] == a)
+          tris[j] = static_cast<unsigned char>(vertex);
+      }
+      return true;
+    }
+  }
+  for (std::size_t i = 0; i < tris.size(); i += 4) {
+    for (int e = 0; e < 3; ++e) {
+      if (((tris[i + 3] >> (e * 2)) & DETAIL_EDGE_BOUNDARY) == 0)
+        continue;
+      const unsigned char a = tris[i + e], b = tris[i + (e + 1) % 3], c = tris[i + (e + 2) % 3];
+      const float dx = verts[b * 3 + 0] - verts[a * 3 + 0];
+      const float dz = verts[b * 3 + 2] - verts[a * 3 + 2];
+      const float px = point[0] - verts[a * 3 + 0];
+      const float pz = point[2] - verts[a * 3 + 2];
+      const float lengthSqr = dx * dx + dz * dz;
+      const float t = dx * px + dz * pz;
+      if (t <= 0.0f || t >= lengthSqr || std::fabs(dx * pz - dz * px) > tolerance * std::sqrt(lengthSqr))
+        continue;
+      // The triangle becomes (a, vertex, c) and (vertex, b, c) is added, keeping the flags of the edges to c.
+      const int flagsBC = (tris[i + 3] >> ((e + 1) % 3 * 2)) & 3;
+      const int flagsCA = (tris[i + 3] >> ((e + 2) % 3 * 2)) & 3;
+      const unsigned char split = static_cast<unsigned char>(vertex);
+      tris[i + 0] = a;
+      tris[i + 1] = split;
+      tris[i + 2] = c;
+      tris[i + 3] = static_cast<unsigned char>(DETAIL_EDGE_BOUNDARY | flagsCA << 4);
+      const unsigned char added[4] = {split, b, c, static_cast<unsigned char>(DETAIL_EDGE_BOUNDARY | flagsBC << 2)};
+      tris.insert(tris.end(), added, added + 4);
+      return true;
+    }
+  }
+  return false;
+}
+
+/// A polygon of a window with the seam vertices inserted, with its detail mesh.
+struct SeamPolygon {
+  int source;
+  std::vector<rcMeshIndex> verts;
+  std::vector<rcMeshIndex> neighbours;
+  std::vector<float> detailVerts;
+  std::vector<unsigned char> detailTris;
+};
+
+/// Inserts the seam vertices into the portal edges of the window, so that its edges meet the vertices of its finer
+/// neighbours without T-junctions. The mesh is converted to the configured cell size first, in which the vertices of
+/// the finer windows lie on whole cells. The detail triangles along an edge are split at the inserted vertices. A
+/// polygon that ends up with more than nvp vertices is split into convex pieces, whose detail meshes are the
+/// triangulated pieces.
+bool insertSeamVertices(rcContext &context, const rcConfig &config, const WindowRect &rect, const SeamVertices &seams, rcPolyMesh &mesh, rcPolyMeshDetail &detailMesh) {
+  if (std::all_of(seams.begin(), seams.end(), [](const std::vector<std::array<int, 2>> &seam) { return seam.empty(); }))
+    return true;
+
+  const int scale = 1 << rect.level;
+  const int nvp = mesh.nvp;
+  std::vector<rcMeshIndex> verts(mesh.verts, mesh.verts + mesh.nverts * 3);
+  for (std::size_t i = 0; i < verts.size(); i += 3) {
+    verts[i + 0] = static_cast<rcMeshIndex>(verts[i + 0] * scale);
+    verts[i + 2] = static_cast<rcMeshIndex>(verts[i + 2] * scale);
+  }
+  mesh.cs = config.cs;
+  mesh.maxEdgeError *= static_cast<float>(scale);
+  // The detail mesh places the polygon vertices one cell above the polygon mesh.
+  const auto detailPosition = [&](const rcMeshIndex *vertex, float *position) {
+    position[0] = static_cast<float>(vertex[0]) * mesh.cs + mesh.bmin[0];
+    position[1] = static_cast<float>(vertex[1]) * mesh.ch + (mesh.bmin[1] + mesh.ch);
+    position[2] = static_cast<float>(vertex[2]) * mesh.cs + mesh.bmin[2];
+  };
+
+  std::vector<SeamPolygon> polys(static_cast<std::size_t>(mesh.npolys));
+  std::vector<std::vector<int>> pieceIds(static_cast<std::size_t>(mesh.npolys));
+  for (int i = 0; i < mesh.npolys; ++i) {
+    const rcMeshIndex *poly = &mesh.polys[i * 2 * nvp];
+    const unsigned int *detail = &detailMesh.meshes[i * 4];
+    int vertCount = 0;
+    while (vertCount < nvp && poly[vertCount] != RC_MESH_NULL_IDX)
+      vertCount++;
+
+    SeamPolygon polygon{i, {}, {}, {}, {}};
+    // The detail vertex of each polygon vertex, or -1 for an inserted vertex.
+    std::vector<int> detailIds;
+    for (int j = 0; j < vertCount; ++j) {
+      const rcMeshIndex neighbour = poly[nvp + j];
+      polygon.verts.push_back(poly[j]);
+      polygon.neighbours.push_back(neighbour);
+      detailIds.push_back(j);
+      if (neighbour == RC_MESH_NULL_IDX || !(neighbour & RC_MESH_PORTAL_FLAG))
+        continue;
+      const int dir = static_cast<int>(neighbour & 0xf);
+      const int a = alongBoundary(&verts[poly[j] * 3], dir);
+      const int b = alongBoundary(&verts[poly[(j + 1) % vertCount] * 3], dir);
+      const std::vector<std::array<int, 2>> &seam = seams[dir];
+      for (std::size_t k = 0; k < seam.size(); ++k) {
+        const std::array<int, 2> &seamVertex = seam[a < b ? k : seam.size() - 1 - k];
+        if (seamVertex[0] <= std::min(a, b) || seamVertex[0] >= std::max(a, b))
+          continue;
+        const int x = dir == 0 ? 0 : dir == 2 ? rect.sizeX : seamVertex[0];
+        const int z = dir == 3 ? 0 : dir == 1 ? rect.sizeZ : seamVertex[0];
+        polygon.verts.push_back(static_cast<rcMeshIndex>(verts.size() / 3));
+        polygon.neighbours.push_back(neighbour);
+        detailIds.push_back(-1);
+        verts.push_back(static_cast<rcMeshIndex>(x));
+        verts.push_back(static_cast<rcMeshIndex>(seamVertex[1]));
+        verts.push_back(static_cast<rcMeshIndex>(z));
+      }
+    }
+
+    const float *oldDetailVerts = &detailMesh.verts[detail[0] * 3];
+    const unsigned char *oldDetailTris = &detailMesh.tris[detail[2] * 4];
+    const int count = static_cast<int>(polygon.verts.size());
+    if (count == vertCount) {
+      polygon.detailVerts.assign(oldDetailVerts, oldDetailVerts + detail[1] * 3);
+      polygon.detailTris.assign(oldDetailTris, oldDetailTris + detail[3] * 4);
+      polys[i] = std::move(polygon);
+      pieceIds[i].push_back(i);
+      continue;
+    }
+
+    // The detail mesh starts with the polygon vertices, followed by the samples of the old detail mesh.
+    std::vector<float> polyVerts(static_cast<std::size_t>(count) * 3);
+    std::vector<int> detailRemap(detail[1]);
+    for (int j = 0; j < count; ++j) {
+      if (detailIds[j] < 0) {
+        detailPosition(&verts[polygon.verts[j] * 3], &polyVerts[j * 3]);
+      } else {
+        std::copy(oldDetailVerts + detailIds[j] * 3, oldDetailVerts + detailIds[j] * 3 + 3, &polyVerts[j * 3]);
+        detailRemap[detailIds[j]] = j;
+      }
+    }
+
+    if (count <= nvp) {
+      if (count + static_cast<int>(detail[1]) - vertCount > 255) {
+        context.log(RC_LOG_ERROR, "buildStreamed: Too many detail vertices after inserting the seam vertices of window (%d, %d).", rect.originX, rect.originZ);
+        return false;
+      }
+      polygon.detailVerts = polyVerts;
+      polygon.detailVerts.insert(polygon.detailVerts.end(), oldDetailVerts + vertCount * 3, oldDetailVerts + detail[1] * 3);
+      for (int j = vertCount; j < static_cast<int>(detail[1]); ++j)
+        detailRemap[j] = count + j - vertCount;
+      for (unsigned int j = 0; j < detail[3] * 4; ++j)
+        polygon.detailTris.push_back(j % 4 == 3 ? oldDetailTris[j] : static_cast<unsigned char>(detailRemap[oldDetailTris[j]]));
+      for (int j = 0; j < count; ++j) {
+        if (detailIds[j] < 0 && !splitDetailTriangle(polygon.detailVerts, polygon.detailTris, j, config.cs * 0.01f)) {
+          context.log(RC_LOG_ERROR, "buildStreamed: No detail edge for a seam vertex of window (%d, %d).", rect.originX, rect.originZ);
+          return false;
+        }
+      }
+      polys[i] = std::move(polygon);
+      pieceIds[i].push_back(i);
+      continue;
+    }
+
+    std::vector<std::array<int, 2>> points(static_cast<std::size_t>(count));
+    for (int j = 0; j < count; ++j)
+      points[j] = {static_cast<int>(verts[polygon.verts[j] * 3 + 0]), static_cast<int>(verts[polygon.verts[j] * 3 + 2])};
+    std::vector<std::vector<int>> pieces;
+    if (!splitConvexPolygon(points, nvp, pieces)) {
+      context.log(RC_LOG_ERROR, "buildStreamed: Could not split a polygon with seam vertices of window (%d, %d).", rect.originX, rect.originZ);
+      return false;
+    }
+    for (std::size_t p = 0; p < pieces.size(); ++p) {
+      const std::vector<int> &piece = pieces[p];
+      const int pieceCount = static_cast<int>(piece.size());
+      SeamPolygon piecePolygon{i, {}, {}, {}, {}};
+      std::vector<std::array<int, 2>> piecePoints;
+      for (int k = 0; k < pieceCount; ++k) {
+        // An edge between points that do not follow each other is a cut, linked to the piece on its other side below.
+        const int from = piece[k], to = piece[(k + 1) % pieceCount];
+        piecePolygon.verts.push_back(polygon.verts[from]);
+        piecePolygon.neighbours.push_back(to == (from + 1) % count ? polygon.neighbours[from] : static_cast<rcMeshIndex>(i));
+        piecePolygon.detailVerts.insert(piecePolygon.detailVerts.end(), &polyVerts[from * 3], &polyVerts[from * 3] + 3);
+        piecePoints.push_back(points[from]);
+      }
+      std::vector<std::vector<int>> triangles;
+      splitConvexPolygon(piecePoints, 3, triangles);
+      for (const std::vector<int> &triangle : triangles) {
+        int flags = 0;
+        for (int e = 0; e < 3; ++e)
+          flags |= (triangle[(e + 1) % 3] == (triangle[e] + 1) % pieceCount ? DETAIL_EDGE_BOUNDARY : 0) << (e * 2);
+        const unsigned char tri[4] = {static_cast<unsigned char>(triangle[0]), static_cast<unsigned char>(triangle[1]), static_cast<unsigned char>(triangle[2]), static_cast<unsigned char>(flags)};
+        piecePolygon.detailTris.insert(piecePolygon.detailTris.end(), tri, tri + 4);
+      }
+      if (p == 0) {
+        polys[i] = std::move(piecePolygon);
+        pieceIds[i].push_back(i);
+      } else {
+        pieceIds[i].push_back(static_cast<int>(polys.size()));
+        polys.push_back(std::move(piecePolygon));
+      }
+    }
+  }
+
+  // Link the edges between polygons to the piece of the neighbour that holds the edge.
+  for (SeamPolygon &polygon : polys) {
+    const std::size_t count = polygon.verts.size();
+    for (std::size_t j = 0; j < count; ++j) {
+      rcMeshIndex &neighbour = polygon.neighbours[j];
+      if (neighbour == RC_MESH_NULL_IDX || (neighbour & RC_MESH_PORTAL_FLAG) || pieceIds[neighbour].size() == 1)
+        continue;
+      const rcMeshIndex a = polygon.verts[j], b = polygon.verts[(j + 1) % count];
+      for (const int candidate : pieceIds[neighbour]) {
+        const std::vector<rcMeshIndex> &candidateVerts = polys[candidate].verts;
+        for (std::size_t k = 0; k < candidateVerts.size(); ++k) {
+          if (candidateVerts[k] == b && candidateVerts[(k + 1) % candidateVerts.size()] == a)
+            neighbour = static_cast<rcMeshIndex>(candidate);
+        }
+      }
+    }
+  }
+
+  const int polyCount = static_cast<int>(polys.size());
+  std::size_t detailVertCount = 0, detailTriCount = 0;
+  for (const SeamPolygon &polygon : polys) {
+    detailVertCount += polygon.detailVerts.size() / 3;
+    detailTriCount += polygon.detailTris.size() / 4;
+  }
+  rcMeshIndex *newVerts = static_cast<rcMeshIndex *>(rcAlloc(sizeof(rcMeshIndex) * verts.size(), RC_ALLOC_PERM));
+  rcMeshIndex *newPolys = static_cast<rcMeshIndex *>(rcAlloc(sizeof(rcMeshIndex) * polyCount * 2 * nvp, RC_ALLOC_PERM));
+  unsigned short *newRegs = static_cast<unsigned short *>(rcAlloc(sizeof(unsigned short) * polyCount, RC_ALLOC_PERM));
+  unsigned short *newFlags = static_cast<unsigned short *>(rcAlloc(sizeof(unsigned short) * polyCount, RC_ALLOC_PERM));
+  unsigned char *newAreas = static_cast<unsigned char *>(rcAlloc(sizeof(unsigned char) * polyCount, RC_ALLOC_PERM));
+  unsigned int *newMeshes = static_cast<unsigned int *>(rcAlloc(sizeof(unsigned int) * polyCount * 4, RC_ALLOC_PERM));
+  float *newDetailVerts = static_cast<float *>(rcAlloc(sizeof(float) * detailVertCount * 3, RC_ALLOC_PERM));
+  unsigned char *newDetailTris = static_cast<unsigned char *>(rcAlloc(sizeof(unsigned char) * detailTriCount * 4, RC_ALLOC_PERM));
+  if (!newVerts || !newPolys || !newRegs || !newFlags || !newAreas || !newMeshes || !newDetailVerts || !newDetailTris) {
+    for (void *ptr : {static_cast<void *>(newVerts), static_cast<void *>(newPolys), static_cast<void *>(newRegs), static_cast<void *>(newFlags), static_cast<void *>(newAreas), static_cast<void *>(newMeshes), static_cast<void *>(newDetailVerts), static_cast<void *>(newDetailTris)})
+      rcFree(ptr);
+    context.log(RC_LOG_ERROR, "buildStreamed: Out of memory 'seam' (%d).", polyCount);
+    return false;
+  }
+
+  std::copy(verts.begin(), verts.end(), newVerts);
+  std::fill(newPolys, newPolys + polyCount * 2 * nvp, RC_MESH_NULL_IDX);
+  unsigned int vertBase = 0, triBase = 0;
+  for (int i = 0; i < polyCount; ++i) {
+    const SeamPolygon &polygon = polys[i];
+    std::copy(polygon.verts.begin(), polygon.verts.end(), &newPolys[i * 2 * nvp]);
+    std::copy(polygon.neighbours.begin(), polygon.neighbours.end(), &newPolys[i * 2 * nvp + nvp]);
+    newRegs[i] = mesh.regs[polygon.source];
+    newFlags[i] = mesh.flags[polygon.source];
+    newAreas[i] = mesh.areas[polygon.source];
+    const unsigned int vertCount = static_cast<unsigned int>(polygon.detailVerts.size() / 3);
+    const unsigned int triCount = static_cast<unsigned int>(polygon.detailTris.size() / 4);
+    const unsigned int submesh[4] = {vertBase, vertCount, triBase, triCount};
+    std::copy(submesh, submesh + 4, &newMeshes[i * 4]);
+    std::copy(polygon.detailVerts.begin(), polygon.detailVerts.end(), &newDetailVerts[vertBase * 3]);
+    std::copy(polygon.detailTris.begin(), polygon.detailTris.end(), &newDetailTris[triBase * 4]);
+    vertBase += vertCount;
+    triBase += triCount;
+  }
+
+  rcFree(mesh.verts);
+  rcFree(mesh.polys);
+  rcFree(mesh.regs);
+  rcFree(mesh.flags);
+  rcFree(mesh.areas);
+  rcFree(detailMesh.meshes);
+  rcFree(detailMesh.verts);
+  rcFree(detailMesh.tris);
+  mesh.verts = newVerts;
+  mesh.polys = newPolys;
+  mesh.regs = newRegs;
+  mesh.flags = newFlags;
+  mesh.areas = newAreas;
+  mesh.nverts = static_cast<int>(verts.size() / 3);
+  mesh.npolys = polyCount;
+  mesh.maxpolys = polyCount;
+  detailMesh.meshes = newMeshes;
+  detailMesh.verts = newDetailVerts;
+  detailMesh.tris = newDetailTris;
+  detailMesh.nmeshes = polyCount;
+  detailMesh.nverts = static_cast<int>(detailVertCount);
+  detailMesh.ntris = static_cast<int>(detailTriCount);
+  return true;
+}
+
+/// Builds the window at its level, splitting it when it exceeds the memory cap. With adaptive levels, the seam vertices
+/// of its finer neighbours are inserted into its portal edges, and its own portal edge vertices are kept for the
+/// coarser windows built after it.
+bool buildWindow(StreamedBuild &build, const WindowRect &rect) {
+  rcContext &context = build.context;
+  const StreamingBuildSettings &settings = build.settings;
+  StreamingBuildStats &stats = build.stats;
+  stats.windowCount++;
+  s_capExceeded = false;
+
+  const rcConfig windowConfig = makeWindowConfig(build.config, rect.originX, rect.originZ, rect.sizeX, rect.sizeZ, rect.level);
+  if (rect.level > 0)
+    stats.coarseWindowCount++;
+  stats.cellCount += static_cast<std::size_t>(windowConfig.width) * static_cast<std::size_t>(windowConfig.height);
+
+  const rcMeshLoaderObj &mesh = *build.pGeom.getMesh();
+  const rcChunkyTriMesh &chunkyMesh = *build.pGeom.getChunkyMesh();
+  std::vector<int> chunkIds;
+  const int chunkCount = findWindowChunks(build, windowConfig, chunkIds);
+  const bool keepBoundaries = settings.adaptiveLevels > 0;
+  SeamVertices seams;
+  if (rect.level > 0)
+    findSeamVertices(build, rect, seams);
+
+  const std::string filePath = settings.outputDirectory + "/window_" + std::to_string(rect.originX) + "_" + std::to_string(rect.originZ) + ".bin";
+  BuildCacheKey key;
+  if (build.cache) {
+    key = hashWindowInputs(build, windowConfig, chunkIds.data(), chunkCount, seams);
+    bool hasOutput = false;
+    if (build.cache->fetch(key, filePath, hasOutput)) {
+      if (!hasOutput) {
+        std::remove(filePath.c_str());
+        return true;
+      }
+      stats.writtenCount++;
+      if (!keepBoundaries)
+        return true;
+      WindowData window;
+      window.pmesh = rcAllocPolyMesh();
+      window.dmesh = rcAllocPolyMeshDetail();
+      if (!window.pmesh || !window.dmesh || !loadStreamedWindow(context, filePath, *window.pmesh, *window.dmesh))
+        return false;
+      addBoundaryVertices(build, rect, *window.pmesh);
+      return true;
+    }
+  }
+
+  // A window without polygons has no file, so the file of an earlier build of the window must not stay behind.
+  const auto storeEmptyWindow = [&]() {
+    std::remove(filePath.c_str());
+    return !build.cache || build.cache->store(key, {});
+  };
+
+  bool built = false;
+  {
+    WindowData window;
+    built = [&]() {
+      window.solid = rcAllocHeightfield();
+      if (!window.solid || !rcCreateHeightfield(&context, *window.solid, windowConfig.width, windowConfig.height, windowConfig.bmin, windowConfig.bmax, windowConfig.cs, windowConfig.ch)) {
+        context.log(RC_LOG_ERROR, "buildStreamed: Could not create solid heightfield.");
+        return false;
+      }
+
+      for (int i = 0; i < chunkCount; ++i) {
+        const rcChunkyTriMeshNode &node = chunkyMesh.nodes[chunkIds[i]];
+        if (!rcRasterizeTriangles(&context, mesh.getVerts(), mesh.getVertCount(), &chunkyMesh.tris[node.i * 3], &build.triareas[static_cast<std::size_t>(node.i)], node.n, *window.solid, windowConfig.walkableClimb)) {
+          context.log(RC_LOG_ERROR, "buildStreamed: Could not rasterize triangles.");
+          return false;
+        }
+      }
+      rcFilterWalkableSpans(&context, settings.filterFlags, windowConfig.walkableHeight, windowConfig.walkableClimb, *window.solid);
+
+      window.chf = rcAllocCompactHeightfield();
+      if (!window.chf || !rcBuildCompactHeightfield(&context, windowConfig.walkableHeight, windowConfig.walkableClimb, *window.solid, *window.chf)) {
+        context.log(RC_LOG_ERROR, "buildStreamed: Could not build compact data.");
+        return false;
+      }
+      rcFreeHeightField(window.solid);
+      window.solid = nullptr;
+
+      if (!rcErodeWalkableArea(&context, windowConfig.walkableRadius, *window.chf) ||
+          !markConvexVolumes(context, build.pGeom, *window.chf) ||
+          !rcBuildDistanceField(&context, *window.chf) ||
+          !rcBuildRegions(&context, *window.chf, windowConfig.borderSize, windowConfig.minRegionArea, windowConfig.mergeRegionArea)) {
+        context.log(RC_LOG_ERROR, "buildStreamed: Could not build regions.");
+        return false;
+      }
+
+      window.cset = rcAllocContourSet();
+      if (!window.cset || !rcBuildContours(&context, *window.chf, windowConfig.maxSimplificationError, windowConfig.maxEdgeLen, *window.cset)) {
+        context.log(RC_LOG_ERROR, "buildStreamed: Could not create contours.");
+        return false;
+      }
+      if (window.cset->nconts == 0)
+        return storeEmptyWindow();
+
+      window.pmesh = rcAllocPolyMesh();
+      if (!window.pmesh || !rcBuildPolyMesh(&context, *window.cset, windowConfig.maxVertsPerPoly, *window.pmesh)) {
+        context.log(RC_LOG_ERROR, "buildStreamed: Could not triangulate contours.");
+        return false;
+      }
+      rcFreeContourSet(window.cset);
+      window.cset = nullptr;
+
+      window.dmesh = rcAllocPolyMeshDetail();
+      if (!window.dmesh || !rcBuildPolyMeshDetail(&context, *window.pmesh, *window.chf, windowConfig.detailSampleDist, windowConfig.detailSampleMaxError, *window.dmesh, settings.detailBuildFlags)) {
+        context.log(RC_LOG_ERROR, "buildStreamed: Could not build detail mesh.");
+        return false;
+      }
+      rcFreeCompactHeightfield(window.chf);
+      window.chf = nullptr;
+
+      if (window.pmesh->npolys == 0)
+        return storeEmptyWindow();
+      if (!insertSeamVertices(context, build.config, rect, seams, *window.pmesh, *window.dmesh))
+        return false;
+      if (!writeStreamedWindow(filePath, *window.pmesh, *window.dmesh)) {
+        context.log(RC_LOG_ERROR, "buildStreamed: Could not write '%s'.", filePath.c_str());
+        return false;
+      }
+      stats.writtenCount++;
+      stats.polyCount += window.pmesh->npolys;
+      if (build.cache && !build.cache->store(key, filePath))
+        context.log(RC_LOG_WARNING, "buildStreamed: Could not store '%s' in the build cache.", filePath.c_str());
+      if (keepBoundaries)
+        addBoundaryVertices(build, rect, *window.pmesh);
+      return true;
+    }();
+  }
+  if (built)
+    return true;
+
+  // Split windows that ran out of the memory cap into quadrants. The quadrants keep the level of the window and are
+  // split along its cells, as its neighbours were planned, and may already be built, against that level.
+  const int scale = 1 << rect.level;
+  const int halfX = (rect.sizeX / scale + 1) / 2 * scale;
+  const int halfZ = (rect.sizeZ / scale + 1) / 2 * scale;
+  if (!s_capExceeded || std::max(halfX, halfZ) < settings.minWindowSize || (halfX == rect.sizeX && halfZ == rect.sizeZ))
+    return false;
+  context.log(RC_LOG_WARNING, "buildStreamed: Window (%d, %d) exceeds the memory cap, splitting it.", rect.originX, rect.originZ);
+  stats.splitCount++;
+  for (int z = rect.originZ; z < rect.originZ + rect.sizeZ; z += halfZ) {
+    for (int x = rect.originX; x < rect.originX + rect.sizeX; x += halfX) {
+      const int quadrantX = std::min(halfX, rect.originX + rect.sizeX - x);
+      const int quadrantZ = std::min(halfZ, rect.originZ + rect.sizeZ - z);
+      if (!buildWindow(build, {x, z, quadrantX, quadrantZ, rect.level}))
+        return false;
+    }
+  }
+  return true;
+}
+
+/// Adds the windows of the quadtree node at the given depth. The cell size of a node is doubled once for every level
+/// it lies above the bottom of the quadtree, so that the nodes of every depth have about as many cells. A node with
+/// geometry that needs fine cells is split into quadrants, down to the bottom of the quadtree or the minimum window
+/// size, where it is built with the configured cell size.
+void addAdaptiveWindows(const StreamedBuild &build, const int originX, const int originZ, const int sizeX, const int sizeZ, const int depth, std::vector<WindowRect> &windows) {
+  const int level = alignedLevel(sizeX, sizeZ, std::max(build.settings.adaptiveLevels - depth, 0));
+  if (level == 0 || !needsFineCells(build, makeWindowConfig(build.config, originX, originZ, sizeX, sizeZ, level))) {
+    windows.push_back({originX, originZ, sizeX, sizeZ, level});
+    return;
+  }
+
+  const int halfX = (sizeX + 1) / 2;
+  const int halfZ = (sizeZ + 1) / 2;
+  if (std::max(halfX, halfZ) < build.settings.minWindowSize) {
+    windows.push_back({originX, originZ, sizeX, sizeZ, 0});
+    return;
+  }
+  for (int z = originZ; z < originZ + sizeZ; z += halfZ) {
+    for (int x = originX; x < originX + sizeX; x += halfX)
+      addAdaptiveWindows(build, x, z, std::min(halfX, originX + sizeX - x), std::min(halfZ, originZ + sizeZ - z), depth + 1, windows);
+  }
+}
+} // namespace
+
+bool generateStreamed(rcContext &context, const InputGeom &pGeom, const rcConfig &config, const StreamingBuildSettings &settings, StreamingBuildStats &stats) {
+  if (!pGeom.getMesh() || !pGeom.getChunkyMesh()) {
+    context.log(RC_LOG_ERROR, "buildStreamed: Input mesh is not specified.");
+    return false;
+  }
+
+  stats = StreamingBuildStats{};
+  context.resetTimers();
+  context.startTimer(RC_TIMER_TOTAL);
+
+  BuildCache cache;
+  if (!settings.cacheDirectory.empty() && !cache.open(settings.cacheDirectory, settings.cacheSizeLimit)) {
+    context.log(RC_LOG_ERROR, "buildStreamed: Could not open the build cache '%s'.", settings.cacheDirectory.c_str());
+    return false;
+  }
+
+  StreamedBuild build{context, pGeom, config, settings, cache.isOpen() ? &cache : nullptr, stats, {}, {}, {}, {}};
+  classifyTriangles(build);
+  if (settings.adaptiveLevels > 0)
+    weldVertices(build);
+
+  bool success = true;
+  {
+    ScopedAllocationTracking tracking{settings.memoryCap};
+    std::vector<WindowRect> windows;
+    for (int z = 0; z < config.height; z += settings.windowSize) {
+      for (int x = 0; x < config.width; x += settings.windowSize) {
+        const int sizeX = std::min(settings.windowSize, config.width - x);
+        const int sizeZ = std::min(settings.windowSize, config.height - z);
+        if (settings.adaptiveLevels > 0)
+          addAdaptiveWindows(build, x, z, sizeX, sizeZ, 0, windows);
+        else
+          windows.push_back({x, z, sizeX, sizeZ, 0});
+      }
+    }
+    // Build the finer windows first, so that each coarser window can insert the vertices its finer neighbours have on
+    // their shared edges.
+    std::stable_sort(windows.begin(), windows.end(), [](const WindowRect &a, const WindowRect &b) { return a.level < b.level; });
+    for (const WindowRect &window : windows) {
+      success = buildWindow(build, window);
+      if (!success)
+        break;
+    }
+    stats.peakMemory = s_peakBytes;
+  }
+  stats.cache = cache.getStats();
+
+  context.stopTimer(RC_TIMER_TOTAL);
+  context.log(RC_LOG_PROGRESS, ">> Streamed: %d windows (%d split, %d coarse), %d written with %d polygons, peak memory %.1f MB", stats.windowCount, stats.splitCount, stats.coarseWindowCount, stats.writtenCount, stats.polyCount, static_cast<float>(stats.peakMemory) / (1024.0f * 1024.0f));
+  return success;
+}
+
+bool writeStreamedWindow(const std::string &filePath, const rcPolyMesh &mesh, const rcPolyMeshDetail &detailMesh) {
+  std::ofstream file{filePath, std::ios::out | std::ios::binary};
+  if (!file.is_open())
+    return false;
+  const std::uint32_t header[] = {STREAMED_WINDOW_MAGIC, STREAMED_WINDOW_VERSION, static_cast<std::uint32_t>(sizeof(rcMeshIndex))};
+  const int counts[] = {mesh.nverts, mesh.npolys, mesh.nvp, mesh.borderSize, detailMesh.nmeshes, detailMesh.nverts, detailMesh.ntris};
+  const float bounds[] = {mesh.bmin[0], mesh.bmin[1], mesh.bmin[2], mesh.bmax[0], mesh.bmax[1], mesh.bmax[2], mesh.cs, mesh.ch, mesh.maxEdgeError};
+  writeArray(file, header, 3);
+  writeArray(file, counts, 7);
+  writeArray(file, bounds, 9);
+  writeArray(file, mesh.verts, static_cast<std::size_t>(mesh.nverts) * 3);
+  writeArray(file, mesh.polys, static_cast<std::size_t>(mesh.npolys) * 2 * mesh.nvp);
+  writeArray(file, mesh.regs, static_cast<std::size_t>(mesh.npolys));
+  writeArray(file, mesh.flags, static_cast<std::size_t>(mesh.npolys));
+  writeArray(file, mesh.areas, static_cast<std::size_t>(mesh.npolys));
+  writeArray(file, detailMesh.meshes, static_cast<std::size_t>(detailMesh.nmeshes) * 4);
+  writeArray(file, detailMesh.verts, static_cast<std::size_t>(detailMesh.nverts) * 3);
+  writeArray(file, detailMesh.tris, static_cast<std::size_t>(detailMesh.ntris) * 4);
+  return static_cast<bool>(file);
+}
+
+bool loadStreamedWindow(rcContext &context, const std::string &filePath, rcPolyMesh &mesh, rcPolyMeshDetail &detailMesh) {
+  std::ifstream file{filePath, std::ios::in | std::ios::binary};
+  std::uint32_t header[3];
+  int counts[7];
+  float bounds[9];
+  if (!file.is_open() || !readArray(file, header, 3) || header[0] != STREAMED_WINDOW_MAGIC || header[1] != STREAMED_WINDOW_VERSION || header[2] != sizeof(rcMeshIndex) ||
+      !readArray(file, counts, 7) || !readArray(file, bounds, 9)) {
+    context.log(RC_LOG_ERROR, "loadStreamedWindow: Invalid window file '%s'.", filePath.c_str());
+    return false;
+  }
+
+  mesh.nverts = counts[0];
+  mesh.npolys = counts[1];
+  mesh.maxpolys = counts[1];
+  mesh.nvp = counts[2];
+  mesh.borderSize = counts[3];
+  rcVcopy(mesh.bmin, &bounds[0]);
+  rcVcopy(mesh.bmax, &bounds[3]);
+  mesh.cs = bounds[6];
+  mesh.ch = bounds[7];
+  mesh.maxEdgeError = bounds[8];
+  mesh.verts = static_cast<rcMeshIndex *>(rcAlloc(sizeof(rcMeshIndex) * mesh.nverts * 3, RC_ALLOC_PERM));
+  mesh.polys = static_cast<rcMeshIndex *>(rcAlloc(sizeof(rcMeshIndex) * mesh.npolys * 2 * mesh.nvp, RC_ALLOC_PERM));
+  mesh.regs = static_cast<unsigned short *>(rcAlloc(sizeof(unsigned short) * mesh.npolys, RC_ALLOC_PERM));
+  mesh.flags = static_cast<unsigned short *>(rcAlloc(sizeof(unsigned short) * mesh.npolys, RC_ALLOC_PERM));
+  mesh.areas = static_cast<unsigned char *>(rcAlloc(sizeof(unsigned char) * mesh.npolys, RC_ALLOC_PERM));
+
+  detailMesh.nmeshes = counts[4];
+  detailMesh.nverts = counts[5];
+  detailMesh.ntris = counts[6];
+  detailMesh.meshes = static_cast<unsigned int *>(rcAlloc(sizeof(unsigned int) * detailMesh.nmeshes * 4, RC_ALLOC_PERM));
+  detailMesh.verts = static_cast<float *>(rcAlloc(sizeof(float) * detailMesh.nverts * 3, RC_ALLOC_PERM));
+  detailMesh.tris = static_cast<unsigned char *>(rcAlloc(sizeof(unsigned char) * detailMesh.ntris * 4, RC_ALLOC_PERM));
+
+  if (!mesh.verts || !mesh.polys || !mesh.regs || !mesh.flags || !mesh.areas || !detailMesh.meshes || !detailMesh.verts || !detailMesh.tris) {
+    context.log(RC_LOG_ERROR, "loadStreamedWindow: Out of memory.");
+    return false;
+  }
+  if (!readArray(file, mesh.verts, static_cast<std::size_t>(mesh.nverts) * 3) ||
+      !readArray(file, mesh.polys, static_cast<std::size_t>(mesh.npolys) * 2 * mesh.nvp) ||
+      !readArray(file, mesh.regs, static_cast<std::size_t>(mesh.npolys)) ||
+      !readArray(file, mesh.flags, static_cast<std::size_t>(mesh.npolys)) ||
+      !readArray(file, mesh.areas, static_cast<std::size_t>(mesh.npolys)) ||
+      !readArray(file, detailMesh.meshes, static_cast<std::size_t>(detailMesh.nmeshes) * 4) ||
+      !readArray(file, detailMesh.verts, static_cast<std::size_t>(detailMesh.nverts) * 3) ||
+      !readArray(file, detailMesh.tris, static_cast<std::size_t>(detailMesh.ntris) * 4)) {
+    context.log(RC_LOG_ERROR, "loadStreamedWindow: Truncated window file '%s'.", filePath.c_str());
+    return false;
+  }
+  return true;
+}
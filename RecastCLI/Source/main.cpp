@@ -7,6 +7,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <fstream>
+#include <initializer_list>
 #include <iostream>
 #include <iterator>
 #include <set>
@@ -20,6 +21,7 @@
 #include "BuildContext.h"
 #include "Generators.h"
 #include "InputGeom.h"
+#include "StreamingBuild.h"
 
 class InputParser {
 public:
@@ -30,7 +32,7 @@ public:
         for (char &ch : m_tokens.back())
           ch = static_cast<char>(tolower(ch));
       else
-        m_tokens.back().erase(std::find(m_tokens.back().begin(), m_tokens.back().end(), '\"'));
+        m_tokens.back().erase(std::remove(m_tokens.back().begin(), m_tokens.back().end(), '\"'), m_tokens.back().end());
     }
   }
 
@@ -39,7 +41,8 @@ public:
       std::stringstream ss{option};
       std::string s;
       while (std::getline(ss, s, ';')) {
-        return s == token;
+        if (s == token)
+          return true;
       }
       return false;
     });
@@ -55,7 +58,8 @@ public:
       std::stringstream ss{option};
       std::string s;
       while (std::getline(ss, s, ';')) {
-        return s == token;
+        if (s == token)
+          return true;
       }
       return false;
     });
@@ -78,6 +82,20 @@ void printOptions() {
   std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
   std::cout << "-cs;--cellsize\t\t\t(optional) cell size (float)" << std::endl;
   std::cout << "-ar;--agentradius\t\t(optional) agent radius (float)" << std::endl;
+  std::cout << "-t;--threads\t\t\t(optional) worker threads, 0 uses all hardware threads (int)" << std::endl;
+  std::cout << "-ta;--temparena\t\t\t(optional) serve temporary allocations from an arena of this many MB per thread (int)" << std::endl;
+  std::cout << "-mt;--memorytracking\t\t(optional) record the peak memory of each build step, and of each thread in ThreadMemory.csv, not with -sw (flag)" << std::endl;
+  std::cout << "-tr;--trace\t\t\t(optional) write a Chrome trace of the build steps to this file (string)" << std::endl;
+  std::cout << "-pc;--perfcounters\t\t(optional) record the IPC and cache and branch miss rates of each build step in the timings, Linux only (flag)" << std::endl;
+  std::cout << "-id;--incrementaldelaunay\t(optional) build the detail mesh with incremental Delaunay insertion" << std::endl;
+  std::cout << "-pw;--parallelwatershed\t\t(optional) also time the watershed regions flooded in parallel tiles (flag)" << std::endl;
+  std::cout << "-cu;--cleanup\t\t\t(optional) weld the input vertices within this distance and drop degenerate, duplicate and out of bounds triangles (float)" << std::endl;
+  std::cout << "-cb;--cullbackfaces\t\t(optional) also cull the downward facing input triangles without geometry below them, cleans up with -cu 0 when -cu is not given (flag)" << std::endl;
+  std::cout << "-sw;--streamwindow\t\t(optional) stream the build in windows of this many cells into the output directory (int)" << std::endl;
+  std::cout << "-mc;--memorycap\t\t\t(optional) memory cap of the Recast allocations of a streamed build in MB, excluding the input mesh, 0 for no limit (int)" << std::endl;
+  std::cout << "-al;--adaptivelevels\t\t(optional) double the cell size of streamed windows without steep or edge geometry up to this many times (int)" << std::endl;
+  std::cout << "-cd;--cachedirectory\t\t(optional) reuse the unchanged windows of a streamed build from this cache directory (string)" << std::endl;
+  std::cout << "-cl;--cachelimit\t\t(optional) size limit of the build cache in MB, 0 for no limit (int)" << std::endl;
   std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
 }
 
@@ -95,9 +113,17 @@ const float g_vertsPerPoly = 6.0f;
 const float g_detailSampleDist = 6.0f;
 const float g_detailSampleMaxError = 1.0f;
 const int g_loopCount = 1;
+// The statistics of one build: the time of each timer, followed by the peak PERM and TEMP memory of each timer, and
+// the instructions per cycle and the L1 data, last level cache and branch misses per 1000 instructions of each timer.
+const int g_statsPerBuild = RC_MAX_TIMERS * 7;
+using BuildStats = std::array<float, g_loopCount * g_statsPerBuild>;
+// The peak PERM and TEMP memory of each timer on one thread of one build, for every thread of every build.
+using ThreadMemoryStats = std::vector<std::array<float, RC_MAX_TIMERS * 2>>;
 const bool g_filterLedgeSpans = true;
 const bool g_filterWalkableLowHeightSpans = true;
 const bool g_filterLowHangingObstacles = true;
+int g_detailBuildFlags = 0;
+bool g_parallelWatershed = false;
 
 const char header[] =
     "ID,"
@@ -133,7 +159,9 @@ const char header[] =
     "Build Regions Filter (ms),"
     "Build Layers (ms),"
     "Build Polymesh Detail (ms),"
-    "Merge Polymesh Details (ms)";
+    "Merge Polymesh Details (ms),"
+    "Mark Area Volumes (ms),"
+    "Filter Spans (ms)";
 
 struct Vertex {
   int x;
@@ -145,48 +173,94 @@ struct Edge {
   Vertex v2{};
 };
 
-inline std::array<float, g_loopCount * RC_MAX_TIMERS> generateThesisTimes(BuildContext &context, const InputGeom &pGeom, rcConfig &config, int *&pEdges, int &edgeCount) {
-  std::array<float, g_loopCount * RC_MAX_TIMERS> times{};
+inline void recordThreadMemoryStats(const BuildContext &context, ThreadMemoryStats &threadMemory) {
+  for (int thread = 0; thread < context.getMaxThreads(); ++thread) {
+    std::array<float, RC_MAX_TIMERS * 2> peaks{};
+    for (int j = 0; j < RC_MAX_TIMERS; ++j) {
+      rcMemoryStats memory{};
+      if (!context.getThreadMemoryStats(static_cast<rcTimerLabel>(j), thread, memory))
+        return;
+      peaks[j] = static_cast<float>(memory.perm.peakBytes) / 1024.0f;
+      peaks[RC_MAX_TIMERS + j] = static_cast<float>(memory.temp.peakBytes) / 1024.0f;
+    }
+    threadMemory.push_back(peaks);
+  }
+}
+
+inline void recordBuildStats(const BuildContext &context, const int loop, BuildStats &stats, ThreadMemoryStats &threadMemory) {
+  float *times = &stats[loop * g_statsPerBuild];
+  float *permPeaks = times + RC_MAX_TIMERS;
+  float *tempPeaks = permPeaks + RC_MAX_TIMERS;
+  float *ipc = tempPeaks + RC_MAX_TIMERS;
+  float *missRates[] = {ipc + RC_MAX_TIMERS, ipc + RC_MAX_TIMERS * 2, ipc + RC_MAX_TIMERS * 3};
+  for (int j = 0; j < RC_MAX_TIMERS; ++j) {
+    const rcTimerLabel label = static_cast<rcTimerLabel>(j);
+    times[j] = static_cast<float>(context.getAccumulatedTime(label)) * 1e-3f;
+    rcMemoryStats memory{};
+    const bool tracked = context.getMemoryStats(label, memory);
+    permPeaks[j] = tracked ? static_cast<float>(memory.perm.peakBytes) / 1024.0f : -1.0f;
+    tempPeaks[j] = tracked ? static_cast<float>(memory.temp.peakBytes) / 1024.0f : -1.0f;
+
+    std::int64_t cycles{}, instructions{}, misses{};
+    const bool counted = context.getPerfCounter(label, PERF_INSTRUCTIONS, instructions) && instructions > 0;
+    ipc[j] = counted && context.getPerfCounter(label, PERF_CYCLES, cycles) && cycles > 0 ? static_cast<float>(instructions) / static_cast<float>(cycles) : -1.0f;
+    const PerfCounter missCounters[] = {PERF_L1D_READ_MISSES, PERF_LLC_MISSES, PERF_BRANCH_MISSES};
+    for (int k = 0; k < 3; ++k)
+      missRates[k][j] = counted && context.getPerfCounter(label, missCounters[k], misses) ? static_cast<float>(misses) * 1000.0f / static_cast<float>(instructions) : -1.0f;
+  }
+  recordThreadMemoryStats(context, threadMemory);
+}
+
+inline BuildStats generateThesisTimes(BuildContext &context, const InputGeom &pGeom, rcConfig &config, int *&pEdges, int &edgeCount, ThreadMemoryStats &threadMemory) {
+  BuildStats times{};
   for (int i{}; i < g_loopCount; i++) {
     rcPolyMesh *pMesh{nullptr};
     rcPolyMeshDetail *pDMesh{nullptr};
-    if (!generateTheses(context, pGeom, config, g_filterLowHangingObstacles, g_filterLedgeSpans, g_filterWalkableLowHeightSpans, pMesh, pDMesh, pEdges, edgeCount))
+    if (!generateTheses(context, pGeom, config, g_filterLowHangingObstacles, g_filterLedgeSpans, g_filterWalkableLowHeightSpans, pMesh, pDMesh, pEdges, edgeCount, g_detailBuildFlags))
       context.dumpLog("Error Thesis:");
     rcFreePolyMesh(pMesh);
     rcFreePolyMeshDetail(pDMesh);
     pMesh = nullptr;
     pDMesh = nullptr;
+    context.resetTempArenas();
     if (i != g_loopCount - 1) {
       rcFree(pEdges);
     }
-    const int offset{i * RC_MAX_TIMERS};
-    for (int j = 0; j < RC_MAX_TIMERS; ++j) {
-      times[offset + j] = static_cast<float>(context.getAccumulatedTime(static_cast<rcTimerLabel>(j))) * 1e-3f;
-    }
+    recordBuildStats(context, i, times, threadMemory);
   }
   return times;
 }
 
-inline std::array<float, g_loopCount * RC_MAX_TIMERS> generateSingleMeshTimes(BuildContext &context, const InputGeom &pGeom, rcConfig &config) {
-  std::array<float, g_loopCount * RC_MAX_TIMERS> times{};
+inline BuildStats generateSingleMeshTimes(BuildContext &context, const InputGeom &pGeom, rcConfig &config, ThreadMemoryStats &threadMemory, const bool parallelRegions = false) {
+  BuildStats times{};
   for (int i{}; i < g_loopCount; i++) {
     rcPolyMesh *pMesh{nullptr};
     rcPolyMeshDetail *pDMesh{nullptr};
-    generateSingle(context, pGeom, config, g_filterLowHangingObstacles, g_filterLedgeSpans, g_filterWalkableLowHeightSpans, pMesh, pDMesh);
+    generateSingle(context, pGeom, config, g_filterLowHangingObstacles, g_filterLedgeSpans, g_filterWalkableLowHeightSpans, pMesh, pDMesh, g_detailBuildFlags, parallelRegions);
     rcFreePolyMesh(pMesh);
     rcFreePolyMeshDetail(pDMesh);
     pMesh = nullptr;
     pDMesh = nullptr;
+    context.resetTempArenas();
 
-    const int offset{i * RC_MAX_TIMERS};
-    for (int j = 0; j < RC_MAX_TIMERS; ++j) {
-      times[offset + j] = static_cast<float>(context.getAccumulatedTime(static_cast<rcTimerLabel>(j))) * 1e-3f;
-    }
+    recordBuildStats(context, i, times, threadMemory);
   }
   return times;
 }
 
-inline void writeCsvFile(const bool isThesis, const std::string &filePath, const std::string &environmentName, const InputGeom &pGeom, rcConfig &config, const float gridSize, const std::array<float, g_loopCount * RC_MAX_TIMERS> &timerData) {
+// Writes a column per timer for each kind. The columns repeat the timer columns of the header, which start at
+// "Total (ms)".
+inline void writeTimerColumns(std::ofstream &csvFile, const std::initializer_list<const char *> kinds) {
+  std::stringstream timerColumns{std::string{header}.substr(std::string{header}.find("Total (ms)"))};
+  for (const char *kind : kinds) {
+    timerColumns.clear();
+    timerColumns.seekg(0);
+    for (std::string column; std::getline(timerColumns, column, ',');)
+      csvFile << ',' << column.substr(0, column.size() - 5) << kind;
+  }
+}
+
+inline void writeCsvFile(const char *method, const std::string &filePath, const std::string &environmentName, const InputGeom &pGeom, rcConfig &config, const float gridSize, const BuildStats &timerData) {
   static int count{};
   try {
     system(("mkdir " + filePath).c_str());
@@ -199,14 +273,16 @@ inline void writeCsvFile(const bool isThesis, const std::string &filePath, const
   if (height < 1e-3f)
     height = 1.f;
   std::ofstream csvFile{filePath + "/Timings.csv", std::ios::out | std::ios::app};
-  csvFile.write(header, sizeof(header)).put('\n');
+  csvFile << header;
+  writeTimerColumns(csvFile, {" Peak Perm (KB)", " Peak Temp (KB)", " IPC", " L1D Misses (per 1k instructions)", " LLC Misses (per 1k instructions)", " Branch Misses (per 1k instructions)"});
+  csvFile << '\n';
   for (int i{}; i < g_loopCount; ++i) {
-    csvFile << count++ << (isThesis ? ",Thesis," : ",Default,") << environmentName << ',' << gridSize << ',';
+    csvFile << count++ << ',' << method << ',' << environmentName << ',' << gridSize << ',';
     csvFile << (int)(width * height * depth) << ',';
     csvFile << config.width * config.height << ',';
-    for (int j{}; j < RC_MAX_TIMERS; ++j) {
-      csvFile << timerData[i * RC_MAX_TIMERS + j];
-      if (j != RC_MAX_TIMERS - 1)
+    for (int j{}; j < g_statsPerBuild; ++j) {
+      csvFile << timerData[i * g_statsPerBuild + j];
+      if (j != g_statsPerBuild - 1)
         csvFile << ',';
     }
     csvFile << std::endl;
@@ -214,12 +290,44 @@ inline void writeCsvFile(const bool isThesis, const std::string &filePath, const
   csvFile.close();
 }
 
+// Writes the peak memory of each thread to ThreadMemory.csv, which stays empty when memory tracking is off.
+inline void writeThreadMemoryCsvFile(const char *method, const std::string &filePath, const std::string &environmentName, const float gridSize, const ThreadMemoryStats &threadMemory) {
+  if (threadMemory.empty())
+    return;
+  std::ofstream csvFile{filePath + "/ThreadMemory.csv", std::ios::out | std::ios::app};
+  csvFile << "Method,Environment,Grid Size,Thread";
+  writeTimerColumns(csvFile, {" Peak Perm (KB)", " Peak Temp (KB)"});
+  csvFile << '\n';
+  // Every build records the same number of threads.
+  const std::size_t threadCount = threadMemory.size() / g_loopCount;
+  for (std::size_t i{}; i < threadMemory.size(); ++i) {
+    csvFile << method << ',' << environmentName << ',' << gridSize << ',' << i % threadCount;
+    for (const float peak : threadMemory[i])
+      csvFile << ',' << peak;
+    csvFile << '\n';
+  }
+}
+
 inline void generateTimes(const std::string &output, const std::string &environmentName, const float gridSize, BuildContext &context, const InputGeom &pGeom, rcConfig &config, int *&pEdge, int &edgeCount) {
-  const std::array<float, g_loopCount * RC_MAX_TIMERS> defaultTimes{generateSingleMeshTimes(context, pGeom, config)};
-  const std::array<float, g_loopCount * RC_MAX_TIMERS> thesisTimes{generateThesisTimes(context, pGeom, config, pEdge, edgeCount)};
+  ThreadMemoryStats defaultMemory{}, thesisMemory{};
+  const BuildStats defaultTimes{generateSingleMeshTimes(context, pGeom, config, defaultMemory)};
+  const BuildStats thesisTimes{generateThesisTimes(context, pGeom, config, pEdge, edgeCount, thesisMemory)};
+
+  writeCsvFile("Default", output, environmentName, pGeom, config, gridSize, defaultTimes);
+  writeCsvFile("Thesis", output, environmentName, pGeom, config, gridSize, thesisTimes);
+  writeThreadMemoryCsvFile("Default", output, environmentName, gridSize, defaultMemory);
+  writeThreadMemoryCsvFile("Thesis", output, environmentName, gridSize, thesisMemory);
+  if (g_parallelWatershed) {
+    ThreadMemoryStats parallelMemory{};
+    const BuildStats parallelTimes{generateSingleMeshTimes(context, pGeom, config, parallelMemory, true)};
+    writeCsvFile("Parallel Watershed", output, environmentName, pGeom, config, gridSize, parallelTimes);
+    writeThreadMemoryCsvFile("Parallel Watershed", output, environmentName, gridSize, parallelMemory);
+  }
+}
 
-  writeCsvFile(false, output, environmentName, pGeom, config, gridSize, defaultTimes);
-  writeCsvFile(true, output, environmentName, pGeom, config, gridSize, thesisTimes);
+inline void writeTrace(const InputParser &parser, const BuildContext &context) {
+  if (parser.cmdOptionExists("-tr;--trace") && !context.writeTrace(parser.getCmdOption("-tr;--trace").c_str()))
+    std::cerr << "Could not write the trace to " << parser.getCmdOption("-tr;--trace") << std::endl;
 }
 
 inline bool compareEdges(const Edge &edge1, const Edge &edge2) {
@@ -431,15 +539,40 @@ int main(const int argc, char *argv[]) {
     return 1;
   }
 
-  float cellSize = 0.3f;
+  if (parser.cmdOptionExists("-cu;--cleanup") || parser.cmdOptionExists("-cb;--cullbackfaces")) {
+    InputCleanupSettings cleanup{};
+    cleanup.weldDistance = parser.cmdOptionExists("-cu;--cleanup") ? std::stof(parser.getCmdOption("-cu;--cleanup")) : 0.0f;
+    rcVcopy(cleanup.boundsMin, pGeom.getNavMeshBoundsMin());
+    rcVcopy(cleanup.boundsMax, pGeom.getNavMeshBoundsMax());
+    cleanup.cullBackFaces = parser.cmdOptionExists("-cb;--cullbackfaces");
+    InputCleanupStats stats{};
+    if (!pGeom.cleanupMesh(&context, cleanup, stats)) {
+      context.dumpLog("Geom cleanup log %s:", fileName.c_str());
+      return 1;
+    }
+    std::cout << "Cleanup kept " << stats.outputTris << " of " << stats.inputTris << " triangles (" << stats.degenerateTris << " degenerate, " << stats.duplicateTris << " duplicate, "
+              << stats.outOfBoundsTris << " out of bounds, " << stats.backFaceTris << " back faces) and " << stats.outputVerts << " of " << stats.inputVerts << " vertices" << std::endl;
+  }
 
-  if (parser.cmdOptionExists("-cs;--cellsize"))
-    cellSize = std::stof(parser.getCmdOption("-cs;--cellsize"));
-  if (!parser.cmdOptionExists("-lcmr;--localclearanceminimumrefference")) {
+  if (parser.cmdOptionExists("-t;--threads"))
+    context.setMaxThreads(std::stoi(parser.getCmdOption("-t;--threads")));
+  if (parser.cmdOptionExists("-ta;--temparena") && !context.setTempArenaSize(static_cast<std::size_t>(std::stoi(parser.getCmdOption("-ta;--temparena"))) * 1024 * 1024)) {
+    std::cerr << "Could not allocate the temporary memory arenas." << std::endl;
     return 1;
   }
-  lcmRef = parser.getCmdOption("-lcmr;--localclearanceminimumrefference");
+  if (parser.cmdOptionExists("-tr;--trace"))
+    context.enableTrace();
+  if (parser.cmdOptionExists("-pc;--perfcounters") && !context.enablePerfCounters())
+    std::cerr << "Hardware performance counters are not available, the counter columns stay -1." << std::endl;
+  if (parser.cmdOptionExists("-id;--incrementaldelaunay"))
+    g_detailBuildFlags |= RC_DETAIL_INCREMENTAL_DELAUNAY;
+  if (parser.cmdOptionExists("-pw;--parallelwatershed"))
+    g_parallelWatershed = true;
 
+  float cellSize = 0.3f;
+
+  if (parser.cmdOptionExists("-cs;--cellsize"))
+    cellSize = std::stof(parser.getCmdOption("-cs;--cellsize"));
   rcConfig config{};
   config.cs = cellSize;
   config.ch = g_cellHeight;
@@ -454,9 +587,56 @@ int main(const int argc, char *argv[]) {
   config.maxVertsPerPoly = static_cast<int>(g_vertsPerPoly);
   config.detailSampleDist = cellSize * g_detailSampleDist;
   config.detailSampleMaxError = g_cellHeight * g_detailSampleMaxError;
+
+  if (parser.cmdOptionExists("-sw;--streamwindow")) {
+    // The streamed build routes the allocations through its own allocator to enforce the memory cap.
+    if (parser.cmdOptionExists("-mt;--memorytracking")) {
+      std::cerr << "Memory tracking is not available for streamed builds, which report their peak memory instead." << std::endl;
+      return 1;
+    }
+    // The memory cap has to see the temporary allocations too.
+    context.setTempArenaSize(0);
+    StreamingBuildSettings settings{};
+    settings.windowSize = std::stoi(parser.getCmdOption("-sw;--streamwindow"));
+    if (parser.cmdOptionExists("-mc;--memorycap"))
+      settings.memoryCap = static_cast<std::size_t>(std::stoi(parser.getCmdOption("-mc;--memorycap"))) * 1024 * 1024;
+    if (parser.cmdOptionExists("-al;--adaptivelevels"))
+      settings.adaptiveLevels = std::stoi(parser.getCmdOption("-al;--adaptivelevels"));
+    settings.filterFlags = (g_filterLowHangingObstacles ? RC_FILTER_LOW_HANGING_OBSTACLES : 0) | (g_filterLedgeSpans ? RC_FILTER_LEDGE_SPANS : 0) | (g_filterWalkableLowHeightSpans ? RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS : 0);
+    settings.detailBuildFlags = g_detailBuildFlags;
+    settings.outputDirectory = output;
+    if (parser.cmdOptionExists("-cd;--cachedirectory"))
+      settings.cacheDirectory = parser.getCmdOption("-cd;--cachedirectory");
+    if (parser.cmdOptionExists("-cl;--cachelimit"))
+      settings.cacheSizeLimit = static_cast<std::size_t>(std::stoi(parser.getCmdOption("-cl;--cachelimit"))) * 1024 * 1024;
+    rcVcopy(config.bmin, pGeom.getNavMeshBoundsMin());
+    rcVcopy(config.bmax, pGeom.getNavMeshBoundsMax());
+    rcCalcGridSize(config.bmin, config.bmax, config.cs, &config.width, &config.height);
+    StreamingBuildStats stats{};
+    if (!generateStreamed(context, pGeom, config, settings, stats)) {
+      context.dumpLog("Streamed build of %s:", fileName.c_str());
+      return 1;
+    }
+    std::cout << "Streamed " << stats.windowCount << " windows (" << stats.splitCount << " split, " << stats.coarseWindowCount << " coarse) with " << stats.cellCount << " cells, wrote " << stats.writtenCount << " with "
+              << stats.polyCount << " polygons in " << static_cast<float>(context.getAccumulatedTime(RC_TIMER_TOTAL)) * 1e-3f << " ms, peak memory " << static_cast<float>(stats.peakMemory) / (1024.0f * 1024.0f) << " MB" << std::endl;
+    if (!settings.cacheDirectory.empty())
+      std::cout << "Build cache: " << stats.cache.hits << " hits, " << stats.cache.misses << " misses, " << stats.cache.evictions << " evictions" << std::endl;
+    writeTrace(parser, context);
+    return 0;
+  }
+
+  if (!parser.cmdOptionExists("-lcmr;--localclearanceminimumrefference")) {
+    return 1;
+  }
+  lcmRef = parser.getCmdOption("-lcmr;--localclearanceminimumrefference");
+
+  if (parser.cmdOptionExists("-mt;--memorytracking"))
+    context.enableMemoryTracking();
+
   int *pEdges{nullptr};
   int edgeCount{};
   const std::string name{fileName.substr(7, fileName.size() - 11)};
   generateTimes(output, name, cellSize, context, pGeom, config, pEdges, edgeCount);
+  writeTrace(parser, context);
   processBourderEdges(lcmRef, output, name + "_" + std::to_string(static_cast<int>(cellSize * 10)), pGeom, config, pEdges, edgeCount);
 }
\ No newline at end of file
@@ -258,3 +258,61 @@ TEST_CASE("rcVector", "[recast, alloc]")
 		v.clear();
 	}
 }
+
+TEST_CASE("rcArena", "[recast, alloc]")
+{
+	rcArena arena;
+	REQUIRE(arena.init(256));
+
+	SECTION("Bump and reset")
+	{
+		void* a = arena.alloc(10);
+		void* b = arena.alloc(0);
+		REQUIRE(a != NULL);
+		REQUIRE(b != NULL);
+		REQUIRE(a != b);
+		REQUIRE(arena.owns(a));
+		REQUIRE(arena.owns(b));
+		REQUIRE(((uintptr_t)b - (uintptr_t)a) % 16 == 0);
+
+		const size_t mark = arena.getMark();
+		void* c = arena.alloc(100);
+		REQUIRE(c != NULL);
+		REQUIRE(arena.alloc(256) == NULL);
+		arena.reset(mark);
+		REQUIRE(arena.alloc(100) == c);
+
+		arena.reset();
+		REQUIRE(arena.getUsed() == 0);
+		REQUIRE(arena.alloc(10) == a);
+	}
+
+	SECTION("Temporary allocations")
+	{
+		rcAllocSetArenas(&arena, 1, NULL);
+		void* temp = rcAlloc(64, RC_ALLOC_TEMP);
+		void* perm = rcAlloc(64, RC_ALLOC_PERM);
+		void* overflow = rcAlloc(1024, RC_ALLOC_TEMP);
+		REQUIRE(arena.owns(temp));
+		REQUIRE(!arena.owns(perm));
+		REQUIRE(overflow != NULL);
+		REQUIRE(!arena.owns(overflow));
+
+		rcFree(temp);
+		rcFree(perm);
+		rcFree(overflow);
+		REQUIRE(arena.getUsed() == 64);
+
+		{
+			rcTempVector<int> v;
+			for (int i = 0; i < 8; ++i)
+				v.push_back(i);
+			REQUIRE(arena.owns(v.data()));
+			REQUIRE(v[7] == 7);
+		}
+		rcAllocSetArenas(NULL, 0, NULL);
+		void* disabled = rcAlloc(16, RC_ALLOC_TEMP);
+		REQUIRE(!arena.owns(disabled));
+		rcFree(disabled);
+	}
+}
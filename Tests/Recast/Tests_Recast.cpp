@@ -1,9 +1,15 @@
+#include <algorithm>
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <string>
+#include <vector>
 
 #include "catch2/catch_all.hpp"
 
 #include "Recast.h"
+#include "RecastAlloc.h"
 
 TEST_CASE("rcSwap", "[recast]")
 {
@@ -511,6 +517,118 @@ TEST_CASE("rcClearUnwalkableTriangles", "[recast]")
 	}
 }
 
+namespace
+{
+/// Runs parallel ranges serially, but in reverse order and each on its own thread index,
+/// to check that results do not depend on how work is scheduled.
+class ReverseRangeContext : public rcContext
+{
+public:
+	explicit ReverseRangeContext(const int rangeSize) : rcContext(false), m_rangeSize(rangeSize) {}
+
+protected:
+	virtual int doGetMaxThreads() const { return 4; }
+	virtual void doParallelFor(const int count, rcParallelForFunc* func, void* userData)
+	{
+		const int nranges = (count + m_rangeSize - 1) / m_rangeSize;
+		for (int i = nranges - 1; i >= 0; --i)
+		{
+			const int begin = i * m_rangeSize;
+			const int end = rcMin(begin + m_rangeSize, count);
+			func(userData, begin, end, i % 4);
+		}
+	}
+
+private:
+	int m_rangeSize;
+};
+
+/// Builds triangles with slopes sweeping from flat to upside down, some of them close to 45
+/// degrees and some degenerate, in both windings and at different scales.
+void buildSlopeTriangles(std::vector<float>& verts, std::vector<int>& tris)
+{
+	const int numTris = 10003;
+	for (int i = 0; i < numTris; ++i)
+	{
+		const float angle = (i % 3 == 0 ? 45.0f + (float)(i % 101 - 50) * 1e-5f : (float)i * 0.037f) / 180.0f * RC_PI;
+		const float scale = (i % 4 == 0) ? 1e-3f : (i % 4 == 1) ? 1e3f : 1.0f;
+		const float dirY = (i % 7 == 0) ? 0.0f : sinf(angle) * scale;
+		const float dirZ = (i % 7 == 0) ? 0.0f : -cosf(angle) * scale;
+		const float v[] = {
+			0, 0, 0,
+			scale, 0, 0,
+			0, dirY, dirZ
+		};
+		const int base = (int)verts.size() / 3;
+		verts.insert(verts.end(), v, v + 9);
+		tris.push_back(base);
+		tris.push_back(base + ((i & 1) ? 2 : 1));
+		tris.push_back(base + ((i & 1) ? 1 : 2));
+	}
+}
+
+/// Returns whether the triangle is walkable by its normalized normal.
+bool isWalkableByNormal(const float* verts, const int* tri, const float walkableSlopeAngle)
+{
+	float e0[3], e1[3], norm[3];
+	rcVsub(e0, &verts[tri[1] * 3], &verts[tri[0] * 3]);
+	rcVsub(e1, &verts[tri[2] * 3], &verts[tri[0] * 3]);
+	rcVcross(norm, e0, e1);
+	rcVnormalize(norm);
+	return norm[1] > cosf(walkableSlopeAngle / 180.0f * RC_PI);
+}
+}
+
+TEST_CASE("rcMarkWalkableTriangles and rcClearUnwalkableTriangles match the normalized normals", "[recast]")
+{
+	rcContext ctx(false);
+	std::vector<float> verts;
+	std::vector<int> tris;
+	buildSlopeTriangles(verts, tris);
+	const int numVerts = (int)verts.size() / 3;
+	const int numTris = (int)tris.size() / 3;
+	const float walkableSlopeAngle = 45.0f;
+
+	SECTION("Marking sets exactly the walkable triangles")
+	{
+		std::vector<unsigned char> areas(numTris, 42);
+		rcMarkWalkableTriangles(&ctx, walkableSlopeAngle, &verts[0], numVerts, &tris[0], numTris, &areas[0]);
+		for (int i = 0; i < numTris; ++i)
+		{
+			const bool walkable = isWalkableByNormal(&verts[0], &tris[i * 3], walkableSlopeAngle);
+			REQUIRE(areas[i] == (walkable ? RC_WALKABLE_AREA : 42));
+		}
+	}
+
+	SECTION("Parallel ranges give the same areas as a serial run")
+	{
+		ReverseRangeContext parallelCtx(1);
+		std::vector<unsigned char> serialAreas(numTris, 42);
+		std::vector<unsigned char> parallelAreas(numTris, 42);
+		rcMarkWalkableTriangles(&ctx, walkableSlopeAngle, &verts[0], numVerts, &tris[0], numTris, &serialAreas[0]);
+		rcMarkWalkableTriangles(&parallelCtx, walkableSlopeAngle, &verts[0], numVerts, &tris[0], numTris, &parallelAreas[0]);
+		REQUIRE(parallelAreas == serialAreas);
+
+		std::fill(serialAreas.begin(), serialAreas.end(), 42);
+		std::fill(parallelAreas.begin(), parallelAreas.end(), 42);
+		rcClearUnwalkableTriangles(&ctx, walkableSlopeAngle, &verts[0], numVerts, &tris[0], numTris, &serialAreas[0]);
+		rcClearUnwalkableTriangles(&parallelCtx, walkableSlopeAngle, &verts[0], numVerts, &tris[0], numTris, &parallelAreas[0]);
+		REQUIRE(parallelAreas == serialAreas);
+	}
+
+	SECTION("Clearing resets exactly the unwalkable triangles, except the degenerate ones")
+	{
+		std::vector<unsigned char> areas(numTris, 42);
+		rcClearUnwalkableTriangles(0, walkableSlopeAngle, &verts[0], numVerts, &tris[0], numTris, &areas[0]);
+		for (int i = 0; i < numTris; ++i)
+		{
+			const bool degenerate = i % 7 == 0;
+			const bool walkable = isWalkableByNormal(&verts[0], &tris[i * 3], walkableSlopeAngle);
+			REQUIRE(areas[i] == ((walkable || degenerate) ? 42 : RC_NULL_AREA));
+		}
+	}
+}
+
 TEST_CASE("rcAddSpan", "[recast]")
 {
 	rcContext ctx(false);
@@ -935,3 +1053,1567 @@ TEST_CASE("rcRasterizeTriangles", "[recast]")
 		REQUIRE(!solid.spans[1 + 2 * width]->next);
 	}
 }
+
+namespace
+{
+/// Builds a compact heightfield of a flat size x size floor, optionally with a second floor
+/// over the rows [bridgeMinZ, bridgeMaxZ] so that those rows hold two layers.
+bool buildFloorCompactHeightfield(rcContext& ctx, const int size, const int bridgeMinZ, const int bridgeMaxZ, rcCompactHeightfield& chf)
+{
+	rcHeightfield hf;
+	const float bmin[] = {0, 0, 0};
+	const float bmax[] = {(float)size, 10, (float)size};
+	if (!rcCreateHeightfield(&ctx, hf, size, size, bmin, bmax, 1, 0.1f))
+		return false;
+	for (int z = 0; z < size; ++z)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			if (!rcAddSpan(&ctx, hf, x, z, 0, 1, RC_WALKABLE_AREA, 1))
+				return false;
+			if (z >= bridgeMinZ && z <= bridgeMaxZ && !rcAddSpan(&ctx, hf, x, z, 40, 41, RC_WALKABLE_AREA, 1))
+				return false;
+		}
+	}
+	return rcBuildCompactHeightfield(&ctx, 5, 2, hf, chf);
+}
+}
+
+TEST_CASE("rcErodeWalkableArea", "[recast]")
+{
+	rcContext ctx(false);
+	const int size = 40;
+	const int radius = 2;
+
+	// Without a bridge all rows are single layer, with it some rows use the generic path.
+	const bool bridge = GENERATE(false, true);
+	const int bridgeMinZ = bridge ? 10 : size;
+	const int bridgeMaxZ = bridge ? 14 : size;
+	rcCompactHeightfield chf;
+	REQUIRE(buildFloorCompactHeightfield(ctx, size, bridgeMinZ, bridgeMaxZ, chf));
+
+	REQUIRE(rcErodeWalkableArea(&ctx, radius, chf));
+
+	for (int z = 0; z < size; ++z)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			const rcCompactCell& cell = chf.cells[x + z * size];
+			REQUIRE(cell.count == ((z >= bridgeMinZ && z <= bridgeMaxZ) ? 2 : 1));
+
+			// Spans closer than the radius to the edge of their floor are removed.
+			const int floorEdge = rcMin(rcMin(x, size - 1 - x), rcMin(z, size - 1 - z));
+			REQUIRE(chf.areas[cell.index] == (floorEdge >= radius ? RC_WALKABLE_AREA : RC_NULL_AREA));
+			if (cell.count == 2)
+			{
+				const int bridgeEdge = rcMin(rcMin(x, size - 1 - x), rcMin(z - bridgeMinZ, bridgeMaxZ - z));
+				REQUIRE(chf.areas[cell.index + 1] == (bridgeEdge >= radius ? RC_WALKABLE_AREA : RC_NULL_AREA));
+			}
+		}
+	}
+}
+
+TEST_CASE("rcMedianFilterWalkableArea", "[recast]")
+{
+	rcContext ctx(false);
+	const int size = 40;
+	rcCompactHeightfield chf;
+	REQUIRE(buildFloorCompactHeightfield(ctx, size, 20, 24, chf));
+
+	// A 3x3 block of area 2, a single span of area 3 and a null span.
+	for (int z = 5; z < 8; ++z)
+	{
+		for (int x = 5; x < 8; ++x)
+		{
+			chf.areas[chf.cells[x + z * size].index] = 2;
+		}
+	}
+	chf.areas[chf.cells[20 + 30 * size].index] = 3;
+	chf.areas[chf.cells[30 + 30 * size].index] = RC_NULL_AREA;
+
+	REQUIRE(rcMedianFilterWalkableArea(&ctx, chf));
+
+	// The corners of the block have a majority of area 1 around them, the rest of area 2.
+	REQUIRE(chf.areas[chf.cells[6 + 6 * size].index] == 2);
+	REQUIRE(chf.areas[chf.cells[6 + 5 * size].index] == 2);
+	REQUIRE(chf.areas[chf.cells[5 + 5 * size].index] == RC_WALKABLE_AREA);
+	REQUIRE(chf.areas[chf.cells[7 + 7 * size].index] == RC_WALKABLE_AREA);
+	REQUIRE(chf.areas[chf.cells[20 + 30 * size].index] == RC_WALKABLE_AREA);
+	REQUIRE(chf.areas[chf.cells[30 + 30 * size].index] == RC_NULL_AREA);
+	for (int i = 0; i < chf.spanCount; ++i)
+	{
+		if (chf.areas[i] != 2 && chf.areas[i] != RC_NULL_AREA)
+		{
+			REQUIRE(chf.areas[i] == RC_WALKABLE_AREA);
+		}
+	}
+}
+
+TEST_CASE("rcBuildPolyMesh", "[recast]")
+{
+	rcContext ctx;
+
+	const int contourVerts[] = {
+		0, 0, 0, 0,
+		0, 0, 4, 0,
+		4, 0, 4, 0,
+		4, 0, 0, 0,
+	};
+
+	rcContourSet cset;
+	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour), RC_ALLOC_PERM);
+	cset.nconts = 1;
+	rcContour& contour = cset.conts[0];
+	contour.verts = (int*)rcAlloc(sizeof(contourVerts), RC_ALLOC_PERM);
+	contour.rverts = (int*)rcAlloc(sizeof(contourVerts), RC_ALLOC_PERM);
+	memcpy(contour.verts, contourVerts, sizeof(contourVerts));
+	memcpy(contour.rverts, contourVerts, sizeof(contourVerts));
+	contour.nverts = 4;
+	contour.nrverts = 4;
+	contour.reg = 1;
+	contour.area = RC_WALKABLE_AREA;
+	cset.bmax[0] = 4;
+	cset.bmax[1] = 1;
+	cset.bmax[2] = 4;
+	cset.cs = 1;
+	cset.ch = 1;
+	cset.width = 4;
+	cset.height = 4;
+
+	const int nvp = 6;
+
+	SECTION("Mesh indices use the configured index type")
+	{
+		REQUIRE(RC_MESH_NULL_IDX == (rcMeshIndex)~(rcMeshIndex)0);
+		REQUIRE((RC_MESH_PORTAL_FLAG & 0xf) == 0);
+		REQUIRE((unsigned int)RC_MESH_MAX_COUNT <= (unsigned int)RC_MESH_NULL_IDX);
+	}
+
+	SECTION("Builds a single polygon from a convex contour")
+	{
+		rcPolyMesh mesh;
+		REQUIRE(rcBuildPolyMesh(&ctx, cset, nvp, mesh));
+
+		REQUIRE(mesh.nverts == 4);
+		REQUIRE(mesh.npolys == 1);
+		REQUIRE(mesh.nvp == nvp);
+		REQUIRE(mesh.regs[0] == 1);
+		REQUIRE(mesh.areas[0] == RC_WALKABLE_AREA);
+
+		const rcMeshIndex* p = &mesh.polys[0];
+		for (int i = 0; i < 4; ++i)
+		{
+			REQUIRE(p[i] < (rcMeshIndex)mesh.nverts);
+			REQUIRE(p[nvp + i] == RC_MESH_NULL_IDX);
+		}
+		for (int i = 4; i < nvp; ++i)
+		{
+			REQUIRE(p[i] == RC_MESH_NULL_IDX);
+		}
+	}
+
+	SECTION("Edges on the tile border are marked as portals")
+	{
+		cset.borderSize = 1;
+
+		rcPolyMesh mesh;
+		REQUIRE(rcBuildPolyMesh(&ctx, cset, nvp, mesh));
+		REQUIRE(mesh.npolys == 1);
+
+		const rcMeshIndex* p = &mesh.polys[0];
+		for (int i = 0; i < 4; ++i)
+		{
+			REQUIRE(p[nvp + i] != RC_MESH_NULL_IDX);
+			REQUIRE((p[nvp + i] & RC_MESH_PORTAL_FLAG) != 0);
+			REQUIRE((p[nvp + i] & 0xf) < 4);
+		}
+	}
+}
+
+namespace
+{
+/// Context that keeps the logged messages.
+class LogContext : public rcContext
+{
+public:
+	LogContext() : rcContext(true) {}
+
+	std::vector<std::string> messages;
+
+protected:
+	virtual void doLog(const rcLogCategory /*category*/, const char* msg, const int len)
+	{
+		messages.push_back(std::string(msg, len));
+	}
+};
+
+/// Builds a compact heightfield and poly mesh of a small terrain with a ramp and a raised block.
+bool buildTestCompactHeightfield(rcContext& ctx, rcCompactHeightfield& chf)
+{
+	const float verts[] = {
+		0, 0, 0,   20, 0, 0,   20, 0, 20,   0, 0, 20,	// Ground
+		4, 0, 4,   10, 3, 4,   10, 3, 10,   4, 0, 10,	// Ramp
+		10, 3, 4,  16, 3, 4,   16, 3, 10,   10, 3, 10,	// Plateau
+	};
+	const int tris[] = {
+		0, 2, 1,   0, 3, 2,
+		4, 6, 5,   4, 7, 6,
+		8, 10, 9,  8, 11, 10,
+	};
+	const int nverts = 12;
+	const int ntris = 6;
+
+	const float cellSize = 0.25f;
+	const float cellHeight = 0.1f;
+	const int walkableHeight = 20;
+	const int walkableClimb = 5;
+
+	float bmin[3];
+	float bmax[3];
+	rcCalcBounds(verts, nverts, bmin, bmax);
+	bmax[1] += 1.0f;
+	int width = 0;
+	int height = 0;
+	rcCalcGridSize(bmin, bmax, cellSize, &width, &height);
+
+	rcHeightfield solid;
+	if (!rcCreateHeightfield(&ctx, solid, width, height, bmin, bmax, cellSize, cellHeight))
+		return false;
+	unsigned char areas[ntris];
+	memset(areas, 0, sizeof(areas));
+	rcMarkWalkableTriangles(&ctx, 45.0f, verts, nverts, tris, ntris, areas);
+	if (!rcRasterizeTriangles(&ctx, verts, nverts, tris, areas, ntris, solid, walkableClimb))
+		return false;
+	return rcBuildCompactHeightfield(&ctx, walkableHeight, walkableClimb, solid, chf);
+}
+
+bool buildTestPolyMesh(rcContext& ctx, rcCompactHeightfield& chf, rcPolyMesh& mesh)
+{
+	if (!buildTestCompactHeightfield(ctx, chf))
+		return false;
+	if (!rcBuildDistanceField(&ctx, chf))
+		return false;
+	if (!rcBuildRegions(&ctx, chf, 0, 8, 20))
+		return false;
+	rcContourSet cset;
+	if (!rcBuildContours(&ctx, chf, 1.3f, 48, cset))
+		return false;
+	return rcBuildPolyMesh(&ctx, cset, 6, mesh);
+}
+}
+
+TEST_CASE("rcBuildPolyMeshDetail", "[recast]")
+{
+	rcContext ctx(false);
+	rcCompactHeightfield chf;
+	rcPolyMesh mesh;
+	REQUIRE(buildTestPolyMesh(ctx, chf, mesh));
+	REQUIRE(mesh.npolys > 1);
+
+	rcPolyMeshDetail& serial = *rcAllocPolyMeshDetail();
+	REQUIRE(rcBuildPolyMeshDetail(&ctx, mesh, chf, 1.5f, 0.1f, serial));
+	REQUIRE(serial.nmeshes == mesh.npolys);
+
+	SECTION("Sub-meshes are packed in polygon order")
+	{
+		int nverts = 0;
+		int ntris = 0;
+		for (int i = 0; i < serial.nmeshes; ++i)
+		{
+			REQUIRE(serial.meshes[i*4+0] == (unsigned int)nverts);
+			REQUIRE(serial.meshes[i*4+2] == (unsigned int)ntris);
+			REQUIRE(serial.meshes[i*4+1] >= 3);
+			nverts += serial.meshes[i*4+1];
+			ntris += serial.meshes[i*4+3];
+		}
+		REQUIRE(nverts == serial.nverts);
+		REQUIRE(ntris == serial.ntris);
+	}
+
+	SECTION("Parallel build matches the serial build")
+	{
+		const int rangeSize = GENERATE(1, 3, 1000);
+		ReverseRangeContext parallelCtx(rangeSize);
+		rcPolyMeshDetail& parallel = *rcAllocPolyMeshDetail();
+		REQUIRE(rcBuildPolyMeshDetail(&parallelCtx, mesh, chf, 1.5f, 0.1f, parallel));
+
+		REQUIRE(parallel.nmeshes == serial.nmeshes);
+		REQUIRE(parallel.nverts == serial.nverts);
+		REQUIRE(parallel.ntris == serial.ntris);
+		REQUIRE(memcmp(parallel.meshes, serial.meshes, sizeof(unsigned int)*4*serial.nmeshes) == 0);
+		REQUIRE(memcmp(parallel.verts, serial.verts, sizeof(float)*3*serial.nverts) == 0);
+		REQUIRE(memcmp(parallel.tris, serial.tris, sizeof(unsigned char)*4*serial.ntris) == 0);
+		rcFreePolyMeshDetail(&parallel);
+	}
+
+	SECTION("Flat polygons are not sampled")
+	{
+		LogContext logCtx;
+		rcPolyMeshDetail& dmesh = *rcAllocPolyMeshDetail();
+		REQUIRE(rcBuildPolyMeshDetail(&logCtx, mesh, chf, 1.5f, 0.1f, dmesh));
+		rcFreePolyMeshDetail(&dmesh);
+
+		int nflat = -1;
+		int npolys = -1;
+		for (size_t i = 0; i < logCtx.messages.size(); ++i)
+			sscanf(logCtx.messages[i].c_str(), "rcBuildPolyMeshDetail: Skipped sampling of %d/%d", &nflat, &npolys);
+		REQUIRE(npolys == mesh.npolys);
+		// The ground and plateau are flat, the ramp is not.
+		REQUIRE(nflat > 0);
+		REQUIRE(nflat < mesh.npolys);
+	}
+
+	SECTION("Incremental Delaunay insertion covers the same polygons")
+	{
+		rcPolyMeshDetail& incremental = *rcAllocPolyMeshDetail();
+		REQUIRE(rcBuildPolyMeshDetail(&ctx, mesh, chf, 1.5f, 0.1f, incremental, RC_DETAIL_INCREMENTAL_DELAUNAY));
+		REQUIRE(incremental.nmeshes == serial.nmeshes);
+
+		int nsampled = 0;
+		for (int i = 0; i < incremental.nmeshes; ++i)
+		{
+			const unsigned int* m = &incremental.meshes[i*4];
+			const unsigned int* sm = &serial.meshes[i*4];
+			const float* verts = &incremental.verts[m[0]*3];
+
+			// Same winding and total area as the rebuilt triangulation.
+			float area = 0;
+			for (unsigned int j = 0; j < m[3]; ++j)
+			{
+				const unsigned char* t = &incremental.tris[(m[2]+j)*4];
+				REQUIRE(t[0] < m[1]);
+				REQUIRE(t[1] < m[1]);
+				REQUIRE(t[2] < m[1]);
+				const float* a = &verts[t[0]*3];
+				const float* b = &verts[t[1]*3];
+				const float* c = &verts[t[2]*3];
+				area += (b[0]-a[0])*(c[2]-a[2]) - (b[2]-a[2])*(c[0]-a[0]);
+			}
+			float serialArea = 0;
+			for (unsigned int j = 0; j < sm[3]; ++j)
+			{
+				const unsigned char* t = &serial.tris[(sm[2]+j)*4];
+				const float* a = &serial.verts[(sm[0]+t[0])*3];
+				const float* b = &serial.verts[(sm[0]+t[1])*3];
+				const float* c = &serial.verts[(sm[0]+t[2])*3];
+				serialArea += (b[0]-a[0])*(c[2]-a[2]) - (b[2]-a[2])*(c[0]-a[0]);
+			}
+			REQUIRE(area == Catch::Approx(serialArea).epsilon(1e-4));
+
+			// Once interior samples were added, no vertex lies inside the circumcircle of a triangle.
+			if (m[3] <= m[1]-2)
+				continue;
+			nsampled++;
+			for (unsigned int j = 0; j < m[3]; ++j)
+			{
+				const unsigned char* t = &incremental.tris[(m[2]+j)*4];
+				const float* a = &verts[t[0]*3];
+				const float* b = &verts[t[1]*3];
+				const float* c = &verts[t[2]*3];
+				const float bx = b[0]-a[0], bz = b[2]-a[2];
+				const float cx = c[0]-a[0], cz = c[2]-a[2];
+				const float d = 2*(bx*cz - bz*cx);
+				if (fabsf(d) < 1e-6f)
+					continue;
+				const float ux = (cz*(bx*bx + bz*bz) - bz*(cx*cx + cz*cz)) / d;
+				const float uz = (bx*(cx*cx + cz*cz) - cx*(bx*bx + bz*bz)) / d;
+				const float r2 = ux*ux + uz*uz;
+				for (unsigned int k = 0; k < m[1]; ++k)
+				{
+					const float dx = verts[k*3+0]-a[0] - ux;
+					const float dz = verts[k*3+2]-a[2] - uz;
+					REQUIRE(dx*dx + dz*dz >= r2*0.99f);
+				}
+			}
+		}
+		REQUIRE(nsampled > 0);
+		rcFreePolyMeshDetail(&incremental);
+	}
+
+	rcFreePolyMeshDetail(&serial);
+}
+
+TEST_CASE("rcMarkAreaVolumes", "[recast]")
+{
+	rcContext ctx(false);
+	const int size = 70;
+	rcCompactHeightfield sequential;
+	rcCompactHeightfield batched;
+	REQUIRE(buildFloorCompactHeightfield(ctx, size, 30, 40, sequential));
+	REQUIRE(buildFloorCompactHeightfield(ctx, size, 30, 40, batched));
+
+	// Overlapping volumes of all shapes, some partly or fully outside of the grid and some
+	// clearing the area, so that the marking order matters.
+	const int numVolumes = 60;
+	rcAreaVolume volumes[numVolumes];
+	float verts[numVolumes][4 * 3];
+	memset(volumes, 0, sizeof(volumes));
+	srand(42);
+	for (int i = 0; i < numVolumes; ++i)
+	{
+		rcAreaVolume& volume = volumes[i];
+		const float x = (float)(rand() % (size + 20)) - 10.0f;
+		const float z = (float)(rand() % (size + 20)) - 10.0f;
+		const float extent = 1.0f + (float)(rand() % 15);
+		volume.type = i % 3;
+		volume.areaId = (unsigned char)(i % 7 == 0 ? RC_NULL_AREA : 1 + i % 5);
+		if (volume.type == RC_AREA_VOLUME_BOX)
+		{
+			const float boxMin[] = {x, 0.0f, z};
+			const float boxMax[] = {x + extent, (i % 2) ? 2.0f : 10.0f, z + extent * 0.5f};
+			rcVcopy(volume.boxMin, boxMin);
+			rcVcopy(volume.boxMax, boxMax);
+		}
+		else if (volume.type == RC_AREA_VOLUME_CONVEX)
+		{
+			const float poly[] = {x, 0, z,   x, 0, z + extent,   x + extent, 0, z + extent * 0.7f,   x + extent * 0.8f, 0, z - 1.0f};
+			memcpy(verts[i], poly, sizeof(poly));
+			volume.verts = verts[i];
+			volume.nverts = 4;
+			volume.minY = -1.0f;
+			volume.maxY = (i % 2) ? 2.0f : 10.0f;
+		}
+		else
+		{
+			const float position[] = {x, -1.0f, z};
+			rcVcopy(volume.position, position);
+			volume.radius = extent * 0.5f;
+			volume.height = (i % 2) ? 3.0f : 10.0f;
+		}
+	}
+
+	for (int i = 0; i < numVolumes; ++i)
+	{
+		const rcAreaVolume& volume = volumes[i];
+		if (volume.type == RC_AREA_VOLUME_BOX)
+			rcMarkBoxArea(&ctx, volume.boxMin, volume.boxMax, volume.areaId, sequential);
+		else if (volume.type == RC_AREA_VOLUME_CONVEX)
+			rcMarkConvexPolyArea(&ctx, volume.verts, volume.nverts, volume.minY, volume.maxY, volume.areaId, sequential);
+		else
+			rcMarkCylinderArea(&ctx, volume.position, volume.radius, volume.height, volume.areaId, sequential);
+	}
+
+	SECTION("Serial")
+	{
+		REQUIRE(rcMarkAreaVolumes(&ctx, volumes, numVolumes, batched));
+	}
+
+	SECTION("Parallel")
+	{
+		ReverseRangeContext parallelCtx(1);
+		REQUIRE(rcMarkAreaVolumes(&parallelCtx, volumes, numVolumes, batched));
+	}
+
+	REQUIRE(sequential.spanCount == batched.spanCount);
+	REQUIRE(memcmp(sequential.areas, batched.areas, sequential.spanCount) == 0);
+
+	// The volumes changed the areas at all.
+	int numMarked = 0;
+	for (int i = 0; i < sequential.spanCount; ++i)
+	{
+		if (sequential.areas[i] != RC_WALKABLE_AREA)
+			numMarked++;
+	}
+	REQUIRE(numMarked > 0);
+}
+
+namespace
+{
+/// Builds a heightfield with a few random spans per column, using a fixed seed.
+bool buildRandomHeightfield(rcContext& ctx, const int size, rcHeightfield& hf)
+{
+	const float bmin[] = {0, 0, 0};
+	const float bmax[] = {(float)size, 100.0f, (float)size};
+	if (!rcCreateHeightfield(&ctx, hf, size, size, bmin, bmax, 1.0f, 1.0f))
+		return false;
+	srand(7);
+	for (int z = 0; z < size; ++z)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			int y = rand() % 8;
+			const int numSpans = rand() % 4;
+			for (int i = 0; i < numSpans; ++i)
+			{
+				const unsigned short smin = (unsigned short)y;
+				const unsigned short smax = (unsigned short)(y + 1 + rand() % 3);
+				const unsigned char area = (unsigned char)((rand() % 3) ? RC_WALKABLE_AREA : RC_NULL_AREA);
+				if (!rcAddSpan(&ctx, hf, x, z, smin, smax, area, 1))
+					return false;
+				y = smax + 1 + rand() % 12;
+			}
+		}
+	}
+	return true;
+}
+
+/// Returns the area ids of all spans of the heightfield, column by column.
+std::vector<unsigned char> getSpanAreas(const rcHeightfield& hf)
+{
+	std::vector<unsigned char> areas;
+	for (int i = 0; i < hf.width * hf.height; ++i)
+	{
+		for (const rcSpan* span = hf.spans[i]; span; span = span->next)
+			areas.push_back((unsigned char)span->area);
+	}
+	return areas;
+}
+}
+
+TEST_CASE("rcFilterWalkableSpans", "[recast]")
+{
+	rcContext ctx(false);
+	const int size = 40;
+	const int walkableHeight = 6;
+	const int walkableClimb = 2;
+	const int filterFlags = GENERATE(
+		RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS | RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS,
+		RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS,
+		RC_FILTER_LEDGE_SPANS | RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS,
+		RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS,
+		RC_FILTER_LEDGE_SPANS,
+		0);
+
+	rcHeightfield separate;
+	rcHeightfield fused;
+	REQUIRE(buildRandomHeightfield(ctx, size, separate));
+	REQUIRE(buildRandomHeightfield(ctx, size, fused));
+
+	const std::vector<unsigned char> unfiltered = getSpanAreas(separate);
+
+	if (filterFlags & RC_FILTER_LOW_HANGING_OBSTACLES)
+		rcFilterLowHangingWalkableObstacles(&ctx, walkableClimb, separate);
+	if (filterFlags & RC_FILTER_LEDGE_SPANS)
+		rcFilterLedgeSpans(&ctx, walkableHeight, walkableClimb, separate);
+	if (filterFlags & RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS)
+		rcFilterWalkableLowHeightSpans(&ctx, walkableHeight, separate);
+
+	SECTION("Serial")
+	{
+		rcFilterWalkableSpans(&ctx, filterFlags, walkableHeight, walkableClimb, fused);
+	}
+
+	SECTION("Parallel")
+	{
+		ReverseRangeContext parallelCtx(3);
+		rcFilterWalkableSpans(&parallelCtx, filterFlags, walkableHeight, walkableClimb, fused);
+	}
+
+	const std::vector<unsigned char> expected = getSpanAreas(separate);
+	REQUIRE(getSpanAreas(fused) == expected);
+	if (filterFlags != 0)
+		REQUIRE(expected != unfiltered);
+}
+
+namespace
+{
+/// Adds a floor of quads and a box standing on it at the given position.
+void buildFloorWithBox(const float boxX, const float boxZ, std::vector<float>& verts, std::vector<int>& tris)
+{
+	verts.clear();
+	tris.clear();
+	const int floorSize = 12;
+	for (int z = 0; z <= floorSize; ++z)
+	{
+		for (int x = 0; x <= floorSize; ++x)
+		{
+			verts.push_back((float)x);
+			verts.push_back(0.1f * (float)((x * 7 + z * 3) % 4));
+			verts.push_back((float)z);
+		}
+	}
+	for (int z = 0; z < floorSize; ++z)
+	{
+		for (int x = 0; x < floorSize; ++x)
+		{
+			const int v = x + z * (floorSize + 1);
+			const int quad[] = {v, v + floorSize + 1, v + 1,   v + 1, v + floorSize + 1, v + floorSize + 2};
+			tris.insert(tris.end(), quad, quad + 6);
+		}
+	}
+
+	// A box with a walkable top that is too high to climb on.
+	const int first = (int)verts.size() / 3;
+	for (int i = 0; i < 8; ++i)
+	{
+		verts.push_back(boxX + ((i & 1) ? 2.3f : 0.0f));
+		verts.push_back((i & 2) ? 1.5f : -0.5f);
+		verts.push_back(boxZ + ((i & 4) ? 1.7f : 0.0f));
+	}
+	const int faces[] = {
+		2, 6, 3,   3, 6, 7,	// top
+		0, 2, 1,   1, 2, 3,	// front
+		4, 5, 6,   5, 7, 6,	// back
+		0, 4, 2,   2, 4, 6,	// left
+		1, 3, 5,   3, 7, 5	// right
+	};
+	for (int i = 0; i < 30; ++i)
+		tris.push_back(first + faces[i]);
+}
+
+/// Rasterizes and filters the mesh into a fresh heightfield.
+bool buildFilteredHeightfield(rcContext& ctx, const std::vector<float>& verts, const std::vector<int>& tris, const int filterFlags, rcHeightfield& hf)
+{
+	const float bmin[] = {-1.0f, -1.0f, -1.0f};
+	const float bmax[] = {13.0f, 5.0f, 13.0f};
+	if (!rcCreateHeightfield(&ctx, hf, 56, 56, bmin, bmax, 0.25f, 0.1f))
+		return false;
+	const int ntris = (int)tris.size() / 3;
+	std::vector<unsigned char> areas(ntris, 0);
+	rcMarkWalkableTriangles(&ctx, 45.0f, &verts[0], (int)verts.size() / 3, &tris[0], ntris, &areas[0]);
+	if (!rcRasterizeTriangles(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], ntris, hf, 2))
+		return false;
+	rcFilterWalkableSpans(&ctx, filterFlags, 10, 2, hf);
+	return true;
+}
+
+/// Returns all spans of the heightfield as (column, smin, smax, area) tuples.
+std::vector<unsigned int> getSpans(const rcHeightfield& hf)
+{
+	std::vector<unsigned int> spans;
+	for (int i = 0; i < hf.width * hf.height; ++i)
+	{
+		for (const rcSpan* span = hf.spans[i]; span; span = span->next)
+		{
+			spans.push_back((unsigned int)i);
+			spans.push_back(span->smin);
+			spans.push_back(span->smax);
+			spans.push_back(span->area);
+		}
+	}
+	return spans;
+}
+}
+
+TEST_CASE("rcRasterizeTrianglesInColumns", "[recast]")
+{
+	rcContext ctx(false);
+	const int filterFlags = RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS | RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS;
+
+	std::vector<float> verts;
+	std::vector<int> tris;
+	buildFloorWithBox(2.3f, 3.1f, verts, tris);
+	rcHeightfield patched;
+	REQUIRE(buildFilteredHeightfield(ctx, verts, tris, filterFlags, patched));
+	const std::vector<unsigned int> before = getSpans(patched);
+
+	// Move the box and rebuild the columns it covered before and after, plus two columns of slack.
+	buildFloorWithBox(6.6f, 4.2f, verts, tris);
+	const int minX = (int)((2.3f + 1.0f) / 0.25f) - 2;
+	const int minZ = (int)((3.1f + 1.0f) / 0.25f) - 2;
+	const int maxX = (int)((6.6f + 2.3f + 1.0f) / 0.25f) + 2;
+	const int maxZ = (int)((4.2f + 1.7f + 1.0f) / 0.25f) + 2;
+	rcClearHeightfieldColumns(&ctx, patched, minX, minZ, maxX, maxZ);
+	const int ntris = (int)tris.size() / 3;
+	std::vector<unsigned char> areas(ntris, 0);
+	rcMarkWalkableTriangles(&ctx, 45.0f, &verts[0], (int)verts.size() / 3, &tris[0], ntris, &areas[0]);
+	REQUIRE(rcRasterizeTrianglesInColumns(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], ntris, patched, minX, minZ, maxX, maxZ, 2));
+	rcFilterWalkableSpansInColumns(&ctx, filterFlags, 10, 2, minX, minZ, maxX, maxZ, patched);
+
+	rcHeightfield rebuilt;
+	REQUIRE(buildFilteredHeightfield(ctx, verts, tris, filterFlags, rebuilt));
+	const std::vector<unsigned int> expected = getSpans(rebuilt);
+	REQUIRE(expected != before);
+	REQUIRE(getSpans(patched) == expected);
+
+	SECTION("Columns outside the rectangle are not touched")
+	{
+		REQUIRE(rcRasterizeTrianglesInColumns(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], ntris, patched, -10, -10, -5, -5, 2));
+		REQUIRE(getSpans(patched) == expected);
+	}
+}
+
+TEST_CASE("rcBuildDistanceField keeps the distances out of the arenas", "[recast]")
+{
+	rcContext ctx(false);
+	std::vector<float> verts;
+	std::vector<int> tris;
+	buildFloorWithBox(2.3f, 3.1f, verts, tris);
+	rcHeightfield hf;
+	REQUIRE(buildFilteredHeightfield(ctx, verts, tris, 0, hf));
+
+	rcArena arena;
+	REQUIRE(arena.init(4 * 1024 * 1024));
+	rcAllocSetArenas(&arena, 1, NULL);
+	rcCompactHeightfield chf;
+	const bool built = rcBuildCompactHeightfield(&ctx, 10, 2, hf, chf) && rcBuildDistanceField(&ctx, chf);
+	const bool ownsDist = arena.owns(chf.dist);
+	const std::vector<unsigned short> dist(chf.dist, chf.dist + chf.spanCount);
+
+	// Reuse the arena as the next build step would, while the compact heightfield is still alive.
+	arena.reset();
+	memset(arena.alloc(arena.getCapacity()), 0xff, arena.getCapacity());
+	rcAllocSetArenas(NULL, 0, NULL);
+
+	REQUIRE(built);
+	REQUIRE(arena.getUsed() > 0);
+	REQUIRE(!ownsDist);
+	REQUIRE(std::vector<unsigned short>(chf.dist, chf.dist + chf.spanCount) == dist);
+	REQUIRE(chf.maxDistance > 0);
+}
+
+TEST_CASE("rcRasterizeHeightmap", "[recast]")
+{
+	rcContext ctx(false);
+	const int numX = 11;
+	const int numZ = 9;
+	const float origin[] = {0.3f, 0.5f, -0.2f};
+	const float spacing = 0.37f;
+
+	std::vector<float> heights(numX * numZ);
+	for (int z = 0; z < numZ; ++z)
+	{
+		for (int x = 0; x < numX; ++x)
+		{
+			heights[x + z * numX] = 0.8f * sinf(0.9f * (float)x) + 0.5f * cosf(1.3f * (float)z);
+		}
+	}
+
+	// The triangulation of the heightmap that rcRasterizeHeightmap is equivalent to.
+	std::vector<float> verts;
+	std::vector<int> tris;
+	for (int z = 0; z < numZ; ++z)
+	{
+		for (int x = 0; x < numX; ++x)
+		{
+			verts.push_back(origin[0] + (float)x * spacing);
+			verts.push_back(origin[1] + heights[x + z * numX]);
+			verts.push_back(origin[2] + (float)z * spacing);
+		}
+	}
+	for (int z = 0; z < numZ - 1; ++z)
+	{
+		for (int x = 0; x < numX - 1; ++x)
+		{
+			const int v00 = x + z * numX;
+			const int v10 = v00 + 1;
+			const int v01 = v00 + numX;
+			const int v11 = v01 + 1;
+			const int cell[] = {v00, v11, v10, v00, v01, v11};
+			tris.insert(tris.end(), cell, cell + 6);
+		}
+	}
+	const int ntris = (int)tris.size() / 3;
+
+	const float bmin[] = {-1.0f, -1.0f, -1.0f};
+	const float bmax[] = {5.0f, 3.0f, 5.0f};
+
+	SECTION("Matches the triangulated heightmap")
+	{
+		std::vector<unsigned char> cellAreas((numX - 1) * (numZ - 1), RC_WALKABLE_AREA);
+		std::vector<unsigned char> triAreas(ntris, RC_WALKABLE_AREA);
+
+		rcHeightfield fromHeightmap;
+		REQUIRE(rcCreateHeightfield(&ctx, fromHeightmap, 24, 24, bmin, bmax, 0.25f, 0.1f));
+		REQUIRE(rcRasterizeHeightmap(&ctx, &heights[0], &cellAreas[0], numX, numZ, origin, spacing, fromHeightmap));
+
+		rcHeightfield fromTriangles;
+		REQUIRE(rcCreateHeightfield(&ctx, fromTriangles, 24, 24, bmin, bmax, 0.25f, 0.1f));
+		REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &triAreas[0], ntris, fromTriangles));
+
+		int numColumns = 0;
+		for (int i = 0; i < 24 * 24; ++i)
+		{
+			const rcSpan* expected = fromTriangles.spans[i];
+			const rcSpan* span = fromHeightmap.spans[i];
+			REQUIRE((expected == NULL) == (span == NULL));
+			if (expected == NULL)
+			{
+				continue;
+			}
+			numColumns++;
+			REQUIRE(expected->next == NULL);
+			REQUIRE(span->next == NULL);
+			// The two differ only in floating point rounding at the cell boundaries.
+			REQUIRE(abs((int)span->smin - (int)expected->smin) <= 1);
+			REQUIRE(abs((int)span->smax - (int)expected->smax) <= 1);
+			REQUIRE(span->area == RC_WALKABLE_AREA);
+		}
+		REQUIRE(numColumns > 0);
+	}
+
+	SECTION("Coarse heightfield")
+	{
+		// Every column overlaps several heightmap cells.
+		std::vector<unsigned char> cellAreas((numX - 1) * (numZ - 1), RC_WALKABLE_AREA);
+		const float coarseOrigin[] = {0.4f, 0.5f, -0.2f};
+		rcHeightfield hf;
+		REQUIRE(rcCreateHeightfield(&ctx, hf, 6, 6, bmin, bmax, 1.0f, 0.1f));
+		REQUIRE(rcRasterizeHeightmap(&ctx, &heights[0], &cellAreas[0], numX, numZ, coarseOrigin, spacing, hf));
+
+		for (int z = 0; z < 6; ++z)
+		{
+			for (int x = 0; x < 6; ++x)
+			{
+				const rcSpan* span = hf.spans[x + z * 6];
+				const bool covered = x >= 1 && z <= 3;
+				REQUIRE((span != NULL) == covered);
+				if (span != NULL)
+				{
+					REQUIRE(span->next == NULL);
+					REQUIRE(span->smin < span->smax);
+				}
+			}
+		}
+	}
+
+	SECTION("Higher cells decide the area")
+	{
+		std::vector<float> flat(numX * numZ, 0.0f);
+		std::vector<unsigned char> cellAreas((numX - 1) * (numZ - 1), 0);
+		for (int z = 0; z < numZ - 1; ++z)
+		{
+			for (int x = (numX - 1) / 2; x < numX - 1; ++x)
+			{
+				cellAreas[x + z * (numX - 1)] = RC_WALKABLE_AREA;
+			}
+		}
+
+		rcHeightfield hf;
+		REQUIRE(rcCreateHeightfield(&ctx, hf, 24, 24, bmin, bmax, 0.25f, 0.1f));
+		REQUIRE(rcRasterizeHeightmap(&ctx, &flat[0], &cellAreas[0], numX, numZ, origin, spacing, hf));
+
+		// Columns on the boundary between the halves are walkable, because both halves are at the same height.
+		const float boundaryX = origin[0] + (float)((numX - 1) / 2) * spacing;
+		const int z = 8;
+		for (int x = 0; x < 24; ++x)
+		{
+			const rcSpan* span = hf.spans[x + z * 24];
+			if (span == NULL)
+			{
+				continue;
+			}
+			const float columnMaxX = bmin[0] + (float)(x + 1) * 0.25f;
+			REQUIRE(span->area == (columnMaxX > boundaryX ? RC_WALKABLE_AREA : 0));
+		}
+	}
+
+	SECTION("Heightmap outside the heightfield")
+	{
+		std::vector<unsigned char> cellAreas((numX - 1) * (numZ - 1), RC_WALKABLE_AREA);
+		const float farOrigin[] = {20.0f, 0.5f, 20.0f};
+		rcHeightfield hf;
+		REQUIRE(rcCreateHeightfield(&ctx, hf, 24, 24, bmin, bmax, 0.25f, 0.1f));
+		REQUIRE(rcRasterizeHeightmap(&ctx, &heights[0], &cellAreas[0], numX, numZ, farOrigin, spacing, hf));
+		for (int i = 0; i < 24 * 24; ++i)
+		{
+			REQUIRE(hf.spans[i] == NULL);
+		}
+	}
+}
+
+namespace
+{
+/// Builds a house with vertical walls and a walkable pyramid roof on a 2x2 footprint.
+void buildHouse(std::vector<float>& verts, std::vector<int>& tris)
+{
+	const float points[] = {
+		0.0f, 0.0f, 0.0f,   2.0f, 0.0f, 0.0f,   2.0f, 0.0f, 2.0f,   0.0f, 0.0f, 2.0f,
+		0.0f, 1.0f, 0.0f,   2.0f, 1.0f, 0.0f,   2.0f, 1.0f, 2.0f,   0.0f, 1.0f, 2.0f,
+		1.0f, 1.5f, 1.0f
+	};
+	const int faces[] = {
+		0, 4, 1,   1, 4, 5,   1, 5, 2,   2, 5, 6,   2, 6, 3,   3, 6, 7,   3, 7, 0,   0, 7, 4,
+		4, 8, 5,   5, 8, 6,   6, 8, 7,   7, 8, 4
+	};
+	verts.assign(points, points + sizeof(points) / sizeof(points[0]));
+	tris.assign(faces, faces + sizeof(faces) / sizeof(faces[0]));
+}
+
+/// Fills the transform of an instance that rotates by the angles around the x and y-axis, then scales and translates.
+void setInstanceTransform(rcMeshInstance& instance, const float pitch, const float yaw, const float* scale, const float* translation)
+{
+	const float cp = cosf(pitch), sp = sinf(pitch), cy = cosf(yaw), sy = sinf(yaw);
+	const float rotation[9] = {
+		cy, sy * sp, sy * cp,
+		0.0f, cp, -sp,
+		-sy, cy * sp, cy * cp
+	};
+	for (int row = 0; row < 3; ++row)
+	{
+		for (int col = 0; col < 3; ++col)
+		{
+			instance.transform[row * 4 + col] = scale[row] * rotation[row * 3 + col];
+		}
+		instance.transform[row * 4 + 3] = translation[row];
+	}
+}
+}
+
+TEST_CASE("rcRasterizeMeshInstances", "[recast]")
+{
+	rcContext ctx(false);
+
+	std::vector<float> houseVerts;
+	std::vector<int> houseTris;
+	buildHouse(houseVerts, houseTris);
+	std::vector<float> floorVerts;
+	std::vector<int> floorTris;
+	buildFloorWithBox(4.0f, 4.0f, floorVerts, floorTris);
+	std::vector<unsigned char> floorAreas(floorTris.size() / 3, RC_NULL_AREA);
+
+	rcInstancedMesh meshes[2];
+	meshes[0].verts = &houseVerts[0];
+	meshes[0].numVerts = (int)houseVerts.size() / 3;
+	meshes[0].tris = &houseTris[0];
+	meshes[0].triAreaIDs = NULL;
+	meshes[0].numTris = (int)houseTris.size() / 3;
+	meshes[1].verts = &floorVerts[0];
+	meshes[1].numVerts = (int)floorVerts.size() / 3;
+	meshes[1].tris = &floorTris[0];
+	meshes[1].triAreaIDs = &floorAreas[0];
+	meshes[1].numTris = (int)floorTris.size() / 3;
+
+	const float one[] = {1.0f, 1.0f, 1.0f};
+	const float large[] = {1.5f, 1.5f, 1.5f};
+	const float mirrored[] = {-1.0f, 1.0f, 1.0f};
+	const float flat[] = {1.0f, 0.5f, 1.0f};
+	const float offsets[][3] = {
+		{0.0f, 0.0f, 0.0f}, {1.0f, 0.3f, 1.0f}, {6.0f, 0.3f, 2.0f}, {3.0f, 0.3f, 8.0f},
+		{8.0f, 0.5f, 7.0f}, {10.0f, 0.3f, 2.0f}, {9.0f, 0.3f, 10.0f}, {40.0f, 0.0f, 40.0f}
+	};
+	rcMeshInstance instances[8];
+	instances[0].mesh = 1;
+	setInstanceTransform(instances[0], 0.0f, 0.0f, one, offsets[0]);
+	instances[1].mesh = 0;
+	setInstanceTransform(instances[1], 0.0f, 0.0f, one, offsets[1]);
+	instances[2].mesh = 0;
+	setInstanceTransform(instances[2], 0.0f, 0.65f, large, offsets[2]);
+	instances[3].mesh = 0;
+	setInstanceTransform(instances[3], 0.0f, RC_PI * 0.5f, one, offsets[3]);
+	instances[4].mesh = 0;
+	setInstanceTransform(instances[4], 0.5f, 0.2f, one, offsets[4]);
+	instances[5].mesh = 0;
+	setInstanceTransform(instances[5], 0.0f, 0.3f, mirrored, offsets[5]);
+	instances[6].mesh = 0;
+	setInstanceTransform(instances[6], 0.0f, 0.0f, flat, offsets[6]);
+	instances[7].mesh = 0;
+	setInstanceTransform(instances[7], 0.0f, 0.0f, one, offsets[7]);
+
+	// Flatten the instances into a single mesh.
+	std::vector<float> verts;
+	std::vector<int> tris;
+	std::vector<unsigned char> areas;
+	for (int i = 0; i < 8; ++i)
+	{
+		const rcInstancedMesh& mesh = meshes[instances[i].mesh];
+		const float* m = instances[i].transform;
+		const float determinant =
+			m[0] * (m[5] * m[10] - m[6] * m[9]) -
+			m[1] * (m[4] * m[10] - m[6] * m[8]) +
+			m[2] * (m[4] * m[9] - m[5] * m[8]);
+		const int firstVert = (int)verts.size() / 3;
+		const int firstTri = (int)areas.size();
+		for (int v = 0; v < mesh.numVerts; ++v)
+		{
+			const float* p = &mesh.verts[v * 3];
+			for (int row = 0; row < 3; ++row)
+			{
+				verts.push_back(m[row * 4 + 0] * p[0] + m[row * 4 + 1] * p[1] + m[row * 4 + 2] * p[2] + m[row * 4 + 3]);
+			}
+		}
+		for (int t = 0; t < mesh.numTris; ++t)
+		{
+			const int* tri = &mesh.tris[t * 3];
+			tris.push_back(firstVert + tri[0]);
+			tris.push_back(firstVert + (determinant < 0.0f ? tri[2] : tri[1]));
+			tris.push_back(firstVert + (determinant < 0.0f ? tri[1] : tri[2]));
+			areas.push_back(mesh.triAreaIDs ? mesh.triAreaIDs[t] : RC_NULL_AREA);
+		}
+		rcMarkWalkableTriangles(&ctx, 45.0f, &verts[0], (int)verts.size() / 3, &tris[firstTri * 3], mesh.numTris, &areas[firstTri]);
+	}
+
+	const float bmin[] = {-1.0f, -1.0f, -1.0f};
+	const float bmax[] = {13.0f, 5.0f, 13.0f};
+	rcHeightfield expected;
+	REQUIRE(rcCreateHeightfield(&ctx, expected, 56, 56, bmin, bmax, 0.25f, 0.1f));
+	REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], (int)areas.size(), expected, 2));
+
+	rcHeightfield instanced;
+	REQUIRE(rcCreateHeightfield(&ctx, instanced, 56, 56, bmin, bmax, 0.25f, 0.1f));
+	REQUIRE(rcRasterizeMeshInstances(&ctx, meshes, 2, instances, 8, 45.0f, instanced, 2));
+
+	const std::vector<unsigned int> expectedSpans = getSpans(expected);
+	REQUIRE(getSpans(instanced) == expectedSpans);
+
+	// The roof of the upright house is walkable, while the tilted house has a roof face that is not.
+	const int firstHouseTri = meshes[1].numTris;
+	for (int t = 8; t < 12; ++t)
+	{
+		REQUIRE(areas[firstHouseTri + t] == RC_WALKABLE_AREA);
+	}
+	bool tiltedRoofBlocked = false;
+	for (int t = 8; t < 12; ++t)
+	{
+		tiltedRoofBlocked |= areas[firstHouseTri + 3 * 12 + t] == RC_NULL_AREA;
+	}
+	REQUIRE(tiltedRoofBlocked);
+
+	SECTION("Instances outside the heightfield are skipped")
+	{
+		rcHeightfield empty;
+		REQUIRE(rcCreateHeightfield(&ctx, empty, 56, 56, bmin, bmax, 0.25f, 0.1f));
+		REQUIRE(rcRasterizeMeshInstances(&ctx, meshes, 2, &instances[7], 1, 45.0f, empty, 2));
+		REQUIRE(getSpans(empty).empty());
+	}
+}
+
+namespace
+{
+/// Builds the closed surface of a box rotated by the angles around the x and y-axis.
+void buildRotatedBox(const float* center, const float* halfExtents, const float pitch, const float yaw,
+                     std::vector<float>& verts, std::vector<int>& tris)
+{
+	const float cp = cosf(pitch), sp = sinf(pitch), cy = cosf(yaw), sy = sinf(yaw);
+	verts.clear();
+	for (int i = 0; i < 8; ++i)
+	{
+		const float x = (i & 1) ? halfExtents[0] : -halfExtents[0];
+		const float y = (i & 2) ? halfExtents[1] : -halfExtents[1];
+		const float z = (i & 4) ? halfExtents[2] : -halfExtents[2];
+		const float py = cp * y - sp * z;
+		const float pz = sp * y + cp * z;
+		verts.push_back(center[0] + cy * x + sy * pz);
+		verts.push_back(center[1] + py);
+		verts.push_back(center[2] - sy * x + cy * pz);
+	}
+	const int faces[] = {
+		0, 1, 3,   0, 3, 2,   4, 6, 7,   4, 7, 5,   0, 4, 5,   0, 5, 1,
+		2, 3, 7,   2, 7, 6,   0, 2, 6,   0, 6, 4,   1, 5, 7,   1, 7, 3
+	};
+	tris.assign(faces, faces + 36);
+}
+
+/// Builds an ellipsoid as a convex hull of latitude rings between two poles, with faces wound outwards.
+void buildEllipsoid(const float* center, const float* radii, const int slices, const int stacks,
+                    std::vector<float>& verts, std::vector<int>& tris)
+{
+	verts.clear();
+	tris.clear();
+	verts.push_back(center[0]);
+	verts.push_back(center[1] + radii[1]);
+	verts.push_back(center[2]);
+	for (int stack = 1; stack < stacks; ++stack)
+	{
+		const float latitude = RC_PI * (float)stack / (float)stacks;
+		for (int slice = 0; slice < slices; ++slice)
+		{
+			const float longitude = 2.0f * RC_PI * (float)slice / (float)slices;
+			verts.push_back(center[0] + radii[0] * sinf(latitude) * cosf(longitude));
+			verts.push_back(center[1] + radii[1] * cosf(latitude));
+			verts.push_back(center[2] + radii[2] * sinf(latitude) * sinf(longitude));
+		}
+	}
+	verts.push_back(center[0]);
+	verts.push_back(center[1] - radii[1]);
+	verts.push_back(center[2]);
+
+	const int bottom = (int)verts.size() / 3 - 1;
+	for (int slice = 0; slice < slices; ++slice)
+	{
+		const int next = (slice + 1) % slices;
+		const int top[] = {0, 1 + next, 1 + slice};
+		tris.insert(tris.end(), top, top + 3);
+		for (int stack = 0; stack < stacks - 2; ++stack)
+		{
+			const int a = 1 + stack * slices + slice;
+			const int b = 1 + stack * slices + next;
+			const int quad[] = {a, b, b + slices, a, b + slices, a + slices};
+			tris.insert(tris.end(), quad, quad + 6);
+		}
+		const int ring = 1 + (stacks - 2) * slices;
+		const int base[] = {ring + slice, ring + next, bottom};
+		tris.insert(tris.end(), base, base + 3);
+	}
+}
+
+/// Checks that the primitive covers the same columns as the triangulated surface, between the same heights.
+void requireSameColumnBounds(const rcHeightfield& primitive, const rcHeightfield& triangles, const int tolerance)
+{
+	int numColumns = 0;
+	for (int i = 0; i < primitive.width * primitive.height; ++i)
+	{
+		const rcSpan* span = primitive.spans[i];
+		const rcSpan* surface = triangles.spans[i];
+		REQUIRE((span == NULL) == (surface == NULL));
+		if (span == NULL)
+		{
+			continue;
+		}
+		numColumns++;
+		REQUIRE(span->next == NULL);
+		const rcSpan* top = surface;
+		while (top->next)
+		{
+			top = top->next;
+		}
+		REQUIRE(abs((int)span->smin - (int)surface->smin) <= tolerance);
+		REQUIRE(abs((int)span->smax - (int)top->smax) <= tolerance);
+		REQUIRE(span->area == RC_WALKABLE_AREA);
+	}
+	REQUIRE(numColumns > 0);
+}
+}
+
+TEST_CASE("rcRasterizeBox, rcRasterizeCylinder and rcRasterizeConvexHull", "[recast]")
+{
+	rcContext ctx(false);
+	const float bmin[] = {-1.0f, -1.0f, -1.0f};
+	const float bmax[] = {5.0f, 3.0f, 5.0f};
+
+	rcHeightfield primitive;
+	REQUIRE(rcCreateHeightfield(&ctx, primitive, 24, 24, bmin, bmax, 0.25f, 0.1f));
+	rcHeightfield triangles;
+	REQUIRE(rcCreateHeightfield(&ctx, triangles, 24, 24, bmin, bmax, 0.25f, 0.1f));
+
+	std::vector<float> verts;
+	std::vector<int> tris;
+
+	SECTION("Box")
+	{
+		const float center[] = {1.33f, 0.47f, 2.11f};
+		const float halfExtents[] = {1.21f, 0.66f, 0.83f};
+		const float boxMin[] = {center[0] - halfExtents[0], center[1] - halfExtents[1], center[2] - halfExtents[2]};
+		const float boxMax[] = {center[0] + halfExtents[0], center[1] + halfExtents[1], center[2] + halfExtents[2]};
+		REQUIRE(rcRasterizeBox(&ctx, boxMin, boxMax, RC_WALKABLE_AREA, primitive));
+
+		buildRotatedBox(center, halfExtents, 0.0f, 0.0f, verts, tris);
+		std::vector<unsigned char> areas(tris.size() / 3, RC_WALKABLE_AREA);
+		REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], (int)areas.size(), triangles));
+		requireSameColumnBounds(primitive, triangles, 0);
+	}
+
+	SECTION("Cylinder")
+	{
+		const float position[] = {2.07f, -0.3f, 1.71f};
+		const float radius = 1.13f;
+		const float height = 1.9f;
+		REQUIRE(rcRasterizeCylinder(&ctx, position, radius, height, RC_WALKABLE_AREA, primitive));
+
+		int numColumns = 0;
+		for (int z = 0; z < 24; ++z)
+		{
+			for (int x = 0; x < 24; ++x)
+			{
+				const float columnMinX = bmin[0] + (float)x * 0.25f;
+				const float columnMinZ = bmin[2] + (float)z * 0.25f;
+				const float dx = rcMax(rcMax(columnMinX - position[0], position[0] - columnMinX - 0.25f), 0.0f);
+				const float dz = rcMax(rcMax(columnMinZ - position[2], position[2] - columnMinZ - 0.25f), 0.0f);
+				const rcSpan* span = primitive.spans[x + z * 24];
+				REQUIRE((span != NULL) == (dx * dx + dz * dz < radius * radius));
+				if (span != NULL)
+				{
+					numColumns++;
+					REQUIRE(span->smin == 7);
+					REQUIRE(span->smax == 26);
+					REQUIRE(span->next == NULL);
+				}
+			}
+		}
+		REQUIRE(numColumns > 0);
+	}
+
+	SECTION("Rotated box as a convex hull")
+	{
+		const float center[] = {2.03f, 0.91f, 1.87f};
+		const float halfExtents[] = {1.12f, 0.43f, 0.71f};
+		buildRotatedBox(center, halfExtents, 0.31f, 0.57f, verts, tris);
+		REQUIRE(rcRasterizeConvexHull(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], (int)tris.size() / 3, RC_WALKABLE_AREA, primitive));
+
+		std::vector<unsigned char> areas(tris.size() / 3, RC_WALKABLE_AREA);
+		REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], (int)areas.size(), triangles));
+		requireSameColumnBounds(primitive, triangles, 1);
+	}
+
+	SECTION("Tetrahedron as a convex hull")
+	{
+		const float points[] = {0.13f, 0.2f, 0.31f,   3.71f, 0.4f, 0.57f,   1.43f, 0.1f, 3.62f,   1.77f, 2.3f, 1.49f};
+		const int faces[] = {0, 1, 2,   0, 3, 1,   1, 3, 2,   2, 3, 0};
+		verts.assign(points, points + 12);
+		tris.assign(faces, faces + 12);
+		REQUIRE(rcRasterizeConvexHull(&ctx, &verts[0], 4, &tris[0], 4, RC_WALKABLE_AREA, primitive));
+
+		std::vector<unsigned char> areas(4, RC_WALKABLE_AREA);
+		REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], 4, &tris[0], &areas[0], 4, triangles));
+		requireSameColumnBounds(primitive, triangles, 1);
+	}
+
+	SECTION("Many-faced convex hull")
+	{
+		const float center[] = {2.13f, 0.87f, 1.94f};
+		const float radii[] = {2.41f, 1.17f, 1.73f};
+		buildEllipsoid(center, radii, 32, 16, verts, tris);
+		REQUIRE(tris.size() / 3 == 32 * 2 * 15);
+		REQUIRE(rcRasterizeConvexHull(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], (int)tris.size() / 3, RC_WALKABLE_AREA, primitive));
+
+		std::vector<unsigned char> areas(tris.size() / 3, RC_WALKABLE_AREA);
+		REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], (int)areas.size(), triangles));
+		requireSameColumnBounds(primitive, triangles, 1);
+	}
+
+	SECTION("Outside the heightfield")
+	{
+		const float boxMin[] = {7.0f, 0.0f, 7.0f};
+		const float boxMax[] = {8.0f, 1.0f, 8.0f};
+		REQUIRE(rcRasterizeBox(&ctx, boxMin, boxMax, RC_WALKABLE_AREA, primitive));
+		const float position[] = {1.0f, 4.0f, 1.0f};
+		REQUIRE(rcRasterizeCylinder(&ctx, position, 1.0f, 1.0f, RC_WALKABLE_AREA, primitive));
+		for (int i = 0; i < 24 * 24; ++i)
+		{
+			REQUIRE(primitive.spans[i] == NULL);
+		}
+	}
+}
+
+namespace
+{
+/// Returns the bounds and the cells of all layers of the set.
+std::vector<int> getLayers(const rcHeightfieldLayerSet& lset)
+{
+	std::vector<int> data;
+	for (int i = 0; i < lset.nlayers; ++i)
+	{
+		const rcHeightfieldLayer& layer = lset.layers[i];
+		const int bounds[] = {layer.width, layer.height, layer.minx, layer.maxx, layer.miny, layer.maxy, layer.hmin, layer.hmax};
+		data.insert(data.end(), bounds, bounds + 8);
+		data.insert(data.end(), layer.heights, layer.heights + layer.width * layer.height);
+		data.insert(data.end(), layer.areas, layer.areas + layer.width * layer.height);
+		data.insert(data.end(), layer.cons, layer.cons + layer.width * layer.height);
+	}
+	return data;
+}
+}
+
+TEST_CASE("rcBuildHeightfieldLayers", "[recast]")
+{
+	rcContext ctx(false);
+	const int walkableHeight = 6;
+	const int walkableClimb = 2;
+	const int borderSize = 2;
+	int expectedLayers = 0;
+
+	rcHeightfield hf;
+	SECTION("Random spans")
+	{
+		REQUIRE(buildRandomHeightfield(ctx, 40, hf));
+	}
+
+	SECTION("More stacked floors than the former limit of 63 overlapping regions")
+	{
+		const int size = 16;
+		expectedLayers = 80;
+		const float bmin[] = {0, 0, 0};
+		const float bmax[] = {(float)size, 2000.0f, (float)size};
+		REQUIRE(rcCreateHeightfield(&ctx, hf, size, size, bmin, bmax, 1.0f, 1.0f));
+		for (int z = 0; z < size; ++z)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				for (int i = 0; i < expectedLayers; ++i)
+					REQUIRE(rcAddSpan(&ctx, hf, x, z, (unsigned short)(i * 20), (unsigned short)(i * 20 + 1), RC_WALKABLE_AREA, 1));
+			}
+		}
+	}
+
+	rcCompactHeightfield chf;
+	REQUIRE(rcBuildCompactHeightfield(&ctx, walkableHeight, walkableClimb, hf, chf));
+
+	rcHeightfieldLayerSet serial;
+	REQUIRE(rcBuildHeightfieldLayers(&ctx, chf, borderSize, walkableHeight, serial));
+	REQUIRE(serial.nlayers > 0);
+	if (expectedLayers)
+		REQUIRE(serial.nlayers == expectedLayers);
+
+	// Every band of rows is swept on its own thread and connected to the previous band afterwards.
+	ReverseRangeContext parallelCtx(1);
+	rcHeightfieldLayerSet parallel;
+	REQUIRE(rcBuildHeightfieldLayers(&parallelCtx, chf, borderSize, walkableHeight, parallel));
+	REQUIRE(getLayers(parallel) == getLayers(serial));
+}
+
+namespace
+{
+/// Returns the region ids of all spans of the compact heightfield, followed by the region count.
+std::vector<unsigned short> getSpanRegions(const rcCompactHeightfield& chf)
+{
+	std::vector<unsigned short> regions;
+	for (int i = 0; i < chf.spanCount; ++i)
+		regions.push_back(chf.spans[i].reg);
+	regions.push_back(chf.maxRegions);
+	return regions;
+}
+
+/// Builds a compact heightfield with many small regions to merge and filter: a floor with a lattice of holes, a
+/// stripe of another area and a bridge over part of the floor, next to islands that are too small to keep.
+bool buildLatticeCompactHeightfield(rcContext& ctx, rcCompactHeightfield& chf)
+{
+	const int size = 96;
+	const float bmin[] = {0, 0, 0};
+	const float bmax[] = {(float)size, 100.0f, (float)size};
+	rcHeightfield hf;
+	if (!rcCreateHeightfield(&ctx, hf, size, size, bmin, bmax, 1.0f, 1.0f))
+		return false;
+	for (int z = 0; z < size; ++z)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			bool floor;
+			if (x < 76)
+				floor = (x % 6 != 3 || z % 6 != 3) && (x % 11 != 7 || z % 3 == 0);
+			else if (z < 48)
+				floor = x % 5 != 0 && z % 5 != 0;
+			else
+				floor = x % 3 != 0 && z % 3 != 0;
+			const unsigned char area = (x >= 30 && x < 34) ? 2 : RC_WALKABLE_AREA;
+			if (floor && !rcAddSpan(&ctx, hf, x, z, 0, 1, area, 1))
+				return false;
+			if (x >= 20 && x < 60 && z >= 40 && z < 45 && !rcAddSpan(&ctx, hf, x, z, 10, 11, RC_WALKABLE_AREA, 1))
+				return false;
+		}
+	}
+	return rcBuildCompactHeightfield(&ctx, 2, 1, hf, chf) && rcBuildDistanceField(&ctx, chf);
+}
+
+/// Returns the 64-bit FNV-1a hash of the region ids of all spans.
+unsigned long long hashSpanRegions(const rcCompactHeightfield& chf)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for (int i = 0; i < chf.spanCount; ++i)
+	{
+		hash ^= chf.spans[i].reg;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+}
+
+TEST_CASE("rcBuildRegionsParallel", "[recast]")
+{
+	rcContext ctx(false);
+	const int walkableHeight = 2;
+	const int walkableClimb = 1;
+	const int borderSize = 0;
+	const int minRegionArea = 8;
+	const int mergeRegionArea = 20;
+
+	// Spans over several flood tiles, so that regions are joined across tile borders.
+	rcHeightfield hf;
+	bool flat = false;
+	SECTION("Random spans")
+	{
+		REQUIRE(buildRandomHeightfield(ctx, 150, hf));
+	}
+
+	SECTION("Flat floor")
+	{
+		flat = true;
+		const int size = 150;
+		const float bmin[] = {0, 0, 0};
+		const float bmax[] = {(float)size, 10.0f, (float)size};
+		REQUIRE(rcCreateHeightfield(&ctx, hf, size, size, bmin, bmax, 1.0f, 1.0f));
+		for (int z = 0; z < size; ++z)
+		{
+			for (int x = 0; x < size; ++x)
+				REQUIRE(rcAddSpan(&ctx, hf, x, z, 0, 1, RC_WALKABLE_AREA, 1));
+		}
+	}
+
+	rcCompactHeightfield chf;
+	REQUIRE(rcBuildCompactHeightfield(&ctx, walkableHeight, walkableClimb, hf, chf));
+	REQUIRE(rcBuildDistanceField(&ctx, chf));
+
+	REQUIRE(rcBuildRegions(&ctx, chf, borderSize, minRegionArea, mergeRegionArea));
+	const std::vector<unsigned short> serial = getSpanRegions(chf);
+	REQUIRE(chf.maxRegions > 0);
+
+	// The region expansion only reads the regions of the previous iteration.
+	ReverseRangeContext parallelCtx(64);
+	REQUIRE(rcBuildRegions(&parallelCtx, chf, borderSize, minRegionArea, mergeRegionArea));
+	REQUIRE(getSpanRegions(chf) == serial);
+
+	// The flood tiles do not depend on the threads they are flooded on.
+	REQUIRE(rcBuildRegionsParallel(&ctx, chf, borderSize, minRegionArea, mergeRegionArea));
+	const std::vector<unsigned short> tiled = getSpanRegions(chf);
+	REQUIRE(chf.maxRegions > 0);
+	ReverseRangeContext tileCtx(1);
+	REQUIRE(rcBuildRegionsParallel(&tileCtx, chf, borderSize, minRegionArea, mergeRegionArea));
+	REQUIRE(getSpanRegions(chf) == tiled);
+
+	// An open floor is flooded from its centre, across the tile borders, into a single region.
+	if (flat)
+		REQUIRE(tiled == serial);
+}
+
+TEST_CASE("Region merging and filtering", "[recast]")
+{
+	// The region ids, and the hash of the ids of all spans, that each builder produced before the merge and filter
+	// pass was rewritten around a merge queue.
+	typedef bool (BuildRegionsFunc)(rcContext*, rcCompactHeightfield&, int, int, int);
+	struct ExpectedRegions
+	{
+		BuildRegionsFunc* build;
+		int maxRegions;
+		unsigned long long hash;
+	};
+	ExpectedRegions expected = {0, 0, 0};
+	SECTION("Watershed")
+	{
+		const ExpectedRegions watershed = {rcBuildRegions, 67, 0x64540f58b51cdc3cULL};
+		expected = watershed;
+	}
+	SECTION("Watershed on tiles")
+	{
+		const ExpectedRegions tiled = {rcBuildRegionsParallel, 67, 0xa50032e9b731b39aULL};
+		expected = tiled;
+	}
+	SECTION("Monotone")
+	{
+		const ExpectedRegions monotone = {rcBuildRegionsMonotone, 97, 0x8375759f949cf8ceULL};
+		expected = monotone;
+	}
+	SECTION("Local clearance minimum")
+	{
+		const ExpectedRegions lcm = {rcBuildRegionsLCM, 127, 0x0d1da5dd12e6b57fULL};
+		expected = lcm;
+	}
+
+	rcContext ctx(false);
+	ReverseRangeContext parallelCtx(1);
+	rcContext* contexts[] = {&ctx, &parallelCtx};
+	for (int i = 0; i < 2; ++i)
+	{
+		rcCompactHeightfield chf;
+		REQUIRE(buildLatticeCompactHeightfield(*contexts[i], chf));
+		REQUIRE(expected.build(contexts[i], chf, 0, 12, 40));
+		REQUIRE(chf.maxRegions == expected.maxRegions);
+		REQUIRE(hashSpanRegions(chf) == expected.hash);
+	}
+}
+
+TEST_CASE("Time-sliced builds", "[recast]")
+{
+	rcContext ctx(false);
+	rcCompactHeightfield chf;
+	REQUIRE(buildTestCompactHeightfield(ctx, chf));
+
+	// The builds in one call.
+	REQUIRE(rcBuildDistanceField(&ctx, chf));
+	const std::vector<unsigned short> dist(chf.dist, chf.dist + chf.spanCount);
+	const unsigned short maxDistance = chf.maxDistance;
+	REQUIRE(rcBuildRegions(&ctx, chf, 0, 8, 20));
+	const std::vector<unsigned short> regions = getSpanRegions(chf);
+	const unsigned short maxRegions = chf.maxRegions;
+	rcContourSet cset;
+	REQUIRE(rcBuildContours(&ctx, chf, 1.3f, 48, cset));
+	rcPolyMesh mesh;
+	REQUIRE(rcBuildPolyMesh(&ctx, cset, 6, mesh));
+	REQUIRE(mesh.npolys > 1);
+	rcPolyMeshDetail dmesh;
+	REQUIRE(rcBuildPolyMeshDetail(&ctx, mesh, chf, 1.5f, 0.1f, dmesh));
+
+	// The same builds, one row, level, contour, vertex or polygon per step.
+	bool ok = true;
+	bool done = false;
+	int steps = 0;
+
+	SECTION("Distance field")
+	{
+		rcDistanceFieldBuild* build = rcAllocDistanceFieldBuild();
+		REQUIRE(build);
+		REQUIRE(rcBeginDistanceField(&ctx, chf, *build));
+		REQUIRE(chf.dist == NULL);
+		for (; ok && !done; ++steps)
+			ok = rcStepDistanceField(&ctx, *build, 1, done);
+		rcFreeDistanceFieldBuild(build);
+
+		REQUIRE(ok);
+		REQUIRE(steps == chf.height*4);
+		REQUIRE(chf.maxDistance == maxDistance);
+		REQUIRE(std::vector<unsigned short>(chf.dist, chf.dist + chf.spanCount) == dist);
+	}
+
+	SECTION("Regions")
+	{
+		for (int i = 0; i < chf.spanCount; ++i)
+			chf.spans[i].reg = 0;
+
+		rcRegionsBuild* build = rcAllocRegionsBuild();
+		REQUIRE(build);
+		REQUIRE(rcBeginRegions(&ctx, chf, 0, 8, 20, *build));
+		for (; ok && !done; ++steps)
+			ok = rcStepRegions(&ctx, *build, 1, done);
+		rcFreeRegionsBuild(build);
+
+		REQUIRE(ok);
+		// One step per level, plus the expansion and the filtering.
+		REQUIRE(steps == ((maxDistance+1) & ~1)/2 + 2);
+		REQUIRE(chf.maxRegions == maxRegions);
+		REQUIRE(getSpanRegions(chf) == regions);
+	}
+
+	SECTION("Contours")
+	{
+		rcContourSet sliced;
+		rcContoursBuild* build = rcAllocContoursBuild();
+		REQUIRE(build);
+		REQUIRE(rcBeginContours(&ctx, chf, 1.3f, 48, sliced, *build));
+		for (; ok && !done; ++steps)
+			ok = rcStepContours(&ctx, *build, 1, done);
+		rcFreeContoursBuild(build);
+
+		REQUIRE(ok);
+		REQUIRE(steps == chf.height*2 + 1);
+		REQUIRE(sliced.nconts == cset.nconts);
+		for (int i = 0; i < cset.nconts; ++i)
+		{
+			const rcContour& a = sliced.conts[i];
+			const rcContour& b = cset.conts[i];
+			REQUIRE(a.reg == b.reg);
+			REQUIRE(a.area == b.area);
+			REQUIRE(a.nverts == b.nverts);
+			REQUIRE(memcmp(a.verts, b.verts, sizeof(int)*4*b.nverts) == 0);
+			REQUIRE(a.nrverts == b.nrverts);
+			REQUIRE(memcmp(a.rverts, b.rverts, sizeof(int)*4*b.nrverts) == 0);
+		}
+	}
+
+	SECTION("Polygon mesh")
+	{
+		rcPolyMesh sliced;
+		rcPolyMeshBuild* build = rcAllocPolyMeshBuild();
+		REQUIRE(build);
+		REQUIRE(rcBeginPolyMesh(&ctx, cset, 6, sliced, *build));
+		for (; ok && !done; ++steps)
+			ok = rcStepPolyMesh(&ctx, *build, 1, done);
+		rcFreePolyMeshBuild(build);
+
+		REQUIRE(ok);
+		REQUIRE(steps > cset.nconts);
+		REQUIRE(sliced.nverts == mesh.nverts);
+		REQUIRE(sliced.npolys == mesh.npolys);
+		REQUIRE(memcmp(sliced.verts, mesh.verts, sizeof(rcMeshIndex)*3*mesh.nverts) == 0);
+		REQUIRE(memcmp(sliced.polys, mesh.polys, sizeof(rcMeshIndex)*2*mesh.nvp*mesh.npolys) == 0);
+		REQUIRE(memcmp(sliced.regs, mesh.regs, sizeof(unsigned short)*mesh.npolys) == 0);
+		REQUIRE(memcmp(sliced.areas, mesh.areas, sizeof(unsigned char)*mesh.npolys) == 0);
+	}
+
+	SECTION("Detail mesh")
+	{
+		rcPolyMeshDetail sliced;
+		rcPolyMeshDetailBuild* build = rcAllocPolyMeshDetailBuild();
+		REQUIRE(build);
+		REQUIRE(rcBeginPolyMeshDetail(&ctx, mesh, chf, 1.5f, 0.1f, sliced, *build));
+		for (; ok && !done; ++steps)
+			ok = rcStepPolyMeshDetail(&ctx, *build, 1, done);
+		rcFreePolyMeshDetailBuild(build);
+
+		REQUIRE(ok);
+		REQUIRE(steps == mesh.npolys);
+		REQUIRE(sliced.nmeshes == dmesh.nmeshes);
+		REQUIRE(sliced.nverts == dmesh.nverts);
+		REQUIRE(sliced.ntris == dmesh.ntris);
+		REQUIRE(memcmp(sliced.meshes, dmesh.meshes, sizeof(unsigned int)*4*dmesh.nmeshes) == 0);
+		REQUIRE(memcmp(sliced.verts, dmesh.verts, sizeof(float)*3*dmesh.nverts) == 0);
+		REQUIRE(memcmp(sliced.tris, dmesh.tris, sizeof(unsigned char)*4*dmesh.ntris) == 0);
+	}
+}
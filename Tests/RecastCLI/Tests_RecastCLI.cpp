@@ -0,0 +1,1104 @@
+#include "BuildCache.h"
+#include "BuildContext.h"
+#include "ChunkyTriMesh.h"
+#include "Generators.h"
+#include "InputGeom.h"
+#include "StreamingBuild.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <Recast.h>
+
+#include <catch2/catch_all.hpp>
+
+namespace fs = std::filesystem;
+
+namespace {
+// A fresh directory under the system temporary directory, removed again at the end of the test.
+struct TempDirectory {
+  explicit TempDirectory(const char *name) : path{fs::temp_directory_path() / name} {
+    fs::remove_all(path);
+    fs::create_directories(path);
+  }
+  ~TempDirectory() {
+    std::error_code error;
+    fs::remove_all(path, error);
+  }
+  fs::path path;
+};
+
+void writeFile(const fs::path &path, const std::string &contents) { std::ofstream{path, std::ios::binary} << contents; }
+
+std::string readFile(const fs::path &path) {
+  std::ifstream file{path, std::ios::binary};
+  return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+// Writes a square of quads from the origin to (size, size) in xz, rising by @p rise per unit along x.
+void writePlaneObj(const fs::path &path, const int quads, const float size, const float rise = 0.0f) {
+  std::ofstream file{path};
+  const float step = size / static_cast<float>(quads);
+  for (int z = 0; z <= quads; ++z)
+    for (int x = 0; x <= quads; ++x)
+      file << "v " << static_cast<float>(x) * step << ' ' << static_cast<float>(x) * step * rise << ' ' << static_cast<float>(z) * step << '\n';
+  for (int z = 0; z < quads; ++z) {
+    for (int x = 0; x < quads; ++x) {
+      const int v = z * (quads + 1) + x + 1;
+      file << "f " << v << ' ' << v + quads + 1 << ' ' << v + 1 << '\n';
+      file << "f " << v + 1 << ' ' << v + quads + 1 << ' ' << v + quads + 2 << '\n';
+    }
+  }
+}
+
+// The agent settings of the CLI, with the given bounds.
+rcConfig makeSoloConfig(const float *bmin, const float *bmax) {
+  rcConfig config{};
+  config.cs = 0.3f;
+  config.ch = 0.2f;
+  config.walkableSlopeAngle = 45.0f;
+  config.walkableHeight = 10;
+  config.walkableClimb = 4;
+  config.walkableRadius = 2;
+  config.maxEdgeLen = 40;
+  config.maxSimplificationError = 1.3f;
+  config.minRegionArea = 64;
+  config.mergeRegionArea = 400;
+  config.maxVertsPerPoly = 6;
+  config.detailSampleDist = 1.8f;
+  config.detailSampleMaxError = 0.2f;
+  rcVcopy(config.bmin, bmin);
+  rcVcopy(config.bmax, bmax);
+  rcCalcGridSize(config.bmin, config.bmax, config.cs, &config.width, &config.height);
+  return config;
+}
+
+rcConfig makeStreamingConfig(const InputGeom &geom) { return makeSoloConfig(geom.getNavMeshBoundsMin(), geom.getNavMeshBoundsMax()); }
+
+// A 20 by 20 floor with a box of 2 by 2 by 2 on it, whose corner is at (boxX, 0, boxZ).
+struct FloorWithBox {
+  FloorWithBox(const float boxX, const float boxZ) {
+    const float floorVerts[] = {0, 0, 0, 0, 0, 20, 20, 0, 0, 20, 0, 20};
+    verts.assign(floorVerts, floorVerts + 12);
+    const int floorTris[] = {0, 1, 2, 2, 1, 3};
+    tris.assign(floorTris, floorTris + 6);
+    for (int i = 0; i < 8; ++i) {
+      verts.push_back(boxX + static_cast<float>(i & 1) * 2.0f);
+      verts.push_back(static_cast<float>((i >> 1) & 1) * 2.0f);
+      verts.push_back(boxZ + static_cast<float>((i >> 2) & 1) * 2.0f);
+    }
+    // The top and the four sides of the box, wound to face outwards.
+    const int boxTris[] = {2, 6, 3, 3, 6, 7, 0, 1, 2, 2, 1, 3, 4, 6, 5, 5, 6, 7, 0, 2, 4, 4, 2, 6, 1, 5, 3, 3, 5, 7};
+    for (const int v : boxTris)
+      tris.push_back(4 + v);
+  }
+  int getVertCount() const { return static_cast<int>(verts.size() / 3); }
+  int getTriCount() const { return static_cast<int>(tris.size() / 3); }
+
+  std::vector<float> verts;
+  std::vector<int> tris;
+};
+
+void requireEqualMeshes(const rcPolyMesh &a, const rcPolyMesh &b, const rcPolyMeshDetail &detailA, const rcPolyMeshDetail &detailB) {
+  REQUIRE(a.nverts == b.nverts);
+  REQUIRE(a.npolys == b.npolys);
+  REQUIRE(std::vector<rcMeshIndex>(a.verts, a.verts + a.nverts * 3) == std::vector<rcMeshIndex>(b.verts, b.verts + b.nverts * 3));
+  REQUIRE(std::vector<rcMeshIndex>(a.polys, a.polys + a.npolys * 2 * a.nvp) == std::vector<rcMeshIndex>(b.polys, b.polys + b.npolys * 2 * b.nvp));
+  REQUIRE(std::vector<unsigned char>(a.areas, a.areas + a.npolys) == std::vector<unsigned char>(b.areas, b.areas + b.npolys));
+  REQUIRE(detailA.nverts == detailB.nverts);
+  REQUIRE(detailA.ntris == detailB.ntris);
+  REQUIRE(std::vector<float>(detailA.verts, detailA.verts + detailA.nverts * 3) == std::vector<float>(detailB.verts, detailB.verts + detailB.nverts * 3));
+}
+
+// The doubled area of the polygons of the mesh, in cells.
+long long polyMeshDoubleArea(const rcPolyMesh &mesh) {
+  long long area = 0;
+  for (int i = 0; i < mesh.npolys; ++i) {
+    const rcMeshIndex *poly = &mesh.polys[i * 2 * mesh.nvp];
+    int count = 0;
+    while (count < mesh.nvp && poly[count] != RC_MESH_NULL_IDX)
+      count++;
+    long long doubleArea = 0;
+    for (int j = 0, k = count - 1; j < count; k = j++)
+      doubleArea += static_cast<long long>(mesh.verts[poly[k] * 3 + 0]) * mesh.verts[poly[j] * 3 + 2] - static_cast<long long>(mesh.verts[poly[j] * 3 + 0]) * mesh.verts[poly[k] * 3 + 2];
+    area += std::llabs(doubleArea);
+  }
+  return area;
+}
+
+// Returns true if the point at (x, z) cells lies inside a polygon of the mesh.
+bool polyMeshContains(const rcPolyMesh &mesh, const float x, const float z) {
+  for (int i = 0; i < mesh.npolys; ++i) {
+    const rcMeshIndex *poly = &mesh.polys[i * 2 * mesh.nvp];
+    int count = 0;
+    while (count < mesh.nvp && poly[count] != RC_MESH_NULL_IDX)
+      count++;
+    bool inside = false;
+    for (int j = 0, k = count - 1; j < count; k = j++) {
+      const float xj = mesh.verts[poly[j] * 3 + 0], zj = mesh.verts[poly[j] * 3 + 2];
+      const float xk = mesh.verts[poly[k] * 3 + 0], zk = mesh.verts[poly[k] * 3 + 2];
+      if ((zj > z) != (zk > z) && x < (xk - xj) * (z - zj) / (zk - zj) + xj)
+        inside = !inside;
+    }
+    if (inside)
+      return true;
+  }
+  return false;
+}
+
+// Requires every link between two polygons of the mesh to lead back from the neighbour.
+void requireMutualLinks(const rcPolyMesh &mesh) {
+  for (int i = 0; i < mesh.npolys; ++i) {
+    const rcMeshIndex *poly = &mesh.polys[i * 2 * mesh.nvp];
+    for (int j = 0; j < mesh.nvp && poly[j] != RC_MESH_NULL_IDX; ++j) {
+      const rcMeshIndex neighbour = poly[mesh.nvp + j];
+      if (neighbour == RC_MESH_NULL_IDX)
+        continue;
+      REQUIRE(static_cast<int>(neighbour) < mesh.npolys);
+      const rcMeshIndex *neighbourPoly = &mesh.polys[neighbour * 2 * mesh.nvp];
+      REQUIRE(std::find(neighbourPoly + mesh.nvp, neighbourPoly + mesh.nvp * 2, static_cast<rcMeshIndex>(i)) != neighbourPoly + mesh.nvp * 2);
+    }
+  }
+}
+
+// The vertices of a polygon of the mesh, followed by the vertices of its detail mesh.
+std::vector<float> polyWithDetail(const rcPolyMesh &mesh, const rcPolyMeshDetail &detailMesh, const int poly) {
+  std::vector<float> verts;
+  for (int j = 0; j < mesh.nvp && mesh.polys[poly * 2 * mesh.nvp + j] != RC_MESH_NULL_IDX; ++j) {
+    const rcMeshIndex *v = &mesh.verts[mesh.polys[poly * 2 * mesh.nvp + j] * 3];
+    verts.insert(verts.end(), {static_cast<float>(v[0]), static_cast<float>(v[1]), static_cast<float>(v[2])});
+  }
+  const unsigned int *subMesh = &detailMesh.meshes[poly * 4];
+  verts.insert(verts.end(), &detailMesh.verts[subMesh[0] * 3], &detailMesh.verts[(subMesh[0] + subMesh[1]) * 3]);
+  return verts;
+}
+
+// The vertices on the portal edges of a streamed window, in cells of the configured cell size from the origin of the
+// build.
+std::vector<std::array<int, 3>> loadPortalVertices(rcContext &context, const fs::path &path, const rcConfig &config, const int originX, const int originZ) {
+  rcPolyMesh *mesh = rcAllocPolyMesh();
+  rcPolyMeshDetail *detailMesh = rcAllocPolyMeshDetail();
+  REQUIRE(loadStreamedWindow(context, path.string(), *mesh, *detailMesh));
+  const int unit = static_cast<int>(std::lround(mesh->cs / config.cs));
+  std::vector<std::array<int, 3>> verts;
+  for (int i = 0; i < mesh->npolys; ++i) {
+    const rcMeshIndex *poly = &mesh->polys[i * 2 * mesh->nvp];
+    for (int j = 0; j < mesh->nvp && poly[j] != RC_MESH_NULL_IDX; ++j) {
+      if (poly[mesh->nvp + j] == RC_MESH_NULL_IDX || !(poly[mesh->nvp + j] & RC_MESH_PORTAL_FLAG))
+        continue;
+      const rcMeshIndex *v = &mesh->verts[poly[j] * 3];
+      verts.push_back({originX + static_cast<int>(v[0]) * unit, static_cast<int>(v[1]), originZ + static_cast<int>(v[2]) * unit});
+      const int nj = j + 1 < mesh->nvp && poly[j + 1] != RC_MESH_NULL_IDX ? j + 1 : 0;
+      v = &mesh->verts[poly[nj] * 3];
+      verts.push_back({originX + static_cast<int>(v[0]) * unit, static_cast<int>(v[1]), originZ + static_cast<int>(v[2]) * unit});
+    }
+  }
+  rcFreePolyMesh(mesh);
+  rcFreePolyMeshDetail(detailMesh);
+  return verts;
+}
+
+// A streamed window read back from its file, with its bounds, polygon area and portal edge vertices in cells of the
+// build, and the contour simplification error it was built with in its own cells.
+struct LoadedWindow {
+  int originX, originZ, sizeX, sizeZ, unit;
+  long long area;
+  float maxEdgeError;
+  std::vector<std::array<int, 3>> portalVerts;
+};
+
+std::vector<LoadedWindow> loadWindows(rcContext &context, const fs::path &directory, const rcConfig &config) {
+  std::vector<LoadedWindow> windows;
+  for (const fs::directory_entry &file : fs::directory_iterator(directory)) {
+    LoadedWindow window{};
+    if (std::sscanf(file.path().filename().string().c_str(), "window_%d_%d.bin", &window.originX, &window.originZ) != 2)
+      continue;
+    rcPolyMesh *mesh = rcAllocPolyMesh();
+    rcPolyMeshDetail *detailMesh = rcAllocPolyMeshDetail();
+    REQUIRE(loadStreamedWindow(context, file.path().string(), *mesh, *detailMesh));
+    window.unit = static_cast<int>(std::lround(mesh->cs / config.cs));
+    window.sizeX = static_cast<int>(std::lround((mesh->bmax[0] - mesh->bmin[0]) / config.cs));
+    window.sizeZ = static_cast<int>(std::lround((mesh->bmax[2] - mesh->bmin[2]) / config.cs));
+    window.maxEdgeError = mesh->maxEdgeError;
+    for (int i = 0; i < mesh->npolys; ++i) {
+      const rcMeshIndex *poly = &mesh->polys[i * 2 * mesh->nvp];
+      int count = 0;
+      while (count < mesh->nvp && poly[count] != RC_MESH_NULL_IDX)
+        count++;
+      long long doubleArea = 0;
+      for (int j = 0, k = count - 1; j < count; k = j++)
+        doubleArea += static_cast<long long>(mesh->verts[poly[k] * 3 + 0]) * mesh->verts[poly[j] * 3 + 2] - static_cast<long long>(mesh->verts[poly[j] * 3 + 0]) * mesh->verts[poly[k] * 3 + 2];
+      window.area += std::llabs(doubleArea) * window.unit * window.unit / 2;
+    }
+    rcFreePolyMesh(mesh);
+    rcFreePolyMeshDetail(detailMesh);
+    window.portalVerts = loadPortalVertices(context, file.path(), config, window.originX, window.originZ);
+    windows.push_back(window);
+  }
+  return windows;
+}
+
+// Requires every portal vertex of a window that lies strictly inside an edge of a coarser window to be a vertex of
+// that coarser window too.
+void requireSeamVerticesShared(const std::vector<LoadedWindow> &windows) {
+  for (const LoadedWindow &fine : windows) {
+    for (const LoadedWindow &coarse : windows) {
+      if (fine.unit >= coarse.unit)
+        continue;
+      for (const std::array<int, 3> &vertex : fine.portalVerts) {
+        const bool onEdgeX = (vertex[0] == coarse.originX || vertex[0] == coarse.originX + coarse.sizeX) && vertex[2] > coarse.originZ && vertex[2] < coarse.originZ + coarse.sizeZ;
+        const bool onEdgeZ = (vertex[2] == coarse.originZ || vertex[2] == coarse.originZ + coarse.sizeZ) && vertex[0] > coarse.originX && vertex[0] < coarse.originX + coarse.sizeX;
+        if (onEdgeX || onEdgeZ)
+          REQUIRE(std::find(coarse.portalVerts.begin(), coarse.portalVerts.end(), vertex) != coarse.portalVerts.end());
+      }
+    }
+  }
+}
+
+int countWindowFiles(const fs::path &directory) {
+  int count = 0;
+  for (const fs::directory_entry &file : fs::directory_iterator(directory))
+    count += file.path().extension() == ".bin" ? 1 : 0;
+  return count;
+}
+
+// Records the thread index of every item of an outer parallelFor and of the parallelFor each item starts.
+struct NestedParallelFor {
+  static const int OUTER_COUNT = 8;
+  static const int INNER_COUNT = 16;
+  rcContext *context;
+  int outerThreads[OUTER_COUNT];
+  int innerThreads[OUTER_COUNT][INNER_COUNT];
+
+  static void runInner(void *userData, const int begin, const int end, const int threadIndex) {
+    int *threads = static_cast<int *>(userData);
+    for (int i = begin; i < end; ++i)
+      threads[i] = threadIndex;
+  }
+
+  static void runOuter(void *userData, const int begin, const int end, const int threadIndex) {
+    NestedParallelFor &nested = *static_cast<NestedParallelFor *>(userData);
+    for (int i = begin; i < end; ++i) {
+      nested.outerThreads[i] = threadIndex;
+      nested.context->parallelFor(INNER_COUNT, runInner, nested.innerThreads[i]);
+    }
+  }
+};
+
+// An allocator that counts its blocks, to check that other allocators are layered on top of it.
+int s_countedAllocs = 0;
+int s_countedFrees = 0;
+
+void *allocCounted(const size_t size, rcAllocHint) {
+  ++s_countedAllocs;
+  return std::malloc(size);
+}
+
+void freeCounted(void *ptr) {
+  ++s_countedFrees;
+  std::free(ptr);
+}
+
+BuildCacheKey makeKey(const int value) {
+  BuildCacheKey key;
+  key.add(value);
+  return key;
+}
+// Returns a pseudo-random number in [0, 1), so that the tests are repeatable.
+float nextRandom(std::uint32_t &state) {
+  state = state * 1664525u + 1013904223u;
+  return static_cast<float>(state >> 8) / static_cast<float>(1u << 24);
+}
+
+// Adds triangles of up to 3 units wide at random positions in a box of 100 by 10 by 100, each with its own vertices.
+void buildTriangleSoup(const int count, std::uint32_t seed, std::vector<float> &verts, std::vector<int> &tris) {
+  for (int i = 0; i < count; ++i) {
+    const float center[3] = {nextRandom(seed) * 100.0f, nextRandom(seed) * 10.0f, nextRandom(seed) * 100.0f};
+    for (int j = 0; j < 3; ++j) {
+      tris.push_back(static_cast<int>(verts.size() / 3));
+      for (int k = 0; k < 3; ++k)
+        verts.push_back(center[k] + (nextRandom(seed) - 0.5f) * 3.0f);
+    }
+  }
+}
+
+// Returns whether the xz-bounds of the triangle overlap the rect.
+bool triOverlapsRect(const float *verts, const int *tri, const float *rectMin, const float *rectMax) {
+  float bmin[2] = {verts[tri[0] * 3 + 0], verts[tri[0] * 3 + 2]};
+  float bmax[2] = {bmin[0], bmin[1]};
+  for (int j = 1; j < 3; ++j) {
+    for (int k = 0; k < 2; ++k) {
+      bmin[k] = std::min(bmin[k], verts[tri[j] * 3 + k * 2]);
+      bmax[k] = std::max(bmax[k], verts[tri[j] * 3 + k * 2]);
+    }
+  }
+  return bmin[0] <= rectMax[0] && bmax[0] >= rectMin[0] && bmin[1] <= rectMax[1] && bmax[1] >= rectMin[1];
+}
+
+// Intersects the segment with the front face of one triangle, the way raycastMesh does for four at a time.
+bool intersectSegmentTriangle(const float *sp, const float *sq, const float *a, const float *b, const float *c, float &t) {
+  float ab[3], ac[3], qp[3], ap[3], norm[3], e[3];
+  rcVsub(ab, b, a);
+  rcVsub(ac, c, a);
+  rcVsub(qp, sp, sq);
+  rcVcross(norm, ab, ac);
+  const float d = rcVdot(qp, norm);
+  if (d <= 0.0f)
+    return false;
+  rcVsub(ap, sp, a);
+  t = rcVdot(ap, norm);
+  if (t < 0.0f || t > d)
+    return false;
+  rcVcross(e, qp, ap);
+  const float v = rcVdot(ac, e);
+  if (v < 0.0f || v > d)
+    return false;
+  const float w = -rcVdot(ab, e);
+  if (w < 0.0f || v + w > d)
+    return false;
+  t /= d;
+  return true;
+}
+
+// Casts the segment against every triangle of the mesh.
+bool raycastAllTriangles(const rcMeshLoaderObj &mesh, const float *src, const float *dst, float &tmin) {
+  const float *verts = mesh.getVerts();
+  const int *tris = mesh.getTris();
+  bool hit = false;
+  tmin = 1.0f;
+  for (int i = 0; i < mesh.getTriCount(); ++i) {
+    float t;
+    if (intersectSegmentTriangle(src, dst, &verts[tris[i * 3 + 0] * 3], &verts[tris[i * 3 + 1] * 3], &verts[tris[i * 3 + 2] * 3], t)) {
+      tmin = std::min(tmin, t);
+      hit = true;
+    }
+  }
+  return hit;
+}
+} // namespace
+
+TEST_CASE("BuildContext", "[recastcli]") {
+  SECTION("Runs a parallelFor started from a worker on the thread of that worker") {
+    BuildContext context;
+    context.setMaxThreads(4);
+    NestedParallelFor nested{};
+    nested.context = &context;
+    context.parallelFor(NestedParallelFor::OUTER_COUNT, NestedParallelFor::runOuter, &nested);
+    for (int i = 0; i < NestedParallelFor::OUTER_COUNT; ++i) {
+      for (int j = 0; j < NestedParallelFor::INNER_COUNT; ++j)
+        REQUIRE(nested.innerThreads[i][j] == nested.outerThreads[i]);
+    }
+  }
+}
+
+TEST_CASE("BuildCacheKey", "[recastcli]") {
+  SECTION("Hashes the bytes with 64-bit FNV-1a") {
+    BuildCacheKey key;
+    REQUIRE(key.toString() == "cbf29ce484222325");
+    key.add("a", 1);
+    REQUIRE(key.getHash() == 0xaf63dc4c8601ec8cull);
+    REQUIRE(key.toString() == "af63dc4c8601ec8c");
+  }
+
+  SECTION("Depends on the order of the inputs") {
+    BuildCacheKey ab, ba;
+    ab.add(1);
+    ab.add(2);
+    ba.add(2);
+    ba.add(1);
+    REQUIRE(ab.getHash() != ba.getHash());
+    REQUIRE(makeKey(1).getHash() == makeKey(1).getHash());
+  }
+}
+
+TEST_CASE("BuildCache", "[recastcli]") {
+  TempDirectory directory{"recast_build_cache_test"};
+  const fs::path cachePath = directory.path / "cache";
+  const fs::path inputPath = directory.path / "input.bin";
+  const fs::path outputPath = directory.path / "output.bin";
+
+  SECTION("Returns the stored output of a key") {
+    BuildCache cache;
+    REQUIRE(cache.open(cachePath.string(), 0));
+    REQUIRE(fs::is_directory(cachePath));
+
+    bool hasOutput = false;
+    REQUIRE_FALSE(cache.fetch(makeKey(1), outputPath.string(), hasOutput));
+
+    writeFile(inputPath, "window one");
+    REQUIRE(cache.store(makeKey(1), inputPath.string()));
+    REQUIRE(cache.fetch(makeKey(1), outputPath.string(), hasOutput));
+    REQUIRE(hasOutput);
+    REQUIRE(readFile(outputPath) == "window one");
+
+    REQUIRE_FALSE(cache.fetch(makeKey(2), outputPath.string(), hasOutput));
+    REQUIRE(cache.getStats().hits == 1);
+    REQUIRE(cache.getStats().misses == 2);
+  }
+
+  SECTION("Records builds without output") {
+    BuildCache cache;
+    REQUIRE(cache.open(cachePath.string(), 0));
+    REQUIRE(cache.store(makeKey(1), ""));
+
+    bool hasOutput = true;
+    REQUIRE(cache.fetch(makeKey(1), outputPath.string(), hasOutput));
+    REQUIRE_FALSE(hasOutput);
+    REQUIRE_FALSE(fs::exists(outputPath));
+  }
+
+  SECTION("Finds the entries of an earlier run") {
+    {
+      BuildCache cache;
+      REQUIRE(cache.open(cachePath.string(), 0));
+      writeFile(inputPath, "window one");
+      REQUIRE(cache.store(makeKey(1), inputPath.string()));
+    }
+    BuildCache cache;
+    REQUIRE(cache.open(cachePath.string(), 0));
+    bool hasOutput = false;
+    REQUIRE(cache.fetch(makeKey(1), outputPath.string(), hasOutput));
+    REQUIRE(readFile(outputPath) == "window one");
+  }
+
+  SECTION("Evicts the least recently used entries over the size limit") {
+    BuildCache cache;
+    REQUIRE(cache.open(cachePath.string(), 25));
+    writeFile(inputPath, "0123456789");
+    REQUIRE(cache.store(makeKey(1), inputPath.string()));
+    REQUIRE(cache.store(makeKey(2), inputPath.string()));
+
+    // Using the first entry makes the second one the least recently used.
+    bool hasOutput = false;
+    REQUIRE(cache.fetch(makeKey(1), outputPath.string(), hasOutput));
+    REQUIRE(cache.store(makeKey(3), inputPath.string()));
+    REQUIRE(cache.getStats().evictions == 1);
+    REQUIRE_FALSE(fs::exists(cachePath / makeKey(2).toString()));
+
+    REQUIRE(cache.fetch(makeKey(1), outputPath.string(), hasOutput));
+    REQUIRE(cache.fetch(makeKey(3), outputPath.string(), hasOutput));
+    REQUIRE_FALSE(cache.fetch(makeKey(2), outputPath.string(), hasOutput));
+  }
+
+  SECTION("Applies a smaller size limit when opened") {
+    {
+      BuildCache cache;
+      REQUIRE(cache.open(cachePath.string(), 0));
+      writeFile(inputPath, "0123456789");
+      for (int i = 0; i < 4; ++i)
+        REQUIRE(cache.store(makeKey(i), inputPath.string()));
+    }
+    BuildCache cache;
+    REQUIRE(cache.open(cachePath.string(), 15));
+    REQUIRE(cache.getStats().evictions == 3);
+
+    std::uintmax_t totalSize = 0;
+    for (const fs::directory_entry &file : fs::directory_iterator(cachePath))
+      totalSize += file.file_size();
+    REQUIRE(totalSize <= 15);
+  }
+}
+
+TEST_CASE("Streamed build", "[recastcli]") {
+  TempDirectory directory{"recast_streamed_build_test"};
+  const fs::path objPath = directory.path / "plane.obj";
+  const fs::path outputPath = directory.path / "windows";
+  fs::create_directories(outputPath);
+  writePlaneObj(objPath, 8, 20.0f);
+
+  rcContext context;
+  InputGeom geom;
+  REQUIRE(geom.load(&context, objPath.string()));
+  rcConfig config = makeStreamingConfig(geom);
+
+  StreamingBuildSettings settings{};
+  settings.windowSize = 32;
+  settings.minWindowSize = 16;
+  settings.outputDirectory = outputPath.string();
+
+  SECTION("Builds on top of the allocator installed before it and restores it") {
+    s_countedAllocs = 0;
+    s_countedFrees = 0;
+    rcAllocSetCustom(allocCounted, freeCounted);
+    StreamingBuildStats stats{};
+    const bool built = generateStreamed(context, geom, config, settings, stats);
+    rcAllocFunc *allocFunc = nullptr;
+    rcFreeFunc *freeFunc = nullptr;
+    rcAllocGetCustom(&allocFunc, &freeFunc);
+    rcAllocSetCustom(nullptr, nullptr);
+    REQUIRE(built);
+    REQUIRE(allocFunc == allocCounted);
+    REQUIRE(freeFunc == freeCounted);
+    REQUIRE(s_countedAllocs > 0);
+    REQUIRE(s_countedFrees == s_countedAllocs);
+  }
+
+  SECTION("Removes the file of a window that builds empty") {
+    // Windows past the end of the plane have no geometry.
+    config.bmax[0] += 20.0f;
+    rcCalcGridSize(config.bmin, config.bmax, config.cs, &config.width, &config.height);
+    const fs::path emptyWindowPath = outputPath / "window_96_0.bin";
+    writeFile(emptyWindowPath, "stale");
+
+    StreamingBuildStats stats{};
+    REQUIRE(generateStreamed(context, geom, config, settings, stats));
+    REQUIRE(stats.writtenCount > 0);
+    REQUIRE(stats.writtenCount < stats.windowCount);
+    REQUIRE(fs::exists(outputPath / "window_0_0.bin"));
+    REQUIRE_FALSE(fs::exists(emptyWindowPath));
+  }
+
+  SECTION("Splits a window that exceeds the memory cap") {
+    settings.windowSize = config.width;
+    StreamingBuildStats uncapped{};
+    REQUIRE(generateStreamed(context, geom, config, settings, uncapped));
+    REQUIRE(uncapped.windowCount == 1);
+    REQUIRE(uncapped.splitCount == 0);
+
+    fs::remove_all(outputPath);
+    fs::create_directories(outputPath);
+    settings.memoryCap = uncapped.peakMemory - 1;
+    StreamingBuildStats capped{};
+    REQUIRE(generateStreamed(context, geom, config, settings, capped));
+    REQUIRE(capped.splitCount > 0);
+    REQUIRE(capped.peakMemory <= settings.memoryCap);
+    REQUIRE(capped.writtenCount > 1);
+    REQUIRE(countWindowFiles(outputPath) == capped.writtenCount);
+  }
+
+  SECTION("Fails when a window at the minimum size exceeds the memory cap") {
+    settings.memoryCap = 1024;
+    StreamingBuildStats stats{};
+    REQUIRE_FALSE(generateStreamed(context, geom, config, settings, stats));
+  }
+
+  SECTION("Reads the windows it writes") {
+    StreamingBuildStats stats{};
+    REQUIRE(generateStreamed(context, geom, config, settings, stats));
+
+    rcPolyMesh *mesh = rcAllocPolyMesh();
+    rcPolyMeshDetail *detailMesh = rcAllocPolyMeshDetail();
+    REQUIRE(loadStreamedWindow(context, (outputPath / "window_0_0.bin").string(), *mesh, *detailMesh));
+    REQUIRE(mesh->npolys > 0);
+    REQUIRE(mesh->nvp == config.maxVertsPerPoly);
+    REQUIRE(mesh->cs == config.cs);
+    REQUIRE(detailMesh->nmeshes == mesh->npolys);
+    for (int i = 0; i < mesh->npolys * mesh->nvp; ++i) {
+      const rcMeshIndex vertex = mesh->polys[(i / mesh->nvp) * 2 * mesh->nvp + i % mesh->nvp];
+      REQUIRE((vertex == RC_MESH_NULL_IDX || static_cast<int>(vertex) < mesh->nverts));
+    }
+
+    // Writing the loaded meshes again reproduces the file.
+    const fs::path copyPath = directory.path / "copy.bin";
+    REQUIRE(writeStreamedWindow(copyPath.string(), *mesh, *detailMesh));
+    REQUIRE(readFile(copyPath) == readFile(outputPath / "window_0_0.bin"));
+    rcFreePolyMesh(mesh);
+    rcFreePolyMeshDetail(detailMesh);
+
+    writeFile(copyPath, "RCSW");
+    rcPolyMesh *truncated = rcAllocPolyMesh();
+    rcPolyMeshDetail *truncatedDetail = rcAllocPolyMeshDetail();
+    REQUIRE_FALSE(loadStreamedWindow(context, copyPath.string(), *truncated, *truncatedDetail));
+    rcFreePolyMesh(truncated);
+    rcFreePolyMeshDetail(truncatedDetail);
+  }
+
+  SECTION("Inserts the vertices of finer windows into the edges of coarser ones") {
+    // The windows along the outline of the plane need fine cells, the ones inside it are built with a coarser cell size.
+    writePlaneObj(objPath, 16, 60.0f);
+    InputGeom largeGeom;
+    REQUIRE(largeGeom.load(&context, objPath.string()));
+    config = makeStreamingConfig(largeGeom);
+    settings.adaptiveLevels = 1;
+    StreamingBuildStats stats{};
+    REQUIRE(generateStreamed(context, largeGeom, config, settings, stats));
+    REQUIRE(stats.coarseWindowCount > 0);
+
+    // Walk along the edge at x = 32 from the fine windows at (16, 32) and (16, 48) into the coarse window at (32, 32).
+    const std::vector<std::array<int, 3>> coarse = loadPortalVertices(context, outputPath / "window_32_32.bin", config, 32, 32);
+    std::vector<std::array<int, 3>> fine = loadPortalVertices(context, outputPath / "window_16_32.bin", config, 16, 32);
+    const std::vector<std::array<int, 3>> fineNorth = loadPortalVertices(context, outputPath / "window_16_48.bin", config, 16, 48);
+    fine.insert(fine.end(), fineNorth.begin(), fineNorth.end());
+    int seamCount = 0;
+    for (const std::array<int, 3> &vertex : fine) {
+      if (vertex[0] != 32 || vertex[2] <= 32 || vertex[2] >= 64)
+        continue;
+      seamCount++;
+      REQUIRE(std::find(coarse.begin(), coarse.end(), vertex) != coarse.end());
+    }
+    REQUIRE(seamCount > 0);
+    requireSeamVerticesShared(loadWindows(context, outputPath, config));
+  }
+
+  SECTION("Keeps the cell size of a window that exceeds the memory cap") {
+    // The build covers the inside of the plane only, so every window is coarse. Windows of 30 cells have an odd number
+    // of cells at level 1, so their halves would need fine cells.
+    writePlaneObj(objPath, 16, 60.0f);
+    InputGeom largeGeom;
+    REQUIRE(largeGeom.load(&context, objPath.string()));
+    config = makeStreamingConfig(largeGeom);
+    for (const int axis : {0, 2}) {
+      config.bmin[axis] += 9.0f;
+      config.bmax[axis] -= 9.0f;
+    }
+    rcCalcGridSize(config.bmin, config.bmax, config.cs, &config.width, &config.height);
+    settings.windowSize = 30;
+    settings.minWindowSize = 4;
+    settings.adaptiveLevels = 1;
+    StreamingBuildStats uncapped{};
+    REQUIRE(generateStreamed(context, largeGeom, config, settings, uncapped));
+
+    fs::remove_all(outputPath);
+    fs::create_directories(outputPath);
+    settings.memoryCap = uncapped.peakMemory - 1;
+    StreamingBuildStats capped{};
+    REQUIRE(generateStreamed(context, largeGeom, config, settings, capped));
+    REQUIRE(capped.splitCount > 0);
+    REQUIRE(capped.coarseWindowCount == capped.windowCount);
+    const std::vector<LoadedWindow> windows = loadWindows(context, outputPath, config);
+    for (const LoadedWindow &window : windows)
+      REQUIRE((window.sizeX % window.unit == 0 && window.sizeZ % window.unit == 0));
+    requireSeamVerticesShared(windows);
+  }
+
+  SECTION("Builds slopes that rise more than the climb per coarse cell with finer cells") {
+    // At level 2 a cell is 1.2 wide, so a 40 degree slope rises about 1.0 per cell against a climb of 0.8, while at
+    // level 1 it rises about 0.5. A 20 degree slope rises less than the climb even at level 2.
+    settings.adaptiveLevels = 2;
+    const auto buildSlope = [&](const float slopeDegrees) {
+      fs::remove_all(outputPath);
+      fs::create_directories(outputPath);
+      writePlaneObj(objPath, 16, 60.0f, std::tan(slopeDegrees / 180.0f * RC_PI));
+      InputGeom slopeGeom;
+      REQUIRE(slopeGeom.load(&context, objPath.string()));
+      config = makeStreamingConfig(slopeGeom);
+      StreamingBuildStats stats{};
+      REQUIRE(generateStreamed(context, slopeGeom, config, settings, stats));
+      const std::vector<LoadedWindow> windows = loadWindows(context, outputPath, config);
+      requireSeamVerticesShared(windows);
+      // Coarse windows simplify their contours as tightly in world units as fine ones.
+      for (const LoadedWindow &window : windows)
+        REQUIRE(window.maxEdgeError * static_cast<float>(window.unit) == Catch::Approx(config.maxSimplificationError));
+      return windows;
+    };
+    const auto maxUnit = [](const std::vector<LoadedWindow> &windows) {
+      int unit = 0;
+      for (const LoadedWindow &window : windows)
+        unit = std::max(unit, window.unit);
+      return unit;
+    };
+    // Apart from the eroded outline, the polygons cover the whole plane.
+    const auto coversPlane = [&](const std::vector<LoadedWindow> &windows) {
+      long long area = 0;
+      for (const LoadedWindow &window : windows)
+        area += window.area;
+      return area > static_cast<long long>(config.width) * config.height * 9 / 10;
+    };
+    const std::vector<LoadedWindow> steep = buildSlope(40.0f);
+    REQUIRE(maxUnit(steep) == 2);
+    REQUIRE(coversPlane(steep));
+    const std::vector<LoadedWindow> gentle = buildSlope(20.0f);
+    REQUIRE(maxUnit(gentle) == 4);
+    REQUIRE(coversPlane(gentle));
+  }
+}
+
+TEST_CASE("rcCreateChunkyTriMesh", "[recastcli]") {
+  std::vector<float> verts;
+  std::vector<int> tris;
+  // Enough triangles for the top levels of the tree to be built on their own threads.
+  buildTriangleSoup(40000, 1, verts, tris);
+  const int triCount = static_cast<int>(tris.size() / 3);
+  const int trisPerChunk = 256;
+  rcChunkyTriMesh chunkyMesh;
+  REQUIRE(rcCreateChunkyTriMesh(verts.data(), tris.data(), triCount, trisPerChunk, &chunkyMesh, 1));
+
+  SECTION("Puts every triangle in one leaf that bounds it") {
+    REQUIRE(chunkyMesh.ntris == triCount);
+    std::vector<int> leafCounts(static_cast<std::size_t>(triCount), 0);
+    for (int i = 0; i < chunkyMesh.nnodes; ++i) {
+      const rcChunkyTriMeshNode &node = chunkyMesh.nodes[i];
+      if (node.i < 0)
+        continue;
+      REQUIRE(node.n <= trisPerChunk);
+      REQUIRE(node.n <= chunkyMesh.maxTrisPerChunk);
+      bool bounded = true;
+      for (int j = 0; j < node.n; ++j) {
+        const int *tri = &chunkyMesh.tris[(node.i + j) * 3];
+        // Every triangle of the soup has its own vertices, so its first vertex identifies it.
+        leafCounts[static_cast<std::size_t>(tri[0] / 3)]++;
+        for (int k = 0; k < 3; ++k) {
+          const float *v = &verts[tri[k] * 3];
+          bounded = bounded && tri[k] == tri[0] + k && v[0] >= node.bmin[0] && v[0] <= node.bmax[0] && v[2] >= node.bmin[1] && v[2] <= node.bmax[1];
+        }
+      }
+      REQUIRE(bounded);
+    }
+    REQUIRE(std::all_of(leafCounts.begin(), leafCounts.end(), [](const int count) { return count == 1; }));
+  }
+
+  SECTION("Builds the same tree on any number of threads") {
+    rcChunkyTriMesh threaded;
+    REQUIRE(rcCreateChunkyTriMesh(verts.data(), tris.data(), triCount, trisPerChunk, &threaded, 4));
+    REQUIRE(threaded.nnodes == chunkyMesh.nnodes);
+    REQUIRE(threaded.maxTrisPerChunk == chunkyMesh.maxTrisPerChunk);
+    for (int i = 0; i < chunkyMesh.nnodes; ++i) {
+      const rcChunkyTriMeshNode &a = chunkyMesh.nodes[i];
+      const rcChunkyTriMeshNode &b = threaded.nodes[i];
+      REQUIRE((a.i == b.i && a.n == b.n && a.bmin[0] == b.bmin[0] && a.bmin[1] == b.bmin[1] && a.bmax[0] == b.bmax[0] && a.bmax[1] == b.bmax[1]));
+    }
+    REQUIRE(std::equal(chunkyMesh.tris, chunkyMesh.tris + triCount * 3, threaded.tris));
+  }
+
+  std::vector<int> ids(static_cast<std::size_t>(chunkyMesh.nnodes));
+  std::uint32_t seed = 2;
+
+  SECTION("Finds the chunks overlapping a rect like a loop over all leaves") {
+    for (int query = 0; query < 100; ++query) {
+      float rectMin[2] = {nextRandom(seed) * 110.0f - 5.0f, nextRandom(seed) * 110.0f - 5.0f};
+      float rectMax[2] = {rectMin[0] + nextRandom(seed) * 20.0f, rectMin[1] + nextRandom(seed) * 20.0f};
+      const int count = rcGetChunksOverlappingRect(&chunkyMesh, rectMin, rectMax, ids.data(), static_cast<int>(ids.size()));
+      const std::set<int> found(ids.begin(), ids.begin() + count);
+      REQUIRE(found.size() == static_cast<std::size_t>(count));
+
+      std::set<int> expected;
+      for (int i = 0; i < chunkyMesh.nnodes; ++i) {
+        const rcChunkyTriMeshNode &node = chunkyMesh.nodes[i];
+        if (node.i >= 0 && node.bmin[0] <= rectMax[0] && node.bmax[0] >= rectMin[0] && node.bmin[1] <= rectMax[1] && node.bmax[1] >= rectMin[1])
+          expected.insert(i);
+      }
+      REQUIRE(found == expected);
+
+      // Every triangle that overlaps the rect is in one of the chunks found.
+      std::vector<bool> inFound(static_cast<std::size_t>(triCount), false);
+      for (const int id : found) {
+        const rcChunkyTriMeshNode &node = chunkyMesh.nodes[id];
+        for (int j = 0; j < node.n; ++j)
+          inFound[static_cast<std::size_t>(chunkyMesh.tris[(node.i + j) * 3] / 3)] = true;
+      }
+      int missed = 0;
+      for (int i = 0; i < triCount; ++i)
+        missed += triOverlapsRect(verts.data(), &tris[i * 3], rectMin, rectMax) && !inFound[static_cast<std::size_t>(i)] ? 1 : 0;
+      REQUIRE(missed == 0);
+    }
+  }
+
+  SECTION("Finds the chunks overlapping a segment like a loop over all leaves") {
+    for (int query = 0; query < 200; ++query) {
+      float p[2] = {nextRandom(seed) * 110.0f - 5.0f, nextRandom(seed) * 110.0f - 5.0f};
+      float q[2] = {nextRandom(seed) * 110.0f - 5.0f, nextRandom(seed) * 110.0f - 5.0f};
+      // Some segments run along an axis.
+      if (query % 5 == 0)
+        q[query % 2] = p[query % 2];
+      const int count = rcGetChunksOverlappingSegment(&chunkyMesh, p, q, ids.data(), static_cast<int>(ids.size()));
+      const std::set<int> found(ids.begin(), ids.begin() + count);
+      REQUIRE(found.size() == static_cast<std::size_t>(count));
+
+      // Every leaf that contains a point of the segment is found, and no leaf outside the bounds of the segment.
+      const float segMin[2] = {std::min(p[0], q[0]), std::min(p[1], q[1])};
+      const float segMax[2] = {std::max(p[0], q[0]), std::max(p[1], q[1])};
+      int wrong = 0;
+      for (int i = 0; i < chunkyMesh.nnodes; ++i) {
+        const rcChunkyTriMeshNode &node = chunkyMesh.nodes[i];
+        if (node.i < 0)
+          continue;
+        const bool inSegmentBounds = node.bmin[0] <= segMax[0] && node.bmax[0] >= segMin[0] && node.bmin[1] <= segMax[1] && node.bmax[1] >= segMin[1];
+        bool containsPoint = false;
+        for (int k = 0; k <= 256 && inSegmentBounds && !containsPoint; ++k) {
+          const float t = static_cast<float>(k) / 256.0f;
+          const float x = p[0] + (q[0] - p[0]) * t, z = p[1] + (q[1] - p[1]) * t;
+          containsPoint = x >= node.bmin[0] && x <= node.bmax[0] && z >= node.bmin[1] && z <= node.bmax[1];
+        }
+        wrong += (!inSegmentBounds && found.count(i) != 0) || (containsPoint && found.count(i) == 0) ? 1 : 0;
+      }
+      REQUIRE(wrong == 0);
+    }
+  }
+}
+
+TEST_CASE("InputGeom::raycastMesh", "[recastcli]") {
+  TempDirectory directory{"recast_raycast_test"};
+  const fs::path objPath = directory.path / "soup.obj";
+  {
+    std::vector<float> verts;
+    std::vector<int> tris;
+    buildTriangleSoup(2000, 3, verts, tris);
+    std::ofstream file{objPath};
+    for (std::size_t i = 0; i < verts.size(); i += 3)
+      file << "v " << verts[i + 0] << ' ' << verts[i + 1] << ' ' << verts[i + 2] << '\n';
+    for (std::size_t i = 0; i < tris.size(); i += 3)
+      file << "f " << tris[i + 0] + 1 << ' ' << tris[i + 1] + 1 << ' ' << tris[i + 2] + 1 << '\n';
+  }
+
+  rcContext context;
+  InputGeom geom;
+  REQUIRE(geom.load(&context, objPath.string()));
+
+  // Casts rays between random points in and around the soup, half of them straight down, and compares them with a
+  // loop over all triangles.
+  const auto requireSameHits = [&](const int rayCount) {
+    std::uint32_t seed = 4;
+    int hitCount = 0, mismatches = 0;
+    for (int ray = 0; ray < rayCount; ++ray) {
+      float src[3], dst[3];
+      for (int k = 0; k < 3; ++k) {
+        src[k] = nextRandom(seed) * 110.0f - 5.0f;
+        dst[k] = nextRandom(seed) * 110.0f - 5.0f;
+      }
+      src[1] = src[1] * 0.2f - 5.0f;
+      dst[1] = dst[1] * 0.2f - 5.0f;
+      if (ray % 2 == 0) {
+        src[1] = 20.0f;
+        dst[0] = src[0];
+        dst[1] = -10.0f;
+        dst[2] = src[2];
+      }
+      float t = 0.0f, expectedT = 0.0f;
+      const bool hit = geom.raycastMesh(src, dst, t);
+      const bool expectedHit = raycastAllTriangles(*geom.getMesh(), src, dst, expectedT);
+      if (hit != expectedHit || (hit && std::fabs(t - expectedT) > 1e-5f))
+        mismatches++;
+      hitCount += hit ? 1 : 0;
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(hitCount > rayCount / 20);
+  };
+
+  SECTION("Finds the closest hit like a loop over all triangles") {
+    requireSameHits(20000);
+  }
+
+  SECTION("Casts against the cleaned up mesh") {
+    // The first ray builds the raycast packets of the loaded mesh, which the cleanup replaces.
+    requireSameHits(100);
+    InputCleanupSettings settings{};
+    settings.weldDistance = 0.5f;
+    for (int i = 0; i < 3; ++i) {
+      settings.boundsMin[i] = 20.0f;
+      settings.boundsMax[i] = 80.0f;
+    }
+    settings.boundsMin[1] = -10.0f;
+    InputCleanupStats stats{};
+    REQUIRE(geom.cleanupMesh(&context, settings, stats));
+    REQUIRE(stats.outputTris < stats.inputTris);
+    requireSameHits(5000);
+  }
+}
+
+TEST_CASE("InputGeom::cleanupMesh", "[recastcli]") {
+  TempDirectory directory{"recast_cleanup_test"};
+  const fs::path objPath = directory.path / "cleanup.obj";
+  writeFile(objPath,
+            // A floor quad, preceded by the downward facing twin of its first triangle and followed by a rotated duplicate.
+            "v 0 0 0\nv 0 0 1\nv 1 0 0\nv 1 0 1\n"
+            "f 1 3 2\nf 1 2 3\nf 3 2 4\nf 2 3 1\n"
+            // A vertex that welds into the third one, and a triangle that collapses with it.
+            "v 1.0001 0 0\nf 3 5 4\n"
+            // A triangle without area.
+            "v 2 0 0\nf 1 3 6\n"
+            // A sliver thinner than the weld distance, which still has area.
+            "v 0 1 2\nv 1 1 2.005\nv 2 1 2\nf 7 8 9\n"
+            // A triangle out of bounds.
+            "v 100 0 0\nv 100 0 1\nv 101 0 0\nf 10 11 12\n"
+            // A downward facing triangle without a floor below it, and one above the floor quad.
+            "v 5 2 5\nv 6 2 5\nv 5 2 6\nf 13 14 15\n"
+            "v 0 2 0\nv 1 2 0\nv 0 2 1\nf 16 17 18\n");
+
+  rcContext context;
+  InputGeom geom;
+  REQUIRE(geom.load(&context, objPath.string()));
+
+  InputCleanupSettings settings{};
+  settings.weldDistance = 0.01f;
+  for (int i = 0; i < 3; ++i) {
+    settings.boundsMin[i] = -10.0f;
+    settings.boundsMax[i] = 10.0f;
+  }
+
+  // The floor triangles face up when their normal points up.
+  const auto countFloorTris = [&geom]() {
+    const float *verts = geom.getMesh()->getVerts();
+    const int *tris = geom.getMesh()->getTris();
+    int count = 0;
+    for (int i = 0; i < geom.getMesh()->getTriCount(); ++i) {
+      const float *va = &verts[tris[i * 3 + 0] * 3];
+      const float *vb = &verts[tris[i * 3 + 1] * 3];
+      const float *vc = &verts[tris[i * 3 + 2] * 3];
+      float e0[3], e1[3], n[3];
+      rcVsub(e0, vb, va);
+      rcVsub(e1, vc, va);
+      rcVcross(n, e0, e1);
+      count += va[1] == 0.0f && vb[1] == 0.0f && vc[1] == 0.0f && n[1] > 0.0f ? 1 : 0;
+    }
+    return count;
+  };
+
+  SECTION("Counts each dropped triangle once") {
+    settings.cullBackFaces = false;
+    InputCleanupStats stats{};
+    REQUIRE(geom.cleanupMesh(&context, settings, stats));
+    REQUIRE(stats.inputVerts == 18);
+    REQUIRE(stats.inputTris == 10);
+    REQUIRE(stats.weldedVerts == 1);
+    REQUIRE(stats.degenerateTris == 2);
+    REQUIRE(stats.duplicateTris == 1);
+    REQUIRE(stats.outOfBoundsTris == 1);
+    REQUIRE(stats.backFaceTris == 0);
+    REQUIRE(stats.outputTris == 6);
+    REQUIRE(stats.outputVerts == 13);
+    REQUIRE(geom.getMesh()->getTriCount() == 6);
+    REQUIRE(countFloorTris() == 2);
+  }
+
+  SECTION("Culls the back faces without a floor below them") {
+    settings.cullBackFaces = true;
+    InputCleanupStats stats{};
+    REQUIRE(geom.cleanupMesh(&context, settings, stats));
+    REQUIRE(stats.duplicateTris == 1);
+    REQUIRE(stats.backFaceTris == 2);
+    REQUIRE(stats.outputTris == 4);
+    REQUIRE(stats.outputVerts == 10);
+    // The floor keeps its upward facing triangle, although its downward facing twin came first.
+    REQUIRE(countFloorTris() == 2);
+  }
+}
+
+TEST_CASE("IncrementalSoloMesh", "[recastcli]") {
+  const float bmin[3] = {0.0f, -1.0f, 0.0f};
+  const float bmax[3] = {20.0f, 3.0f, 20.0f};
+  const rcConfig config = makeSoloConfig(bmin, bmax);
+  const int filterFlags = RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS | RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS;
+  rcContext context;
+
+  SECTION("Rebuilds edits with the walkable area of a full build") {
+    const FloorWithBox before{4.0f, 4.0f};
+    IncrementalSoloMesh incremental;
+    REQUIRE(incremental.build(context, config, filterFlags, before.verts.data(), before.getVertCount(), before.tris.data(), before.getTriCount(), nullptr, 0));
+    // Move the box around, each time within the bounds of its old and new place.
+    const float boxCorners[][2] = {{12.0f, 6.0f}, {4.0f, 4.0f}, {8.0f, 14.0f}, {9.0f, 13.0f}};
+    float boxX = 4.0f;
+    float boxZ = 4.0f;
+    for (const auto &corner : boxCorners) {
+      const FloorWithBox after{corner[0], corner[1]};
+      const float changedBMin[3] = {std::min(boxX, corner[0]), 0.0f, std::min(boxZ, corner[1])};
+      const float changedBMax[3] = {std::max(boxX, corner[0]) + 2.0f, 2.0f, std::max(boxZ, corner[1]) + 2.0f};
+      REQUIRE(incremental.rebuild(context, after.verts.data(), after.getVertCount(), after.tris.data(), after.getTriCount(), nullptr, 0, changedBMin, changedBMax));
+
+      IncrementalSoloMesh full;
+      REQUIRE(full.build(context, config, filterFlags, after.verts.data(), after.getVertCount(), after.tris.data(), after.getTriCount(), nullptr, 0));
+      const rcPolyMesh &mesh = *incremental.getPolyMesh();
+      REQUIRE(incremental.getPolyMeshDetail()->nmeshes == mesh.npolys);
+      requireMutualLinks(mesh);
+      // The regions are cut differently, but cover the same floor.
+      const long long area = polyMeshDoubleArea(mesh);
+      const long long fullArea = polyMeshDoubleArea(*full.getPolyMesh());
+      REQUIRE(std::llabs(area - fullArea) * 100 < fullArea);
+      REQUIRE(polyMeshContains(mesh, (boxX + 1.0f) / config.cs, (boxZ + 1.0f) / config.cs) == polyMeshContains(*full.getPolyMesh(), (boxX + 1.0f) / config.cs, (boxZ + 1.0f) / config.cs));
+      REQUIRE_FALSE(polyMeshContains(mesh, (corner[0] + 1.0f) / config.cs, (corner[1] + 1.0f) / config.cs));
+      boxX = corner[0];
+      boxZ = corner[1];
+    }
+  }
+
+  SECTION("Leaves the polygons away from an edit unchanged") {
+    // A separate island next to the floor, which no region of the floor reaches.
+    const float wideBMax[3] = {32.0f, 3.0f, 20.0f};
+    const rcConfig wideConfig = makeSoloConfig(bmin, wideBMax);
+    const auto addIsland = [](FloorWithBox &geometry) {
+      const int base = geometry.getVertCount();
+      const float islandVerts[] = {24, 0, 0, 24, 0, 20, 32, 0, 0, 32, 0, 20};
+      geometry.verts.insert(geometry.verts.end(), islandVerts, islandVerts + 12);
+      for (const int v : {0, 1, 2, 2, 1, 3})
+        geometry.tris.push_back(base + v);
+    };
+    FloorWithBox before{4.0f, 4.0f};
+    addIsland(before);
+    FloorWithBox after{4.0f, 12.0f};
+    addIsland(after);
+
+    IncrementalSoloMesh incremental;
+    REQUIRE(incremental.build(context, wideConfig, filterFlags, before.verts.data(), before.getVertCount(), before.tris.data(), before.getTriCount(), nullptr, 0));
+    const float islandX = 23.0f / wideConfig.cs;
+    const auto islandPolys = [&](const bool onIsland) {
+      const rcPolyMesh &mesh = *incremental.getPolyMesh();
+      std::vector<std::vector<float>> polys;
+      for (int i = 0; i < mesh.npolys; ++i) {
+        if ((mesh.verts[mesh.polys[i * 2 * mesh.nvp] * 3] > islandX) == onIsland)
+          polys.push_back(polyWithDetail(mesh, *incremental.getPolyMeshDetail(), i));
+      }
+      return polys;
+    };
+    const std::vector<std::vector<float>> islandBefore = islandPolys(true);
+    const std::vector<std::vector<float>> floorBefore = islandPolys(false);
+    REQUIRE_FALSE(islandBefore.empty());
+
+    const float changedBMin[3] = {4.0f, 0.0f, 4.0f};
+    const float changedBMax[3] = {6.0f, 2.0f, 14.0f};
+    REQUIRE(incremental.rebuild(context, after.verts.data(), after.getVertCount(), after.tris.data(), after.getTriCount(), nullptr, 0, changedBMin, changedBMax));
+    requireMutualLinks(*incremental.getPolyMesh());
+    REQUIRE(islandPolys(false) != floorBefore);
+    // The untouched polygons keep their order ahead of the new ones.
+    const std::vector<std::vector<float>> islandAfter = islandPolys(true);
+    REQUIRE(islandAfter == islandBefore);
+    const rcPolyMesh &mesh = *incremental.getPolyMesh();
+    for (int i = 0; i < static_cast<int>(islandBefore.size()); ++i)
+      REQUIRE(polyWithDetail(mesh, *incremental.getPolyMeshDetail(), i) == islandBefore[i]);
+  }
+
+  SECTION("Fails to rebuild before a build") {
+    const FloorWithBox box{4.0f, 4.0f};
+    IncrementalSoloMesh incremental;
+    REQUIRE_FALSE(incremental.rebuild(context, box.verts.data(), box.getVertCount(), box.tris.data(), box.getTriCount(), nullptr, 0, bmin, bmax));
+  }
+}
+
+TEST_CASE("TimeSlicedSoloMesh", "[recastcli]") {
+  const float bmin[3] = {0.0f, -1.0f, 0.0f};
+  const float bmax[3] = {20.0f, 3.0f, 20.0f};
+  const rcConfig config = makeSoloConfig(bmin, bmax);
+  const int filterFlags = RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS | RC_FILTER_WALKABLE_LOW_HEIGHT_SPANS;
+  const FloorWithBox box{8.0f, 8.0f};
+  rcContext context;
+
+  SECTION("Builds the same mesh as a build in one call") {
+    IncrementalSoloMesh oneShot;
+    REQUIRE(oneShot.build(context, config, filterFlags, box.verts.data(), box.getVertCount(), box.tris.data(), box.getTriCount(), nullptr, 0));
+
+    TimeSlicedSoloMesh sliced;
+    sliced.init(context, config, filterFlags, box.verts.data(), box.getVertCount(), box.tris.data(), box.getTriCount(), nullptr, 0);
+    // Without a budget every step runs a single batch. Count the batches of each stage.
+    int stageSteps[static_cast<int>(SoloMeshStage::Failed) + 1] = {};
+    for (;;) {
+      const SoloMeshStage stage = sliced.getStage();
+      const bool finished = sliced.step(0);
+      ++stageSteps[static_cast<int>(stage)];
+      if (finished)
+        break;
+    }
+    REQUIRE(sliced.getStage() == SoloMeshStage::Done);
+    // The stages after area marking are split too: the start of the build, then the batches.
+    REQUIRE(stageSteps[static_cast<int>(SoloMeshStage::BuildDistanceField)] > 2);
+    REQUIRE(stageSteps[static_cast<int>(SoloMeshStage::BuildRegions)] > 2);
+    REQUIRE(stageSteps[static_cast<int>(SoloMeshStage::BuildContours)] > 2);
+
+    REQUIRE(oneShot.getPolyMesh()->npolys > 0);
+    requireEqualMeshes(*sliced.getPolyMesh(), *oneShot.getPolyMesh(), *sliced.getPolyMeshDetail(), *oneShot.getPolyMeshDetail());
+  }
+
+  SECTION("Reports no mesh before the build is done") {
+    TimeSlicedSoloMesh sliced;
+    sliced.init(context, config, filterFlags, box.verts.data(), box.getVertCount(), box.tris.data(), box.getTriCount(), nullptr, 0);
+    REQUIRE_FALSE(sliced.step(0));
+    REQUIRE(sliced.getPolyMesh() == nullptr);
+  }
+}
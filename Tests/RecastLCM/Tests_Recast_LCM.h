@@ -73,7 +73,9 @@ const char header[] =
     "Build Regions Filter (ms),"
     "Build Layers (ms),"
     "Build Polymesh Detail (ms),"
-    "Merge Polymesh Details (ms)";
+    "Merge Polymesh Details (ms),"
+    "Mark Area Volumes (ms),"
+    "Filter Spans (ms)";
 
 struct Vertex {
   int x;